@@ -0,0 +1,350 @@
+/**
+ * @file AuditLog.cpp
+ * @brief Implements the asynchronous, rotating audit log of executed commands.
+ * @author Nikol Grigoryan
+ */
+#include "AuditLog.h"
+#include <QDateTime>
+#include <QFileInfo>
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+/**
+ * @brief Appends a field with tabs, newlines and backslashes escaped so it stays on one line.
+ */
+void appendEscaped(QByteArray& out, const QString& field)
+{
+    const QByteArray utf8 = field.toUtf8();
+    for (const char c : utf8) {
+        switch (c) {
+        case '\\': out += "\\\\"; break;
+        case '\t': out += "\\t"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        default: out += c; break;
+        }
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Allocates the ring once; it is reused by every log opened on this object.
+ */
+AuditLog::AuditLog()
+    : m_slots(new Slot[kQueueCapacity])
+{
+    static_assert((kQueueCapacity & (kQueueCapacity - 1)) == 0, "kQueueCapacity must be a power of two");
+    for (int i = 0; i < kQueueCapacity; ++i) {
+        m_slots[i].sequence.store(static_cast<quint64>(i), std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Flushes and joins the writer.
+ */
+AuditLog::~AuditLog()
+{
+    close();
+}
+
+/**
+ * @brief Opens the file on the caller's thread so errors are reported synchronously, then starts the writer.
+ */
+bool AuditLog::open(const Options& options, QString& error)
+{
+    close();
+    m_options = options;
+    m_options.keepFiles = std::max(1, m_options.keepFiles);
+    if (!openFile()) {
+        error = QString("Cannot open audit log %1: %2").arg(m_options.path, m_file.errorString());
+        return false;
+    }
+
+    m_recorded.store(0);
+    m_written.store(0);
+    m_dropped.store(0);
+    m_blocked.store(0);
+    m_bytes.store(0);
+    m_rotations.store(0);
+    m_writeErrors.store(0);
+    {
+        std::lock_guard<std::mutex> lock(m_errorMutex);
+        m_lastError.clear();
+    }
+
+    // Reserved capacity survives resize(0), so the writer reuses both buffers
+    m_buffer.reserve(kWriteBufferBytes + 4096);
+    m_line.reserve(256);
+    m_stopping.store(false);
+    m_open.store(true, std::memory_order_release);
+    m_writer = std::thread(&AuditLog::writeLoop, this);
+    return true;
+}
+
+/**
+ * @brief Refuses new records, lets the writer drain the ring and joins it.
+ */
+void AuditLog::close()
+{
+    if (!m_writer.joinable()) return;
+    m_open.store(false, std::memory_order_release);
+    m_stopping.store(true);
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_wake.notify_one();
+    }
+    m_writer.join();
+    m_file.close();
+}
+
+/**
+ * @brief Copies the result into the ring and wakes the writer if it sleeps.
+ */
+void AuditLog::record(qint64 timestampMs, const QString& op, const QString& name, bool ok, qint64 latencyNs,
+                      const QString& message)
+{
+    if (!isOpen()) return;
+
+    Record record;
+    record.timestampMs = timestampMs;
+    record.latencyNs = latencyNs;
+    record.op = op;
+    record.name = name;
+    record.ok = ok;
+    if (!ok) record.message = message;
+
+    if (!tryPush(record)) {
+        if (m_options.policy == OverloadPolicy::Drop) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        m_blocked.fetch_add(1, std::memory_order_relaxed);
+        while (!tryPush(record)) {
+            if (!isOpen()) return;
+            std::this_thread::yield();
+        }
+    }
+    m_recorded.fetch_add(1, std::memory_order_relaxed);
+
+    // Pairs with the writer's store to m_writerSleeping: either it sees the record or we see it asleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_writerSleeping.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_wake.notify_one();
+    }
+}
+
+/**
+ * @brief Claims the next free slot with a compare-and-swap on the enqueue position.
+ */
+bool AuditLog::tryPush(Record& record)
+{
+    quint64 pos = m_enqueuePos.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+    for (;;) {
+        slot = &m_slots[pos & (kQueueCapacity - 1)];
+        const quint64 sequence = slot->sequence.load(std::memory_order_acquire);
+        const qint64 diff = static_cast<qint64>(sequence - pos);
+        if (diff == 0) {
+            if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            return false; // The writer has not consumed this slot's previous lap yet
+        } else {
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    slot->record = std::move(record);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Takes the oldest published record; writer thread only.
+ */
+bool AuditLog::tryPop(Record& record)
+{
+    Slot& slot = m_slots[m_dequeuePos & (kQueueCapacity - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != m_dequeuePos + 1) return false;
+    record = std::move(slot.record);
+    slot.record = Record{};
+    slot.sequence.store(m_dequeuePos + kQueueCapacity, std::memory_order_release);
+    ++m_dequeuePos;
+    return true;
+}
+
+/**
+ * @brief Formats everything queued, writes it in large chunks and sleeps when idle.
+ */
+void AuditLog::writeLoop()
+{
+    Record record;
+    for (;;) {
+        bool any = false;
+        while (tryPop(record)) {
+            any = true;
+            appendLine(record);
+            if (m_buffer.size() >= kWriteBufferBytes) writeBuffer();
+        }
+        if (any) {
+            writeBuffer();
+            m_file.flush();
+            continue;
+        }
+
+        if (m_stopping.load()) break;
+        if (rotationDue(0)) rotate();
+
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_writerSleeping.store(true, std::memory_order_seq_cst);
+        // Re-check after announcing sleep so a record published meanwhile is not missed
+        const Slot& next = m_slots[m_dequeuePos & (kQueueCapacity - 1)];
+        if (next.sequence.load(std::memory_order_seq_cst) != m_dequeuePos + 1 && !m_stopping.load()) {
+            m_wake.wait_for(lock, std::chrono::milliseconds(kIdleWaitMs));
+        }
+        m_writerSleeping.store(false, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Formats one record, rotating first when the line would not fit in the current file.
+ */
+void AuditLog::appendLine(const Record& record)
+{
+    const qint64 second = record.timestampMs / 1000;
+    if (second != m_stampSecond) {
+        m_stampSecond = second;
+        m_stampPrefix = QDateTime::fromMSecsSinceEpoch(second * 1000).toUTC()
+                            .toString("yyyy-MM-ddThh:mm:ss").toLatin1();
+    }
+
+    m_line.resize(0);
+    m_line += m_stampPrefix;
+    m_line += '.';
+    m_line += QByteArray::number(record.timestampMs % 1000).rightJustified(3, '0');
+    m_line += "Z\t";
+    appendEscaped(m_line, record.op);
+    m_line += '\t';
+    if (record.name.isEmpty()) {
+        m_line += '-';
+    } else {
+        appendEscaped(m_line, record.name);
+    }
+    m_line += record.ok ? "\tOK\t" : "\tERR\t";
+    m_line += QByteArray::number(record.latencyNs / 1000);
+    if (!record.ok) {
+        m_line += '\t';
+        appendEscaped(m_line, record.message);
+    }
+    m_line += '\n';
+
+    // Lines never straddle files: what precedes this line goes to the old file
+    if (rotationDue(m_line.size())) {
+        writeBuffer();
+        rotate();
+    }
+    m_buffer += m_line;
+    m_written.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Writes the pending bytes to the current file.
+ */
+void AuditLog::writeBuffer()
+{
+    if (m_buffer.isEmpty()) return;
+    const qint64 written = m_file.isOpen() ? m_file.write(m_buffer) : -1;
+    if (written != m_buffer.size()) {
+        fail(QString("Failed to write audit log %1: %2").arg(m_options.path, m_file.errorString()));
+    }
+    if (written > 0) {
+        m_fileBytes += written;
+        m_bytes.fetch_add(written, std::memory_order_relaxed);
+    }
+    m_buffer.resize(0);
+}
+
+/**
+ * @brief Reports whether adding @p incomingBytes to the file and the buffer would exceed the size limit,
+ *        or the file is too old.
+ *
+ * An empty file is never rotated, so a single line larger than the limit still gets written.
+ */
+bool AuditLog::rotationDue(qint64 incomingBytes) const
+{
+    const qint64 bytes = m_fileBytes + m_buffer.size();
+    if (bytes == 0) return false;
+    if (m_options.maxFileBytes > 0 && bytes + incomingBytes > m_options.maxFileBytes) return true;
+    return m_options.rotateIntervalSec > 0
+        && QDateTime::currentMSecsSinceEpoch() - m_fileOpenedMs >= qint64(m_options.rotateIntervalSec) * 1000;
+}
+
+/**
+ * @brief Shifts `path.N` to `path.N+1`, dropping the oldest, moves the current file to `path.1` and reopens.
+ */
+void AuditLog::rotate()
+{
+    m_file.close();
+    const QString& path = m_options.path;
+    const auto rotated = [&path](int n) { return QString("%1.%2").arg(path).arg(n); };
+
+    QFile::remove(rotated(m_options.keepFiles));
+    for (int n = m_options.keepFiles - 1; n >= 1; --n) {
+        if (QFile::exists(rotated(n))) QFile::rename(rotated(n), rotated(n + 1));
+    }
+    if (!QFile::rename(path, rotated(1))) {
+        fail(QString("Failed to rotate audit log %1.").arg(path));
+    }
+    m_rotations.fetch_add(1, std::memory_order_relaxed);
+
+    if (!openFile()) {
+        fail(QString("Cannot reopen audit log %1: %2").arg(path, m_file.errorString()));
+    }
+}
+
+/**
+ * @brief Opens the current file for appending and picks up its size and age.
+ */
+bool AuditLog::openFile()
+{
+    m_file.setFileName(m_options.path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) return false;
+    m_fileBytes = m_file.size();
+
+    // An existing file keeps its age so time-based rotation is not reset by reopening it
+    const QDateTime born = QFileInfo(m_file).birthTime();
+    m_fileOpenedMs = (m_fileBytes > 0 && born.isValid()) ? born.toMSecsSinceEpoch()
+                                                         : QDateTime::currentMSecsSinceEpoch();
+    return true;
+}
+
+/**
+ * @brief Counts a write error and keeps its message for `stats()`.
+ */
+void AuditLog::fail(const QString& error)
+{
+    m_writeErrors.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(m_errorMutex);
+    m_lastError = error;
+}
+
+/**
+ * @brief Reads every counter with relaxed loads.
+ */
+AuditLog::Stats AuditLog::stats() const
+{
+    Stats s;
+    s.recorded = m_recorded.load(std::memory_order_relaxed);
+    s.written = m_written.load(std::memory_order_relaxed);
+    s.dropped = m_dropped.load(std::memory_order_relaxed);
+    s.blocked = m_blocked.load(std::memory_order_relaxed);
+    s.bytes = m_bytes.load(std::memory_order_relaxed);
+    s.rotations = m_rotations.load(std::memory_order_relaxed);
+    s.writeErrors = m_writeErrors.load(std::memory_order_relaxed);
+    s.depth = static_cast<int>(std::max<qint64>(0, s.recorded - s.written));
+    std::lock_guard<std::mutex> lock(m_errorMutex);
+    s.lastError = m_lastError;
+    return s;
+}
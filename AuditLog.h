@@ -0,0 +1,219 @@
+/**
+ * @file AuditLog.h
+ * @brief Declares the asynchronous, rotating audit log of executed commands.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * @class AuditLog
+ * @brief Persists one line per executed command without writing on the caller's thread.
+ *
+ * `record` copies the result into a slot of a bounded ring (Vyukov's bounded queue: one
+ * compare-and-swap per record, no lock) and returns. A dedicated writer thread formats the
+ * records into a buffer and writes them to the file in batches. Each line is tab-separated:
+ *
+ *     2026-10-17T09:41:07.512Z	create_line	L1	OK	184
+ *     2026-10-17T09:41:07.513Z	connect	-	ERR	12	Shape 'X' not found.
+ *
+ * with the UTC start time, the command name, its `-name` (or `-`), the status, the latency
+ * in microseconds and, for failures, the escaped message.
+ *
+ * The file is rotated when it would exceed `maxFileBytes` or is older than
+ * `rotateIntervalSec`: `path` becomes `path.1`, `path.1` becomes `path.2`, and so on up to
+ * `keepFiles`. When the ring is full, `OverloadPolicy::Drop` discards the record and counts
+ * it, while `OverloadPolicy::Block` makes the caller wait for the writer.
+ */
+class AuditLog
+{
+public:
+    /**
+     * @brief What `record` does when the writer has fallen `kQueueCapacity` records behind.
+     */
+    enum class OverloadPolicy
+    {
+        Drop, ///< Discard the record and count it; the caller never waits.
+        Block ///< Wait for room; nothing is lost, but the caller stalls with the disk.
+    };
+
+    /**
+     * @brief Where and how to write.
+     */
+    struct Options
+    {
+        QString path;                           ///< Current log file; rotated files get `.1`, `.2`, ...
+        qint64 maxFileBytes = 64ll * 1024 * 1024; ///< Rotate before the file grows past this; `0` disables.
+        int rotateIntervalSec = 0;              ///< Rotate files older than this; `0` disables.
+        int keepFiles = 5;                      ///< Rotated files kept besides the current one.
+        OverloadPolicy policy = OverloadPolicy::Drop;
+    };
+
+    /**
+     * @brief Counters of the current log; read without locking, so only approximately consistent.
+     */
+    struct Stats
+    {
+        qint64 recorded = 0;    ///< Records accepted into the ring.
+        qint64 written = 0;     ///< Records written to the file.
+        qint64 dropped = 0;     ///< Records discarded because the ring was full.
+        qint64 blocked = 0;     ///< Records whose caller had to wait for room.
+        qint64 bytes = 0;       ///< Bytes written across all files.
+        qint64 rotations = 0;   ///< Files rotated.
+        qint64 writeErrors = 0; ///< Failed writes, opens or renames.
+        int depth = 0;          ///< Records waiting for the writer.
+        QString lastError;      ///< Most recent write error, if any.
+    };
+
+    /**
+     * @brief Records the ring holds; must be a power of two.
+     */
+    static constexpr int kQueueCapacity = 65536;
+
+    /**
+     * @brief Formatted bytes collected before they are written to the file.
+     */
+    static constexpr int kWriteBufferBytes = 256 * 1024;
+
+    /**
+     * @brief Longest the writer sleeps with nothing to do, which bounds time-based rotation delay.
+     */
+    static constexpr int kIdleWaitMs = 200;
+
+    AuditLog();
+
+    /**
+     * @brief Writes what is queued and stops the writer.
+     */
+    ~AuditLog();
+
+    AuditLog(const AuditLog&) = delete;
+    AuditLog& operator=(const AuditLog&) = delete;
+
+    /**
+     * @brief Opens the log file for appending and starts the writer; closes any open log first.
+     * @param options Destination, rotation limits and overload policy.
+     * @param error Describes why the file cannot be opened.
+     * @return `true` when records are being persisted.
+     */
+    bool open(const Options& options, QString& error);
+
+    /**
+     * @brief Writes every queued record, then stops the writer and closes the file.
+     */
+    void close();
+
+    /**
+     * @brief Reports whether records are being persisted.
+     */
+    bool isOpen() const { return m_open.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Returns the options of the open log.
+     */
+    const Options& options() const { return m_options; }
+
+    /**
+     * @brief Queues one command result; a no-op while the log is closed.
+     *
+     * Thread-safe. Only copies the arguments; formatting and I/O happen on the writer thread.
+     * @param timestampMs Start time in milliseconds since the epoch.
+     * @param op Command name.
+     * @param name Value of the command's `-name`, or empty.
+     * @param ok Whether the command succeeded.
+     * @param latencyNs Execution time.
+     * @param message Result message; only stored for failures.
+     */
+    void record(qint64 timestampMs, const QString& op, const QString& name, bool ok, qint64 latencyNs,
+                const QString& message);
+
+    /**
+     * @brief Returns a snapshot of the counters.
+     */
+    Stats stats() const;
+
+    /**
+     * @brief Returns the bytes of the record ring plus, while open, the writer's line buffer.
+     *
+     * Strings queued in the ring are transient and not counted.
+     */
+    qsizetype usedBytes() const
+    {
+        return qsizetype(kQueueCapacity) * qsizetype(sizeof(Slot)) + (isOpen() ? kWriteBufferBytes : 0);
+    }
+
+private:
+    /**
+     * @brief One queued command result.
+     */
+    struct Record
+    {
+        qint64 timestampMs = 0;
+        qint64 latencyNs = 0;
+        QString op;
+        QString name;
+        QString message;
+        bool ok = false;
+    };
+
+    /**
+     * @brief Ring slot; its sequence number says whether a producer or the writer owns it.
+     */
+    struct Slot
+    {
+        std::atomic<quint64> sequence{0};
+        Record record;
+    };
+
+    bool tryPush(Record& record);
+    bool tryPop(Record& record);
+
+    /**
+     * @brief Writer thread body: drain, format, write and rotate until stopped.
+     */
+    void writeLoop();
+    void appendLine(const Record& record);
+    void writeBuffer();
+    bool rotationDue(qint64 incomingBytes) const;
+    void rotate();
+    bool openFile();
+    void fail(const QString& error);
+
+    Options m_options;
+    std::unique_ptr<Slot[]> m_slots;
+    std::atomic<quint64> m_enqueuePos{0};
+    quint64 m_dequeuePos = 0;                ///< Writer thread only.
+
+    std::atomic<bool> m_open{false};
+    std::atomic<bool> m_stopping{false};
+    std::atomic<bool> m_writerSleeping{false};
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::thread m_writer;
+
+    // Writer thread only while open
+    QFile m_file;
+    QByteArray m_buffer;                     ///< Formatted lines not yet written.
+    QByteArray m_line;                       ///< Line being formatted, reused to avoid allocations.
+    qint64 m_fileBytes = 0;
+    qint64 m_fileOpenedMs = 0;
+    qint64 m_stampSecond = -1;               ///< Second that `m_stampPrefix` formats.
+    QByteArray m_stampPrefix;                ///< `yyyy-MM-ddThh:mm:ss` of `m_stampSecond`.
+
+    std::atomic<qint64> m_recorded{0};
+    std::atomic<qint64> m_written{0};
+    std::atomic<qint64> m_dropped{0};
+    std::atomic<qint64> m_blocked{0};
+    std::atomic<qint64> m_bytes{0};
+    std::atomic<qint64> m_rotations{0};
+    std::atomic<qint64> m_writeErrors{0};
+    mutable std::mutex m_errorMutex;
+    QString m_lastError;
+};
@@ -6,356 +6,2557 @@
 #include "CommandDispatcher.h"
 #include <QFile>
 #include <QTextStream>
-#include "LineShape.h"
-#include "TriangleShape.h"
-#include "RectangleShape.h"
-#include "SquareShape.h"
+#include <QRegularExpression>
+#include <QDateTime>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <memory>
+#include "InstanceShape.h"
+#include "ShapeRequest.h"
+#include "ScriptProgram.h"
+#include "ScriptReader.h"
+#include "ScriptValidator.h"
 #include "Utility.h"
+#include "ConnectorBatchItem.h"
+#include "GraphAnalytics.h"
+#include "ConcurrentNameSet.h"
+#include "Parallel.h"
+
+namespace {
+
+/**
+ * @brief Pen shared by all connectors between shapes.
+ */
+QPen connectorPen()
+{
+    return QPen(Qt::darkGray, 1.5, Qt::DashLine);
+}
+
+/**
+ * @brief Describes the names a connect command could not resolve, listing at most ten.
+ */
+QString unknownObjectsMessage(QStringList missing)
+{
+    missing.removeDuplicates();
+    return QString("%1 unknown object(s), nothing connected: %2%3")
+        .arg(missing.size())
+        .arg(QStringList(missing.mid(0, 10)).join(", "))
+        .arg(missing.size() > 10 ? ", ..." : "");
+}
+
+/**
+ * @brief Script line parsed, and for independent `create_*` lines fully built, off the GUI thread.
+ */
+struct PreparedLine
+{
+    Command cmd;                      ///< Parsed command.
+    QString parseError;               ///< Set when the line does not parse.
+    bool skipped = false;             ///< Blank or comment line.
+    bool parsed = false;              ///< `cmd` is valid.
+    ShapeRequest request;             ///< Validated geometry of a `create_*` line.
+    std::unique_ptr<ShapeBase> shape; ///< Shape built ahead of time; only set for independent creates.
+};
+
+/**
+ * @brief Parses a window of script lines in parallel and pre-builds the shapes that cannot conflict.
+ *
+ * The dependency analysis is per name: a valid `create_*` is independent when its name is
+ * not in the repository and no earlier line of the window defines it, and no `delete` or
+ * nested `execute_file` (which may remove names) comes before it. Such a line is certain
+ * to succeed when committed in order, so its vertices and graphics item are built here.
+ * Every other line keeps only its parsed command and runs through the normal dispatcher.
+ * @param lines Lines of the window.
+ * @param out Receives one entry per line of the window.
+ * @param repo Repository as it is before the window is committed; only read.
+ */
+void prepareWindow(const QStringList& lines, std::vector<PreparedLine>& out, const ShapeRepository& repo)
+{
+    const int count = static_cast<int>(out.size());
+    ConcurrentNameSet defined;
+    std::vector<int> barriers(Parallel::workerCount(), INT_MAX);
+
+    // Parse every line and record which line first defines each name
+    Parallel::forRanges(count, [&](int first, int last, int worker) {
+        for (int i = first; i < last; ++i) {
+            PreparedLine& line = out[i];
+            const QString& raw = lines[i];
+            line.skipped = ScriptValidator::isSkipped(raw);
+            if (line.skipped) continue;
+            line.parsed = CommandParser().parse(raw, line.cmd, line.parseError);
+            if (!line.parsed) continue;
+
+            if (line.cmd.name == "delete" || line.cmd.name == "execute_file") {
+                barriers[worker] = std::min(barriers[worker], i);
+            } else if (ShapeRequest::isCreateCommand(line.cmd.name)) {
+                QString name, error;
+                if (ShapeRequest::readName(line.cmd, name, error)
+                    && ShapeRequest::fromCommand(line.cmd, name, line.request, error)) {
+                    defined.claim(name, i);
+                }
+            }
+        }
+    }, 256);
+    const int barrier = std::min(count, *std::min_element(barriers.begin(), barriers.end()));
+
+    // Build the independent creates; the repository is not modified until the window commits
+    Parallel::forRanges(barrier, [&](int first, int last, int) {
+        for (int i = first; i < last; ++i) {
+            PreparedLine& line = out[i];
+            const QString& name = line.request.name;
+            if (name.isEmpty() || defined.firstLine(name) != i || repo.contains(name)) continue;
+            line.shape.reset(line.request.build());
+        }
+    }, 256);
+}
+
+} // namespace
+
+/**
+ * @brief State of a script between slices: its reader, the prepared window and the tallies so far.
+ */
+struct CommandDispatcher::ScriptRun
+{
+    /**
+     * @brief What the next slice does; each phase before `Run` reads one window per step.
+     */
+    enum class Phase
+    {
+        Detect,   ///< Read the first window and look for program syntax.
+        Validate, ///< Check a plain script with `-validate_first`.
+        Load,     ///< Read a program, which is compiled whole.
+        Run,      ///< Execute lines or bytecode.
+    };
+
+    QString path;                    ///< Script file.
+    ScriptReader reader;             ///< Streams the lines of a plain script one window at a time.
+    Phase phase = Phase::Detect;
+    bool validate = false;           ///< Run nothing unless the whole script validates.
+    std::unique_ptr<ScriptValidator::Pass> validation; ///< Validation of a plain script so far.
+    QStringList source;              ///< Lines of a program read so far.
+    int lineCount = 0;               ///< Lines read before the script runs; the whole script once it was validated or compiled.
+    QStringList lines;               ///< Trimmed lines of the current window.
+    int windowSize = kScriptWindow;  ///< Lines prepared at a time.
+    std::vector<PreparedLine> window; ///< Current window.
+    int begin = 0;                   ///< Index of the window's first line.
+    int position = 0;                ///< Next line of the window to commit.
+    int successCount = 0;
+    int failureCount = 0;
+    QString details;                 ///< One entry per failed line.
+    HistoryStep step;                ///< Changes of a background run, pushed as one step when it ends.
+    bool started = false;            ///< A background run has read its script.
+    SceneTransaction transaction;    ///< Transaction opened by the script's own `begin`.
+    qint64 startedMs = 0;            ///< Wall-clock start of a background run, for the audit log.
+    QElapsedTimer clock;             ///< Running time of a background run, across slices.
+    std::unique_ptr<ScriptProgram> program; ///< Compiled script when it uses variables or loops.
+    int pc = 0;                      ///< Next instruction of `program`.
+    std::vector<double> variables;   ///< Variable slots of `program`.
+    std::vector<double> stack;       ///< Value stack of `program`, empty between statements.
+};
+
+/**
+ * @brief Initializes the dispatcher with the graphics scene and repository.
+ * @param scene Scene used to render shapes and connectors.
+ * @param repo Repository that manages shape lifetimes and name lookups.
+ */
+CommandDispatcher::CommandDispatcher(QGraphicsScene* scene, ShapeRepository* repo)
+    : m_scene(scene), m_repo(repo), m_scheduler(kSchedulerSliceMs),
+      m_server([this](const Command& cmd) {
+          CommandResult result;
+          execute(cmd, result);
+          return result;
+      })
+{
+}
+
+/**
+ * @brief Executes a parsed command and formats its feedback.
+ * @param cmd Parsed command structure produced by `CommandParser`.
+ * @param message Output parameter that captures user-facing feedback.
+ * @return `true` when the command completes successfully.
+ */
+bool CommandDispatcher::execute(const Command& cmd, QString& message)
+{
+    CommandResult result;
+    execute(cmd, result);
+    message = result.text();
+    return result.ok;
+}
+
+/**
+ * @brief Executes a parsed command and, while the audit log is open, records its result.
+ * @param cmd Parsed command structure produced by `CommandParser`.
+ * @param result Receives the success flag and the unformatted feedback.
+ * @return `true` when the command completes successfully.
+ */
+bool CommandDispatcher::execute(const Command& cmd, CommandResult& result)
+{
+    if (!m_audit.isOpen()) {
+        result.ok = executeCommand(cmd, result);
+        return result.ok;
+    }
+    const qint64 startedMs = QDateTime::currentMSecsSinceEpoch();
+    QElapsedTimer clock;
+    clock.start();
+    result.ok = executeCommand(cmd, result);
+    m_audit.record(startedMs, cmd.name, cmd.args.value("name"), result.ok, clock.nsecsElapsed(),
+                   result.ok ? QString() : result.text());
+    return result.ok;
+}
+
+/**
+ * @brief Opens a history step for the command and routes it to the matching handler.
+ * @param cmd Parsed command structure produced by `CommandParser`.
+ * @param result Receives the feedback.
+ * @return `true` when the command completes successfully.
+ */
+bool CommandDispatcher::executeCommand(const Command& cmd, CommandResult& result)
+{
+    // Script lines append to the step opened by the enclosing execute_file
+    if (m_recording) {
+        return dispatch(cmd, result);
+    }
+
+    // History navigation never records a step of its own
+    if ((cmd.name == "undo" || cmd.name == "redo") && m_scheduler.isBusy(CommandScheduler::Priority::Background)) {
+        result.message = QString("'%1' is unavailable while a script runs in the background.").arg(cmd.name);
+        return false;
+    } else if ((cmd.name == "undo" || cmd.name == "redo") && m_transaction->isOpen()) {
+        result.message = QString("'%1' is unavailable while a transaction is open; commit or roll back first.").arg(cmd.name);
+        return false;
+    } else if (cmd.name == "undo") {
+        return handleUndo(cmd, result.message);
+    } else if (cmd.name == "redo") {
+        return handleRedo(cmd, result.message);
+    }
+
+    HistoryStep step;
+    step.label = cmd.args.contains("name") ? QString("%1 %2").arg(cmd.name, cmd.args["name"]) : cmd.name;
+    m_recording = &step;
+    const bool ok = dispatch(cmd, result);
+    flushTransforms();
+    m_recording = nullptr;
+    m_history.push(std::move(step));
+    return ok;
+}
+
+/**
+ * @brief Routes a command to the matching handler.
+ * @param cmd Parsed command structure.
+ * @param result Receives the feedback; hot-path handlers set a code and payload instead of text.
+ * @return `true` when the command completes successfully.
+ */
+bool CommandDispatcher::dispatch(const Command& cmd, CommandResult& result)
+{
+    // Coalesced transforms must land before any command that reads or replaces geometry
+    const bool isTransform = cmd.name == "move" || cmd.name == "rotate" || cmd.name == "scale";
+    if (!isTransform) {
+        flushTransforms();
+    }
+
+    // Inside a transaction, commands are staged rather than applied
+    if (m_transaction->isOpen() && cmd.name != "commit" && cmd.name != "rollback") {
+        return stageCommand(cmd, result);
+    }
+
+    // Dispatch based on command name; add more as needed
+    if (ShapeRequest::isCreateCommand(cmd.name)) {
+        return handleCreateShape(cmd, result);
+    } else if (cmd.name == "create_instance") {
+        return handleCreateInstance(cmd, result);
+    } else if (cmd.name == "create_grid") {
+        return handleCreateGrid(cmd, result.message);
+    } else if (cmd.name == "connect") {
+        return handleConnect(cmd, result);
+    } else if (cmd.name == "connect_chain") {
+        return handleConnectChain(cmd, result.message);
+    } else if (cmd.name == "connect_star") {
+        return handleConnectStar(cmd, result.message);
+    } else if (cmd.name == "connect_edges") {
+        return handleConnectEdges(cmd, result.message);
+    } else if (cmd.name == "execute_file") {
+        return handleExecuteFile(cmd, result.message);
+    } else if (cmd.name == "validate_file") {
+        return handleValidateFile(cmd, result.message);
+    } else if (cmd.name == "save") {
+        return handleSave(cmd, result.message);
+    } else if (cmd.name == "autosave") {
+        return handleAutosave(cmd, result.message);
+    } else if (cmd.name == "checkpoint") {
+        return handleCheckpoint(cmd, result.message);
+    } else if (cmd.name == "diff") {
+        return handleDiff(cmd, result.message);
+    } else if (cmd.name == "move") {
+        return handleMove(cmd, result);
+    } else if (cmd.name == "rotate") {
+        return handleRotate(cmd, result);
+    } else if (cmd.name == "scale") {
+        return handleScale(cmd, result);
+    } else if (cmd.name == "disconnect") {
+        return handleDisconnect(cmd, result);
+    } else if (cmd.name == "list_connections") {
+        return handleListConnections(cmd, result.message);
+    } else if (cmd.name == "delete") {
+        return handleDelete(cmd, result);
+    } else if (cmd.name == "history_budget") {
+        return handleHistoryBudget(cmd, result.message);
+    } else if (cmd.name == "reachable") {
+        return handleReachable(cmd, result.message);
+    } else if (cmd.name == "shortest_path") {
+        return handleShortestPath(cmd, result.message);
+    } else if (cmd.name == "component") {
+        return handleComponent(cmd, result.message);
+    } else if (cmd.name == "components") {
+        return handleComponents(cmd, result.message);
+    } else if (cmd.name == "top_degree") {
+        return handleTopDegree(cmd, result.message);
+    } else if (cmd.name == "clear_highlight") {
+        return handleClearHighlight(cmd, result.message);
+    } else if (cmd.name == "queue_stats") {
+        return handleQueueStats(cmd, result.message);
+    } else if (cmd.name == "serve") {
+        return handleServe(cmd, result.message);
+    } else if (cmd.name == "audit_log") {
+        return handleAuditLog(cmd, result.message);
+    } else if (cmd.name == "mem_stats") {
+        return handleMemStats(cmd, result.message);
+    } else if (cmd.name == "begin") {
+        return handleBegin(cmd, result.message);
+    } else if (cmd.name == "commit") {
+        return handleCommit(cmd, result.message);
+    } else if (cmd.name == "rollback") {
+        return handleRollback(cmd, result.message);
+    } else if (cmd.name == "undo" || cmd.name == "redo") {
+        result.message = QString("'%1' cannot be used inside a script.").arg(cmd.name);
+        return false;
+    }
+
+    result.message = QString("Unknown command '%1'.").arg(cmd.name);
+    return false;
+}
+
+/**
+ * @brief Routes a command that may be staged to its handler, which stages instead of applying.
+ * @param cmd Parsed command issued while a transaction is open.
+ * @param result Receives the staged count, or the failure that aborted the transaction.
+ * @return `true` when the command was staged.
+ */
+bool CommandDispatcher::stageCommand(const Command& cmd, CommandResult& result)
+{
+    bool ok = false;
+    if (ShapeRequest::isCreateCommand(cmd.name)) {
+        ok = handleCreateShape(cmd, result);
+    } else if (cmd.name == "connect") {
+        ok = handleConnect(cmd, result);
+    } else if (cmd.name == "connect_chain") {
+        ok = handleConnectChain(cmd, result.message);
+    } else if (cmd.name == "connect_star") {
+        ok = handleConnectStar(cmd, result.message);
+    } else if (cmd.name == "connect_edges") {
+        ok = handleConnectEdges(cmd, result.message);
+    } else if (cmd.name == "begin") {
+        result.message = "A transaction is already open; transactions do not nest.";
+    } else {
+        result.message = QString("'%1' cannot be used inside a transaction.").arg(cmd.name);
+    }
+
+    if (!ok) {
+        const QString reason = result.text();
+        m_transaction->abort(reason);
+        result.code = CommandResult::Code::Text;
+        result.message = QString("%1 The transaction is aborted; commit or rollback discards it.").arg(reason);
+        return false;
+    }
+    result.code = CommandResult::Code::Staged;
+    result.subject = cmd.args.value("name", cmd.name);
+    result.count = m_transaction->addCommand();
+    return true;
+}
+
+/**
+ * @brief Triggers a due autosave and forwards the result of finished background saves.
+ * @param ok Receives the success flag of the reported save.
+ * @param message Receives the save outcome.
+ * @return `true` if a finished save is reported.
+ */
+bool CommandDispatcher::serviceBackgroundTasks(bool& ok, QString& message)
+{
+    // Only autosave when the scene changed since the last save and the interval elapsed
+    if (m_autosaveIntervalMs > 0 && !m_saver.isBusy()
+        && m_autosaveClock.isValid() && m_autosaveClock.elapsed() >= m_autosaveIntervalMs
+        && m_repo->revision() != m_lastSavedRevision) {
+        const SceneSnapshot snap = m_repo->snapshot();
+        if (m_saver.start(snap, m_autosavePath)) {
+            m_lastSavedRevision = m_repo->revision();
+            m_autosaveClock.restart();
+        }
+    }
+    return m_saver.takeResult(ok, message);
+}
+
+/**
+ * @brief Schedules a console command: scripts become background jobs, everything else runs next.
+ * @param cmd Parsed command.
+ * @param report Receives the result; a script also reports when it starts.
+ */
+void CommandDispatcher::submit(const Command& cmd, const std::function<void(const CommandResult&)>& report)
+{
+    if (cmd.name != "execute_file") {
+        m_scheduler.post(CommandScheduler::Priority::Interactive, [this, cmd, report](qint64) {
+            CommandResult result;
+            execute(cmd, result);
+            report(result);
+            return true;
+        });
+        return;
+    }
+
+    // The script is read when its turn comes, so queued scripts see each other's results
+    auto run = std::make_shared<ScriptRun>();
+    run->windowSize = kBackgroundScriptWindow;
+    m_scheduler.post(CommandScheduler::Priority::Background, [this, cmd, report, run](qint64 budgetNs) {
+        CommandResult result;
+        if (!run->started) {
+            run->started = true;
+            run->startedMs = QDateTime::currentMSecsSinceEpoch();
+            run->clock.start();
+            if (!beginScript(cmd, *run, result.message)) {
+                m_audit.record(run->startedMs, cmd.name, QString(), false, run->clock.nsecsElapsed(), result.message);
+                report(result);
+                return true;
+            }
+        }
+
+        // Detection, validation and loading take slices of their own; lines start in the next one
+        if (run->phase != ScriptRun::Phase::Run) {
+            if (!prepareScript(*run, budgetNs, result.message)) {
+                m_audit.record(run->startedMs, cmd.name, QString(), false, run->clock.nsecsElapsed(), result.message);
+                report(result);
+                return true;
+            }
+            if (run->phase == ScriptRun::Phase::Run) {
+                report(CommandResult{ true, run->lineCount > 0
+                                                ? QString("Running script %1 (%2 lines) in the background.")
+                                                      .arg(run->path).arg(run->lineCount)
+                                                : QString("Running script %1 in the background.").arg(run->path) });
+            }
+            return false;
+        }
+
+        // Lines append to the run's own step; commands typed between slices record their own
+        m_recording = &run->step;
+        const bool done = stepScript(*run, budgetNs);
+        flushTransforms();
+        m_recording = nullptr;
+        if (!done) return false;
+
+        run->step.label = cmd.name;
+        m_history.push(std::move(run->step));
+        result.ok = finishScript(*run, result.message);
+        m_audit.record(run->startedMs, cmd.name, QString(), result.ok, run->clock.nsecsElapsed(), result.message);
+        report(result);
+        return true;
+    });
+}
+
+/**
+ * @brief Runs a batch of queued submissions through `execute()` in submission order.
+ * @param maxBatch Upper bound on commands executed by this call.
+ * @param report Receives every command and its result.
+ * @return `true` when more submissions are waiting.
+ */
+bool CommandDispatcher::drainQueue(int maxBatch, const std::function<void(const Command&, const CommandResult&)>& report)
+{
+    m_queue.drain(maxBatch, [this, &report](const Command& cmd) {
+        CommandResult result;
+        execute(cmd, result);
+        if (report) report(cmd, result);
+        return result;
+    });
+    return m_queue.hasPending();
+}
+
+/**
+ * @brief Adds a shape to the scene and repository and records the creation.
+ * @param name Unique shape name.
+ * @param shape Shape whose ownership transfers to the repository.
+ */
+void CommandDispatcher::insertShape(const QString& name, ShapeBase* shape)
+{
+    const ShapeHandle handle = m_repo->add(name, shape);
+    if (handle.isNull()) {
+        delete shape;
+        return;
+    }
+    // Instances share their layer's item, which only the first one adds
+    QGraphicsItem* item = shape->graphicsItem();
+    if (item->scene() != m_scene) m_scene->addItem(item);
+
+    record(shapeDelta(HistoryDelta::Op::CreateShape, handle));
+}
+
+/**
+ * @brief Removes a shape, its incident connectors, and records each removal.
+ * @param name Shape name.
+ * @param removedConnectors Receives the number of removed connectors when non-null.
+ * @return `true` if the shape was found.
+ */
+bool CommandDispatcher::eraseShape(const QString& name, int* removedConnectors)
+{
+    const ShapeHandle handle = m_repo->handle(name);
+    ShapeBase* shape = m_repo->get(handle);
+    if (!shape) return false;
+
+    // Drop attached connectors via the adjacency list rather than scanning scene items
+    const QVector<int> edges = m_repo->connections().incident(handle);
+    for (int id : edges) disconnectEdge(id);
+    if (removedConnectors) *removedConnectors = edges.size();
+
+    record(shapeDelta(HistoryDelta::Op::DeleteShape, handle));
+
+    // Deleting the shape deletes its item, which detaches it from the scene
+    delete m_repo->take(handle);
+    return true;
+}
+
+/**
+ * @brief Connects two shapes and records the connection.
+ * @param s1 First shape.
+ * @param s2 Second shape.
+ */
+void CommandDispatcher::connectShapes(ShapeBase* s1, ShapeBase* s2)
+{
+    auto* item = m_scene->addLine(QLineF(s1->center(), s2->center()), connectorPen());
+    m_repo->connections().add(s1->handle(), s2->handle(), item);
+
+    HistoryDelta delta;
+    delta.op = HistoryDelta::Op::Connect;
+    delta.shape.name = m_repo->name(s1->handle());
+    delta.other = m_repo->name(s2->handle());
+    record(std::move(delta));
+}
+
+/**
+ * @brief Resolves all endpoints, then draws every connector through one batch item.
+ * @param pairs Endpoint name pairs.
+ * @param msg Lists unknown names on failure.
+ * @return `true` if all pairs were connected, or staged in the open transaction.
+ */
+bool CommandDispatcher::connectBulk(const QVector<QPair<QString, QString>>& pairs, QString& msg)
+{
+    if (m_transaction->isOpen()) return stageConnections(pairs, msg);
+
+    // Resolve every name up front so a typo leaves the scene untouched
+    const ShapeTable& table = m_repo->table();
+    QVector<QLineF> lines;
+    QVector<QPair<ShapeHandle, ShapeHandle>> ends;
+    lines.reserve(pairs.size());
+    ends.reserve(pairs.size());
+    QStringList missing;
+    for (const auto& pair : pairs) {
+        // Centers come straight from the value table; no virtual call per endpoint
+        const ShapeHandle h1 = m_repo->handle(pair.first);
+        const ShapeHandle h2 = m_repo->handle(pair.second);
+        bool found1 = false, found2 = false;
+        const QPointF c1 = table.center(h1, &found1);
+        const QPointF c2 = table.center(h2, &found2);
+        if (!found1) missing << pair.first;
+        if (!found2) missing << pair.second;
+        if (found1 && found2) {
+            lines.append(QLineF(c1, c2));
+            ends.append(qMakePair(h1, h2));
+        }
+    }
+    if (!missing.isEmpty()) {
+        msg = unknownObjectsMessage(missing);
+        return false;
+    }
+
+    // One item and one scene insertion for the whole batch
+    auto* batch = new ConnectorBatchItem(connectorPen());
+    const int first = batch->addLines(lines);
+    m_scene->addItem(batch);
+
+    ConnectionIndex& connections = m_repo->connections();
+    for (int i = 0; i < pairs.size(); ++i) {
+        connections.add(ends[i].first, ends[i].second, batch, first + i);
+
+        HistoryDelta delta;
+        delta.op = HistoryDelta::Op::Connect;
+        delta.shape.name = pairs[i].first;
+        delta.other = pairs[i].second;
+        record(std::move(delta));
+    }
+    return true;
+}
+
+/**
+ * @brief Resolves endpoints against the repository and the staged shapes, then stages the pairs.
+ * @param pairs Endpoint name pairs.
+ * @param msg Lists unknown names on failure.
+ * @return `true` if every pair was staged.
+ */
+bool CommandDispatcher::stageConnections(const QVector<QPair<QString, QString>>& pairs, QString& msg)
+{
+    QStringList missing;
+    for (const auto& pair : pairs) {
+        for (const QString& name : { pair.first, pair.second }) {
+            if (!m_repo->contains(name) && !m_transaction->definesName(name)) missing << name;
+        }
+    }
+    if (!missing.isEmpty()) {
+        msg = unknownObjectsMessage(missing);
+        return false;
+    }
+    m_transaction->stageConnections(pairs);
+    return true;
+}
+
+/**
+ * @brief Removes a connection edge and its connector item.
+ * @param edgeId Edge id.
+ */
+void CommandDispatcher::disconnectEdge(int edgeId)
+{
+    const ConnectionIndex::Edge& e = m_repo->connections().edge(edgeId);
+
+    HistoryDelta delta;
+    delta.op = HistoryDelta::Op::Disconnect;
+    delta.shape.name = m_repo->name(e.a);
+    delta.other = m_repo->name(e.b);
+    record(std::move(delta));
+
+    m_repo->connections().remove(edgeId);
+}
+
+/**
+ * @brief Composes a transform into the shape's pending transform.
+ * @param name Shape name.
+ * @param transform Transform applied after any already pending one.
+ */
+void CommandDispatcher::transformShape(const QString& name, const QTransform& transform)
+{
+    const ShapeHandle handle = m_repo->handle(name);
+    auto it = m_pendingTransforms.find(handle);
+    if (it == m_pendingTransforms.end()) {
+        m_pendingTransforms.insert(handle, transform);
+    } else {
+        *it = *it * transform;
+    }
+}
+
+/**
+ * @brief Applies every pending transform once and records it as a single delta per shape.
+ *
+ * The delta keeps the vertices from before the transform, so undo restores them exactly
+ * instead of applying an inverse matrix that may be singular or drift by rounding.
+ */
+void CommandDispatcher::flushTransforms()
+{
+    if (m_pendingTransforms.isEmpty()) return;
+
+    for (auto it = m_pendingTransforms.constBegin(); it != m_pendingTransforms.constEnd(); ++it) {
+        const QTransform& t = it.value();
+        HistoryDelta delta;
+        delta.op = HistoryDelta::Op::Transform;
+        delta.shape = m_repo->record(it.key());
+        applyTransform(it.key(), t);
+
+        delta.params = { t.m11(), t.m12(), t.m21(), t.m22(), t.dx(), t.dy() };
+        record(std::move(delta));
+    }
+    m_pendingTransforms.clear();
+}
+
+/**
+ * @brief Maps a shape's vertices through a transform and updates scene, store and connectors.
+ * @param handle Shape handle.
+ * @param transform Transform to apply.
+ */
+void CommandDispatcher::applyTransform(ShapeHandle handle, const QTransform& transform)
+{
+    ShapeBase* shape = m_repo->get(handle);
+    if (!shape) return;
+
+    QVector<QPointF> points = shape->vertices();
+    for (QPointF& p : points) p = transform.map(p);
+    m_repo->updateGeometry(handle, points);
+}
+
+/**
+ * @brief Computes where a shape's center will be once its pending transform is applied.
+ * @param name Shape name.
+ * @return Transformed center; affine maps preserve centroids and box centers of symmetric shapes.
+ */
+QPointF CommandDispatcher::pendingCenter(const QString& name) const
+{
+    const ShapeHandle handle = m_repo->handle(name);
+    const QPointF c = m_repo->table().center(handle);
+    auto it = m_pendingTransforms.constFind(handle);
+    return it == m_pendingTransforms.constEnd() ? c : it.value().map(c);
+}
+
+/**
+ * @brief Appends a delta to the history step currently being recorded.
+ * @param delta Delta describing the applied mutation.
+ */
+void CommandDispatcher::record(HistoryDelta delta)
+{
+    if (m_recording) m_recording->deltas.append(std::move(delta));
+}
+
+/**
+ * @brief Undoes a single delta by applying its inverse.
+ * @param delta Delta to revert.
+ */
+void CommandDispatcher::revert(const HistoryDelta& delta)
+{
+    switch (delta.op) {
+    case HistoryDelta::Op::CreateShape:
+        eraseShape(delta.shape.name);
+        break;
+    case HistoryDelta::Op::DeleteShape:
+        restoreShape(delta);
+        break;
+    case HistoryDelta::Op::Connect:
+        disconnectByName(delta.shape.name, delta.other);
+        break;
+    case HistoryDelta::Op::Disconnect:
+        connectByName(delta.shape.name, delta.other);
+        break;
+    case HistoryDelta::Op::Transform:
+        m_repo->updateGeometry(m_repo->handle(delta.shape.name), delta.shape.vertices());
+        break;
+    }
+}
+
+/**
+ * @brief Redoes a single delta that was previously reverted.
+ * @param delta Delta to re-apply.
+ */
+void CommandDispatcher::reapply(const HistoryDelta& delta)
+{
+    switch (delta.op) {
+    case HistoryDelta::Op::CreateShape:
+        restoreShape(delta);
+        break;
+    case HistoryDelta::Op::DeleteShape:
+        eraseShape(delta.shape.name);
+        break;
+    case HistoryDelta::Op::Connect:
+        connectByName(delta.shape.name, delta.other);
+        break;
+    case HistoryDelta::Op::Disconnect:
+        disconnectByName(delta.shape.name, delta.other);
+        break;
+    case HistoryDelta::Op::Transform: {
+        const QVector<qreal>& m = delta.params;
+        applyTransform(m_repo->handle(delta.shape.name), QTransform(m[0], m[1], m[2], m[3], m[4], m[5]));
+        break;
+    }
+    }
+}
+
+/**
+ * @brief Describes a shape for a creation or deletion delta.
+ *
+ * An instance also keeps its layer, plus its placement when that is not a pure
+ * translation, since its record then holds the mapped vertices rather than an offset.
+ * @param op `CreateShape` or `DeleteShape`.
+ * @param handle Live shape handle.
+ */
+HistoryDelta CommandDispatcher::shapeDelta(HistoryDelta::Op op, ShapeHandle handle) const
+{
+    HistoryDelta delta;
+    delta.op = op;
+    delta.shape = m_repo->record(handle);
+    if (const auto* instance = dynamic_cast<const InstanceShape*>(m_repo->get(handle))) {
+        delta.layer = instance->layer();
+        if (!delta.shape.instance) {
+            const QTransform t = instance->placement();
+            delta.params = { t.m11(), t.m12(), t.m21(), t.m22(), t.dx(), t.dy() };
+        }
+    }
+    return delta;
+}
+
+/**
+ * @brief Recreates the shape of a creation or deletion delta.
+ *
+ * An instance gets a new slot in the layer it was drawn by, so it costs a slot again
+ * rather than a standalone shape with its own vertices and item.
+ * @param delta Delta holding the shape record, and the layer for an instance.
+ */
+void CommandDispatcher::restoreShape(const HistoryDelta& delta)
+{
+    const ShapeRecord& record = delta.shape;
+    if (delta.layer) {
+        const QVector<qreal>& m = delta.params;
+        const QTransform placement = m.size() == 6 ? QTransform(m[0], m[1], m[2], m[3], m[4], m[5])
+                                                   : QTransform::fromTranslate(record.offset.x(), record.offset.y());
+        const int slot = delta.layer->addInstances(placement, { QPointF() });
+        insertShape(record.name, new InstanceShape(delta.layer, slot));
+        return;
+    }
+    if (ShapeBase* shape = ShapeBase::create(record.kind, record.vertices())) {
+        insertShape(record.name, shape);
+    }
+}
+
+/**
+ * @brief Recreates a run of translated instances of one layer with a single slot range.
+ * @param deltas Creation or deletion deltas sharing `deltas[0].layer`, none with a placement.
+ */
+void CommandDispatcher::restoreInstances(const QVector<const HistoryDelta*>& deltas)
+{
+    QVector<QPointF> offsets;
+    offsets.reserve(deltas.size());
+    for (const HistoryDelta* delta : deltas) offsets.append(delta->shape.offset);
+
+    const std::shared_ptr<InstanceLayerItem>& layer = deltas.first()->layer;
+    const int first = layer->addInstances(QTransform(), offsets);
+    for (int i = 0; i < deltas.size(); ++i) insertShape(deltas[i]->shape.name, new InstanceShape(layer, first + i));
+}
+
+/**
+ * @brief Redraws a run of connections through one batch item, as `connect_chain` does.
+ *
+ * Pairs whose shapes no longer exist are skipped, as `connectByName()` skips them.
+ * @param deltas Deltas whose replay adds the connection between `shape.name` and `other`.
+ */
+void CommandDispatcher::restoreConnections(const QVector<const HistoryDelta*>& deltas)
+{
+    QVector<QPair<QString, QString>> pairs;
+    pairs.reserve(deltas.size());
+    for (const HistoryDelta* delta : deltas) {
+        if (m_repo->contains(delta->shape.name) && m_repo->contains(delta->other)) {
+            pairs.append(qMakePair(delta->shape.name, delta->other));
+        }
+    }
+    if (pairs.size() == 1) {
+        connectByName(pairs[0].first, pairs[0].second);
+    } else if (!pairs.isEmpty()) {
+        QString msg;
+        connectBulk(pairs, msg);
+    }
+}
+
+/**
+ * @brief Undoes a step in reverse order or redoes it in order.
+ *
+ * Consecutive restores of translated instances of one layer, as undoing a bulk delete or
+ * redoing `create_grid` produces, are applied as one slot range, and consecutive restored
+ * connections are drawn through one batch item; every other delta goes through `revert()`
+ * or `reapply()`.
+ * @param step Step to replay.
+ * @param undo `true` to undo, `false` to redo.
+ */
+void CommandDispatcher::replayStep(const HistoryStep& step, bool undo)
+{
+    const int n = step.deltas.size();
+    const auto at = [&step, n, undo](int i) -> const HistoryDelta& { return step.deltas[undo ? n - 1 - i : i]; };
+    const auto restoresInstance = [undo](const HistoryDelta& d) {
+        return d.op == (undo ? HistoryDelta::Op::DeleteShape : HistoryDelta::Op::CreateShape)
+            && d.layer && d.params.isEmpty();
+    };
+    const auto restoresConnection = [undo](const HistoryDelta& d) {
+        return d.op == (undo ? HistoryDelta::Op::Disconnect : HistoryDelta::Op::Connect);
+    };
+
+    for (int i = 0; i < n;) {
+        const HistoryDelta& delta = at(i);
+        if (restoresInstance(delta)) {
+            QVector<const HistoryDelta*> run;
+            for (; i < n && restoresInstance(at(i)) && at(i).layer == delta.layer; ++i) run.append(&at(i));
+            restoreInstances(run);
+            continue;
+        }
+        if (restoresConnection(delta)) {
+            QVector<const HistoryDelta*> run;
+            for (; i < n && restoresConnection(at(i)); ++i) run.append(&at(i));
+            restoreConnections(run);
+            continue;
+        }
+        if (undo) {
+            revert(delta);
+        } else {
+            reapply(delta);
+        }
+        ++i;
+    }
+}
+
+/**
+ * @brief Connects two shapes looked up by name.
+ * @param n1 First shape name.
+ * @param n2 Second shape name.
+ */
+void CommandDispatcher::connectByName(const QString& n1, const QString& n2)
+{
+    ShapeBase* s1 = m_repo->get(n1);
+    ShapeBase* s2 = m_repo->get(n2);
+    if (s1 && s2) connectShapes(s1, s2);
+}
+
+/**
+ * @brief Removes the newest connection between two named shapes.
+ * @param n1 First shape name.
+ * @param n2 Second shape name.
+ */
+void CommandDispatcher::disconnectByName(const QString& n1, const QString& n2)
+{
+    const int id = m_repo->connections().find(m_repo->handle(n1), m_repo->handle(n2));
+    if (id >= 0) disconnectEdge(id);
+}
+
+/**
+ * @brief Validates the presence of a non-empty `-name` parameter in a command.
+ * @param cmd Command to inspect.
+ * @param nameOut Receives the trimmed name when available.
+ * @param msg Provides details when the validation fails.
+ * @return `true` when the name exists and is not empty.
+ */
+bool CommandDispatcher::requireName(const Command& cmd, QString& nameOut, QString& msg) const
+{
+    // Retrieve and validate a -name flag from command
+    return ShapeRequest::readName(cmd, nameOut, msg);
+}
+
+/**
+ * @brief Ensures the provided name is unique within the repository.
+ * @param name Candidate shape name.
+ * @param msg Describes why the validation failed when the method returns `false`.
+ * @return `true` if the name is not already registered.
+ */
+bool CommandDispatcher::validateUniqueName(const QString& name, QString& msg) const
+{
+    if (m_repo->isFull()) {
+        msg = QString("The scene already holds the maximum of %1 shapes.").arg(ShapeHandle::kMaxCount);
+        return false;
+    }
+    // Ensure shape names are unique to simplify lookup for connect
+    if (m_repo->contains(name)) {
+        msg = QString("An object named '%1' already exists. Choose a unique name.").arg(name);
+        return false;
+    }
+    if (m_transaction->isOpen() && m_transaction->definesName(name)) {
+        msg = QString("An object named '%1' is already staged in this transaction. Choose a unique name.").arg(name);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Retrieves a coordinate value from a parsed command.
+ * @param cmd Command containing coordinate arguments.
+ * @param key Coordinate key without the leading dash (e.g., `coord_1`).
+ * @param out Receives the coordinate if present.
+ * @param msg Describes missing arguments on failure.
+ * @return `true` when the coordinate exists.
+ */
+bool CommandDispatcher::requireCoord(const Command& cmd, const QString& key, QPointF& out, QString& msg) const
+{
+    // Fetch a coordinate (e.g., coord_1) from the parsed command
+    if (!cmd.coords.contains(key)) {
+        msg = QString("Missing -%1 coordinate.").arg(key);
+        return false;
+    }
+    out = cmd.coords[key];
+    return true;
+}
+
+/**
+ * @brief Collects the shape names addressed by a `-name` or `-pattern` flag.
+ * @param cmd Command containing one of the flags.
+ * @param targets Receives the matching names.
+ * @param msg Describes why no shape could be resolved.
+ * @return `true` when at least one shape matches.
+ */
+bool CommandDispatcher::resolveTargets(const Command& cmd, QStringList& targets, QString& msg) const
+{
+    if (cmd.args.contains("name")) {
+        const QString name = cmd.args["name"].trimmed();
+        if (!m_repo->contains(name)) {
+            msg = QString("Object '%1' not found.").arg(name);
+            return false;
+        }
+        targets << name;
+        return true;
+    }
+
+    if (cmd.args.contains("pattern")) {
+        const QRegularExpression re(QRegularExpression::wildcardToRegularExpression(cmd.args["pattern"]));
+        for (const QString& name : m_repo->names()) {
+            if (re.match(name).hasMatch()) targets << name;
+        }
+        if (targets.isEmpty()) {
+            msg = QString("No objects match pattern '%1'.").arg(cmd.args["pattern"]);
+            return false;
+        }
+        return true;
+    }
+
+    msg = "Missing -name or -pattern.";
+    return false;
+}
+
+/**
+ * @brief Reads a comma-separated list of names from a flag.
+ * @param cmd Command containing the flag.
+ * @param key Flag name without the leading dash.
+ * @param out Receives the names.
+ * @param msg Describes a missing or empty list.
+ * @return `true` when the list is non-empty.
+ */
+bool CommandDispatcher::requireNameList(const Command& cmd, const QString& key, QStringList& out, QString& msg) const
+{
+    if (!cmd.args.contains(key)) {
+        msg = QString("Missing -%1.").arg(key);
+        return false;
+    }
+    out = cmd.args[key].split(',', Qt::SkipEmptyParts);
+    if (out.isEmpty()) {
+        msg = QString("-%1 must list at least one name.").arg(key);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Reads a flag naming an existing shape.
+ * @param cmd Parsed command.
+ * @param key Flag name without the leading dash.
+ * @param nameOut Receives the trimmed shape name.
+ * @param msg Error message for a missing flag or unknown shape.
+ * @return `true` when the shape exists.
+ */
+bool CommandDispatcher::requireShape(const Command& cmd, const QString& key, QString& nameOut, QString& msg) const
+{
+    nameOut = cmd.args.value(key).trimmed();
+    if (nameOut.isEmpty()) {
+        msg = QString("Missing -%1.").arg(key);
+        return false;
+    }
+    if (!m_repo->contains(nameOut)) {
+        msg = QString("Object '%1' not found.").arg(nameOut);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Tints the graphics items of the given shapes, replacing the previous highlight.
+ * @param names Shapes to highlight.
+ */
+void CommandDispatcher::highlight(const QStringList& names)
+{
+    clearHighlight();
+    const int count = std::min<int>(names.size(), kMaxHighlighted);
+    m_highlighted.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        ShapeBase* shape = m_repo->get(names[i]);
+        if (!shape) continue;
+        shape->setHighlighted(true);
+        m_highlighted << names[i];
+    }
+}
+
+/**
+ * @brief Drops the effects installed by `highlight()` on shapes that still exist.
+ */
+void CommandDispatcher::clearHighlight()
+{
+    // Shapes deleted since the query took their effect with them
+    for (const QString& name : std::as_const(m_highlighted)) {
+        if (ShapeBase* shape = m_repo->get(name)) shape->setHighlighted(false);
+    }
+    m_highlighted.clear();
+}
+
+/**
+ * @brief Handles the `create_line`, `create_triangle`, `create_rectangle` and `create_square` commands.
+ * @param cmd Parsed command providing the shape name and coordinates.
+ * @param result Receives the created shape's result code, or the failure message.
+ * @return `true` when the shape is valid, created and registered.
+ */
+bool CommandDispatcher::handleCreateShape(const Command& cmd, CommandResult& result)
+{
+    QString name;
+    if (!requireName(cmd, name, result.message) || !validateUniqueName(name, result.message)) return false;
+
+    // Geometry checks do not depend on the scene and are shared with validate_file
+    ShapeRequest request;
+    if (!ShapeRequest::fromCommand(cmd, name, request, result.message)) return false;
+
+    if (m_transaction->isOpen()) {
+        m_transaction->stageShape(request);
+        return true;
+    }
+
+    // Create shape and add to scene and repo
+    insertShape(name, request.build());
+    request.describeSuccess(result);
+    return true;
+}
+
+/**
+ * @brief Handles the `create_instance` command which places a copy of an existing shape.
+ * @param cmd Parsed command with `-prototype`, `-name` and `-offset`.
+ * @param result Receives the instance, its prototype and offset, or the error.
+ * @return `true` when the instance was created.
+ */
+bool CommandDispatcher::handleCreateInstance(const Command& cmd, CommandResult& result)
+{
+    // Expect: create_instance -prototype NAME -name NAME -offset {dx,dy}
+    QString prototypeName, name;
+    QPointF offset;
+    if (!requireShape(cmd, "prototype", prototypeName, result.message)
+        || !requireName(cmd, name, result.message) || !validateUniqueName(name, result.message)
+        || !requireCoord(cmd, "offset", offset, result.message)) {
+        return false;
+    }
+
+    QTransform placement;
+    const std::shared_ptr<InstanceLayerItem> layer = instanceLayer(m_repo->get(prototypeName), placement);
+    const int slot = layer->addInstances(placement, { offset });
+    insertShape(name, new InstanceShape(layer, slot));
+
+    result.code = CommandResult::Code::InstanceCreated;
+    result.subject = name;
+    result.object = prototypeName;
+    result.first = offset;
+    return true;
+}
+
+/**
+ * @brief Handles the `create_grid` command which places rows and columns of instances of a shape.
+ *
+ * Cell (r, c) is named `NAME_r_c` and offset from the prototype by `-offset` plus
+ * `(c * dx, r * dy)`. Every name is checked before anything is created, and all slots are
+ * added to the layer in one geometry change.
+ * @param cmd Parsed command with `-prototype`, `-name`, `-rows`, `-cols`, `-spacing` and optional `-offset`.
+ * @param msg Summary of the grid, or the error.
+ * @return `true` when the whole grid was created.
+ */
+bool CommandDispatcher::handleCreateGrid(const Command& cmd, QString& msg)
+{
+    // Expect: create_grid -prototype NAME -name PREFIX -rows R -cols C -spacing {dx,dy} [-offset {x,y}]
+    QString prototypeName, prefix;
+    QPointF spacing;
+    if (!requireShape(cmd, "prototype", prototypeName, msg) || !requireName(cmd, prefix, msg)
+        || !requireCoord(cmd, "spacing", spacing, msg)) {
+        return false;
+    }
+    bool rowsOk = false, colsOk = false;
+    const int rows = cmd.args.value("rows").toInt(&rowsOk);
+    const int cols = cmd.args.value("cols").toInt(&colsOk);
+    if (!rowsOk || !colsOk || rows < 1 || cols < 1 || qint64(rows) * cols > kMaxGridInstances) {
+        msg = QString("-rows and -cols must be positive, with at most %1 cells.").arg(kMaxGridInstances);
+        return false;
+    }
+    if (!m_repo->canAdd(qint64(rows) * cols)) {
+        msg = QString("The grid does not fit: the scene holds %1 of at most %2 shapes.")
+                  .arg(m_repo->size()).arg(ShapeHandle::kMaxCount);
+        return false;
+    }
+    const QPointF origin = cmd.coords.value("offset");
+
+    QStringList names;
+    QVector<QPointF> offsets;
+    names.reserve(rows * cols);
+    offsets.reserve(rows * cols);
+    const QString stem = prefix + '_';
+    for (int r = 0; r < rows; ++r) {
+        const QString rowStem = stem + QString::number(r) + '_';
+        for (int c = 0; c < cols; ++c) {
+            names << rowStem + QString::number(c);
+            if (!validateUniqueName(names.last(), msg)) return false;
+            offsets << origin + QPointF(c * spacing.x(), r * spacing.y());
+        }
+    }
+
+    QTransform placement;
+    const std::shared_ptr<InstanceLayerItem> layer = instanceLayer(m_repo->get(prototypeName), placement);
+    const int first = layer->addInstances(placement, offsets);
+    for (int i = 0; i < names.size(); ++i) insertShape(names[i], new InstanceShape(layer, first + i));
+
+    msg = QString("Grid '%1' of %2 x %3 instances of '%4' created.").arg(prefix).arg(rows).arg(cols).arg(prototypeName);
+    return true;
+}
+
+/**
+ * @brief Finds the layer that draws copies of a prototype, creating it for a new geometry.
+ *
+ * An instance used as a prototype shares its own layer, and the new instance starts from
+ * its placement. For an ordinary shape the layer is reused while the shape keeps the
+ * geometry the layer was made from.
+ * @param prototype Existing shape.
+ * @param placement Receives the transform that maps the layer's geometry onto the prototype.
+ * @return Layer to add slots to.
+ */
+std::shared_ptr<InstanceLayerItem> CommandDispatcher::instanceLayer(ShapeBase* prototype, QTransform& placement)
+{
+    if (auto* instance = dynamic_cast<InstanceShape*>(prototype)) {
+        placement = instance->placement();
+        return instance->layer();
+    }
+
+    placement = QTransform();
+    std::shared_ptr<InstanceLayerItem> layer = m_instanceLayers.value(prototype->handle()).lock();
+    if (layer && layer->kind() == prototype->kind() && layer->baseVertices() == prototype->vertices()) return layer;
+    layer = InstanceShape::makeLayer(*prototype);
+    m_instanceLayers.insert(prototype->handle(), layer);
+    return layer;
+}
+
+/**
+ * @brief Handles the `connect` command to link two shapes by their centers.
+ * @param cmd Parsed command identifying the two shape names.
+ * @param result Receives the connected names, or the error.
+ * @return `true` on successful connection.
+ */
+bool CommandDispatcher::handleConnect(const Command& cmd, CommandResult& result)
+{
+    // Expect: connect -object_name_1 NAME1 -object_name_2 NAME2
+    if (!cmd.args.contains("object_name_1") || !cmd.args.contains("object_name_2")) {
+        result.message = "Missing -object_name_1 or -object_name_2.";
+        return false;
+    }
+    const QString n1 = cmd.args["object_name_1"];
+    const QString n2 = cmd.args["object_name_2"];
+    if (m_transaction->isOpen()) return stageConnections({ { n1, n2 } }, result.message);
+
+    auto* s1 = m_repo->get(n1);
+    auto* s2 = m_repo->get(n2);
+    if (!s1 || !s2) {
+        result.message = "One or both objects not found.";
+        return false;
+    }
+
+    connectShapes(s1, s2);
+
+    result.code = CommandResult::Code::Connected;
+    result.subject = n1;
+    result.object = n2;
+    return true;
+}
+
+/**
+ * @brief Handles the `execute_file` command which runs commands from a script.
+ *
+ * With `-validate_first true` the whole script is checked by `ScriptValidator` first and
+ * nothing runs unless every line passes.
+ * @param cmd Parsed command containing the path to the script file.
+ * @param msg Aggregated result messages per processed line.
+ * @return `true` if all commands in the file succeed.
+ */
+bool CommandDispatcher::handleExecuteFile(const Command& cmd, QString& msg)
+{
+    ScriptRun run;
+    if (!beginScript(cmd, run, msg) || !prepareScript(run, -1, msg)) return false;
+    while (!stepScript(run, -1)) {
+    }
+    return finishScript(run, msg);
+}
+
+/**
+ * @brief Opens a script; `prepareScript()` then reads and checks it before any line runs.
+ * @param cmd Parsed `execute_file` command.
+ * @param run Receives the open reader and whether to validate first.
+ * @param msg Describes why the script cannot run.
+ * @return `true` when the script is open.
+ */
+bool CommandDispatcher::beginScript(const Command& cmd, ScriptRun& run, QString& msg)
+{
+    // Expect: execute_file -file_path PATH [-validate_first true]
+    if (!cmd.args.contains("file_path")) {
+        msg = "Missing -file_path.";
+        return false;
+    }
+    run.path = cmd.args["file_path"];
+    if (!run.reader.open(run.path, msg)) return false;
+
+    const QString validateFirst = cmd.args.value("validate_first", "false");
+    run.validate = validateFirst == "true" || validateFirst == "1";
+    run.phase = ScriptRun::Phase::Detect;
+    return true;
+}
+
+/**
+ * @brief Classifies, validates and loads a script a window at a time, for up to a time budget.
+ *
+ * Program syntax is looked for in the first window only, so a plain script is never read
+ * before it runs unless it is validated first. A program is read whole and compiled once
+ * the last window is in; nothing runs if it does not compile or validate.
+ * @param run Script opened by `beginScript()`; its phase becomes `Run` when it is ready.
+ * @param budgetNs Time after which to stop at the next window boundary; negative prepares it fully.
+ * @param msg Describes why the script cannot run.
+ * @return `false` when the script must not run.
+ */
+bool CommandDispatcher::prepareScript(ScriptRun& run, qint64 budgetNs, QString& msg)
+{
+    using Phase = ScriptRun::Phase;
+    QElapsedTimer clock;
+    clock.start();
+    while (run.phase != Phase::Run) {
+        const int count = run.reader.read(run.lines, ScriptReader::kScanWindow);
+        run.lineCount += count;
+        if (run.phase == Phase::Detect) {
+            if (ScriptProgram::isProgram(run.lines)) {
+                run.phase = Phase::Load;
+                run.source = run.lines;
+            } else if (run.validate) {
+                run.phase = Phase::Validate;
+                run.validation = std::make_unique<ScriptValidator::Pass>(*m_repo);
+                run.validation->feed(run.lines);
+            } else {
+                // Lines are read again a window at a time as they run
+                run.reader.rewind();
+                run.lineCount = 0;
+                run.phase = Phase::Run;
+            }
+        } else if (count > 0) {
+            if (run.phase == Phase::Load) {
+                run.source += run.lines;
+            } else {
+                run.validation->feed(run.lines);
+            }
+        } else if (run.phase == Phase::Validate) {
+            const ScriptValidator::Report report = run.validation->report();
+            run.validation.reset();
+            if (!report.ok()) {
+                msg = QString("Script not executed. %1").arg(report.toString());
+                return false;
+            }
+            run.reader.rewind();
+            run.phase = Phase::Run;
+        } else {
+            // Scripts with variables or loops are compiled once; nothing runs if they do not compile
+            const QStringList source = std::move(run.source);
+            run.source.clear();
+            if (run.validate) {
+                const ScriptValidator::Report report = ScriptValidator::validateProgram(source);
+                if (!report.ok()) {
+                    msg = QString("Script not executed. %1").arg(report.toString());
+                    return false;
+                }
+            }
+            run.program = std::make_unique<ScriptProgram>();
+            ScriptProgram::CompileError error;
+            if (!run.program->compile(source, error)) {
+                msg = QString("Script not executed. Line %1: %2").arg(error.line).arg(error.message);
+                return false;
+            }
+            run.variables.assign(run.program->variableCount(), 0.0);
+            run.stack.assign(run.program->maxStack(), 0.0);
+            run.phase = Phase::Run;
+        }
+        if (budgetNs >= 0 && clock.nsecsElapsed() >= budgetNs) break;
+    }
+    run.lines.clear();
+    return true;
+}
+
+/**
+ * @brief Runs a script for up to a time budget, as plain lines or as a compiled program.
+ * @param run Script being executed.
+ * @param budgetNs Time after which to stop at the next command boundary; negative runs to the end.
+ * @return `true` when the script has finished.
+ */
+bool CommandDispatcher::stepScript(ScriptRun& run, qint64 budgetNs)
+{
+    // Lines stage into the script's own transaction, never into the console's
+    struct RestoreTransaction
+    {
+        SceneTransaction*& slot;
+        SceneTransaction* outer;
+        ~RestoreTransaction() { slot = outer; }
+    } restore{ m_transaction, m_transaction };
+    m_transaction = &run.transaction;
+
+    const bool done = run.program ? stepProgram(run, budgetNs) : stepLines(run, budgetNs);
+    if (done && run.transaction.isOpen()) {
+        ++run.failureCount;
+        run.details += QString("\nEnd of script: the transaction was never committed; %1 staged command(s) rolled back.")
+                           .arg(run.transaction.commandCount());
+        run.transaction.clear();
+    }
+    return done;
+}
+
+/**
+ * @brief Commits script lines in order, reading and preparing a new window whenever the current one is used up.
+ * @param run Script being executed.
+ * @param budgetNs Time after which to stop at the next line boundary; negative runs to the end.
+ * @return `true` when every line has been processed.
+ */
+bool CommandDispatcher::stepLines(ScriptRun& run, qint64 budgetNs)
+{
+    QElapsedTimer clock;
+    clock.start();
+    while (budgetNs < 0 || clock.nsecsElapsed() < budgetNs) {
+        if (run.position == static_cast<int>(run.window.size())) {
+            run.begin += static_cast<int>(run.window.size());
+            const int count = run.reader.read(run.lines, run.windowSize);
+            if (count == 0) return true;
+            run.window.clear();
+            run.window.resize(count);
+            run.position = 0;
+            prepareWindow(run.lines, run.window, *m_repo);
+            continue;
+        }
+
+        // Commit strictly in line order so the result matches serial execution
+        PreparedLine& line = run.window[run.position];
+        const int lineNo = run.begin + run.position + 1;
+        ++run.position;
+        if (line.skipped) continue;
+
+        if (!line.parsed) {
+            ++run.failureCount;
+            // Log each parse error as a separate message
+            run.details += QString("\nLine %1 parse error: %2").arg(lineNo).arg(line.parseError);
+            if (run.transaction.isOpen()) run.transaction.abort(QString("line %1 does not parse").arg(lineNo));
+            continue;
+        }
+
+        CommandResult result;
+        const bool ok = line.shape ? commitPreparedShape(line.request, line.shape, result)
+                                   : execute(line.cmd, result);
+        tallyScriptLine(run, lineNo, ok, result);
+    }
+    return false;
+}
+
+/**
+ * @brief Runs the VM of a compiled script: evaluates its bytecode and executes the filled commands in order.
+ *
+ * The stack is empty at every loop check and after every command, so a slice ends only
+ * there and the next one resumes at `run.pc` with nothing else to restore.
+ * @param run Script whose `program` is set.
+ * @param budgetNs Time after which to stop at the next command or loop iteration; negative runs to the end.
+ * @return `true` when the program has finished.
+ */
+bool CommandDispatcher::stepProgram(ScriptRun& run, qint64 budgetNs)
+{
+    using Op = ScriptProgram::Op;
+    const std::vector<ScriptProgram::Instr>& code = run.program->code();
+    QVector<ScriptProgram::CommandTemplate>& templates = run.program->templates();
+    double* vars = run.variables.data();
+    double* stack = run.stack.data();
+    int top = 0;
+
+    QElapsedTimer clock;
+    clock.start();
+    const int end = static_cast<int>(code.size());
+    while (run.pc < end) {
+        const ScriptProgram::Instr& instr = code[run.pc++];
+        switch (instr.op) {
+        case Op::Push:
+            stack[top++] = instr.value;
+            continue;
+        case Op::Load:
+            stack[top++] = vars[instr.a];
+            continue;
+        case Op::Store:
+            vars[instr.a] = stack[--top];
+            continue;
+        case Op::Add:
+        case Op::Sub:
+        case Op::Mul:
+        case Op::Div:
+        case Op::Mod:
+            --top;
+            stack[top - 1] = ScriptProgram::apply(instr.op, stack[top - 1], stack[top]);
+            continue;
+        case Op::Neg:
+            stack[top - 1] = -stack[top - 1];
+            continue;
+        case Op::Call: {
+            const auto function = static_cast<ScriptProgram::Function>(instr.a);
+            top -= ScriptProgram::arity(function);
+            stack[top] = ScriptProgram::call(function, stack + top);
+            ++top;
+            continue;
+        }
+        case Op::ForCheck: {
+            // Written so that a NaN bound or a zero step ends the loop instead of spinning
+            const double value = vars[instr.a], bound = vars[instr.c], step = vars[instr.c + 1];
+            if (!(step > 0 ? value <= bound : step < 0 && value >= bound)) run.pc = instr.b;
+            break;
+        }
+        case Op::ForNext:
+            vars[instr.a] += vars[instr.c + 1];
+            run.pc = instr.b;
+            break;
+        case Op::RepeatCheck:
+            if (vars[instr.a] >= 1) {
+                vars[instr.a] -= 1;
+            } else {
+                run.pc = instr.b;
+            }
+            break;
+        case Op::Jump:
+            run.pc = instr.b;
+            break;
+        case Op::Exec: {
+            ScriptProgram::CommandTemplate& tmpl = templates[instr.a];
+            top -= tmpl.valueCount;
+            const double* values = stack + top;
+            CommandResult result;
+            bool ok = std::all_of(values, values + tmpl.valueCount, [](double v) { return std::isfinite(v); });
+            if (!ok) {
+                result.message = "An expression is not a finite number.";
+            } else {
+                ok = execute(tmpl.instantiate(values), result);
+            }
+            tallyScriptLine(run, tmpl.line, ok, result);
+            break;
+        }
+        }
+        if (budgetNs >= 0 && clock.nsecsElapsed() >= budgetNs) return run.pc >= end;
+    }
+    return true;
+}
+
+/**
+ * @brief Counts one executed script command; only failures are turned into text.
+ * @param run Script being executed.
+ * @param lineNo One-based script line of the command.
+ * @param ok Whether the command succeeded.
+ * @param result Its result, formatted only on failure.
+ */
+void CommandDispatcher::tallyScriptLine(ScriptRun& run, int lineNo, bool ok, const CommandResult& result)
+{
+    if (ok) {
+        ++run.successCount;
+        return;
+    }
+    ++run.failureCount;
+    run.details += QString("\nLine %1 failed: %2").arg(lineNo).arg(result.text());
+    if (run.transaction.isOpen()) run.transaction.abort(QString("line %1 failed").arg(lineNo));
+}
+
+/**
+ * @brief Summarizes a finished script.
+ * @param run Script whose lines have all been processed.
+ * @param msg Success and failure counts followed by one line per failure.
+ * @return `true` if every line succeeded.
+ */
+bool CommandDispatcher::finishScript(const ScriptRun& run, QString& msg)
+{
+    msg = QString("Script executed: %1 successes, %2 failures.%3")
+              .arg(run.successCount).arg(run.failureCount).arg(run.details);
+    return run.failureCount == 0;
+}
+
+/**
+ * @brief Inserts a shape that `execute_file` built ahead of time, as `create_*` would.
+ * @param request Validated request the shape was built from.
+ * @param shape Pre-built shape; released to the repository on success.
+ * @param result Same result the `create_*` handler reports.
+ * @return `true` when the shape was inserted.
+ */
+bool CommandDispatcher::commitPreparedShape(const ShapeRequest& request, std::unique_ptr<ShapeBase>& shape,
+                                            CommandResult& result)
+{
+    // Mirror dispatch(): earlier transforms land first, and the name is re-checked at commit time
+    flushTransforms();
+    if (!validateUniqueName(request.name, result.message)) return false;
+
+    // Inside a transaction the pre-built shape waits for commit
+    if (m_transaction->isOpen()) {
+        m_transaction->stageShape(request, std::move(shape));
+        result.code = CommandResult::Code::Staged;
+        result.subject = request.name;
+        result.count = m_transaction->addCommand();
+        return true;
+    }
+
+    insertShape(request.name, shape.release());
+    request.describeSuccess(result);
+    return true;
+}
+
+/**
+ * @brief Handles the `validate_file` command which checks a script without running it.
+ * @param cmd Parsed command containing the path to the script file.
+ * @param msg Summary followed by one line per problem.
+ * @return `true` if every line would pass.
+ */
+bool CommandDispatcher::handleValidateFile(const Command& cmd, QString& msg)
+{
+    // Expect: validate_file -file_path PATH
+    if (!cmd.args.contains("file_path")) {
+        msg = "Missing -file_path.";
+        return false;
+    }
+
+    ScriptValidator::Report report;
+    if (!ScriptValidator(*m_repo).validateFile(cmd.args["file_path"], report, msg)) return false;
+    msg = report.toString();
+    return report.ok();
+}
+
+/**
+ * @brief Handles the `save` command by serializing a snapshot on a background thread.
+ * @param cmd Parsed command containing the destination path.
+ * @param msg Message describing whether the save was started.
+ * @return `true` when the background save starts.
+ */
+bool CommandDispatcher::handleSave(const Command& cmd, QString& msg)
+{
+    // Expect: save -file_path PATH
+    if (!cmd.args.contains("file_path")) {
+        msg = "Missing -file_path.";
+        return false;
+    }
+    const QString path = cmd.args["file_path"];
+
+    const SceneSnapshot snap = m_repo->snapshot();
+    if (!m_saver.start(snap, path)) {
+        msg = "A save is already in progress. Try again when it finishes.";
+        return false;
+    }
+    m_lastSavedRevision = m_repo->revision();
+
+    msg = QString("Saving %1 shapes and %2 connections to %3 in the background.")
+              .arg(snap.size()).arg(snap.connectionCount()).arg(path);
+    return true;
+}
+
+/**
+ * @brief Handles the `autosave` command which configures periodic background saves.
+ * @param cmd Parsed command with `-interval_ms` and, when enabling, `-file_path`.
+ * @param msg Message describing the new autosave configuration.
+ * @return `true` when the configuration is valid.
+ */
+bool CommandDispatcher::handleAutosave(const Command& cmd, QString& msg)
+{
+    // Expect: autosave -file_path PATH -interval_ms N   (N = 0 disables autosave)
+    if (!cmd.args.contains("interval_ms")) {
+        msg = "Missing -interval_ms.";
+        return false;
+    }
+    bool ok = false;
+    const int interval = cmd.args["interval_ms"].toInt(&ok);
+    if (!ok || interval < 0) {
+        msg = "Interval must be a non-negative integer number of milliseconds.";
+        return false;
+    }
+
+    if (interval == 0) {
+        m_autosaveIntervalMs = 0;
+        msg = "Autosave disabled.";
+        return true;
+    }
+
+    if (!cmd.args.contains("file_path")) {
+        msg = "Missing -file_path.";
+        return false;
+    }
+    m_autosavePath = cmd.args["file_path"];
+    m_autosaveIntervalMs = interval;
+    m_autosaveClock.start();
+
+    msg = QString("Autosaving to %1 every %2 ms.").arg(m_autosavePath).arg(interval);
+    return true;
+}
+
+/**
+ * @brief Handles the `checkpoint` command which names the current scene version.
+ * @param cmd Parsed command with the checkpoint `-name`.
+ * @param msg Message describing the recorded checkpoint.
+ * @return `true` when the checkpoint is recorded.
+ */
+bool CommandDispatcher::handleCheckpoint(const Command& cmd, QString& msg)
+{
+    // Expect: checkpoint -name LABEL
+    QString name;
+    if (!requireName(cmd, name, msg)) return false;
+
+    const quint64 version = m_repo->version();
+    m_checkpoints.insert(name, version);
+
+    // Only changes after the oldest checkpoint can still be asked for
+    m_repo->retainChangesSince(*std::min_element(m_checkpoints.cbegin(), m_checkpoints.cend()));
+
+    msg = QString("Checkpoint '%1' set at version %2.").arg(name).arg(version);
+    return true;
+}
+
+/**
+ * @brief Handles the `diff` command which lists changes made since a checkpoint.
+ * @param cmd Parsed command with the `-checkpoint` label.
+ * @param msg Summary of added and removed shapes.
+ * @return `true` when the checkpoint exists.
+ */
+bool CommandDispatcher::handleDiff(const Command& cmd, QString& msg)
+{
+    // Expect: diff -checkpoint LABEL
+    if (!cmd.args.contains("checkpoint")) {
+        msg = "Missing -checkpoint.";
+        return false;
+    }
+    const QString label = cmd.args["checkpoint"];
+    auto it = m_checkpoints.constFind(label);
+    if (it == m_checkpoints.constEnd()) {
+        msg = QString("Unknown checkpoint '%1'.").arg(label);
+        return false;
+    }
+
+    QVector<SceneChange> changes;
+    if (!m_repo->changesSince(it.value(), changes)) {
+        msg = QString("The changes since checkpoint '%1' (version %2) are no longer available.").arg(label).arg(it.value());
+        return false;
+    }
+    int added = 0;
+    int removed = 0;
+    int modified = 0;
+    QString details;
+    for (const SceneChange& change : changes) {
+        QChar marker;
+        switch (change.op) {
+        case SceneChange::Op::Added:    ++added;    marker = '+'; break;
+        case SceneChange::Op::Removed:  ++removed;  marker = '-'; break;
+        case SceneChange::Op::Modified: ++modified; marker = '~'; break;
+        }
+        details += QString("\n%1 %2").arg(marker).arg(change.name);
+    }
+
+    msg = QString("Since checkpoint '%1' (version %2 -> %3): %4 added, %5 removed, %6 modified.%7")
+              .arg(label).arg(it.value()).arg(m_repo->version())
+              .arg(added).arg(removed).arg(modified).arg(details);
+    return true;
+}
+
+/**
+ * @brief Handles the `undo` command by reverting the most recent history step.
+ * @param cmd Parsed command (no arguments).
+ * @param msg Summary of the reverted step.
+ * @return `true` when a step was undone.
+ */
+bool CommandDispatcher::handleUndo(const Command& cmd, QString& msg)
+{
+    Q_UNUSED(cmd);
+    HistoryStep* step = m_history.undo();
+    if (!step) {
+        msg = "Nothing to undo.";
+        return false;
+    }
+
+    // Revert in reverse order so later deltas never reference already-removed shapes
+    replayStep(*step, true);
+
+    msg = QString("Undid '%1' (%2 changes).").arg(step->label).arg(step->deltas.size());
+    return true;
+}
+
+/**
+ * @brief Handles the `redo` command by re-applying the next history step.
+ * @param cmd Parsed command (no arguments).
+ * @param msg Summary of the re-applied step.
+ * @return `true` when a step was redone.
+ */
+bool CommandDispatcher::handleRedo(const Command& cmd, QString& msg)
+{
+    Q_UNUSED(cmd);
+    HistoryStep* step = m_history.redo();
+    if (!step) {
+        msg = "Nothing to redo.";
+        return false;
+    }
+
+    replayStep(*step, false);
+
+    msg = QString("Redid '%1' (%2 changes).").arg(step->label).arg(step->deltas.size());
+    return true;
+}
 
 /**
- * @brief Initializes the dispatcher with the graphics scene and repository.
- * @param scene Scene used to render shapes and connectors.
- * @param repo Repository that manages shape lifetimes and name lookups.
+ * @brief Handles the `history_budget` command which bounds undo memory.
+ * @param cmd Parsed command with `-bytes`.
+ * @param msg Message with the new budget and current usage.
+ * @return `true` when the budget is valid.
  */
-CommandDispatcher::CommandDispatcher(QGraphicsScene* scene, ShapeRepository* repo)
-    : m_scene(scene), m_repo(repo)
+bool CommandDispatcher::handleHistoryBudget(const Command& cmd, QString& msg)
 {
+    // Expect: history_budget -bytes N
+    if (!cmd.args.contains("bytes")) {
+        msg = "Missing -bytes.";
+        return false;
+    }
+    bool ok = false;
+    const qlonglong bytes = cmd.args["bytes"].toLongLong(&ok);
+    if (!ok || bytes <= 0) {
+        msg = "Budget must be a positive number of bytes.";
+        return false;
+    }
+
+    m_history.setBudget(bytes);
+    msg = QString("History budget set to %1 bytes; %2 bytes used by %3 undoable steps.")
+              .arg(bytes).arg(m_history.usedBytes()).arg(m_history.undoCount());
+    return true;
 }
 
 /**
- * @brief Executes a parsed command and routes it to the matching handler.
- * @param cmd Parsed command structure produced by `CommandParser`.
- * @param message Output parameter that captures user-facing feedback.
- * @return `true` when the command completes successfully.
+ * @brief Handles the `delete` command for a single name or a glob pattern.
+ * @param cmd Parsed command with `-name` or `-pattern`.
+ * @param result Receives the numbers of removed shapes and connectors.
+ * @return `true` when at least one shape was deleted.
  */
-bool CommandDispatcher::execute(const Command& cmd, QString& message)
+bool CommandDispatcher::handleDelete(const Command& cmd, CommandResult& result)
 {
-    // Dispatch based on command name; add more as needed
-    if (cmd.name == "create_line") {
-        return handleCreateLine(cmd, message);
-    } else if (cmd.name == "create_triangle") {
-        return handleCreateTriangle(cmd, message);
-    } else if (cmd.name == "create_rectangle") {
-        return handleCreateRectangle(cmd, message);
-    } else if (cmd.name == "create_square") {
-        return handleCreateSquare(cmd, message);
-    } else if (cmd.name == "connect") {
-        return handleConnect(cmd, message);
-    } else if (cmd.name == "execute_file") {
-        return handleExecuteFile(cmd, message);
+    // Expect: delete -name NAME   or   delete -pattern GLOB
+    QStringList targets;
+    if (!resolveTargets(cmd, targets, result.message)) return false;
+
+    // Removing most of the scene is cheaper with the BSP index off and rebuilt once afterwards
+    const QGraphicsScene::ItemIndexMethod indexMethod = m_scene->itemIndexMethod();
+    const bool bulk = targets.size() >= kBulkDeleteThreshold && targets.size() * 2 >= m_repo->size();
+    if (bulk) m_scene->setItemIndexMethod(QGraphicsScene::NoIndex);
+
+    int connectors = 0;
+    for (const QString& name : targets) {
+        int removed = 0;
+        eraseShape(name, &removed);
+        connectors += removed;
     }
 
-    message = QString("Unknown command '%1'.").arg(cmd.name);
-    return false;
+    if (bulk) m_scene->setItemIndexMethod(indexMethod);
+
+    result.code = CommandResult::Code::Deleted;
+    result.count = targets.size();
+    result.extra = connectors;
+    return true;
 }
 
 /**
- * @brief Validates the presence of a non-empty `-name` parameter in a command.
- * @param cmd Command to inspect.
- * @param nameOut Receives the trimmed name when available.
- * @param msg Provides details when the validation fails.
- * @return `true` when the name exists and is not empty.
+ * @brief Handles the `disconnect` command which removes the newest connector between two shapes.
+ * @param cmd Parsed command identifying the two shape names.
+ * @param result Receives the disconnected names, or the error.
+ * @return `true` when a connection was removed.
  */
-bool CommandDispatcher::requireName(const Command& cmd, QString& nameOut, QString& msg) const
+bool CommandDispatcher::handleDisconnect(const Command& cmd, CommandResult& result)
 {
-    // Retrieve and validate a -name flag from command
-    if (!cmd.args.contains("name")) {
-        msg = "Missing -name flag.";
+    // Expect: disconnect -object_name_1 NAME1 -object_name_2 NAME2
+    if (!cmd.args.contains("object_name_1") || !cmd.args.contains("object_name_2")) {
+        result.message = "Missing -object_name_1 or -object_name_2.";
         return false;
     }
-    nameOut = cmd.args["name"].trimmed();
-    if (nameOut.isEmpty()) {
-        msg = "Name cannot be empty.";
+    const QString n1 = cmd.args["object_name_1"];
+    const QString n2 = cmd.args["object_name_2"];
+
+    const int id = m_repo->connections().find(m_repo->handle(n1), m_repo->handle(n2));
+    if (id < 0) {
+        result.message = QString("'%1' and '%2' are not connected.").arg(n1, n2);
         return false;
     }
+    disconnectEdge(id);
+
+    result.code = CommandResult::Code::Disconnected;
+    result.subject = n1;
+    result.object = n2;
     return true;
 }
 
 /**
- * @brief Ensures the provided name is unique within the repository.
- * @param name Candidate shape name.
- * @param msg Describes why the validation failed when the method returns `false`.
- * @return `true` if the name is not already registered.
+ * @brief Handles the `list_connections` command using the shape's adjacency list.
+ * @param cmd Parsed command with the shape `-name`.
+ * @param msg Lists the connected shapes.
+ * @return `true` when the shape exists.
  */
-bool CommandDispatcher::validateUniqueName(const QString& name, QString& msg) const
+bool CommandDispatcher::handleListConnections(const Command& cmd, QString& msg)
 {
-    // Ensure shape names are unique to simplify lookup for connect
-    if (m_repo->contains(name)) {
-        msg = QString("An object named '%1' already exists. Choose a unique name.").arg(name);
+    // Expect: list_connections -name NAME
+    QString name;
+    if (!requireName(cmd, name, msg)) return false;
+    if (!m_repo->contains(name)) {
+        msg = QString("Object '%1' not found.").arg(name);
         return false;
     }
+
+    const ConnectionIndex& connections = m_repo->connections();
+    const ShapeHandle handle = m_repo->handle(name);
+    const QVector<int> edges = connections.incident(handle);
+    QStringList neighbors;
+    neighbors.reserve(edges.size());
+    for (int id : edges) {
+        const ConnectionIndex::Edge& e = connections.edge(id);
+        neighbors << m_repo->name(e.a == handle ? e.b : e.a);
+    }
+
+    msg = QString("'%1' has %2 connection(s)%3%4")
+              .arg(name).arg(edges.size())
+              .arg(neighbors.isEmpty() ? "." : ": ")
+              .arg(neighbors.join(", "));
     return true;
 }
 
 /**
- * @brief Retrieves a coordinate value from a parsed command.
- * @param cmd Command containing coordinate arguments.
- * @param key Coordinate key without the leading dash (e.g., `coord_1`).
- * @param out Receives the coordinate if present.
- * @param msg Describes missing arguments on failure.
- * @return `true` when the coordinate exists.
+ * @brief Handles the `move` command which translates one or more shapes.
+ * @param cmd Parsed command with `-name` or `-pattern` and an `-offset {dx,dy}`.
+ * @param result Receives the number of shapes and the offset.
+ * @return `true` when the targets and offset are valid.
  */
-bool CommandDispatcher::requireCoord(const Command& cmd, const QString& key, QPointF& out, QString& msg) const
+bool CommandDispatcher::handleMove(const Command& cmd, CommandResult& result)
 {
-    // Fetch a coordinate (e.g., coord_1) from the parsed command
-    if (!cmd.coords.contains(key)) {
-        msg = QString("Missing -%1 coordinate.").arg(key);
+    // Expect: move -name NAME -offset {dx,dy}   or   move -pattern GLOB -offset {dx,dy}
+    QPointF offset;
+    if (!requireCoord(cmd, "offset", offset, result.message)) return false;
+    QStringList targets;
+    if (!resolveTargets(cmd, targets, result.message)) return false;
+
+    const QTransform t = QTransform::fromTranslate(offset.x(), offset.y());
+    for (const QString& name : targets) transformShape(name, t);
+
+    result.code = CommandResult::Code::Moved;
+    result.count = targets.size();
+    result.first = offset;
+    return true;
+}
+
+/**
+ * @brief Handles the `rotate` command which rotates shapes about their own centers.
+ * @param cmd Parsed command with `-name` or `-pattern` and `-angle` in degrees.
+ * @param result Receives the number of shapes and the angle.
+ * @return `true` when the targets and angle are valid.
+ */
+bool CommandDispatcher::handleRotate(const Command& cmd, CommandResult& result)
+{
+    // Expect: rotate -name NAME -angle DEG   or   rotate -pattern GLOB -angle DEG
+    bool ok = false;
+    const double angle = cmd.args.value("angle").toDouble(&ok);
+    if (!ok || !std::isfinite(angle)) {
+        result.message = "Missing or invalid -angle; it must be a finite number of degrees.";
         return false;
     }
-    out = cmd.coords[key];
+    QStringList targets;
+    if (!resolveTargets(cmd, targets, result.message)) return false;
+
+    for (const QString& name : targets) {
+        const QPointF c = pendingCenter(name);
+        transformShape(name, QTransform::fromTranslate(-c.x(), -c.y())
+                                 * QTransform().rotate(angle)
+                                 * QTransform::fromTranslate(c.x(), c.y()));
+    }
+
+    result.code = CommandResult::Code::Rotated;
+    result.count = targets.size();
+    result.value = angle;
     return true;
 }
 
 /**
- * @brief Handles the `create_line` command.
- * @param cmd Parsed command providing shape name and two coordinates.
- * @param msg Output message describing success or failure.
- * @return `true` when the line is created and registered.
+ * @brief Handles the `scale` command which scales shapes about their own centers.
+ * @param cmd Parsed command with `-name` or `-pattern` and a non-zero `-factor`.
+ * @param result Receives the number of shapes and the factor.
+ * @return `true` when the targets and factor are valid.
  */
-bool CommandDispatcher::handleCreateLine(const Command& cmd, QString& msg)
+bool CommandDispatcher::handleScale(const Command& cmd, CommandResult& result)
 {
-    // Expect: create_line -name NAME -coord_1 {x,y} -coord_2 {x,y}
-    QString name;
-    if (!requireName(cmd, name, msg) || !validateUniqueName(name, msg)) return false;
-
-    QPointF p1, p2;
-    if (!requireCoord(cmd, "coord_1", p1, msg)) return false;
-    if (!requireCoord(cmd, "coord_2", p2, msg)) return false;
+    // Expect: scale -name NAME -factor F   or   scale -pattern GLOB -factor F
+    bool ok = false;
+    const double factor = cmd.args.value("factor").toDouble(&ok);
+    if (!ok || factor == 0.0 || !std::isfinite(factor)) {
+        result.message = "Missing or invalid -factor; it must be a non-zero number.";
+        return false;
+    }
+    QStringList targets;
+    if (!resolveTargets(cmd, targets, result.message)) return false;
 
-    // Create shape and add to scene and repo
-    auto* shape = new LineShape(name, p1, p2);
-    m_scene->addItem(shape->graphicsItem());
-    m_repo->add(name, shape);
+    for (const QString& name : targets) {
+        const QPointF c = pendingCenter(name);
+        transformShape(name, QTransform::fromTranslate(-c.x(), -c.y())
+                                 * QTransform::fromScale(factor, factor)
+                                 * QTransform::fromTranslate(c.x(), c.y()));
+    }
 
-    msg = QString("Line '%1' created from (%2,%3) to (%4,%5).")
-            .arg(name).arg(p1.x()).arg(p1.y()).arg(p2.x()).arg(p2.y());
+    result.code = CommandResult::Code::Scaled;
+    result.count = targets.size();
+    result.value = factor;
     return true;
 }
 
 /**
- * @brief Handles the `create_triangle` command.
- * @param cmd Parsed command containing a shape name and three coordinates.
- * @param msg Informational message about the operation result.
- * @return `true` if the triangle is valid and created.
+ * @brief Handles the `connect_chain` command which connects consecutive names.
+ * @param cmd Parsed command with `-names a,b,c,...`.
+ * @param msg Summary of the created connections.
+ * @return `true` when every name resolves.
  */
-bool CommandDispatcher::handleCreateTriangle(const Command& cmd, QString& msg)
+bool CommandDispatcher::handleConnectChain(const Command& cmd, QString& msg)
 {
-    // Expect: create_triangle -name NAME -coord_1 -coord_2 -coord_3
-    QString name;
-    if (!requireName(cmd, name, msg) || !validateUniqueName(name, msg)) return false;
+    // Expect: connect_chain -names A,B,C,...
+    QStringList names;
+    if (!requireNameList(cmd, "names", names, msg)) return false;
+    if (names.size() < 2) {
+        msg = "A chain needs at least two names.";
+        return false;
+    }
 
-    QPointF p1, p2, p3;
-    if (!requireCoord(cmd, "coord_1", p1, msg)) return false;
-    if (!requireCoord(cmd, "coord_2", p2, msg)) return false;
-    if (!requireCoord(cmd, "coord_3", p3, msg)) return false;
+    QVector<QPair<QString, QString>> pairs;
+    pairs.reserve(names.size() - 1);
+    for (int i = 1; i < names.size(); ++i) pairs.append({names[i - 1], names[i]});
+    if (!connectBulk(pairs, msg)) return false;
 
-    // Simple non-degenerate validation
-    if (Utility::areCollinear(p1, p2, p3)) {
-        msg = "Triangle vertices are collinear. Provide non-collinear points.";
+    msg = QString("Connected a chain of %1 shapes with %2 connectors.").arg(names.size()).arg(pairs.size());
+    return true;
+}
+
+/**
+ * @brief Handles the `connect_star` command which connects a hub to many shapes.
+ * @param cmd Parsed command with `-hub X` and `-names a,b,c,...`.
+ * @param msg Summary of the created connections.
+ * @return `true` when every name resolves.
+ */
+bool CommandDispatcher::handleConnectStar(const Command& cmd, QString& msg)
+{
+    // Expect: connect_star -hub HUB -names A,B,C,...
+    if (!cmd.args.contains("hub")) {
+        msg = "Missing -hub.";
         return false;
     }
+    const QString hub = cmd.args["hub"];
+    QStringList names;
+    if (!requireNameList(cmd, "names", names, msg)) return false;
 
-    auto* shape = new TriangleShape(name, p1, p2, p3);
-    m_scene->addItem(shape->graphicsItem());
-    m_repo->add(name, shape);
+    QVector<QPair<QString, QString>> pairs;
+    pairs.reserve(names.size());
+    for (const QString& name : names) pairs.append({hub, name});
+    if (!connectBulk(pairs, msg)) return false;
 
-    msg = QString("Triangle '%1' created.").arg(name);
+    msg = QString("Connected hub '%1' to %2 shapes.").arg(hub).arg(pairs.size());
     return true;
 }
 
 /**
- * @brief Handles the `create_rectangle` command supporting diagonal or corner input.
- * @param cmd Parsed command with rectangle parameters.
- * @param msg Descriptive feedback about execution.
- * @return `true` when a rectangle is successfully added.
+ * @brief Handles the `connect_edges` command which imports an edge list file.
+ * @param cmd Parsed command with the CSV `-file_path`.
+ * @param msg Summary of the imported edges or the first format error.
+ * @return `true` when the whole file is imported.
  */
-bool CommandDispatcher::handleCreateRectangle(const Command& cmd, QString& msg)
+bool CommandDispatcher::handleConnectEdges(const Command& cmd, QString& msg)
 {
-    // Supports two forms:
-    // 1) Diagonal: -coord_1, -coord_2 (axis-aligned rectangle)
-    // 2) Four corners: -coord_1..-coord_4 (validated as rectangle)
+    // Expect: connect_edges -file_path PATH   (one "name1,name2" pair per line)
+    if (!cmd.args.contains("file_path")) {
+        msg = "Missing -file_path.";
+        return false;
+    }
+    const QString path = cmd.args["file_path"];
 
-    QString name;
-    if (!requireName(cmd, name, msg) || !validateUniqueName(name, msg)) return false;
-
-    const bool hasFour =
-        cmd.coords.contains("coord_1") &&
-        cmd.coords.contains("coord_2") &&
-        cmd.coords.contains("coord_3") &&
-        cmd.coords.contains("coord_4");
-
-    if (hasFour) {
-        QPointF p1 = cmd.coords["coord_1"];
-        QPointF p2 = cmd.coords["coord_2"];
-        QPointF p3 = cmd.coords["coord_3"];
-        QPointF p4 = cmd.coords["coord_4"];
-
-        if (!Utility::isRectangle(p1, p2, p3, p4)) {
-            msg = "Provided corners do not form a rectangle.";
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        msg = QString("Failed to open edge file: %1").arg(path);
+        return false;
+    }
+
+    QVector<QPair<QString, QString>> pairs;
+    int lineNo = 0;
+    while (!f.atEnd()) {
+        const QByteArray raw = f.readLine().trimmed();
+        ++lineNo;
+        if (raw.isEmpty() || raw.startsWith('#')) continue;
+
+        const int comma = raw.indexOf(',');
+        if (comma <= 0 || comma == raw.size() - 1) {
+            msg = QString("Line %1: expected 'name1,name2'.").arg(lineNo);
             return false;
         }
+        pairs.append({QString::fromUtf8(raw.left(comma).trimmed()),
+                      QString::fromUtf8(raw.mid(comma + 1).trimmed())});
+    }
 
-        auto* shape = new RectangleShape(name, {p1, p2, p3, p4});
-        m_scene->addItem(shape->graphicsItem());
-        m_repo->add(name, shape);
-        msg = QString("Rectangle '%1' created from four corners.").arg(name);
-        return true;
+    if (pairs.isEmpty()) {
+        msg = QString("No edges found in %1.").arg(path);
+        return false;
+    }
+    if (!connectBulk(pairs, msg)) return false;
+
+    msg = QString("Imported %1 connections from %2.").arg(pairs.size()).arg(path);
+    return true;
+}
+
+/**
+ * @brief Handles the `reachable` command using a parallel BFS over a CSR snapshot.
+ * @param cmd Parsed command with `-from` and `-to`.
+ * @param msg Whether the target is reachable and at how many hops.
+ * @return `true` when both shapes exist.
+ */
+bool CommandDispatcher::handleReachable(const Command& cmd, QString& msg)
+{
+    // Expect: reachable -from NAME -to NAME
+    QString from, to;
+    if (!requireShape(cmd, "from", from, msg) || !requireShape(cmd, "to", to, msg)) return false;
+
+    const GraphSnapshot graph(*m_repo);
+    const std::vector<int> dist = graph.bfs(graph.vertexOf(from));
+    const int hops = dist[graph.vertexOf(to)];
+
+    if (hops < 0) {
+        clearHighlight();
+        msg = QString("'%1' is not reachable from '%2'.").arg(to, from);
     } else {
-        QPointF p1, p2;
-        if (!requireCoord(cmd, "coord_1", p1, msg)) return false;
-        if (!requireCoord(cmd, "coord_2", p2, msg)) return false;
+        highlight({from, to});
+        msg = QString("'%1' is reachable from '%2' in %3 hop(s).").arg(to, from).arg(hops);
+    }
+    return true;
+}
+
+/**
+ * @brief Handles the `shortest_path` command by walking BFS parents back from the target.
+ * @param cmd Parsed command with `-from` and `-to`.
+ * @param msg The path as a list of shape names.
+ * @return `true` when both shapes exist.
+ */
+bool CommandDispatcher::handleShortestPath(const Command& cmd, QString& msg)
+{
+    // Expect: shortest_path -from NAME -to NAME
+    QString from, to;
+    if (!requireShape(cmd, "from", from, msg) || !requireShape(cmd, "to", to, msg)) return false;
+
+    const GraphSnapshot graph(*m_repo);
+    std::vector<int> parents;
+    const std::vector<int> dist = graph.bfs(graph.vertexOf(from), &parents);
+    const int target = graph.vertexOf(to);
+    if (dist[target] < 0) {
+        clearHighlight();
+        msg = QString("No path from '%1' to '%2'.").arg(from, to);
+        return true;
+    }
+
+    QStringList path;
+    path.reserve(dist[target] + 1);
+    for (int v = target; v >= 0; v = parents[v]) path << graph.nameOf(v);
+    std::reverse(path.begin(), path.end());
 
-        if (qFuzzyCompare(p1.x(), p2.x()) || qFuzzyCompare(p1.y(), p2.y())) {
-            msg = "Diagonal points must differ in both x and y for a valid rectangle.";
+    highlight(path);
+    msg = QString("Shortest path (%1 hop(s)): %2").arg(dist[target]).arg(path.join(" -> "));
+    return true;
+}
+
+/**
+ * @brief Handles the `component` command which lists the shapes connected to one shape.
+ *
+ * The sorted members are kept until the repository changes, so further pages of the same
+ * component cost only their own names.
+ * @param cmd Parsed command with `-name` and an optional 1-based `-page`.
+ * @param msg One page of sorted member names.
+ * @return `true` when the shape exists and the page is in range.
+ */
+bool CommandDispatcher::handleComponent(const Command& cmd, QString& msg)
+{
+    // Expect: component -name NAME [-page N]
+    QString name;
+    if (!requireShape(cmd, "name", name, msg)) return false;
+
+    int page = 1;
+    if (cmd.args.contains("page")) {
+        bool ok = false;
+        page = cmd.args["page"].toInt(&ok);
+        if (!ok || page < 1) {
+            msg = "Page must be a positive integer.";
             return false;
         }
+    }
 
-        auto* shape = new RectangleShape(name, p1, p2);
-        m_scene->addItem(shape->graphicsItem());
-        m_repo->add(name, shape);
-        msg = QString("Rectangle '%1' created from diagonal points.").arg(name);
-        return true;
+    // Revisions count connection changes too, so a cached member list is never stale
+    const ShapeHandle start = m_repo->handle(name);
+    const quint64 revision = m_repo->revision();
+    QVector<ShapeHandle>& members = m_component.members;
+    if (m_component.start != start || m_component.revision != revision || members.isEmpty()) {
+        const GraphSnapshot graph(*m_repo);
+        const std::vector<int> dist = graph.bfs(graph.vertexOf(name));
+        members.clear();
+        for (int v = 0; v < graph.vertexCount(); ++v) {
+            if (dist[v] >= 0) members.append(graph.handleOf(v));
+        }
+        std::sort(members.begin(), members.end(),
+                  [this](ShapeHandle l, ShapeHandle r) { return m_repo->name(l) < m_repo->name(r); });
+        members.squeeze();
+        m_component.start = start;
+        m_component.revision = revision;
+    }
+
+    const int pages = (members.size() + kResultPageSize - 1) / kResultPageSize;
+    if (page > pages) {
+        msg = QString("Page %1 is out of range; the component has %2 page(s).").arg(page).arg(pages);
+        return false;
     }
+
+    // Only the first kMaxHighlighted members are marked, so only those names are looked up
+    const auto namesOf = [this, &members](int first, int count) {
+        QStringList names;
+        const int last = std::min<int>(members.size(), first + count);
+        for (int i = first; i < last; ++i) names << m_repo->name(members[i]);
+        return names;
+    };
+    highlight(namesOf(0, kMaxHighlighted));
+    msg = QString("Component of '%1' has %2 shape(s), page %3/%4: %5")
+              .arg(name).arg(members.size()).arg(page).arg(pages)
+              .arg(namesOf((page - 1) * kResultPageSize, kResultPageSize).join(", "));
+    return true;
 }
 
 /**
- * @brief Handles the `create_square` command in both diagonal and vertex modes.
- * @param cmd Parsed command with square parameters.
- * @param msg Descriptive feedback about execution.
- * @return `true` when the square is successfully added.
+ * @brief Handles the `components` command which summarizes all connected components.
+ * @param cmd Parsed command (no arguments).
+ * @param msg Component count and the sizes of the largest components.
+ * @return Always `true`.
  */
-bool CommandDispatcher::handleCreateSquare(const Command& cmd, QString& msg)
+bool CommandDispatcher::handleComponents(const Command& cmd, QString& msg)
 {
-    // Supports two forms:
-    // 1) Diagonal: -coord_1, -coord_2 (validated equal side lengths)
-    // 2) Four vertices: -coord_1..-coord_4 (validated equal sides and right angles)
+    Q_UNUSED(cmd);
+    const GraphSnapshot graph(*m_repo);
+    const std::vector<int> labels = graph.componentLabels();
 
-    QString name;
-    if (!requireName(cmd, name, msg) || !validateUniqueName(name, msg)) return false;
-
-    const bool hasFour =
-        cmd.coords.contains("coord_1") &&
-        cmd.coords.contains("coord_2") &&
-        cmd.coords.contains("coord_3") &&
-        cmd.coords.contains("coord_4");
-
-    if (hasFour) {
-        QPointF p1 = cmd.coords["coord_1"];
-        QPointF p2 = cmd.coords["coord_2"];
-        QPointF p3 = cmd.coords["coord_3"];
-        QPointF p4 = cmd.coords["coord_4"];
-
-        if (!Utility::isSquare(p1, p2, p3, p4)) {
-            msg = "Provided vertices do not form a square.";
+    // Labels are vertex ids, so sizes accumulate in a dense array
+    std::vector<int> sizes(graph.vertexCount(), 0);
+    for (int label : labels) ++sizes[label];
+
+    QVector<QPair<int, int>> roots;
+    for (int v = 0; v < graph.vertexCount(); ++v) {
+        if (sizes[v] > 0) roots.append({sizes[v], v});
+    }
+    const int shown = std::min<int>(roots.size(), 10);
+    std::partial_sort(roots.begin(), roots.begin() + shown, roots.end(),
+                      [](const QPair<int, int>& l, const QPair<int, int>& r) {
+                          return l.first != r.first ? l.first > r.first : l.second < r.second;
+                      });
+
+    QStringList largest;
+    for (int i = 0; i < shown; ++i) {
+        largest << QString("%1 (%2)").arg(graph.nameOf(roots[i].second)).arg(roots[i].first);
+    }
+    clearHighlight();
+    msg = QString("%1 component(s) over %2 shape(s) and %3 connection(s)%4%5")
+              .arg(roots.size()).arg(graph.vertexCount()).arg(graph.edgeCount())
+              .arg(largest.isEmpty() ? "." : "; largest: ")
+              .arg(largest.join(", "));
+    return true;
+}
+
+/**
+ * @brief Handles the `top_degree` command which ranks shapes by connection count.
+ * @param cmd Parsed command with an optional `-k` (default 10).
+ * @param msg Ranked shape names with their degrees.
+ * @return `true` when `-k` is valid.
+ */
+bool CommandDispatcher::handleTopDegree(const Command& cmd, QString& msg)
+{
+    // Expect: top_degree [-k N]
+    int k = 10;
+    if (cmd.args.contains("k")) {
+        bool ok = false;
+        k = cmd.args["k"].toInt(&ok);
+        if (!ok || k < 1 || k > kResultPageSize) {
+            msg = QString("-k must be between 1 and %1.").arg(kResultPageSize);
             return false;
         }
+    }
 
-        auto* shape = new SquareShape(name, {p1, p2, p3, p4});
-        m_scene->addItem(shape->graphicsItem());
-        m_repo->add(name, shape);
-        msg = QString("Square '%1' created from four vertices.").arg(name);
-        return true;
-    } else {
-        QPointF p1, p2;
-        if (!requireCoord(cmd, "coord_1", p1, msg)) return false;
-        if (!requireCoord(cmd, "coord_2", p2, msg)) return false;
+    const GraphSnapshot graph(*m_repo);
+    const QVector<QPair<int, int>> top = graph.topDegrees(k);
+    QStringList names;
+    QStringList entries;
+    for (const auto& entry : top) {
+        names << graph.nameOf(entry.first);
+        entries << QString("%1 (%2)").arg(graph.nameOf(entry.first)).arg(entry.second);
+    }
+
+    highlight(names);
+    msg = QString("Top %1 shape(s) by connections%2%3")
+              .arg(top.size())
+              .arg(entries.isEmpty() ? "." : ": ")
+              .arg(entries.join(", "));
+    return true;
+}
+
+/**
+ * @brief Handles the `clear_highlight` command.
+ * @param cmd Parsed command (no arguments).
+ * @param msg Confirmation message.
+ * @return Always `true`.
+ */
+bool CommandDispatcher::handleClearHighlight(const Command& cmd, QString& msg)
+{
+    Q_UNUSED(cmd);
+    clearHighlight();
+    msg = "Highlight cleared.";
+    return true;
+}
 
-        if (!Utility::isValidSquareDiagonal(p1, p2)) {
-            msg = "Diagonal points do not define a valid square.";
+/**
+ * @brief Handles the `queue_stats` command which reports the submission queue and scheduler counters.
+ * @param cmd Parsed command (no arguments).
+ * @param msg Queue depth and throughput, then wait times and latency per priority class.
+ * @return Always `true`.
+ */
+bool CommandDispatcher::handleQueueStats(const Command& cmd, QString& msg)
+{
+    Q_UNUSED(cmd);
+    const CommandQueue::Metrics m = m_queue.metrics();
+    msg = QString("Submission queue: depth %1 (peak %2, capacity %3), %4 submitted, %5 completed "
+                  "in %6 batches, %7 refused while full.")
+              .arg(m.depth).arg(m.peakDepth).arg(m_queue.capacity())
+              .arg(m.submitted).arg(m.completed).arg(m.batches).arg(m.rejected);
+
+    const auto ms = [](qint64 ns) { return QString::number(ns / 1e6, 'f', 2); };
+    const auto average = [](qint64 total, qint64 n) { return n > 0 ? total / n : 0; };
+    const CommandScheduler::ClassStats console = m_scheduler.stats(CommandScheduler::Priority::Interactive);
+    msg += QString("\nConsole commands: %1 run, %2 pending; wait avg %3 ms, max %4 ms; "
+                   "latency avg %5 ms, max %6 ms, %7 over the %8 ms target.")
+               .arg(console.completed).arg(console.pending)
+               .arg(ms(average(console.totalWaitNs, console.runs)), ms(console.maxWaitNs))
+               .arg(ms(average(console.totalLatencyNs, console.completed)), ms(console.maxLatencyNs))
+               .arg(console.overTarget).arg(CommandScheduler::kLatencyTargetMs);
+    const CommandScheduler::ClassStats scripts = m_scheduler.stats(CommandScheduler::Priority::Background);
+    msg += QString("\nBackground scripts: %1 finished, %2 pending; %3 slices, wait between slices avg %4 ms, max %5 ms.")
+               .arg(scripts.completed).arg(scripts.pending).arg(scripts.runs)
+               .arg(ms(average(scripts.totalWaitNs, scripts.runs)), ms(scripts.maxWaitNs));
+    return true;
+}
+
+/**
+ * @brief Handles the `serve` command which starts, stops or reports the local socket command server.
+ * @param cmd Parsed command with `-socket NAME` to listen, `-stop true` to stop, or no flags for status.
+ * @param msg Outcome or current status.
+ * @return `true` unless the server could not listen.
+ */
+bool CommandDispatcher::handleServe(const Command& cmd, QString& msg)
+{
+    // Expect: serve -socket NAME | serve -stop true | serve
+    if (cmd.args.value("stop") == "true") {
+        m_server.close();
+        msg = "Command server stopped.";
+        return true;
+    }
+    if (cmd.args.contains("socket")) {
+        const QString name = cmd.args["socket"].trimmed();
+        if (name.isEmpty()) {
+            msg = "-socket must name the socket.";
             return false;
         }
+        if (!m_server.listen(name, msg)) return false;
+        msg = QString("Listening for commands on %1.").arg(m_server.fullServerName());
+        return true;
+    }
 
-        auto* shape = new SquareShape(name, p1, p2);
-        m_scene->addItem(shape->graphicsItem());
-        m_repo->add(name, shape);
-        msg = QString("Square '%1' created from diagonal points.").arg(name);
+    if (!m_server.isListening()) {
+        msg = "Command server is not running. Start it with serve -socket NAME.";
         return true;
     }
+    const CommandServer::Stats s = m_server.stats();
+    msg = QString("Command server on %1: %2 clients (%3 since start), %4 commands (%5 failed) "
+                  "acknowledged in %6 batches, %7 stalls on unread replies.")
+              .arg(m_server.fullServerName()).arg(s.clients).arg(s.connections)
+              .arg(s.commands).arg(s.failures).arg(s.batches).arg(s.stalls);
+    return true;
 }
 
 /**
- * @brief Handles the `connect` command to link two shapes by their centers.
- * @param cmd Parsed command identifying the two shape names.
- * @param msg Message describing the result or encountered error.
- * @return `true` on successful connection.
+ * @brief Handles the `audit_log` command which starts, stops or reports the audit log of command results.
+ * @param cmd Parsed command with `-file_path PATH` and optional `-max_kb` (default 65536), `-rotate_s`
+ *            (default 0, off), `-keep` (default 5) and `-overload drop|block` (default drop);
+ *            `-stop true` to stop; no flags for status.
+ * @param msg Outcome or current counters.
+ * @return `true` unless the options are invalid or the file cannot be opened.
  */
-bool CommandDispatcher::handleConnect(const Command& cmd, QString& msg)
+bool CommandDispatcher::handleAuditLog(const Command& cmd, QString& msg)
 {
-    // Expect: connect -object_name_1 NAME1 -object_name_2 NAME2
-    if (!cmd.args.contains("object_name_1") || !cmd.args.contains("object_name_2")) {
-        msg = "Missing -object_name_1 or -object_name_2.";
-        return false;
+    // Expect: audit_log -file_path PATH [-max_kb N] [-rotate_s N] [-keep N] [-overload drop|block]
+    //       | audit_log -stop true | audit_log
+    if (cmd.args.value("stop") == "true") {
+        const AuditLog::Stats s = m_audit.stats();
+        m_audit.close();
+        msg = QString("Audit log stopped after %1 records (%2 dropped).").arg(s.recorded).arg(s.dropped);
+        return true;
     }
-    const QString n1 = cmd.args["object_name_1"];
-    const QString n2 = cmd.args["object_name_2"];
 
-    auto* s1 = m_repo->get(n1);
-    auto* s2 = m_repo->get(n2);
-    if (!s1 || !s2) {
-        msg = "One or both objects not found.";
-        return false;
+    if (cmd.args.contains("file_path")) {
+        AuditLog::Options options;
+        options.path = cmd.args["file_path"];
+        int maxKb = static_cast<int>(options.maxFileBytes / 1024);
+        const struct { const char* key; int* value; } numbers[] = {
+            { "max_kb", &maxKb }, { "rotate_s", &options.rotateIntervalSec }, { "keep", &options.keepFiles }
+        };
+        for (const auto& number : numbers) {
+            if (!cmd.args.contains(number.key)) continue;
+            bool ok = false;
+            *number.value = cmd.args[number.key].toInt(&ok);
+            if (!ok || *number.value < 0) {
+                msg = QString("-%1 must be a non-negative integer.").arg(number.key);
+                return false;
+            }
+        }
+        options.maxFileBytes = qint64(maxKb) * 1024;
+
+        const QString overload = cmd.args.value("overload", "drop");
+        if (overload != "drop" && overload != "block") {
+            msg = "-overload must be 'drop' or 'block'.";
+            return false;
+        }
+        options.policy = overload == "block" ? AuditLog::OverloadPolicy::Block : AuditLog::OverloadPolicy::Drop;
+
+        if (!m_audit.open(options, msg)) return false;
+        QStringList limits;
+        if (maxKb > 0) limits << QString("at %1 KiB").arg(maxKb);
+        if (options.rotateIntervalSec > 0) limits << QString("every %1 s").arg(options.rotateIntervalSec);
+        msg = QString("Auditing command results to %1 (rotate %2, keep %3 files, %4 when overloaded).")
+                  .arg(options.path, limits.isEmpty() ? QString("never") : limits.join(" or "))
+                  .arg(m_audit.options().keepFiles).arg(overload);
+        return true;
+    }
+
+    if (!m_audit.isOpen()) {
+        msg = "Audit log is off. Start it with audit_log -file_path PATH.";
+        return true;
     }
+    const AuditLog::Stats s = m_audit.stats();
+    msg = QString("Audit log %1: %2 records, %3 written (%4 bytes), %5 queued, %6 dropped, %7 waited for room, "
+                  "%8 rotations, %9 write errors.")
+              .arg(m_audit.options().path).arg(s.recorded).arg(s.written).arg(s.bytes).arg(s.depth)
+              .arg(s.dropped).arg(s.blocked).arg(s.rotations).arg(s.writeErrors);
+    if (!s.lastError.isEmpty()) msg += QString("\nLast error: %1").arg(s.lastError);
+    return true;
+}
 
-    const QPointF c1 = s1->center();
-    const QPointF c2 = s2->center();
+/**
+ * @brief Asks the repository for the scene's share and adds the log buffers, history and caches.
+ * @return Report with every subsystem filled.
+ */
+MemoryStats::Report CommandDispatcher::memoryReport() const
+{
+    MemoryStats::Report report;
+    m_repo->measure(report);
+    report.bytes[MemoryStats::Report::LogBuffer] =
+        MemoryStats::value(MemoryStats::Counter::LogBufferBytes) + m_audit.usedBytes();
 
-    // Draw a simple line connecting centers; unmanaged item for simplicity
-    auto* item = m_scene->addLine(QLineF(c1, c2), QPen(Qt::darkGray, 1.5, Qt::DashLine));
-    Q_UNUSED(item);
+    // Hash and map nodes are charged for their key and value only
+    qsizetype caches = m_history.usedBytes()
+                     + m_pendingTransforms.size() * qsizetype(sizeof(ShapeHandle) + sizeof(QTransform))
+                     + m_instanceLayers.size() * qsizetype(sizeof(ShapeHandle) + sizeof(std::weak_ptr<InstanceLayerItem>))
+                     + m_checkpoints.size() * qsizetype(sizeof(QString) + sizeof(quint64))
+                     + MemoryStats::capacityBytes(m_component.members);
+    for (const QString& name : m_checkpoints.keys()) caches += name.size() * qsizetype(sizeof(QChar));
+    for (const QString& name : m_highlighted) caches += qsizetype(sizeof(QString)) + name.size() * qsizetype(sizeof(QChar));
+    report.bytes[MemoryStats::Report::Caches] = caches;
+    return report;
+}
 
-    msg = QString("Connected '%1' and '%2' by their centers.").arg(n1, n2);
+/**
+ * @brief Handles the `mem_stats` command which reports memory per subsystem and per shape type.
+ * @param cmd Parsed command (no arguments).
+ * @param msg Total, one line per subsystem, then bytes per shape by type.
+ * @return Always `true`.
+ */
+bool CommandDispatcher::handleMemStats(const Command& cmd, QString& msg)
+{
+    Q_UNUSED(cmd);
+    msg = memoryReport().text();
     return true;
 }
 
 /**
- * @brief Handles the `execute_file` command which runs commands from a script.
- * @param cmd Parsed command containing the path to the script file.
- * @param msg Aggregated result messages per processed line.
- * @return `true` if all commands in the file succeed.
+ * @brief Handles the `begin` command which opens a transaction.
+ * @param cmd Parsed command (no arguments).
+ * @param msg Confirms that commands are now staged.
+ * @return Always `true`; a nested `begin` is refused while staging.
  */
-bool CommandDispatcher::handleExecuteFile(const Command& cmd, QString& msg)
+bool CommandDispatcher::handleBegin(const Command& cmd, QString& msg)
 {
-    // Expect: execute_file -file_path PATH
-    if (!cmd.args.contains("file_path")) {
-        msg = "Missing -file_path.";
+    Q_UNUSED(cmd);
+    m_transaction->begin();
+    msg = "Transaction started: create_* and connect* commands are staged until commit or rollback.";
+    return true;
+}
+
+/**
+ * @brief Handles the `commit` command which publishes every staged shape and connection as one step.
+ *
+ * The staged names and endpoints are checked again first, because commands outside the
+ * transaction may have changed the scene since they were staged. Then the shapes are
+ * built in parallel and inserted with scene indexing suspended for large commits, and
+ * all connections are drawn through one batch item, so the scene index is rebuilt once
+ * and the view repaints once.
+ * @param cmd Parsed command (no arguments).
+ * @param msg Number of published shapes and connections, or why nothing was applied.
+ * @return `true` when everything was published.
+ */
+bool CommandDispatcher::handleCommit(const Command& cmd, QString& msg)
+{
+    Q_UNUSED(cmd);
+    SceneTransaction& transaction = *m_transaction;
+    if (!transaction.isOpen()) {
+        msg = "No transaction is open.";
+        return false;
+    }
+    if (transaction.isAborted()) {
+        msg = QString("Transaction rolled back, nothing applied: %1").arg(transaction.abortReason());
+        transaction.clear();
         return false;
     }
-    const QString path = cmd.args["file_path"];
 
-    QFile f(path);
-    if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        msg = QString("Failed to open script file: %1").arg(path);
+    QStringList taken;
+    for (const SceneTransaction::StagedShape& staged : transaction.shapes()) {
+        if (m_repo->contains(staged.request.name)) taken << staged.request.name;
+    }
+    QStringList missing;
+    for (const auto& pair : transaction.connections()) {
+        for (const QString& name : { pair.first, pair.second }) {
+            if (!m_repo->contains(name) && !transaction.definesName(name)) missing << name;
+        }
+    }
+    if (!m_repo->canAdd(qint64(transaction.shapes().size()))) {
+        msg = QString("Transaction rolled back, nothing applied: %1 staged shape(s) do not fit, the scene holds %2 "
+                      "of at most %3 shapes.")
+                  .arg(transaction.shapes().size()).arg(m_repo->size()).arg(ShapeHandle::kMaxCount);
+        transaction.clear();
+        return false;
+    }
+    if (!taken.isEmpty() || !missing.isEmpty()) {
+        msg = taken.isEmpty()
+            ? QString("Transaction rolled back: %1").arg(unknownObjectsMessage(missing))
+            : QString("Transaction rolled back, nothing applied: %1 name(s) were taken since staging: %2")
+                  .arg(taken.size()).arg(QStringList(taken.mid(0, 10)).join(", "));
+        transaction.clear();
         return false;
     }
 
-    QTextStream in(&f);
-    int lineNo = 0;
-    int successCount = 0;
-    int failureCount = 0;
-    while (!in.atEnd()) {
-        const QString raw = in.readLine().trimmed();
-        ++lineNo;
-        if (raw.isEmpty()) continue;
+    // Close the transaction before publishing so connectBulk draws instead of staging
+    transaction.buildShapes();
+    std::vector<SceneTransaction::StagedShape> shapes = std::move(transaction.shapes());
+    const QVector<QPair<QString, QString>> pairs = transaction.connections();
+    const int commands = transaction.commandCount();
+    transaction.clear();
 
-        Command c;
-        QString parseError;
-        if (!CommandParser().parse(raw, c, parseError)) {
-            ++failureCount;
-            // Log each parse error as a separate message
-            msg += QString("\nLine %1 parse error: %2").arg(lineNo).arg(parseError);
-            continue;
-        }
+    const QGraphicsScene::ItemIndexMethod indexMethod = m_scene->itemIndexMethod();
+    const bool bulk = static_cast<int>(shapes.size()) >= kBulkCommitThreshold;
+    if (bulk) m_scene->setItemIndexMethod(QGraphicsScene::NoIndex);
+    for (SceneTransaction::StagedShape& staged : shapes) insertShape(staged.request.name, staged.shape.release());
+    const bool connected = pairs.isEmpty() || connectBulk(pairs, msg);
+    if (bulk) m_scene->setItemIndexMethod(indexMethod);
+    if (!connected) return false;
 
-        QString execMsg;
-        if (!execute(c, execMsg)) {
-            ++failureCount;
-            msg += QString("\nLine %1 failed: %2").arg(lineNo).arg(execMsg);
-        } else {
-            ++successCount;
-        }
-    }
+    msg = QString("Committed %1 command(s): %2 shape(s) and %3 connection(s) applied as one step.")
+              .arg(commands).arg(shapes.size()).arg(pairs.size());
+    return true;
+}
 
-    msg = QString("Script executed: %1 successes, %2 failures.%3")
-              .arg(successCount).arg(failureCount).arg(msg);
-    return failureCount == 0;
+/**
+ * @brief Handles the `rollback` command which discards everything staged since `begin`.
+ * @param cmd Parsed command (no arguments).
+ * @param msg Number of discarded commands.
+ * @return `true` when a transaction was open.
+ */
+bool CommandDispatcher::handleRollback(const Command& cmd, QString& msg)
+{
+    Q_UNUSED(cmd);
+    if (!m_transaction->isOpen()) {
+        msg = "No transaction is open.";
+        return false;
+    }
+    const int commands = m_transaction->commandCount();
+    m_transaction->clear();
+    msg = QString("Rolled back %1 staged command(s); the scene is unchanged.").arg(commands);
+    return true;
 }
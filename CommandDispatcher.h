@@ -7,19 +7,91 @@
 
 #include <QString>
 #include <QGraphicsScene>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QHash>
+#include <QTransform>
 #include "CommandParser.h"
 #include "ShapeRepository.h"
+#include "SceneSaver.h"
+#include "CommandHistory.h"
+#include "ShapeRequest.h"
+#include "CommandQueue.h"
+#include "CommandScheduler.h"
+#include "CommandServer.h"
+#include "AuditLog.h"
+#include "SceneTransaction.h"
+#include "InstanceLayerItem.h"
+#include "MemoryStats.h"
+#include <functional>
+#include <memory>
 
 /**
  * @class CommandDispatcher
  * @brief Routes parsed commands to specific handlers and coordinates shape creation.
  *
  * The dispatcher validates user input, instantiates shape objects, registers them with
- * the repository, and supports batch execution through command scripts.
+ * the repository, and supports batch execution through command scripts. It also drives
+ * background saving of scene snapshots and named checkpoints over scene versions.
+ *
+ * Every top-level command records its scene mutations as one undoable `HistoryStep`;
+ * lines executed from a script append to the step of the enclosing `execute_file`.
+ * Consecutive `move`/`rotate`/`scale` commands are composed per shape and applied to the
+ * scene once, when the batch ends or a command that reads geometry runs.
+ *
+ * Between `begin` and `commit`, `create_*` and `connect*` commands are validated and
+ * staged in a `SceneTransaction` instead of being applied; `commit` publishes all of them
+ * as one step, or nothing if any of them failed. Scripts get their own transaction, so a
+ * script's `begin` does not capture commands typed while it runs.
  */
 class CommandDispatcher
 {
 public:
+    /**
+     * @brief Minimum number of shapes a `delete` must remove before scene indexing is suspended.
+     */
+    static constexpr int kBulkDeleteThreshold = 1024;
+
+    /**
+     * @brief Minimum number of staged shapes a `commit` must publish before scene indexing is suspended.
+     */
+    static constexpr int kBulkCommitThreshold = 1024;
+
+    /**
+     * @brief Maximum number of instances one `create_grid` may create.
+     */
+    static constexpr int kMaxGridInstances = 10000000;
+
+    /**
+     * @brief Number of shape names reported per page by `component`.
+     */
+    static constexpr int kResultPageSize = 100;
+
+    /**
+     * @brief Maximum number of shapes highlighted on the canvas by a graph query.
+     */
+    static constexpr int kMaxHighlighted = 10000;
+
+    /**
+     * @brief Number of script lines `execute_file` parses and prepares in parallel before committing them.
+     */
+    static constexpr int kScriptWindow = 16384;
+
+    /**
+     * @brief Number of queued submissions executed per GUI event-loop iteration.
+     */
+    static constexpr int kDrainBatch = 256;
+
+    /**
+     * @brief Time a background script may run before console commands get their turn.
+     */
+    static constexpr int kSchedulerSliceMs = 8;
+
+    /**
+     * @brief Lines a background script prepares at a time, small enough to fit in a slice.
+     */
+    static constexpr int kBackgroundScriptWindow = 1024;
+
     /**
      * @brief Creates a dispatcher bound to a graphics scene and repository.
      * @param scene Target scene where shapes and connections are rendered.
@@ -29,24 +101,282 @@ public:
 
     /**
      * @brief Executes a parsed command.
+     *
+     * While `audit_log` is on, the result is also queued for the audit file; the file is
+     * written on the audit log's own thread.
      * @param cmd Parsed command information.
      * @param message Receives descriptive feedback regarding success or failure.
      * @return `true` when the command is processed successfully.
      */
     bool execute(const Command& cmd, QString& message);
 
+    /**
+     * @brief Executes a parsed command without formatting its feedback.
+     *
+     * Frequent commands report a result code and payload; call `CommandResult::text()`
+     * only when the message is shown or logged.
+     * @param cmd Parsed command information.
+     * @param result Receives the success flag and the feedback.
+     * @return `true` when the command is processed successfully.
+     */
+    bool execute(const Command& cmd, CommandResult& result);
+
+    /**
+     * @brief Starts a due autosave and reports finished background saves.
+     *
+     * Intended to be called periodically from the GUI thread.
+     * @param ok Receives whether the reported save succeeded.
+     * @param message Receives the outcome of a finished save.
+     * @return `true` when a finished save is being reported.
+     */
+    bool serviceBackgroundTasks(bool& ok, QString& message);
+
+    /**
+     * @brief Provides the thread-safe queue through which any thread can submit commands.
+     */
+    CommandQueue& queue() { return m_queue; }
+
+    /**
+     * @brief Executes up to @p maxBatch queued submissions; GUI thread only.
+     * @param maxBatch Upper bound on commands executed by this call.
+     * @param report Called with every command and its result, e.g. to log it.
+     * @return `true` when submissions remain, so the caller should drain again soon.
+     */
+    bool drainQueue(int maxBatch, const std::function<void(const Command&, const CommandResult&)>& report);
+
+    /**
+     * @brief Schedules a console command ahead of any running script.
+     *
+     * `execute_file` becomes a background job that runs in slices and is undone as one
+     * step once it finishes; other commands run at the next slice.
+     * @param cmd Parsed command.
+     * @param report Receives the command's result on the GUI thread.
+     */
+    void submit(const Command& cmd, const std::function<void(const CommandResult&)>& report);
+
+    /**
+     * @brief Provides the scheduler so the owner can be woken when a slice should run.
+     */
+    CommandScheduler& scheduler() { return m_scheduler; }
+
+    /**
+     * @brief Collects the memory used per subsystem, as printed by `mem_stats`.
+     */
+    MemoryStats::Report memoryReport() const;
+
 private:
+    struct ScriptRun;
+
     QGraphicsScene* m_scene;
     ShapeRepository* m_repo;
 
+    SceneSaver m_saver;
+    QString m_autosavePath;
+    int m_autosaveIntervalMs = 0;
+    QElapsedTimer m_autosaveClock;
+    quint64 m_lastSavedRevision = 0;
+    QMap<QString, quint64> m_checkpoints;
+
+    CommandQueue m_queue;
+    CommandScheduler m_scheduler;
+    CommandServer m_server;
+    AuditLog m_audit;
+
+    CommandHistory m_history;
+    HistoryStep* m_recording = nullptr;
+
+    SceneTransaction m_consoleTransaction;
+    SceneTransaction* m_transaction = &m_consoleTransaction; ///< Transaction of the running script, or the console's.
+
+    QHash<ShapeHandle, QTransform> m_pendingTransforms;
+
+    QHash<ShapeHandle, std::weak_ptr<InstanceLayerItem>> m_instanceLayers; ///< Layer of each prototype's current geometry.
+
+    QStringList m_highlighted;
+
+    /**
+     * @brief Members of the last `component` query, so paging through it skips the BFS and the sort.
+     */
+    struct ComponentCache
+    {
+        ShapeHandle start;             ///< Shape the query started from.
+        quint64 revision = 0;          ///< Repository revision the members were computed at.
+        QVector<ShapeHandle> members;  ///< Members sorted by name.
+    };
+    ComponentCache m_component;
+
+    /**
+     * @brief Executes a command as its own history step, or as part of the recording script's.
+     */
+    bool executeCommand(const Command& cmd, CommandResult& result);
+
+    /**
+     * @brief Routes a command to its handler without opening a history step.
+     */
+    bool dispatch(const Command& cmd, CommandResult& result);
+
+    /**
+     * @brief Runs a command inside the open transaction: stages it, or aborts the transaction if it fails.
+     */
+    bool stageCommand(const Command& cmd, CommandResult& result);
+
     /// @name Command Handlers
     /// @{
-    bool handleCreateLine(const Command& cmd, QString& msg);
-    bool handleCreateTriangle(const Command& cmd, QString& msg);
-    bool handleCreateRectangle(const Command& cmd, QString& msg);
-    bool handleCreateSquare(const Command& cmd, QString& msg);
-    bool handleConnect(const Command& cmd, QString& msg);
+    bool handleCreateShape(const Command& cmd, CommandResult& result);
+    bool handleCreateInstance(const Command& cmd, CommandResult& result);
+    bool handleCreateGrid(const Command& cmd, QString& msg);
+    bool handleConnect(const Command& cmd, CommandResult& result);
+    bool handleConnectChain(const Command& cmd, QString& msg);
+    bool handleConnectStar(const Command& cmd, QString& msg);
+    bool handleConnectEdges(const Command& cmd, QString& msg);
     bool handleExecuteFile(const Command& cmd, QString& msg);
+    bool beginScript(const Command& cmd, ScriptRun& run, QString& msg);
+    bool prepareScript(ScriptRun& run, qint64 budgetNs, QString& msg);
+    bool stepScript(ScriptRun& run, qint64 budgetNs);
+    bool stepLines(ScriptRun& run, qint64 budgetNs);
+    bool stepProgram(ScriptRun& run, qint64 budgetNs);
+    void tallyScriptLine(ScriptRun& run, int lineNo, bool ok, const CommandResult& result);
+    bool finishScript(const ScriptRun& run, QString& msg);
+    bool handleValidateFile(const Command& cmd, QString& msg);
+    bool handleSave(const Command& cmd, QString& msg);
+    bool handleAutosave(const Command& cmd, QString& msg);
+    bool handleCheckpoint(const Command& cmd, QString& msg);
+    bool handleDiff(const Command& cmd, QString& msg);
+    bool handleUndo(const Command& cmd, QString& msg);
+    bool handleRedo(const Command& cmd, QString& msg);
+    bool handleHistoryBudget(const Command& cmd, QString& msg);
+    bool handleDelete(const Command& cmd, CommandResult& result);
+    bool handleDisconnect(const Command& cmd, CommandResult& result);
+    bool handleListConnections(const Command& cmd, QString& msg);
+    bool handleMove(const Command& cmd, CommandResult& result);
+    bool handleRotate(const Command& cmd, CommandResult& result);
+    bool handleScale(const Command& cmd, CommandResult& result);
+    bool handleReachable(const Command& cmd, QString& msg);
+    bool handleShortestPath(const Command& cmd, QString& msg);
+    bool handleComponent(const Command& cmd, QString& msg);
+    bool handleComponents(const Command& cmd, QString& msg);
+    bool handleTopDegree(const Command& cmd, QString& msg);
+    bool handleClearHighlight(const Command& cmd, QString& msg);
+    bool handleQueueStats(const Command& cmd, QString& msg);
+    bool handleServe(const Command& cmd, QString& msg);
+    bool handleAuditLog(const Command& cmd, QString& msg);
+    bool handleMemStats(const Command& cmd, QString& msg);
+    bool handleBegin(const Command& cmd, QString& msg);
+    bool handleCommit(const Command& cmd, QString& msg);
+    bool handleRollback(const Command& cmd, QString& msg);
+    /// @}
+
+    /// @name Scene Mutation Primitives
+    /// All scene changes go through these so they can be recorded and reverted.
+    /// @{
+    /**
+     * @brief Adds a shape to the scene and repository and records the creation.
+     * @param name Unique shape name, interned by the repository.
+     * @param shape Newly created shape; ownership transfers to the repository.
+     */
+    void insertShape(const QString& name, ShapeBase* shape);
+    /**
+     * @brief Inserts a shape built ahead of time by `execute_file`, with `create_*` semantics.
+     * @param request Validated request the shape was built from.
+     * @param shape Pre-built shape; released to the repository on success.
+     * @param result Receives the result the `create_*` handler would report.
+     * @return `true` when the name was still free and the shape was inserted.
+     */
+    bool commitPreparedShape(const ShapeRequest& request, std::unique_ptr<ShapeBase>& shape, CommandResult& result);
+    /**
+     * @brief Removes a shape together with its connectors and records the deletion.
+     * @param name Shape name.
+     * @param removedConnectors Optionally receives the number of connectors removed.
+     * @return `true` when the shape existed.
+     */
+    bool eraseShape(const QString& name, int* removedConnectors = nullptr);
+    /**
+     * @brief Draws a connector between two shape centers and records it.
+     * @param s1 First shape.
+     * @param s2 Second shape.
+     */
+    void connectShapes(ShapeBase* s1, ShapeBase* s2);
+    /**
+     * @brief Connects many shape pairs with a single batched connector item.
+     *
+     * All names are resolved before anything is drawn; if any is unknown nothing is connected.
+     * @param pairs Endpoint name pairs.
+     * @param msg Describes unresolved names on failure.
+     * @return `true` when every pair was connected.
+     */
+    bool connectBulk(const QVector<QPair<QString, QString>>& pairs, QString& msg);
+    /**
+     * @brief Stages connections in the open transaction once both endpoints resolve.
+     *
+     * An endpoint resolves when it is in the repository or staged in the transaction.
+     * @param pairs Endpoint name pairs.
+     * @param msg Lists unknown names on failure.
+     * @return `true` when every pair was staged.
+     */
+    bool stageConnections(const QVector<QPair<QString, QString>>& pairs, QString& msg);
+    /**
+     * @brief Removes a connection edge and records the removal.
+     * @param edgeId Edge id in the repository's connection index.
+     */
+    void disconnectEdge(int edgeId);
+    /**
+     * @brief Queues a transform for a shape, composing it with any pending transform.
+     * @param name Shape name.
+     * @param transform Transform to apply after the pending one.
+     */
+    void transformShape(const QString& name, const QTransform& transform);
+    /**
+     * @brief Applies and records all pending transforms, one scene update per shape.
+     */
+    void flushTransforms();
+    /**
+     * @brief Applies a transform to a shape's vertices immediately.
+     */
+    void applyTransform(ShapeHandle handle, const QTransform& transform);
+    /**
+     * @brief Returns a shape's center including its pending transform.
+     */
+    QPointF pendingCenter(const QString& name) const;
+    /**
+     * @brief Appends a delta to the step being recorded, if any.
+     */
+    void record(HistoryDelta delta);
+    /**
+     * @brief Applies the inverse of a recorded delta.
+     */
+    void revert(const HistoryDelta& delta);
+    /**
+     * @brief Re-applies a previously reverted delta.
+     */
+    void reapply(const HistoryDelta& delta);
+    /**
+     * @brief Describes a shape for a creation or deletion delta, keeping an instance's layer.
+     */
+    HistoryDelta shapeDelta(HistoryDelta::Op op, ShapeHandle handle) const;
+    /**
+     * @brief Recreates a shape from a creation or deletion delta and inserts it.
+     */
+    void restoreShape(const HistoryDelta& delta);
+    /**
+     * @brief Recreates translated instances of one layer as one slot range.
+     */
+    void restoreInstances(const QVector<const HistoryDelta*>& deltas);
+    /**
+     * @brief Redraws the connections of a run of deltas through one batch item.
+     */
+    void restoreConnections(const QVector<const HistoryDelta*>& deltas);
+    /**
+     * @brief Undoes or redoes a whole step, batching runs of deltas that have a bulk path.
+     */
+    void replayStep(const HistoryStep& step, bool undo);
+    /**
+     * @brief Connects two shapes by name if both exist.
+     */
+    void connectByName(const QString& n1, const QString& n2);
+    /**
+     * @brief Removes the newest connection between two shapes, if any.
+     */
+    void disconnectByName(const QString& n1, const QString& n2);
     /// @}
 
     /// @name Common Helpers
@@ -75,5 +405,47 @@ private:
      * @return `true` when the coordinate exists.
      */
     bool requireCoord(const Command& cmd, const QString& key, QPointF& out, QString& msg) const;
+    /**
+     * @brief Resolves the shapes addressed by `-name` or `-pattern`.
+     * @param cmd Command under validation.
+     * @param targets Receives the matching shape names.
+     * @param msg Describes missing flags or empty matches.
+     * @return `true` when at least one shape matches.
+     */
+    bool resolveTargets(const Command& cmd, QStringList& targets, QString& msg) const;
+    /**
+     * @brief Splits a comma-separated `-names` style argument.
+     * @param cmd Command under validation.
+     * @param key Flag name without the leading dash.
+     * @param out Receives the non-empty names.
+     * @param msg Describes a missing or empty list.
+     * @return `true` when at least one name is present.
+     */
+    bool requireNameList(const Command& cmd, const QString& key, QStringList& out, QString& msg) const;
+    /**
+     * @brief Reads a flag that must name an existing shape.
+     * @param cmd Command under validation.
+     * @param key Flag name without the leading dash.
+     * @param nameOut Receives the trimmed name.
+     * @param msg Describes a missing flag or unknown shape.
+     * @return `true` when the shape exists.
+     */
+    bool requireShape(const Command& cmd, const QString& key, QString& nameOut, QString& msg) const;
+    /**
+     * @brief Returns the layer that draws instances of a prototype.
+     * @param prototype Existing shape to copy.
+     * @param placement Receives the prototype's placement on the layer.
+     * @return Layer shared by every instance of the same geometry.
+     */
+    std::shared_ptr<InstanceLayerItem> instanceLayer(ShapeBase* prototype, QTransform& placement);
+    /**
+     * @brief Replaces the current canvas highlight with the given shapes.
+     * @param names Shapes to highlight; at most `kMaxHighlighted` are marked.
+     */
+    void highlight(const QStringList& names);
+    /**
+     * @brief Removes the highlight left by the previous graph query.
+     */
+    void clearHighlight();
     /// @}
 };
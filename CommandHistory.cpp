@@ -0,0 +1,100 @@
+/**
+ * @file CommandHistory.cpp
+ * @brief Implements the delta-encoded undo/redo history.
+ * @author Nikol Grigoryan
+ */
+#include "CommandHistory.h"
+
+/**
+ * @brief Estimates the memory retained by a delta.
+ * @return Approximate size in bytes; prototype vertices shared by instance records are not charged.
+ */
+qsizetype HistoryDelta::byteSize() const
+{
+    return sizeof(HistoryDelta)
+         + (shape.name.size() + other.size()) * qsizetype(sizeof(QChar))
+         + (shape.instance ? 0 : shape.points.size()) * qsizetype(sizeof(QPointF))
+         + params.size() * qsizetype(sizeof(qreal));
+}
+
+/**
+ * @brief Sums the delta sizes of a step.
+ * @param step Step to measure.
+ * @return Approximate size in bytes.
+ */
+qsizetype CommandHistory::stepBytes(const HistoryStep& step)
+{
+    qsizetype bytes = sizeof(HistoryStep) + step.label.size() * qsizetype(sizeof(QChar));
+    for (const HistoryDelta& d : step.deltas) bytes += d.byteSize();
+    return bytes;
+}
+
+/**
+ * @brief Records a new step and drops the redo branch.
+ * @param step Step to append.
+ */
+void CommandHistory::push(HistoryStep step)
+{
+    if (step.deltas.isEmpty()) return;
+
+    // A new mutation invalidates everything that could have been redone
+    for (int i = m_cursor; i < m_steps.size(); ++i) m_usedBytes -= m_stepBytes[i];
+    m_steps.resize(m_cursor);
+    m_stepBytes.resize(m_cursor);
+
+    const qsizetype bytes = stepBytes(step);
+    m_steps.append(std::move(step));
+    m_stepBytes.append(bytes);
+    m_usedBytes += bytes;
+    m_cursor = m_steps.size();
+
+    trim();
+}
+
+/**
+ * @brief Steps the cursor back by one.
+ * @return Step to revert or `nullptr`.
+ */
+HistoryStep* CommandHistory::undo()
+{
+    if (m_cursor == 0) return nullptr;
+    return &m_steps[--m_cursor];
+}
+
+/**
+ * @brief Steps the cursor forward by one.
+ * @return Step to re-apply or `nullptr`.
+ */
+HistoryStep* CommandHistory::redo()
+{
+    if (m_cursor == m_steps.size()) return nullptr;
+    return &m_steps[m_cursor++];
+}
+
+/**
+ * @brief Updates the budget and trims old steps that no longer fit.
+ * @param bytes New budget in bytes.
+ */
+void CommandHistory::setBudget(qsizetype bytes)
+{
+    m_budget = bytes;
+    trim();
+}
+
+/**
+ * @brief Drops the oldest steps until the history fits the budget.
+ */
+void CommandHistory::trim()
+{
+    // Always keep the newest undoable step, even if it alone exceeds the budget
+    int drop = 0;
+    while (m_usedBytes > m_budget && drop < m_cursor - 1) {
+        m_usedBytes -= m_stepBytes[drop];
+        ++drop;
+    }
+    if (drop == 0) return;
+
+    m_steps.remove(0, drop);
+    m_stepBytes.remove(0, drop);
+    m_cursor -= drop;
+}
@@ -0,0 +1,154 @@
+/**
+ * @file CommandHistory.h
+ * @brief Declares the delta-encoded undo/redo history used by the dispatcher.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <memory>
+#include "SceneStore.h"
+
+class InstanceLayerItem;
+
+/**
+ * @struct HistoryDelta
+ * @brief Compact description of one primitive scene mutation.
+ *
+ * A delta records only what is needed to apply the mutation and its inverse: the shape
+ * record for creations and deletions, the two endpoint names for connections, and the
+ * previous vertices plus the applied map for transforms. Creations and deletions of
+ * instances also keep their layer, so restoring one adds a slot to it rather than building
+ * a standalone shape.
+ */
+struct HistoryDelta
+{
+    /**
+     * @brief Primitive mutation recorded by the delta.
+     */
+    enum class Op : quint8
+    {
+        CreateShape, ///< `shape` was added to the scene.
+        DeleteShape, ///< `shape` was removed from the scene.
+        Connect,     ///< `shape.name` and `other` were connected.
+        Disconnect,  ///< The connection between `shape.name` and `other` was removed.
+        Transform    ///< `shape.name` was transformed from `shape.points` by the affine map in `params`.
+    };
+
+    /**
+     * @brief Mutation kind.
+     */
+    Op op = Op::CreateShape;
+    /**
+     * @brief Shape record for shape deltas; the name and the vertices before the map for
+     *        transform deltas; only the name for connection deltas.
+     */
+    ShapeRecord shape;
+    /**
+     * @brief Second endpoint name for connection deltas.
+     */
+    QString other;
+    /**
+     * @brief Affine coefficients `m11, m12, m21, m22, dx, dy` for `Transform`, and the placement
+     *        of an instance that is not a pure translation; empty otherwise.
+     */
+    QVector<qreal> params;
+    /**
+     * @brief Layer drawing the shape when it is an instance; keeps the layer alive for restores.
+     */
+    std::shared_ptr<InstanceLayerItem> layer;
+
+    /**
+     * @brief Estimates the heap and inline bytes retained by the delta.
+     */
+    qsizetype byteSize() const;
+};
+
+/**
+ * @struct HistoryStep
+ * @brief Group of deltas undone and redone as a single unit.
+ *
+ * One console command produces one step; a whole `execute_file` run also produces one step.
+ */
+struct HistoryStep
+{
+    /**
+     * @brief Command that produced the step, shown in undo/redo feedback.
+     */
+    QString label;
+    /**
+     * @brief Deltas in application order.
+     */
+    QVector<HistoryDelta> deltas;
+};
+
+/**
+ * @class CommandHistory
+ * @brief Linear undo/redo stack of `HistoryStep` entries bounded by a memory budget.
+ *
+ * When the estimated size exceeds the budget, the oldest steps are discarded. The most
+ * recent step is always kept so the last command remains undoable.
+ */
+class CommandHistory
+{
+public:
+    /**
+     * @brief Default memory budget in bytes.
+     */
+    static constexpr qsizetype kDefaultBudget = 64 * 1024 * 1024;
+
+    /**
+     * @brief Appends a step, discarding any redoable steps and trimming to the budget.
+     * @param step Step to record; empty steps are ignored.
+     */
+    void push(HistoryStep step);
+
+    /**
+     * @brief Moves the cursor back and returns the step to undo.
+     * @return Step whose deltas must be reverted in reverse order, or `nullptr` if nothing to undo.
+     */
+    HistoryStep* undo();
+
+    /**
+     * @brief Moves the cursor forward and returns the step to redo.
+     * @return Step whose deltas must be re-applied in order, or `nullptr` if nothing to redo.
+     */
+    HistoryStep* redo();
+
+    /**
+     * @brief Changes the memory budget and trims immediately.
+     * @param bytes New budget in bytes.
+     */
+    void setBudget(qsizetype bytes);
+
+    /**
+     * @brief Returns the configured budget in bytes.
+     */
+    qsizetype budget() const { return m_budget; }
+
+    /**
+     * @brief Returns the estimated bytes retained by all recorded steps.
+     */
+    qsizetype usedBytes() const { return m_usedBytes; }
+
+    /**
+     * @brief Returns the number of steps that can be undone.
+     */
+    int undoCount() const { return m_cursor; }
+
+    /**
+     * @brief Returns the number of steps that can be redone.
+     */
+    int redoCount() const { return m_steps.size() - m_cursor; }
+
+private:
+    static qsizetype stepBytes(const HistoryStep& step);
+    void trim();
+
+    QVector<HistoryStep> m_steps;
+    QVector<qsizetype> m_stepBytes;
+    int m_cursor = 0;
+    qsizetype m_usedBytes = 0;
+    qsizetype m_budget = kDefaultBudget;
+};
@@ -4,8 +4,55 @@
  * @author Nikol Grigoryan
  */
 #include "CommandParser.h"
-#include <QStringList>
-#include <QRegularExpression>
+#include <QLocale>
+#include <QVarLengthArray>
+
+namespace {
+
+/**
+ * @brief Whitespace that separates tokens: the ASCII set matched by `\s`.
+ */
+bool isSpace(QChar c)
+{
+    const ushort u = c.unicode();
+    return u == ' ' || (u >= '\t' && u <= '\r');
+}
+
+bool isDigit(QChar c)
+{
+    return c.unicode() >= '0' && c.unicode() <= '9';
+}
+
+/**
+ * @brief Skips whitespace starting at @p i.
+ */
+int skipSpaces(QStringView text, int i)
+{
+    while (i < text.size() && isSpace(text[i])) ++i;
+    return i;
+}
+
+/**
+ * @brief Matches `-?\d+(\.\d+)?` at @p i and advances past it.
+ * @return `false` when no number starts at @p i.
+ */
+bool scanNumber(QStringView text, int& i)
+{
+    int j = i;
+    if (j < text.size() && text[j] == '-') ++j;
+    const int digits = j;
+    while (j < text.size() && isDigit(text[j])) ++j;
+    if (j == digits) return false;
+    if (j < text.size() && text[j] == '.') {
+        const int fraction = ++j;
+        while (j < text.size() && isDigit(text[j])) ++j;
+        if (j == fraction) return false;
+    }
+    i = j;
+    return true;
+}
+
+} // namespace
 
 /**
  * @brief Parses a raw command string into a structured `Command`.
@@ -15,10 +62,29 @@
  * @return `true` on success, otherwise `false`.
  */
 bool CommandParser::parse(const QString& raw, Command& out, QString& errorMessage) const
+{
+    return parse(QStringView(raw), out, errorMessage);
+}
+
+/**
+ * @brief Parses a command from a view, slicing tokens out of it without copying.
+ *
+ * Only the command name and the stored flag keys and values become strings.
+ * @param raw Command text; only read during the call.
+ * @param out Destination structure that receives parsed fields on success.
+ * @param errorMessage Describes why parsing failed when the method returns `false`.
+ * @return `true` on success, otherwise `false`.
+ */
+bool CommandParser::parse(QStringView raw, Command& out, QString& errorMessage) const
 {
     // Tokenize by whitespace while preserving braces in coordinate tokens.
     // We assume users won't include spaces inside braces.
-    QStringList tokens = raw.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
+    QVarLengthArray<QStringView, 32> tokens;
+    for (int i = skipSpaces(raw, 0); i < raw.size(); i = skipSpaces(raw, i)) {
+        const int begin = i;
+        while (i < raw.size() && !isSpace(raw[i])) ++i;
+        tokens.append(raw.mid(begin, i - begin));
+    }
     if (tokens.isEmpty()) {
         errorMessage = "No tokens found in the command.";
         return false;
@@ -26,38 +92,37 @@ bool CommandParser::parse(const QString& raw, Command& out, QString& errorMessag
 
     // First token is the command name (e.g., create_line)
     out = Command{};
-    out.name = tokens.first();
-    tokens.pop_front();
+    out.name = tokens[0].toString();
 
     // Iterate over tokens pairwise for flags and values
-    for (int i = 0; i < tokens.size(); ++i) {
-        const QString t = tokens[i];
+    for (int i = 1; i < tokens.size(); ++i) {
+        const QStringView t = tokens[i];
 
-        // Coordinates come in the form: -coord_X {x,y}
-        if (t.startsWith("-coord_")) {
+        // Coordinates come in the form: -coord_X {x,y}; any other flag may also take an {x,y} value (e.g. -offset)
+        if (t.startsWith(QLatin1String("-coord_")) || (t.startsWith('-') && i + 1 < tokens.size() && tokens[i + 1].startsWith('{'))) {
             if (i + 1 >= tokens.size()) {
-                errorMessage = QString("Expected coordinate after '%1'.").arg(t);
+                errorMessage = QString("Expected coordinate after '%1'.").arg(t.toString());
                 return false;
             }
-            const QString coordToken = tokens[i + 1];
+            const QStringView coordToken = tokens[i + 1];
             QPointF pt;
             QString keyOut;
             if (!parseCoords(coordToken, keyOut, pt, errorMessage)) {
                 return false;
             }
             // Store the coordinate under the given coord key (e.g., coord_1)
-            out.coords.insert(t.mid(1), pt); // strip leading '-' for map key consistency
+            out.coords.insert(t.mid(1).toString(), pt); // strip leading '-' for map key consistency
             ++i; // consume the value
             continue;
         }
 
         // Generic flags like -name value
-        if (t.startsWith("-")) {
+        if (t.startsWith('-')) {
             if (i + 1 >= tokens.size()) {
-                errorMessage = QString("Expected value after flag '%1'.").arg(t);
+                errorMessage = QString("Expected value after flag '%1'.").arg(t.toString());
                 return false;
             }
-            const QString value = tokens[i + 1];
+            const QStringView value = tokens[i + 1];
             if (!parseFlagValue(t, value, out, errorMessage)) {
                 return false;
             }
@@ -66,7 +131,7 @@ bool CommandParser::parse(const QString& raw, Command& out, QString& errorMessag
         }
 
         // If a token is neither coordinate nor flag, it's invalid
-        errorMessage = QString("Unexpected token '%1'. Flags should start with '-'.").arg(t);
+        errorMessage = QString("Unexpected token '%1'. Flags should start with '-'.").arg(t.toString());
         return false;
     }
 
@@ -87,21 +152,43 @@ bool CommandParser::parse(const QString& raw, Command& out, QString& errorMessag
  * @param errorMessage Describes formatting issues when parsing fails.
  * @return `true` if the coordinate token is valid.
  */
-bool CommandParser::parseCoords(const QString& token, QString& keyOut, QPointF& ptOut, QString& errorMessage) const
+bool CommandParser::parseCoords(QStringView token, QString& keyOut, QPointF& ptOut, QString& errorMessage) const
 {
-    // Expect token format: {x,y}
-    static QRegularExpression re("^\\{\\s*(-?\\d+(?:\\.\\d+)?)\\s*,\\s*(-?\\d+(?:\\.\\d+)?)\\s*\\}$");
-    QRegularExpressionMatch m = re.match(token);
-    if (!m.hasMatch()) {
-        errorMessage = QString("Invalid coordinate format '%1'. Expected {x,y}.").arg(token);
+    Q_UNUSED(keyOut);
+
+    // Expect token format: {x,y}, matched by hand so the numbers are read in place
+    int i = 0;
+    int xBegin = 0, xEnd = 0, yBegin = 0, yEnd = 0;
+    bool matched = i < token.size() && token[i++] == '{';
+    if (matched) {
+        xBegin = i = skipSpaces(token, i);
+        matched = scanNumber(token, i);
+        xEnd = i;
+    }
+    if (matched) {
+        i = skipSpaces(token, i);
+        matched = i < token.size() && token[i++] == ',';
+    }
+    if (matched) {
+        yBegin = i = skipSpaces(token, i);
+        matched = scanNumber(token, i);
+        yEnd = i;
+    }
+    if (matched) {
+        i = skipSpaces(token, i);
+        matched = i + 1 == token.size() && token[i] == '}';
+    }
+    if (!matched) {
+        errorMessage = QString("Invalid coordinate format '%1'. Expected {x,y}.").arg(token.toString());
         return false;
     }
 
     bool okX = false, okY = false;
-    const double x = m.captured(1).toDouble(&okX);
-    const double y = m.captured(2).toDouble(&okY);
+    const QLocale c = QLocale::c();
+    const double x = c.toDouble(token.mid(xBegin, xEnd - xBegin), &okX);
+    const double y = c.toDouble(token.mid(yBegin, yEnd - yBegin), &okY);
     if (!okX || !okY) {
-        errorMessage = QString("Failed to parse numeric values in '%1'.").arg(token);
+        errorMessage = QString("Failed to parse numeric values in '%1'.").arg(token.toString());
         return false;
     }
 
@@ -117,11 +204,12 @@ bool CommandParser::parseCoords(const QString& token, QString& keyOut, QPointF&
  * @param errorMessage Reserved for compatibility; currently unused for failures.
  * @return `true` when the flag-value pair is accepted.
  */
-bool CommandParser::parseFlagValue(const QString& flag, const QString& value, Command& out, QString& errorMessage) const
+bool CommandParser::parseFlagValue(QStringView flag, QStringView value, Command& out, QString& errorMessage) const
 {
+    Q_UNUSED(errorMessage);
     // Store flags without the leading '-' to keep keys clean
-    const QString key = flag.mid(1);
+    const QString key = flag.mid(1).toString();
     // For now, we treat all non-coordinate flags as plain strings (e.g., name, file_path)
-    out.args.insert(key, value);
+    out.args.insert(key, value.toString());
     return true;
 }
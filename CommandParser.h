@@ -6,6 +6,7 @@
 #pragma once
 
 #include <QString>
+#include <QStringView>
 #include <QMap>
 #include <QVector>
 #include <QPointF>
@@ -29,6 +30,8 @@ struct Command
     QMap<QString, QString> args;
     /**
      * @brief Parsed coordinate values keyed by the flag name without the leading dash.
+     *
+     * Holds every `-coord_N` flag as well as any other flag whose value is written as `{x,y}`.
      */
     QMap<QString, QPointF> coords;
     /**
@@ -58,6 +61,17 @@ public:
      */
     bool parse(const QString& raw, Command& out, QString& errorMessage) const;
 
+    /**
+     * @brief Parses a command line held in someone else's buffer, such as a slice of a stream.
+     *
+     * Tokens are views into @p raw; nothing is copied except the strings stored in @p out.
+     * @param raw Command text; only read during the call.
+     * @param out Destination structure for parsed data.
+     * @param errorMessage Populated with a descriptive message on failure.
+     * @return `true` on success, otherwise `false`.
+     */
+    bool parse(QStringView raw, Command& out, QString& errorMessage) const;
+
 private:
     /**
      * @brief Parses a coordinate token of the form `{-1.0,2.5}`.
@@ -67,7 +81,7 @@ private:
      * @param errorMessage Describes parsing issues on failure.
      * @return `true` when the coordinate is valid.
      */
-    bool parseCoords(const QString& token, QString& keyOut, QPointF& ptOut, QString& errorMessage) const;
+    bool parseCoords(QStringView token, QString& keyOut, QPointF& ptOut, QString& errorMessage) const;
 
     /**
      * @brief Associates a flag with its value inside the command structure.
@@ -77,5 +91,5 @@ private:
      * @param errorMessage Reserved for compatibility; unused in the current implementation.
      * @return `true` when the flag-value pair is stored successfully.
      */
-    bool parseFlagValue(const QString& flag, const QString& value, Command& out, QString& errorMessage) const;
+    bool parseFlagValue(QStringView flag, QStringView value, Command& out, QString& errorMessage) const;
 };
@@ -0,0 +1,114 @@
+/**
+ * @file CommandQueue.cpp
+ * @brief Implements the lock-free multi-producer, single-consumer command submission queue.
+ * @author Nikol Grigoryan
+ */
+#include "CommandQueue.h"
+#include <thread>
+
+/**
+ * @brief Starts with a stub node that both ends point to.
+ */
+CommandQueue::CommandQueue(int capacity)
+    : m_capacity(capacity), m_head(new Node), m_tail(m_head.load(std::memory_order_relaxed))
+{
+}
+
+/**
+ * @brief Fails the submissions nobody will execute so their waiters are released.
+ */
+CommandQueue::~CommandQueue()
+{
+    drain(m_depth.load(std::memory_order_acquire), [](const Command&) {
+        return CommandResult{ false, "Command was not executed: the application is shutting down." };
+    });
+    delete m_tail;
+}
+
+/**
+ * @brief Claims room for one submission, failing when the queue is at capacity.
+ */
+bool CommandQueue::reserveSlot()
+{
+    const int depth = m_depth.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (depth > m_capacity) {
+        m_depth.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    int peak = m_peakDepth.load(std::memory_order_relaxed);
+    while (depth > peak && !m_peakDepth.compare_exchange_weak(peak, depth, std::memory_order_relaxed)) {
+    }
+    return true;
+}
+
+/**
+ * @brief Links a node after the current head and wakes the consumer if no drain is pending.
+ */
+std::future<CommandResult> CommandQueue::push(Command cmd)
+{
+    Node* node = new Node;
+    node->cmd = std::move(cmd);
+    std::future<CommandResult> result = node->promise.get_future();
+
+    // The exchange orders producers; the consumer sees the node once `next` is published
+    Node* prev = m_head.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+    m_submitted.fetch_add(1, std::memory_order_relaxed);
+
+    if (!m_wakePending.exchange(true, std::memory_order_acq_rel) && m_wake) m_wake();
+    return result;
+}
+
+/**
+ * @brief Pushes only when a slot is free.
+ */
+bool CommandQueue::trySubmit(Command cmd, std::future<CommandResult>* result)
+{
+    if (!reserveSlot()) {
+        m_rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    std::future<CommandResult> future = push(std::move(cmd));
+    if (result) *result = std::move(future);
+    return true;
+}
+
+/**
+ * @brief Yields until a slot is free, then pushes.
+ */
+std::future<CommandResult> CommandQueue::submit(Command cmd)
+{
+    while (!reserveSlot()) std::this_thread::yield();
+    return push(std::move(cmd));
+}
+
+/**
+ * @brief Parses on the producer's thread so the consumer only executes.
+ */
+std::future<CommandResult> CommandQueue::submit(const QString& line)
+{
+    Command cmd;
+    QString error;
+    if (!CommandParser().parse(line.trimmed(), cmd, error)) {
+        std::promise<CommandResult> failed;
+        failed.set_value(CommandResult{ false, QString("Parse error: %1").arg(error) });
+        return failed.get_future();
+    }
+    return submit(std::move(cmd));
+}
+
+/**
+ * @brief Reads every counter with relaxed loads.
+ */
+CommandQueue::Metrics CommandQueue::metrics() const
+{
+    Metrics m;
+    m.depth = m_depth.load(std::memory_order_relaxed);
+    m.peakDepth = m_peakDepth.load(std::memory_order_relaxed);
+    m.submitted = m_submitted.load(std::memory_order_relaxed);
+    m.rejected = m_rejected.load(std::memory_order_relaxed);
+    m.completed = m_completed.load(std::memory_order_relaxed);
+    m.batches = m_batches.load(std::memory_order_relaxed);
+    return m;
+}
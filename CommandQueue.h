@@ -0,0 +1,172 @@
+/**
+ * @file CommandQueue.h
+ * @brief Declares the lock-free multi-producer, single-consumer command submission queue.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QString>
+#include <atomic>
+#include <functional>
+#include <future>
+#include "CommandParser.h"
+#include "CommandResult.h"
+
+/**
+ * @class CommandQueue
+ * @brief Lets any thread submit commands that the GUI thread executes in batches.
+ *
+ * Producers link nodes into an intrusive linked list with a single atomic exchange
+ * (Vyukov's MPSC queue), so submitting never takes a lock and never waits for the
+ * consumer. Each submission carries a promise; its future resolves once the consumer has
+ * executed the command. A bounded depth provides backpressure: `trySubmit` refuses work
+ * when the queue is full, and `submit` waits for room.
+ *
+ * The queue does not know how to execute commands. The consumer calls `drain` with a
+ * callable, and the producer that makes the queue non-empty triggers the wake callback so
+ * the consumer can schedule a drain on its own thread.
+ */
+class CommandQueue
+{
+public:
+    /**
+     * @brief Default bound on queued submissions.
+     */
+    static constexpr int kDefaultCapacity = 65536;
+
+    /**
+     * @brief Counters describing queue activity; read without locking, so only approximately consistent.
+     */
+    struct Metrics
+    {
+        int depth = 0;          ///< Submissions currently queued.
+        int peakDepth = 0;      ///< Highest depth observed.
+        qint64 submitted = 0;   ///< Submissions accepted.
+        qint64 rejected = 0;    ///< `trySubmit` calls refused because the queue was full.
+        qint64 completed = 0;   ///< Submissions executed by the consumer.
+        qint64 batches = 0;     ///< `drain` calls that executed at least one submission.
+    };
+
+    /**
+     * @brief Creates an empty queue.
+     * @param capacity Maximum number of queued submissions.
+     */
+    explicit CommandQueue(int capacity = kDefaultCapacity);
+
+    /**
+     * @brief Resolves every remaining submission with an error and frees the nodes.
+     */
+    ~CommandQueue();
+
+    CommandQueue(const CommandQueue&) = delete;
+    CommandQueue& operator=(const CommandQueue&) = delete;
+
+    /**
+     * @brief Sets the callable invoked, on the producer's thread, when the consumer should drain.
+     *
+     * Called at most once per drain, so a burst of submissions schedules one drain. The
+     * callable must be thread-safe, typically a queued `QMetaObject::invokeMethod`.
+     */
+    void setWakeCallback(std::function<void()> wake) { m_wake = std::move(wake); }
+
+    /**
+     * @brief Queues a parsed command if there is room.
+     * @param cmd Command to execute.
+     * @param result Receives the future of the result when the command was queued.
+     * @return `false` when the queue is full.
+     */
+    bool trySubmit(Command cmd, std::future<CommandResult>* result);
+
+    /**
+     * @brief Queues a parsed command, waiting while the queue is full.
+     *
+     * Must not be called from the consumer thread, which would wait for itself.
+     * @return Future of the command's result.
+     */
+    std::future<CommandResult> submit(Command cmd);
+
+    /**
+     * @brief Parses a raw line on the calling thread and queues it, waiting while the queue is full.
+     *
+     * A line that does not parse is not queued; its future is already resolved with the
+     * parse error. Must not be called from the consumer thread.
+     * @return Future of the command's result.
+     */
+    std::future<CommandResult> submit(const QString& line);
+
+    /**
+     * @brief Executes up to @p maxBatch queued commands in submission order.
+     *
+     * Must only be called from the consumer thread.
+     * @param maxBatch Upper bound on commands executed by this call.
+     * @param execute Callable `CommandResult execute(const Command&)`.
+     * @return Number of commands executed.
+     */
+    template <typename Fn>
+    int drain(int maxBatch, Fn execute)
+    {
+        // Clear first: a submission that completes after this point wakes the consumer again
+        m_wakePending.exchange(false, std::memory_order_acq_rel);
+
+        int done = 0;
+        Node* next = nullptr;
+        while (done < maxBatch && (next = m_tail->next.load(std::memory_order_acquire)) != nullptr) {
+            Node* stub = m_tail;
+            m_tail = next;
+            delete stub;
+
+            // `next` is the new stub; its payload is consumed here and never read again
+            m_depth.fetch_sub(1, std::memory_order_relaxed);
+            next->promise.set_value(execute(next->cmd));
+            next->cmd = Command{};
+            ++done;
+        }
+        if (done > 0) {
+            m_completed.fetch_add(done, std::memory_order_relaxed);
+            m_batches.fetch_add(1, std::memory_order_relaxed);
+        }
+        return done;
+    }
+
+    /**
+     * @brief Reports whether a submission is visible to the consumer. Consumer thread only.
+     */
+    bool hasPending() const { return m_tail->next.load(std::memory_order_acquire) != nullptr; }
+
+    /**
+     * @brief Returns the configured capacity.
+     */
+    int capacity() const { return m_capacity; }
+
+    /**
+     * @brief Returns a snapshot of the counters.
+     */
+    Metrics metrics() const;
+
+private:
+    /**
+     * @brief Linked-list node; the list always starts with an already consumed stub.
+     */
+    struct Node
+    {
+        std::atomic<Node*> next{nullptr};
+        Command cmd;
+        std::promise<CommandResult> promise;
+    };
+
+    bool reserveSlot();
+    std::future<CommandResult> push(Command cmd);
+
+    const int m_capacity;
+    std::atomic<Node*> m_head;  ///< Most recently submitted node; producers exchange it.
+    Node* m_tail;               ///< Consumed stub; only the consumer touches it.
+    std::function<void()> m_wake;
+    std::atomic<bool> m_wakePending{false};
+
+    std::atomic<int> m_depth{0};
+    std::atomic<int> m_peakDepth{0};
+    std::atomic<qint64> m_submitted{0};
+    std::atomic<qint64> m_rejected{0};
+    std::atomic<qint64> m_completed{0};
+    std::atomic<qint64> m_batches{0};
+};
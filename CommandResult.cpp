@@ -0,0 +1,47 @@
+/**
+ * @file CommandResult.cpp
+ * @brief Formats command results on demand.
+ * @author Nikol Grigoryan
+ */
+#include "CommandResult.h"
+
+/**
+ * @brief Builds the message each handler used to format eagerly; identical text for every code.
+ */
+QString CommandResult::text() const
+{
+    switch (code) {
+    case Code::Text:
+        return message;
+    case Code::LineCreated:
+        return QString("Line '%1' created from (%2,%3) to (%4,%5).")
+            .arg(subject).arg(first.x()).arg(first.y()).arg(second.x()).arg(second.y());
+    case Code::TriangleCreated:
+        return QString("Triangle '%1' created.").arg(subject);
+    case Code::RectangleCreated:
+        return QString("Rectangle '%1' created from four corners.").arg(subject);
+    case Code::RectangleCreatedDiagonal:
+        return QString("Rectangle '%1' created from diagonal points.").arg(subject);
+    case Code::SquareCreated:
+        return QString("Square '%1' created from four vertices.").arg(subject);
+    case Code::SquareCreatedDiagonal:
+        return QString("Square '%1' created from diagonal points.").arg(subject);
+    case Code::InstanceCreated:
+        return QString("Instance '%1' of '%2' created at offset (%3,%4).").arg(subject, object).arg(first.x()).arg(first.y());
+    case Code::Connected:
+        return QString("Connected '%1' and '%2' by their centers.").arg(subject, object);
+    case Code::Disconnected:
+        return QString("Disconnected '%1' and '%2'.").arg(subject, object);
+    case Code::Deleted:
+        return QString("Deleted %1 shape(s) and %2 connector(s).").arg(count).arg(extra);
+    case Code::Moved:
+        return QString("Moved %1 shape(s) by (%2,%3).").arg(count).arg(first.x()).arg(first.y());
+    case Code::Rotated:
+        return QString("Rotated %1 shape(s) by %2 degrees.").arg(count).arg(value);
+    case Code::Scaled:
+        return QString("Scaled %1 shape(s) by %2.").arg(count).arg(value);
+    case Code::Staged:
+        return QString("Staged '%1'; %2 command(s) waiting for commit.").arg(subject).arg(count);
+    }
+    return message;
+}
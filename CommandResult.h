@@ -0,0 +1,61 @@
+/**
+ * @file CommandResult.h
+ * @brief Declares the outcome of an executed command, formatted only when it is shown.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QPointF>
+#include <QString>
+
+/**
+ * @struct CommandResult
+ * @brief Success flag plus either a ready message or a result code with its typed payload.
+ *
+ * Handlers on the batch hot path (`create_*` and `create_instance`, `connect`, `disconnect`, `delete`, `move`,
+ * `rotate`, `scale`, and every command staged in a transaction) set a `code` and the
+ * payload fields it names instead of building a string. `text()` formats the message on
+ * demand, so a script line whose success is never shown costs no formatting or
+ * allocation. Every other result, and every failure, carries its text in `message` with
+ * `Code::Text`.
+ */
+struct CommandResult
+{
+    /**
+     * @brief What the result describes, and so which payload fields are set.
+     */
+    enum class Code : quint8
+    {
+        Text,                      ///< `message` is the whole feedback.
+        LineCreated,               ///< `subject` from `first` to `second`.
+        TriangleCreated,           ///< `subject`.
+        RectangleCreated,          ///< `subject`, from four corners.
+        RectangleCreatedDiagonal,  ///< `subject`, from diagonal points.
+        SquareCreated,             ///< `subject`, from four vertices.
+        SquareCreatedDiagonal,     ///< `subject`, from diagonal points.
+        InstanceCreated,           ///< `subject` copied from `object` at the offset `first`.
+        Connected,                 ///< `subject` and `object`.
+        Disconnected,              ///< `subject` and `object`.
+        Deleted,                   ///< `count` shapes and `extra` connectors.
+        Moved,                     ///< `count` shapes by the offset `first`.
+        Rotated,                   ///< `count` shapes by `value` degrees.
+        Scaled,                    ///< `count` shapes by the factor `value`.
+        Staged                     ///< `subject` staged; `count` commands now wait for `commit`.
+    };
+
+    bool ok = false;           ///< `true` when the command succeeded.
+    QString message;           ///< Feedback, as the console would log it; only meaningful for `Code::Text`.
+    Code code = Code::Text;    ///< Result kind.
+    QString subject;           ///< First name in the payload.
+    QString object;            ///< Second name in the payload.
+    QPointF first;             ///< First point in the payload.
+    QPointF second;            ///< Second point in the payload.
+    double value = 0.0;        ///< Scalar in the payload.
+    int count = 0;             ///< Primary count in the payload.
+    int extra = 0;             ///< Secondary count in the payload.
+
+    /**
+     * @brief Returns the user-facing message, formatting the payload if there is one.
+     */
+    QString text() const;
+};
@@ -0,0 +1,107 @@
+/**
+ * @file CommandScheduler.cpp
+ * @brief Implements the GUI-thread scheduler that lets console commands preempt running scripts.
+ * @author Nikol Grigoryan
+ */
+#include "CommandScheduler.h"
+#include <algorithm>
+
+/**
+ * @brief Stores the per-slice budget in nanoseconds.
+ */
+CommandScheduler::CommandScheduler(int sliceBudgetMs)
+    : m_sliceBudgetNs(qint64(sliceBudgetMs) * 1000000)
+{
+}
+
+/**
+ * @brief Appends the task to its class and starts its wait clock.
+ */
+void CommandScheduler::post(Priority priority, Task task)
+{
+    Entry entry;
+    entry.task = std::move(task);
+    entry.readySince.start();
+    queue(priority).push_back(std::move(entry));
+    requestSlice();
+}
+
+/**
+ * @brief Interactive work first; background jobs share whatever budget is left.
+ */
+bool CommandScheduler::runSlice()
+{
+    m_sliceRequested = false;
+
+    // Tasks posted by a running task are picked up by the same loop
+    while (!queue(Priority::Interactive).empty()) runFront(Priority::Interactive, 0);
+
+    QElapsedTimer slice;
+    slice.start();
+    while (!queue(Priority::Background).empty()) {
+        const qint64 remaining = m_sliceBudgetNs - slice.nsecsElapsed();
+        if (remaining <= 0 || !runFront(Priority::Background, remaining)) break;
+    }
+
+    const bool more = isBusy(Priority::Interactive) || isBusy(Priority::Background);
+    if (more) requestSlice();
+    return more;
+}
+
+/**
+ * @brief Records the wait, runs the task, and either retires it or restarts its wait clock.
+ */
+bool CommandScheduler::runFront(Priority priority, qint64 budgetNs)
+{
+    std::deque<Entry>& entries = queue(priority);
+    ClassStats& stats = statsFor(priority);
+
+    const qint64 waitNs = entries.front().readySince.nsecsElapsed();
+    stats.totalWaitNs += waitNs;
+    stats.maxWaitNs = std::max(stats.maxWaitNs, waitNs);
+    ++stats.runs;
+
+    // The task may post more work, so keep no reference into the deque across the call
+    QElapsedTimer run;
+    run.start();
+    const bool firstRun = !entries.front().started;
+    entries.front().started = true;
+    Task task = std::move(entries.front().task);
+    const bool finished = task(budgetNs) || priority == Priority::Interactive;
+
+    if (!finished) {
+        entries.front().task = std::move(task);
+        entries.front().readySince.start();
+        return false;
+    }
+
+    entries.pop_front();
+    ++stats.completed;
+    if (firstRun) {
+        const qint64 latencyNs = waitNs + run.nsecsElapsed();
+        stats.totalLatencyNs += latencyNs;
+        stats.maxLatencyNs = std::max(stats.maxLatencyNs, latencyNs);
+        if (latencyNs > qint64(kLatencyTargetMs) * 1000000) ++stats.overTarget;
+    }
+    return true;
+}
+
+/**
+ * @brief Copies the counters and fills in the current queue length.
+ */
+CommandScheduler::ClassStats CommandScheduler::stats(Priority priority) const
+{
+    ClassStats copy = m_stats[static_cast<int>(priority)];
+    copy.pending = static_cast<int>(queue(priority).size());
+    return copy;
+}
+
+/**
+ * @brief Wakes the owner once per slice.
+ */
+void CommandScheduler::requestSlice()
+{
+    if (m_sliceRequested || !m_wake) return;
+    m_sliceRequested = true;
+    m_wake();
+}
@@ -0,0 +1,131 @@
+/**
+ * @file CommandScheduler.h
+ * @brief Declares the GUI-thread scheduler that lets console commands preempt running scripts.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QElapsedTimer>
+#include <QString>
+#include <deque>
+#include <functional>
+
+/**
+ * @class CommandScheduler
+ * @brief Interleaves short interactive commands with long background jobs on one thread.
+ *
+ * Work is posted in one of two priority classes. Every slice first runs all pending
+ * interactive tasks, then spends at most the slice budget on background jobs, which are
+ * resumable and run one at a time in FIFO order. The owner runs one slice per event-loop
+ * turn, so a command typed while a script runs waits for at most the rest of the current
+ * slice, and the script continues in the next slice.
+ *
+ * The scheduler only measures and orders work; it is told when to run by the owner and
+ * asks for a slice through the wake callback.
+ */
+class CommandScheduler
+{
+public:
+    /**
+     * @brief Priority classes, highest first.
+     */
+    enum class Priority
+    {
+        Interactive, ///< Console commands; always run at the next slice.
+        Background   ///< Resumable jobs such as scripts; run within the slice budget.
+    };
+
+    /**
+     * @brief Callable that does some work and reports whether the job is finished.
+     *
+     * The argument is the time, in nanoseconds, the job may use before it should return.
+     * Interactive tasks run to completion regardless and should return `true`.
+     */
+    using Task = std::function<bool(qint64 budgetNs)>;
+
+    /**
+     * @brief Wait and latency figures of one priority class.
+     */
+    struct ClassStats
+    {
+        qint64 runs = 0;           ///< Slices given to tasks of this class.
+        qint64 completed = 0;      ///< Tasks that finished.
+        qint64 totalWaitNs = 0;    ///< Sum of the time tasks spent runnable but not running.
+        qint64 maxWaitNs = 0;      ///< Longest single wait.
+        qint64 totalLatencyNs = 0; ///< Sum of wait plus run time of completed one-slice tasks.
+        qint64 maxLatencyNs = 0;   ///< Longest wait plus run time of a one-slice task.
+        qint64 overTarget = 0;     ///< One-slice tasks whose latency exceeded `kLatencyTargetMs`.
+        int pending = 0;           ///< Tasks currently waiting.
+    };
+
+    /**
+     * @brief Latency, from posting to completion, that interactive commands are expected to meet.
+     */
+    static constexpr int kLatencyTargetMs = 50;
+
+    /**
+     * @brief Creates an idle scheduler.
+     * @param sliceBudgetMs Time background jobs may use per slice.
+     */
+    explicit CommandScheduler(int sliceBudgetMs);
+
+    /**
+     * @brief Sets the callable invoked when a slice should run; at most one request is outstanding.
+     */
+    void setWakeCallback(std::function<void()> wake) { m_wake = std::move(wake); }
+
+    /**
+     * @brief Queues a task and requests a slice if none is pending.
+     * @param priority Class of the task.
+     * @param task Work to run; called again in later slices until it returns `true`.
+     */
+    void post(Priority priority, Task task);
+
+    /**
+     * @brief Runs every interactive task, then background jobs until the slice budget is spent.
+     * @return `true` when work remains, in which case another slice has been requested.
+     */
+    bool runSlice();
+
+    /**
+     * @brief Reports whether a task of the given class is queued or running.
+     */
+    bool isBusy(Priority priority) const { return !queue(priority).empty(); }
+
+    /**
+     * @brief Returns the counters of one priority class.
+     */
+    ClassStats stats(Priority priority) const;
+
+private:
+    /**
+     * @brief Queued task with the moment it last became runnable.
+     */
+    struct Entry
+    {
+        Task task;
+        QElapsedTimer readySince;
+        bool started = false;
+    };
+
+    std::deque<Entry>& queue(Priority priority) { return m_queues[static_cast<int>(priority)]; }
+    const std::deque<Entry>& queue(Priority priority) const { return m_queues[static_cast<int>(priority)]; }
+    ClassStats& statsFor(Priority priority) { return m_stats[static_cast<int>(priority)]; }
+
+    /**
+     * @brief Runs the front task of a class once and updates its counters.
+     * @return `true` when the task finished and was removed.
+     */
+    bool runFront(Priority priority, qint64 budgetNs);
+
+    /**
+     * @brief Calls the wake callback unless a slice is already requested.
+     */
+    void requestSlice();
+
+    const qint64 m_sliceBudgetNs;
+    std::deque<Entry> m_queues[2];
+    ClassStats m_stats[2];
+    std::function<void()> m_wake;
+    bool m_sliceRequested = false;
+};
@@ -0,0 +1,203 @@
+/**
+ * @file CommandServer.cpp
+ * @brief Implements the local socket server that accepts newline-delimited commands from other processes.
+ * @author Nikol Grigoryan
+ */
+#include "CommandServer.h"
+#include <QElapsedTimer>
+#include <QLocalSocket>
+#include <QPointer>
+
+namespace {
+
+/**
+ * @brief Escapes a message so it fits on one reply line.
+ */
+QByteArray escapeMessage(QString message)
+{
+    message.replace('\\', "\\\\");
+    message.replace('\n', "\\n");
+    return message.toUtf8();
+}
+
+} // namespace
+
+/**
+ * @brief Wires up the listening socket; nothing is accepted until `listen()`.
+ */
+CommandServer::CommandServer(Executor execute, QObject* parent)
+    : QObject(parent), m_execute(std::move(execute)), m_server(this)
+{
+    connect(&m_server, &QLocalServer::newConnection, this, &CommandServer::onNewConnection);
+}
+
+/**
+ * @brief Closes every connection before the socket objects are destroyed.
+ */
+CommandServer::~CommandServer()
+{
+    close();
+}
+
+/**
+ * @brief Removes a stale socket file and starts listening.
+ */
+bool CommandServer::listen(const QString& name, QString& error)
+{
+    close();
+    QLocalServer::removeServer(name);
+    if (!m_server.listen(name)) {
+        error = QString("Cannot listen on '%1': %2").arg(name, m_server.errorString());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Stops accepting and drops every client without waiting for unsent replies.
+ */
+void CommandServer::close()
+{
+    m_server.close();
+    const QList<QLocalSocket*> sockets = m_clients.keys();
+    for (QLocalSocket* socket : sockets) {
+        socket->disconnect(this);
+        socket->abort();
+        dropClient(socket);
+    }
+}
+
+/**
+ * @brief Fills in the number of connected clients.
+ */
+CommandServer::Stats CommandServer::stats() const
+{
+    Stats copy = m_stats;
+    copy.clients = m_clients.size();
+    return copy;
+}
+
+/**
+ * @brief Accepts pending clients and caps their read buffers.
+ */
+void CommandServer::onNewConnection()
+{
+    while (QLocalSocket* socket = m_server.nextPendingConnection()) {
+        // A full read buffer stops Qt from draining the socket, so the kernel pushes back on the client
+        socket->setReadBufferSize(kReadBufferBytes);
+        m_clients.insert(socket, Client{});
+        ++m_stats.connections;
+
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { serve(socket); });
+        connect(socket, &QLocalSocket::bytesWritten, this, [this, socket]() {
+            // Resume a client that was paused for not reading its replies
+            if (socket->bytesToWrite() < kWriteBufferBytes / 2 && socket->canReadLine()) scheduleServe(socket);
+        });
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+            // Lines the client sent before hanging up still run; their replies are dropped
+            auto it = m_clients.find(socket);
+            if (it == m_clients.end()) return;
+            it->closing = true;
+            scheduleServe(socket);
+        });
+
+        // Lines may have arrived together with the connection
+        if (socket->canReadLine()) scheduleServe(socket);
+    }
+}
+
+/**
+ * @brief Runs complete lines in order until the batch is full, then writes all replies at once.
+ */
+void CommandServer::serve(QLocalSocket* socket)
+{
+    auto it = m_clients.find(socket);
+    if (it == m_clients.end()) return;
+    it->scheduled = false;
+
+    // After a hang-up the last line may lack its newline
+    const auto hasLine = [socket, &it]() {
+        return socket->canReadLine() || (it->closing && socket->bytesAvailable() > 0);
+    };
+
+    // Serve a client only once it has read most of its earlier replies
+    if (!it->closing && socket->bytesToWrite() >= kWriteBufferBytes) {
+        ++m_stats.stalls;
+        return;
+    }
+
+    // A line longer than the read buffer can never complete
+    if (!it->closing && !socket->canReadLine() && socket->bytesAvailable() >= kReadBufferBytes) {
+        socket->write(QByteArray::number(it->nextSeq) + " ERR Line exceeds "
+                      + QByteArray::number(kReadBufferBytes) + " bytes; closing connection.\n");
+        // Forget the client now, but keep the socket until the error reply has been sent
+        m_clients.erase(it);
+        socket->disconnect(this);
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+        socket->disconnectFromServer();
+        return;
+    }
+
+    QByteArray replies;
+    QElapsedTimer clock;
+    clock.start();
+    int executed = 0;
+    while (executed < kMaxBatch && clock.elapsed() < kBatchBudgetMs && hasLine()) {
+        const QString line = QString::fromUtf8(socket->readLine()).trimmed();
+        if (line.isEmpty() || line.startsWith('#')) continue;
+
+        Command cmd;
+        CommandResult result;
+        if (!m_parser.parse(line, cmd, result.message)) {
+            result.message = QString("Parse error: %1").arg(result.message);
+        } else {
+            result = m_execute(cmd);
+        }
+
+        replies += QByteArray::number(it->nextSeq++);
+        replies += result.ok ? " OK " : " ERR ";
+        replies += escapeMessage(result.text());
+        replies += '\n';
+        ++executed;
+        ++m_stats.commands;
+        if (!result.ok) ++m_stats.failures;
+
+        // The command may have closed the server, dropping this client
+        it = m_clients.find(socket);
+        if (it == m_clients.end()) return;
+    }
+
+    if (!replies.isEmpty() && !it->closing) {
+        socket->write(replies);
+        ++m_stats.batches;
+    }
+    if (hasLine()) {
+        scheduleServe(socket);
+    } else if (it->closing) {
+        dropClient(socket);
+    }
+}
+
+/**
+ * @brief Continues a client on a later event-loop turn so other clients and the GUI get a turn.
+ */
+void CommandServer::scheduleServe(QLocalSocket* socket)
+{
+    auto it = m_clients.find(socket);
+    if (it == m_clients.end() || it->scheduled) return;
+    it->scheduled = true;
+
+    QPointer<QLocalSocket> guard(socket);
+    QMetaObject::invokeMethod(this, [this, guard]() {
+        if (guard) serve(guard.data());
+    }, Qt::QueuedConnection);
+}
+
+/**
+ * @brief Removes the client's state; the socket is deleted once control returns to the event loop.
+ */
+void CommandServer::dropClient(QLocalSocket* socket)
+{
+    if (m_clients.remove(socket) == 0) return;
+    socket->deleteLater();
+}
@@ -0,0 +1,159 @@
+/**
+ * @file CommandServer.h
+ * @brief Declares the local socket server that accepts newline-delimited commands from other processes.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QLocalServer>
+#include <QString>
+#include <functional>
+#include "CommandParser.h"
+#include "CommandResult.h"
+
+class QLocalSocket;
+
+/**
+ * @class CommandServer
+ * @brief Serves commands sent over a `QLocalServer` (a Unix domain socket on Unix).
+ *
+ * Clients write one command per line and may pipeline as many lines as they like without
+ * waiting for replies. Each client's lines are executed strictly in order, and every
+ * command line is acknowledged with one reply line:
+ *
+ *     <seq> OK <message>
+ *     <seq> ERR <message>
+ *
+ * where `seq` counts the client's command lines from 1; blank and `#` lines are skipped
+ * without a reply. Backslashes and newlines in messages are escaped as `\\` and `\n`.
+ * Lines already received when a client disconnects are still executed.
+ *
+ * Lines are executed in time-boxed batches, one client per event-loop turn, and the
+ * replies of a batch are sent with a single write. Per-client buffers are bounded: the
+ * socket's read buffer is capped, and a client whose replies pile up unread is not served
+ * until it catches up, so a fast or stalled client blocks in its own `write` instead of
+ * growing the application's memory.
+ *
+ * The server lives on the thread that owns it and executes through the given callable on
+ * that thread.
+ */
+class CommandServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Executes one parsed command and returns its outcome.
+     */
+    using Executor = std::function<CommandResult(const Command&)>;
+
+    /**
+     * @brief Bytes of unread input kept per client; also the longest accepted line.
+     */
+    static constexpr qint64 kReadBufferBytes = 1 << 20;
+
+    /**
+     * @brief Bytes of unsent replies after which a client is no longer served until it reads them.
+     */
+    static constexpr qint64 kWriteBufferBytes = 1 << 20;
+
+    /**
+     * @brief Maximum number of lines executed for one client per event-loop turn.
+     */
+    static constexpr int kMaxBatch = 1024;
+
+    /**
+     * @brief Time one client's batch may take before other work gets a turn.
+     */
+    static constexpr int kBatchBudgetMs = 8;
+
+    /**
+     * @brief Counters describing server activity.
+     */
+    struct Stats
+    {
+        int clients = 0;        ///< Currently connected clients.
+        qint64 connections = 0; ///< Clients accepted since the server started.
+        qint64 commands = 0;    ///< Command lines acknowledged.
+        qint64 failures = 0;    ///< Command lines acknowledged with `ERR`.
+        qint64 batches = 0;     ///< Writes of batched replies.
+        qint64 stalls = 0;      ///< Times a client was paused because it did not read its replies.
+    };
+
+    /**
+     * @brief Creates a server that is not listening yet.
+     * @param execute Callable that runs each command.
+     * @param parent Optional QObject parent.
+     */
+    explicit CommandServer(Executor execute, QObject* parent = nullptr);
+
+    /**
+     * @brief Disconnects every client and stops listening.
+     */
+    ~CommandServer() override;
+
+    /**
+     * @brief Starts listening, replacing a stale socket file left by a crashed instance.
+     * @param name Socket name, or an absolute path to the socket file.
+     * @param error Describes why the server could not listen.
+     * @return `true` when the server is listening.
+     */
+    bool listen(const QString& name, QString& error);
+
+    /**
+     * @brief Stops listening and disconnects every client.
+     */
+    void close();
+
+    /**
+     * @brief Reports whether the server accepts connections.
+     */
+    bool isListening() const { return m_server.isListening(); }
+
+    /**
+     * @brief Returns the full name clients connect to.
+     */
+    QString fullServerName() const { return m_server.fullServerName(); }
+
+    /**
+     * @brief Returns a copy of the counters.
+     */
+    Stats stats() const;
+
+private slots:
+    void onNewConnection();
+
+private:
+    /**
+     * @brief Per-client protocol state.
+     */
+    struct Client
+    {
+        qint64 nextSeq = 1;     ///< Sequence number of the next command line.
+        bool scheduled = false; ///< A continuation batch is already queued.
+        bool closing = false;   ///< The client hung up; its remaining lines are still executed.
+    };
+
+    /**
+     * @brief Executes one batch of a client's complete lines and sends the replies.
+     */
+    void serve(QLocalSocket* socket);
+
+    /**
+     * @brief Queues another batch for a client on the next event-loop turn.
+     */
+    void scheduleServe(QLocalSocket* socket);
+
+    /**
+     * @brief Forgets a client and releases its socket.
+     */
+    void dropClient(QLocalSocket* socket);
+
+    Executor m_execute;
+    QLocalServer m_server;
+    QHash<QLocalSocket*, Client> m_clients;
+    CommandParser m_parser;
+    Stats m_stats;
+};
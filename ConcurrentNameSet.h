@@ -0,0 +1,71 @@
+/**
+ * @file ConcurrentNameSet.h
+ * @brief Declares a sharded, thread-safe map from shape names to the line that defines them.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QString>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <memory>
+
+/**
+ * @class ConcurrentNameSet
+ * @brief Records, for every name, the smallest script line that defines it.
+ *
+ * Names are spread over independently locked shards by hash, so workers claiming
+ * different names rarely contend. The result does not depend on the order in which
+ * workers claim: each shard keeps the minimum line per name.
+ */
+class ConcurrentNameSet
+{
+public:
+    /**
+     * @brief Number of independently locked shards.
+     */
+    static constexpr int kShardCount = 64;
+
+    /**
+     * @brief Creates an empty set.
+     */
+    ConcurrentNameSet() : m_shards(new Shard[kShardCount]) {}
+
+    /**
+     * @brief Records that @p line defines @p name, keeping the earliest line.
+     */
+    void claim(const QString& name, int line)
+    {
+        Shard& shard = shardOf(name);
+        QMutexLocker lock(&shard.mutex);
+        auto it = shard.lines.find(name);
+        if (it == shard.lines.end()) {
+            shard.lines.insert(name, line);
+        } else if (line < it.value()) {
+            it.value() = line;
+        }
+    }
+
+    /**
+     * @brief Returns the earliest line defining @p name, or `-1` when none does.
+     *
+     * Safe to call concurrently once all claims have finished.
+     */
+    int firstLine(const QString& name) const
+    {
+        const Shard& shard = shardOf(name);
+        return shard.lines.value(name, -1);
+    }
+
+private:
+    struct Shard
+    {
+        QMutex mutex;
+        QHash<QString, int> lines;
+    };
+
+    Shard& shardOf(const QString& name) const { return m_shards[qHash(name) % kShardCount]; }
+
+    std::unique_ptr<Shard[]> m_shards;
+};
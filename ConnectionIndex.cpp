@@ -0,0 +1,259 @@
+/**
+ * @file ConnectionIndex.cpp
+ * @brief Implements the adjacency index for connectors between shapes.
+ * @author Nikol Grigoryan
+ */
+#include "ConnectionIndex.h"
+#include <algorithm>
+
+/**
+ * @brief Releases the connector items of all live edges and all batches.
+ */
+ConnectionIndex::~ConnectionIndex()
+{
+    for (Edge& e : m_edges) {
+        if (e.live) delete e.item;
+    }
+    for (auto it = m_batches.cbegin(); it != m_batches.cend(); ++it) delete it.key();
+}
+
+/**
+ * @brief Registers an edge drawn by its own line item.
+ * @param a First endpoint.
+ * @param b Second endpoint.
+ * @param item Connector item to own.
+ * @return New edge id.
+ */
+int ConnectionIndex::add(ShapeHandle a, ShapeHandle b, QGraphicsLineItem* item)
+{
+    const int id = link(a, b);
+    m_edges[id].item = item;
+    ++m_itemCount;
+    return id;
+}
+
+/**
+ * @brief Registers an edge drawn by a batch slot.
+ * @param a First endpoint.
+ * @param b Second endpoint.
+ * @param batch Batch item to own.
+ * @param slot Line slot inside the batch.
+ * @return New edge id.
+ */
+int ConnectionIndex::add(ShapeHandle a, ShapeHandle b, ConnectorBatchItem* batch, int slot)
+{
+    const int id = link(a, b);
+    m_edges[id].batch = batch;
+    m_edges[id].slot = slot;
+    QVector<int>& owners = m_batches[batch];
+    if (slot >= owners.size()) owners.resize(slot + 1);
+    owners[slot] = id;
+    return id;
+}
+
+/**
+ * @brief Updates the line drawn for an edge, whichever item draws it.
+ * @param id Live edge id.
+ * @param line New line.
+ */
+void ConnectionIndex::setLine(int id, const QLineF& line)
+{
+    const Edge& e = m_edges[id];
+    if (e.item) {
+        e.item->setLine(line);
+    } else if (e.batch) {
+        e.batch->setLine(e.slot, line);
+    }
+}
+
+/**
+ * @brief Unlinks an edge from both endpoints and releases its connector.
+ * @param id Edge id.
+ * @return `true` if the edge was live.
+ */
+bool ConnectionIndex::remove(int id)
+{
+    if (id < 0 || id >= m_edges.size() || !m_edges[id].live) return false;
+
+    Edge& e = m_edges[id];
+    unlink(e.a, id, e.posA);
+    if (e.b != e.a) unlink(e.b, id, e.posB);
+
+    if (e.item) --m_itemCount;
+    delete e.item;
+    if (e.batch) {
+        e.batch->removeLine(e.slot);
+        if (e.batch->liveCount() == 0) {
+            m_batches.remove(e.batch);
+            delete e.batch;
+        } else if (e.batch->isSparse()) {
+            compactBatch(e.batch);
+        }
+    }
+    e = Edge{};
+    m_free.append(id);
+    --m_live;
+    ++m_version;
+    return true;
+}
+
+/**
+ * @brief Copies the live entries of a shape's adjacency list.
+ * @param shape Shape handle.
+ * @return Edge ids in insertion order.
+ */
+QVector<int> ConnectionIndex::incident(ShapeHandle shape) const
+{
+    const size_t i = size_t(shape.index());
+    if (i >= m_adjacency.size()) return QVector<int>();
+
+    const Adjacency& list = m_adjacency[i];
+    if (list.dead == 0) return list.ids;
+    QVector<int> ids;
+    ids.reserve(list.ids.size() - list.dead);
+    for (int id : list.ids) {
+        if (id >= 0) ids.append(id);
+    }
+    return ids;
+}
+
+/**
+ * @brief Searches the smaller adjacency list for the newest edge joining two shapes.
+ * @param a First endpoint.
+ * @param b Second endpoint.
+ * @return Edge id or `-1`.
+ */
+int ConnectionIndex::find(ShapeHandle a, ShapeHandle b) const
+{
+    const size_t ia = size_t(a.index()), ib = size_t(b.index());
+    if (ia >= m_adjacency.size() || ib >= m_adjacency.size()) return -1;
+
+    const QVector<int>& list = m_adjacency[ia].ids.size() <= m_adjacency[ib].ids.size()
+        ? m_adjacency[ia].ids : m_adjacency[ib].ids;
+    for (int i = list.size() - 1; i >= 0; --i) {
+        if (list[i] < 0) continue;
+        const Edge& e = m_edges[list[i]];
+        if ((e.a == a && e.b == b) || (e.a == b && e.b == a)) return list[i];
+    }
+    return -1;
+}
+
+/**
+ * @brief Sums the edge and adjacency arrays, the individual connector items, and the batches with their slot tables.
+ * @return Estimated bytes; adjacency lists are charged for their entries, not their spare capacity.
+ */
+qsizetype ConnectionIndex::usedBytes() const
+{
+    qsizetype bytes = MemoryStats::capacityBytes(m_edges) + MemoryStats::capacityBytes(m_free)
+                    + MemoryStats::capacityBytes(m_adjacency) + m_adjacencyEntries * qsizetype(sizeof(int))
+                    + m_itemCount * qsizetype(sizeof(QGraphicsLineItem) + MemoryStats::kItemPrivateBytes);
+    for (auto it = m_batches.cbegin(); it != m_batches.cend(); ++it) {
+        bytes += it.key()->usedBytes() + MemoryStats::capacityBytes(it.value());
+    }
+    return bytes;
+}
+
+/**
+ * @brief Claims a recycled or new edge slot and links it to both endpoints.
+ * @param a First endpoint.
+ * @param b Second endpoint.
+ * @return Edge id with no connector attached yet.
+ */
+int ConnectionIndex::link(ShapeHandle a, ShapeHandle b)
+{
+    int id;
+    if (!m_free.isEmpty()) {
+        id = m_free.takeLast();
+    } else {
+        id = m_edges.size();
+        m_edges.append(Edge{});
+    }
+
+    Edge& e = m_edges[id];
+    e.a = a;
+    e.b = b;
+    e.live = true;
+
+    const size_t needed = size_t(std::max(a.index(), b.index())) + 1;
+    if (needed > m_adjacency.size()) m_adjacency.resize(needed);
+    QVector<int>& listA = m_adjacency[size_t(a.index())].ids;
+    e.posA = listA.size();
+    listA.append(id);
+    if (b != a) {
+        QVector<int>& listB = m_adjacency[size_t(b.index())].ids;
+        e.posB = listB.size();
+        listB.append(id);
+    }
+    m_adjacencyEntries += b != a ? 2 : 1;
+    ++m_live;
+    ++m_version;
+    return id;
+}
+
+/**
+ * @brief Returns the stored position of an edge in one endpoint's adjacency list.
+ * @param id Live edge id.
+ * @param shape Endpoint of the edge.
+ */
+int& ConnectionIndex::position(int id, ShapeHandle shape)
+{
+    Edge& e = m_edges[id];
+    return e.a == shape ? e.posA : e.posB;
+}
+
+/**
+ * @brief Tombstones an edge's entry in one endpoint's adjacency list.
+ *
+ * When tombstones make up half of the list it is compacted in place and the positions
+ * stored in the surviving edges are updated, so each removal costs O(1) amortized.
+ * @param shape Endpoint.
+ * @param id Edge id to drop.
+ * @param pos Position of the edge in the endpoint's list.
+ */
+void ConnectionIndex::unlink(ShapeHandle shape, int id, int pos)
+{
+    const size_t i = size_t(shape.index());
+    if (i >= m_adjacency.size()) return;
+
+    Adjacency& list = m_adjacency[i];
+    if (pos < 0 || pos >= list.ids.size() || list.ids[pos] != id) return;
+    list.ids[pos] = -1;
+    ++list.dead;
+
+    if (list.dead == list.ids.size()) {
+        // Release the buffer so a recycled handle index starts without capacity
+        m_adjacencyEntries -= list.ids.size();
+        list = Adjacency();
+    } else if (2 * list.dead >= list.ids.size()) {
+        int out = 0;
+        for (int in = 0; in < list.ids.size(); ++in) {
+            const int live = list.ids[in];
+            if (live < 0) continue;
+            position(live, shape) = out;
+            list.ids[out++] = live;
+        }
+        m_adjacencyEntries -= list.dead;
+        list.ids.resize(out);
+        list.dead = 0;
+    }
+}
+
+/**
+ * @brief Compacts a batch and moves each surviving edge to its line's new slot.
+ *
+ * Runs once half of the batch's slots are dead, so the O(slots) pass is O(1) amortized
+ * per removed edge. Slots only move down, so the slot table is remapped in place.
+ * @param batch Owned batch with at least one live line.
+ */
+void ConnectionIndex::compactBatch(ConnectorBatchItem* batch)
+{
+    QVector<int>& owners = m_batches[batch];
+    const QVector<int> from = batch->compact();
+    for (int slot = 0; slot < from.size(); ++slot) {
+        const int id = owners[from[slot]];
+        owners[slot] = id;
+        m_edges[id].slot = slot;
+    }
+    owners.resize(from.size());
+    owners.squeeze();
+}
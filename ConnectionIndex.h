@@ -0,0 +1,167 @@
+/**
+ * @file ConnectionIndex.h
+ * @brief Declares the adjacency index that tracks connectors between shapes.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QVector>
+#include <QHash>
+#include <QGraphicsLineItem>
+#include <vector>
+#include "ConnectorBatchItem.h"
+#include "MemoryStats.h"
+#include "ShapeHandle.h"
+
+/**
+ * @class ConnectionIndex
+ * @brief Stores connections as edges with per-shape adjacency lists.
+ *
+ * Edges live in a slot array recycled through a free list, so edge ids stay stable while
+ * the edge exists. Endpoints are `ShapeHandle`s and the adjacency lists form an array
+ * indexed by handle, so finding a shape's edges is an array access. The index owns the
+ * connector items and deletes them with their edges, which lets shape removal drop its
+ * connectors in O(degree) instead of scanning the scene. Each edge records its position in
+ * both endpoint lists, so removing it leaves a tombstone in O(1); a list is compacted once
+ * half of it is tombstones, which keeps removal O(1) amortized and preserves edge order.
+ * An edge is drawn either by its own `QGraphicsLineItem` or by a slot of a shared
+ * `ConnectorBatchItem`. The index remembers which edge each batch slot draws, so once half
+ * of a batch is removed it compacts the batch and re-points the surviving edges at their
+ * new slots; a batch is deleted once its last edge is removed.
+ */
+class ConnectionIndex
+{
+public:
+    /**
+     * @brief Connection between two shapes.
+     */
+    struct Edge
+    {
+        ShapeHandle a;                       ///< First endpoint.
+        ShapeHandle b;                       ///< Second endpoint.
+        QGraphicsLineItem* item = nullptr;   ///< Individual connector item, if any.
+        ConnectorBatchItem* batch = nullptr; ///< Shared batch drawing the edge, if any.
+        int slot = -1;                       ///< Line slot inside `batch`.
+        int posA = -1;                       ///< Position in the adjacency list of `a`.
+        int posB = -1;                       ///< Position in the adjacency list of `b`.
+        bool live = false;                   ///< `false` for recycled slots.
+    };
+
+    /**
+     * @brief Creates an empty index.
+     */
+    ConnectionIndex() = default;
+
+    /**
+     * @brief Deletes all connector items still owned by the index.
+     */
+    ~ConnectionIndex();
+
+    ConnectionIndex(const ConnectionIndex&) = delete;
+    ConnectionIndex& operator=(const ConnectionIndex&) = delete;
+
+    /**
+     * @brief Registers a connection.
+     * @param a First endpoint.
+     * @param b Second endpoint.
+     * @param item Connector item; ownership transfers to the index.
+     * @return Edge id valid until the edge is removed.
+     */
+    int add(ShapeHandle a, ShapeHandle b, QGraphicsLineItem* item);
+
+    /**
+     * @brief Registers a connection drawn by a slot of a batch item.
+     * @param a First endpoint.
+     * @param b Second endpoint.
+     * @param batch Batch item; the index takes ownership on first use.
+     * @param slot Line slot inside the batch.
+     * @return Edge id valid until the edge is removed.
+     */
+    int add(ShapeHandle a, ShapeHandle b, ConnectorBatchItem* batch, int slot);
+
+    /**
+     * @brief Re-aims the connector of an edge.
+     * @param id Live edge id.
+     * @param line New connector line.
+     */
+    void setLine(int id, const QLineF& line);
+
+    /**
+     * @brief Removes an edge and deletes its connector item.
+     * @param id Edge id returned by `add()`.
+     * @return `true` when the edge was live.
+     */
+    bool remove(int id);
+
+    /**
+     * @brief Finds the most recently added live edge between two shapes.
+     * @param a First endpoint.
+     * @param b Second endpoint.
+     * @return Edge id or `-1` when the shapes are not connected.
+     */
+    int find(ShapeHandle a, ShapeHandle b) const;
+
+    /**
+     * @brief Lists the edges incident to a shape.
+     * @param shape Shape handle.
+     * @return Edge ids in insertion order (each edge once, also for self-connections).
+     */
+    QVector<int> incident(ShapeHandle shape) const;
+
+    /**
+     * @brief Returns the edge stored under an id.
+     * @param id Live edge id.
+     */
+    const Edge& edge(int id) const { return m_edges[id]; }
+
+    /**
+     * @brief Returns the number of live edges.
+     */
+    int size() const { return m_live; }
+
+    /**
+     * @brief Returns the number of edges added or removed so far; re-aiming does not count.
+     */
+    quint64 version() const { return m_version; }
+
+    /**
+     * @brief Estimates the bytes held by the index and the connector items it owns.
+     */
+    qsizetype usedBytes() const;
+
+    /**
+     * @brief Visits every live edge in slot order.
+     * @param fn Callable `fn(const Edge&)`.
+     */
+    template <typename Fn>
+    void forEachEdge(Fn fn) const
+    {
+        for (const Edge& e : m_edges) {
+            if (e.live) fn(e);
+        }
+    }
+
+private:
+    /**
+     * @brief Edge ids incident to one shape; removed edges leave `-1` until compaction.
+     */
+    struct Adjacency
+    {
+        QVector<int> ids;
+        int dead = 0; ///< Tombstones in `ids`.
+    };
+
+    int link(ShapeHandle a, ShapeHandle b);
+    void unlink(ShapeHandle shape, int id, int pos);
+    int& position(int id, ShapeHandle shape);
+    void compactBatch(ConnectorBatchItem* batch);
+
+    QVector<Edge> m_edges;
+    QVector<int> m_free;
+    std::vector<Adjacency> m_adjacency; ///< Edge lists per handle index; emptied when the shape goes.
+    QHash<ConnectorBatchItem*, QVector<int>> m_batches; ///< Owned batches and the edge id drawn by each slot.
+    int m_live = 0;
+    quint64 m_version = 0;
+    qsizetype m_itemCount = 0;        ///< Edges drawn by their own `QGraphicsLineItem`.
+    qsizetype m_adjacencyEntries = 0; ///< Entries, tombstones included, across all adjacency lists.
+};
@@ -0,0 +1,261 @@
+/**
+ * @file ConnectorBatchItem.cpp
+ * @brief Implements the batched connector item.
+ * @author Nikol Grigoryan
+ */
+#include "ConnectorBatchItem.h"
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Edge of a bucket cell in median line extents; most lines then fit in one cell.
+ */
+constexpr qreal kCellSpan = 4.0;
+
+/**
+ * @brief Cell coordinates are clamped to this magnitude so far-away lines cannot overflow them.
+ */
+constexpr qreal kMaxCell = 1 << 30;
+
+} // namespace
+
+/**
+ * @brief Creates an empty batch and enables exposed-rect culling.
+ * @param pen Pen used for every line.
+ */
+ConnectorBatchItem::ConnectorBatchItem(const QPen& pen)
+    : m_pen(pen)
+{
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, true);
+}
+
+/**
+ * @brief Appends lines with a single bounding-rectangle update and files them in the grid.
+ * @param lines Lines to append.
+ * @return Slot of the first line.
+ */
+int ConnectorBatchItem::addLines(const QVector<QLineF>& lines)
+{
+    if (m_cellSize <= 0 && !lines.isEmpty()) {
+        std::vector<qreal> extents;
+        extents.reserve(size_t(lines.size()));
+        for (const QLineF& l : lines) extents.push_back(qMax(qAbs(l.dx()), qAbs(l.dy())));
+        const auto median = extents.begin() + extents.size() / 2;
+        std::nth_element(extents.begin(), median, extents.end());
+        m_cellSize = qMax(qreal(1.0), kCellSpan * (*median + 2 * m_pen.widthF()));
+    }
+
+    const int first = m_lines.size();
+    prepareGeometryChange();
+    m_lines += lines;
+    m_live.resize(m_lines.size());
+    m_where.resize(m_lines.size());
+    for (int i = first; i < m_lines.size(); ++i) {
+        m_live[i] = true;
+        growBounds(m_lines[i]);
+        bucketInsert(i);
+    }
+    m_liveCount += lines.size();
+    return first;
+}
+
+/**
+ * @brief Re-aims one line; the bounds only change when the line leaves them.
+ * @param slot Live slot.
+ * @param line New line.
+ */
+void ConnectorBatchItem::setLine(int slot, const QLineF& line)
+{
+    const QRectF old = lineBounds(m_lines[slot]);
+    bucketRemove(slot);
+    m_lines[slot] = line;
+    bucketInsert(slot);
+
+    // Compare corners rather than rectangles: horizontal and vertical lines have degenerate rects
+    const QRectF r = lineBounds(line);
+    if (!m_bounds.contains(r.topLeft()) || !m_bounds.contains(r.bottomRight())) {
+        prepareGeometryChange();
+        growBounds(line);
+    }
+    // Repaint only the area covered by the old and new line
+    update(old.united(r));
+}
+
+/**
+ * @brief Hides a line; the slot stays dead until `compact()`.
+ * @param slot Live slot.
+ */
+void ConnectorBatchItem::removeLine(int slot)
+{
+    if (!m_live[slot]) return;
+    bucketRemove(slot);
+    m_live[slot] = false;
+    --m_liveCount;
+    update(lineBounds(m_lines[slot]));
+}
+
+/**
+ * @brief Moves the live lines to the front in slot order and rebuilds the grid and bounds.
+ * @return Previous slot of each line, indexed by its new slot.
+ */
+QVector<int> ConnectorBatchItem::compact()
+{
+    QVector<int> from;
+    from.reserve(m_liveCount);
+    for (int i = 0; i < m_lines.size(); ++i) {
+        if (!m_live[i]) continue;
+        m_lines[from.size()] = m_lines[i];
+        from.append(i);
+    }
+
+    prepareGeometryChange();
+    m_lines.resize(from.size());
+    m_lines.squeeze();
+    m_live.fill(true, from.size());
+    m_live.squeeze();
+    m_where.resize(from.size());
+    m_where.squeeze();
+    m_buckets.clear();
+    m_long.clear();
+    m_bucketEntries = 0;
+    m_bounds = QRectF();
+    for (int i = 0; i < m_lines.size(); ++i) {
+        growBounds(m_lines[i]);
+        bucketInsert(i);
+    }
+    return from;
+}
+
+/**
+ * @brief Reports the cached union of line extents.
+ */
+QRectF ConnectorBatchItem::boundingRect() const
+{
+    return m_bounds;
+}
+
+/**
+ * @brief Paints the live lines that touch the exposed rectangle in one pass.
+ *
+ * Candidates are the long lines plus the buckets around the exposed area, or every bucket
+ * when the area covers more cells than there are buckets, so a small exposed area costs
+ * the lines near it rather than the whole batch.
+ */
+void ConnectorBatchItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+    Q_UNUSED(widget);
+    const QRectF exposed = option->exposedRect;
+    QVector<QLineF> visible;
+    const auto collect = [this, &exposed, &visible](const QVector<int>& slots) {
+        for (int i : slots) {
+            if (exposed.intersects(lineBounds(m_lines[i]))) visible.append(m_lines[i]);
+        }
+    };
+    collect(m_long);
+
+    if (!m_buckets.isEmpty()) {
+        // A bucketed line spans at most two cells per axis, so the query widens by one cell
+        const QPoint lo = cellOf(exposed.topLeft() - QPointF(m_cellSize, m_cellSize));
+        const QPoint hi = cellOf(exposed.bottomRight());
+        const qint64 cells = qint64(hi.x() - lo.x() + 1) * (hi.y() - lo.y() + 1);
+        if (cells > m_buckets.size()) {
+            for (auto it = m_buckets.constBegin(); it != m_buckets.constEnd(); ++it) {
+                const int cx = qint32(it.key() >> 32), cy = qint32(quint32(it.key()));
+                if (cx >= lo.x() && cx <= hi.x() && cy >= lo.y() && cy <= hi.y()) collect(it.value());
+            }
+        } else {
+            for (int cy = lo.y(); cy <= hi.y(); ++cy) {
+                for (int cx = lo.x(); cx <= hi.x(); ++cx) {
+                    const auto it = m_buckets.constFind(cellKey(QPoint(cx, cy)));
+                    if (it != m_buckets.constEnd()) collect(it.value());
+                }
+            }
+        }
+    }
+
+    painter->setPen(m_pen);
+    painter->drawLines(visible);
+}
+
+/**
+ * @brief Bounds of one line grown by the pen, and by at least one unit so axis-aligned
+ * lines still intersect the exposed area.
+ */
+QRectF ConnectorBatchItem::lineBounds(const QLineF& line) const
+{
+    const qreal pad = qMax(m_pen.widthF(), qreal(1.0));
+    return QRectF(line.p1(), line.p2()).normalized().adjusted(-pad, -pad, pad, pad);
+}
+
+/**
+ * @brief Extends the cached bounds to cover a line and the pen width.
+ * @param line Line that must be covered.
+ */
+void ConnectorBatchItem::growBounds(const QLineF& line)
+{
+    const QRectF r = lineBounds(line);
+    m_bounds = m_bounds.isNull() ? r : m_bounds.united(r);
+}
+
+/**
+ * @brief Returns the bucket cell containing a point.
+ */
+QPoint ConnectorBatchItem::cellOf(const QPointF& p) const
+{
+    return QPoint(int(qBound(-kMaxCell, std::floor(p.x() / m_cellSize), kMaxCell)),
+                  int(qBound(-kMaxCell, std::floor(p.y() / m_cellSize), kMaxCell)));
+}
+
+/**
+ * @brief Packs cell coordinates into a bucket key.
+ */
+quint64 ConnectorBatchItem::cellKey(const QPoint& cell)
+{
+    return (quint64(quint32(cell.x())) << 32) | quint32(cell.y());
+}
+
+/**
+ * @brief Files a live slot under the cell of its top-left corner, or in the long list.
+ */
+void ConnectorBatchItem::bucketInsert(int slot)
+{
+    const QRectF r = lineBounds(m_lines[slot]);
+    if (r.width() > m_cellSize || r.height() > m_cellSize) {
+        m_where[slot] = m_long.size();
+        m_long.append(slot);
+        return;
+    }
+    QVector<int>& bucket = m_buckets[cellKey(cellOf(r.topLeft()))];
+    m_where[slot] = bucket.size();
+    bucket.append(slot);
+    ++m_bucketEntries;
+}
+
+/**
+ * @brief Drops a slot from the list it was filed in; the last entry fills the hole, so this is O(1).
+ */
+void ConnectorBatchItem::bucketRemove(int slot)
+{
+    const auto drop = [this, slot](QVector<int>& list) {
+        const int pos = m_where[slot];
+        const int moved = list.last();
+        list[pos] = moved;
+        m_where[moved] = pos;
+        list.removeLast();
+    };
+    const QRectF r = lineBounds(m_lines[slot]);
+    if (r.width() > m_cellSize || r.height() > m_cellSize) {
+        drop(m_long);
+        return;
+    }
+    const auto it = m_buckets.find(cellKey(cellOf(r.topLeft())));
+    if (it == m_buckets.end()) return;
+    drop(it.value());
+    --m_bucketEntries;
+    if (it.value().isEmpty()) m_buckets.erase(it);
+}
@@ -0,0 +1,114 @@
+/**
+ * @file ConnectorBatchItem.h
+ * @brief Declares a graphics item that renders many connector lines at once.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QGraphicsItem>
+#include <QHash>
+#include <QLineF>
+#include <QPen>
+#include <QVector>
+#include "MemoryStats.h"
+
+/**
+ * @class ConnectorBatchItem
+ * @brief Draws a set of connector lines with a single pen as one scene item.
+ *
+ * Bulk connect commands insert thousands of connectors at once; keeping them in one item
+ * avoids a `QGraphicsLineItem` and a scene-index entry per edge. Lines are addressed by
+ * slot so individual connectors can still be re-aimed or removed.
+ *
+ * Painting must not walk every line when only a corner of a large batch is exposed, so
+ * lines no longer than a grid cell are bucketed by the cell holding the top-left corner of
+ * their bounds, and the few longer ones are kept in a list tested on every paint. The
+ * cell edge follows the median line length of the first append. Removed slots stay dead
+ * until the owner calls `compact()`, which renumbers the live lines.
+ */
+class ConnectorBatchItem : public QGraphicsItem
+{
+public:
+    /**
+     * @brief Creates an empty batch drawn with the given pen.
+     * @param pen Pen shared by all lines of the batch.
+     */
+    explicit ConnectorBatchItem(const QPen& pen);
+
+    /**
+     * @brief Appends lines in one geometry change.
+     * @param lines Lines to append.
+     * @return Slot of the first appended line; the others follow consecutively.
+     */
+    int addLines(const QVector<QLineF>& lines);
+
+    /**
+     * @brief Replaces the line stored in a slot.
+     * @param slot Live slot.
+     * @param line New line.
+     */
+    void setLine(int slot, const QLineF& line);
+
+    /**
+     * @brief Stops drawing the line stored in a slot.
+     * @param slot Live slot.
+     */
+    void removeLine(int slot);
+
+    /**
+     * @brief Returns the number of lines still drawn.
+     */
+    int liveCount() const { return m_liveCount; }
+
+    /**
+     * @brief Returns `true` once at least half of the slots are dead and `compact()` pays off.
+     */
+    bool isSparse() const { return 2 * (m_lines.size() - m_liveCount) >= m_lines.size(); }
+
+    /**
+     * @brief Drops dead slots, renumbering live lines in order, and shrinks the bounds.
+     * @return Previous slot of each line, indexed by its new slot.
+     */
+    QVector<int> compact();
+
+    /**
+     * @brief Estimates the bytes held by the item and its line arrays.
+     */
+    qsizetype usedBytes() const
+    {
+        return qsizetype(sizeof(ConnectorBatchItem)) + MemoryStats::kItemPrivateBytes
+             + MemoryStats::capacityBytes(m_lines) + MemoryStats::capacityBytes(m_live)
+             + MemoryStats::capacityBytes(m_where) + MemoryStats::capacityBytes(m_long)
+             + m_buckets.size() * qsizetype(sizeof(quint64) + sizeof(QVector<int>))
+             + m_bucketEntries * qsizetype(sizeof(int));
+    }
+
+    /**
+     * @brief Returns the union of all lines, grown by the pen width.
+     */
+    QRectF boundingRect() const override;
+
+    /**
+     * @brief Draws the live lines that intersect the exposed area.
+     */
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) override;
+
+private:
+    QRectF lineBounds(const QLineF& line) const;
+    void growBounds(const QLineF& line);
+    QPoint cellOf(const QPointF& p) const;
+    static quint64 cellKey(const QPoint& cell);
+    void bucketInsert(int slot);
+    void bucketRemove(int slot);
+
+    QPen m_pen;
+    QVector<QLineF> m_lines;
+    QVector<bool> m_live;
+    QVector<int> m_where;                   ///< Position of each live slot in its bucket or in `m_long`.
+    int m_liveCount = 0;
+    QRectF m_bounds;
+    qreal m_cellSize = 0.0;                 ///< Edge of a bucket cell; chosen by the first non-empty append.
+    QHash<quint64, QVector<int>> m_buckets; ///< Live slots no longer than a cell, per cell.
+    QVector<int> m_long;                    ///< Live slots longer than a cell.
+    qsizetype m_bucketEntries = 0;          ///< Slots held across all buckets.
+};
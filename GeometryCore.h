@@ -0,0 +1,268 @@
+/**
+ * @file GeometryCore.h
+ * @brief Header-only, allocation-free geometry primitives shared by validation and shapes.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @namespace Geometry
+ * @brief `constexpr` geometry templated on the scalar type.
+ *
+ * Every function works on values and fixed-size `std::array`s only, so nothing here
+ * touches the heap and everything can be evaluated at compile time. The scalar type may
+ * be `double`, `float`, or `Fixed<N>`; anything with `+`, `-`, `*`, `<` and `==` works.
+ */
+namespace Geometry {
+
+/**
+ * @brief Signed fixed-point number with @p FracBits fractional bits stored in 64 bits.
+ *
+ * Addition and subtraction are exact; multiplication truncates towards negative infinity.
+ */
+template <int FracBits>
+struct Fixed
+{
+    static_assert(FracBits > 0 && FracBits < 32, "Fixed needs 1..31 fractional bits");
+
+    std::int64_t raw = 0; ///< Value scaled by `2^FracBits`.
+
+    /**
+     * @brief Converts an integer exactly.
+     */
+    static constexpr Fixed fromInt(std::int64_t v) { return fromRaw(v * (std::int64_t(1) << FracBits)); }
+
+    /**
+     * @brief Wraps an already scaled value.
+     */
+    static constexpr Fixed fromRaw(std::int64_t r)
+    {
+        Fixed f;
+        f.raw = r;
+        return f;
+    }
+
+    /**
+     * @brief Returns the value as a `double`.
+     */
+    constexpr double toDouble() const { return double(raw) / double(std::int64_t(1) << FracBits); }
+
+    friend constexpr Fixed operator+(Fixed a, Fixed b) { return fromRaw(a.raw + b.raw); }
+    friend constexpr Fixed operator-(Fixed a, Fixed b) { return fromRaw(a.raw - b.raw); }
+    friend constexpr Fixed operator-(Fixed a) { return fromRaw(-a.raw); }
+    friend constexpr Fixed operator*(Fixed a, Fixed b) { return fromRaw((a.raw * b.raw) >> FracBits); }
+    friend constexpr bool operator==(Fixed a, Fixed b) { return a.raw == b.raw; }
+    friend constexpr bool operator!=(Fixed a, Fixed b) { return a.raw != b.raw; }
+    friend constexpr bool operator<(Fixed a, Fixed b) { return a.raw < b.raw; }
+};
+
+/**
+ * @brief Returns half of a value; exact for binary floating point and fixed point.
+ */
+template <typename T>
+constexpr T half(T v) { return v * T(0.5); }
+
+template <int F>
+constexpr Fixed<F> half(Fixed<F> v) { return Fixed<F>::fromRaw(v.raw / 2); }
+
+/**
+ * @brief Divides by a small positive count.
+ */
+template <typename T>
+constexpr T divide(T v, int n) { return v / T(n); }
+
+template <int F>
+constexpr Fixed<F> divide(Fixed<F> v, int n) { return Fixed<F>::fromRaw(v.raw / n); }
+
+/**
+ * @brief Two-dimensional point or vector.
+ */
+template <typename T>
+struct Vec2
+{
+    T x{};
+    T y{};
+
+    friend constexpr Vec2 operator+(Vec2 a, Vec2 b) { return { a.x + b.x, a.y + b.y }; }
+    friend constexpr Vec2 operator-(Vec2 a, Vec2 b) { return { a.x - b.x, a.y - b.y }; }
+    friend constexpr bool operator==(Vec2 a, Vec2 b) { return a.x == b.x && a.y == b.y; }
+    friend constexpr bool operator!=(Vec2 a, Vec2 b) { return !(a == b); }
+};
+
+/**
+ * @brief Fixed-size point array living on the stack.
+ */
+template <typename T, std::size_t N>
+using Points = std::array<Vec2<T>, N>;
+
+/**
+ * @brief Element-wise equality of two point arrays (`std::array::operator==` is not `constexpr` in C++17).
+ */
+template <typename T, std::size_t N>
+constexpr bool equal(const Points<T, N>& a, const Points<T, N>& b)
+{
+    for (std::size_t i = 0; i < N; ++i) {
+        if (a[i] != b[i]) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Dot product.
+ */
+template <typename T>
+constexpr T dot(Vec2<T> a, Vec2<T> b) { return a.x * b.x + a.y * b.y; }
+
+/**
+ * @brief Z component of the cross product.
+ */
+template <typename T>
+constexpr T cross(Vec2<T> a, Vec2<T> b) { return a.x * b.y - a.y * b.x; }
+
+/**
+ * @brief Squared distance between two points.
+ */
+template <typename T>
+constexpr T dist2(Vec2<T> a, Vec2<T> b) { return dot(a - b, a - b); }
+
+/**
+ * @brief Vector rotated by +90 degrees.
+ */
+template <typename T>
+constexpr Vec2<T> perp(Vec2<T> v) { return { -v.y, v.x }; }
+
+/**
+ * @brief Vector scaled by one half.
+ */
+template <typename T>
+constexpr Vec2<T> halfOf(Vec2<T> v) { return { half(v.x), half(v.y) }; }
+
+/**
+ * @brief Midpoint of a segment.
+ */
+template <typename T>
+constexpr Vec2<T> midpoint(Vec2<T> a, Vec2<T> b) { return halfOf(a + b); }
+
+/**
+ * @brief Lexicographic (x, then y) ordering of points.
+ */
+template <typename T>
+constexpr bool lessXY(Vec2<T> a, Vec2<T> b) { return a.x < b.x || (a.x == b.x && a.y < b.y); }
+
+/**
+ * @brief Arithmetic mean of the points.
+ */
+template <typename T, std::size_t N>
+constexpr Vec2<T> centroid(const Points<T, N>& pts)
+{
+    Vec2<T> sum{};
+    for (std::size_t i = 0; i < N; ++i) sum = sum + pts[i];
+    return { divide(sum.x, int(N)), divide(sum.y, int(N)) };
+}
+
+/**
+ * @brief Component-wise minimum and maximum of the points.
+ * @return `{min, max}` corners of the bounding box.
+ */
+template <typename T, std::size_t N>
+constexpr Points<T, 2> bounds(const Points<T, N>& pts)
+{
+    Vec2<T> lo = pts[0];
+    Vec2<T> hi = pts[0];
+    for (std::size_t i = 1; i < N; ++i) {
+        if (pts[i].x < lo.x) lo.x = pts[i].x;
+        if (pts[i].y < lo.y) lo.y = pts[i].y;
+        if (hi.x < pts[i].x) hi.x = pts[i].x;
+        if (hi.y < pts[i].y) hi.y = pts[i].y;
+    }
+    return { lo, hi };
+}
+
+/**
+ * @brief Sorts four points lexicographically with a five-comparator sorting network.
+ *
+ * For a rectangle the first and last results are opposite corners.
+ */
+template <typename T>
+constexpr Points<T, 4> sortCorners(Points<T, 4> p)
+{
+    constexpr int pairs[5][2] = { { 0, 1 }, { 2, 3 }, { 0, 2 }, { 1, 3 }, { 1, 2 } };
+    for (const auto& pair : pairs) {
+        if (lessXY(p[pair[1]], p[pair[0]])) {
+            const Vec2<T> t = p[pair[0]];
+            p[pair[0]] = p[pair[1]];
+            p[pair[1]] = t;
+        }
+    }
+    return p;
+}
+
+/**
+ * @brief Orders the corners of a rectangle so they trace its outline.
+ *
+ * After lexicographic sorting the extreme corners are opposite, so the outline is
+ * first, second, last, third. No trigonometry is needed.
+ */
+template <typename T>
+constexpr Points<T, 4> outlineOrder(const Points<T, 4>& corners)
+{
+    const Points<T, 4> s = sortCorners(corners);
+    return { s[0], s[1], s[3], s[2] };
+}
+
+/**
+ * @brief Corners of the axis-aligned rectangle spanned by two opposite points.
+ * @return Corners in outline order starting at the minimum corner.
+ */
+template <typename T>
+constexpr Points<T, 4> axisAlignedRect(Vec2<T> p1, Vec2<T> p2)
+{
+    const Points<T, 2> b = bounds<T, 2>({ p1, p2 });
+    return { b[0], Vec2<T>{ b[1].x, b[0].y }, b[1], Vec2<T>{ b[0].x, b[1].y } };
+}
+
+/**
+ * @brief Corners of the square that has `d1`-`d2` as a diagonal.
+ *
+ * The other diagonal has the same length and is perpendicular, so the remaining corners
+ * are the midpoint offset by half of the rotated diagonal vector; no square roots.
+ * @return Corners in outline order starting at `d1`.
+ */
+template <typename T>
+constexpr Points<T, 4> squareFromDiagonal(Vec2<T> d1, Vec2<T> d2)
+{
+    const Vec2<T> m = midpoint(d1, d2);
+    const Vec2<T> w = halfOf(perp(d2 - d1));
+    return { d1, m - w, d2, m + w };
+}
+
+/**
+ * @brief Exact rectangle test for scalar types whose arithmetic is exact on the inputs.
+ *
+ * Meant for integers, fixed point, and compile-time checks; floating-point validation
+ * goes through the adaptive predicates instead.
+ */
+template <typename T>
+constexpr bool isRectangle(const Points<T, 4>& corners)
+{
+    const Points<T, 4> s = sortCorners(corners);
+    if (s[0] == s[1] || s[0] == s[2]) return false;
+    return dot(s[1] - s[0], s[2] - s[0]) == T{} && dot(s[1] - s[3], s[2] - s[3]) == T{}
+        && dist2(s[0], s[1]) == dist2(s[2], s[3]) && dist2(s[0], s[2]) == dist2(s[1], s[3]);
+}
+
+/**
+ * @brief Exact square test for scalar types whose arithmetic is exact on the inputs.
+ */
+template <typename T>
+constexpr bool isSquare(const Points<T, 4>& corners)
+{
+    const Points<T, 4> s = sortCorners(corners);
+    return isRectangle(corners) && dist2(s[0], s[1]) == dist2(s[0], s[2]);
+}
+
+} // namespace Geometry
@@ -0,0 +1,176 @@
+/**
+ * @file GraphAnalytics.cpp
+ * @brief Implements the CSR connection-graph snapshot and its parallel algorithms.
+ * @author Nikol Grigoryan
+ */
+#include "GraphAnalytics.h"
+#include "ShapeRepository.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+/**
+ * @brief Converts the repository's adjacency lists into CSR form.
+ * @param repo Repository to snapshot.
+ */
+GraphSnapshot::GraphSnapshot(const ShapeRepository& repo)
+    : m_repo(repo)
+{
+    // Vertices are the live handles in handle order
+    m_handles.reserve(repo.size());
+    repo.forEachHandle([this](ShapeHandle h) {
+        if (size_t(h.index()) >= m_vertexOf.size()) m_vertexOf.resize(size_t(h.index()) + 1, -1);
+        m_vertexOf[size_t(h.index())] = int(m_handles.size());
+        m_handles.push_back(h);
+    });
+    const int n = vertexCount();
+    const auto vertex = [this](ShapeHandle h) { return m_vertexOf[size_t(h.index())]; };
+
+    // Counting pass: degree per vertex, then prefix sums into offsets
+    const ConnectionIndex& connections = repo.connections();
+    m_offsets.assign(n + 1, 0);
+    connections.forEachEdge([this, &vertex](const ConnectionIndex::Edge& e) {
+        ++m_offsets[vertex(e.a) + 1];
+        if (e.b != e.a) ++m_offsets[vertex(e.b) + 1];
+        ++m_edgeCount;
+    });
+    for (int i = 0; i < n; ++i) m_offsets[i + 1] += m_offsets[i];
+
+    // Fill pass: each undirected edge becomes one arc per endpoint
+    m_targets.resize(m_offsets[n]);
+    std::vector<int> cursor(m_offsets.begin(), m_offsets.end() - 1);
+    connections.forEachEdge([this, &cursor, &vertex](const ConnectionIndex::Edge& e) {
+        const int a = vertex(e.a);
+        const int b = vertex(e.b);
+        m_targets[cursor[a]++] = b;
+        if (a != b) m_targets[cursor[b]++] = a;
+    });
+}
+
+/**
+ * @brief Resolves the name to a handle, then reads the vertex from the handle-indexed array.
+ */
+int GraphSnapshot::vertexOf(const QString& name) const
+{
+    const ShapeHandle h = m_repo.handle(name);
+    return h.isNull() || size_t(h.index()) >= m_vertexOf.size() ? -1 : m_vertexOf[size_t(h.index())];
+}
+
+/**
+ * @brief Names a vertex through the repository's pool; the repository must not change meanwhile.
+ */
+const QString& GraphSnapshot::nameOf(int vertex) const
+{
+    return m_repo.name(m_handles[size_t(vertex)]);
+}
+
+/**
+ * @brief Expands the frontier level by level; each level is split across workers.
+ * @param source Start vertex.
+ * @param parents Receives BFS parents when non-null.
+ * @return Distance per vertex.
+ */
+std::vector<int> GraphSnapshot::bfs(int source, std::vector<int>* parents) const
+{
+    const int n = vertexCount();
+    std::unique_ptr<std::atomic<int>[]> dist(new std::atomic<int>[n]);
+    for (int i = 0; i < n; ++i) dist[i].store(-1, std::memory_order_relaxed);
+    std::vector<int> parent(parents ? n : 0, -1);
+
+    dist[source].store(0, std::memory_order_relaxed);
+    std::vector<int> frontier{source};
+    std::vector<std::vector<int>> local(Parallel::workerCount());
+
+    for (int level = 1; !frontier.empty(); ++level) {
+        Parallel::forRanges(static_cast<int>(frontier.size()), [&](int begin, int end, int worker) {
+            std::vector<int>& next = local[worker];
+            for (int i = begin; i < end; ++i) {
+                const int v = frontier[i];
+                for (int k = m_offsets[v]; k < m_offsets[v + 1]; ++k) {
+                    const int u = m_targets[k];
+                    int expected = -1;
+                    // Exactly one worker wins the claim, so parent[u] has a single writer
+                    if (dist[u].load(std::memory_order_relaxed) == -1
+                        && dist[u].compare_exchange_strong(expected, level, std::memory_order_relaxed)) {
+                        if (parents) parent[u] = v;
+                        next.push_back(u);
+                    }
+                }
+            }
+        });
+
+        frontier.clear();
+        for (auto& next : local) {
+            frontier.insert(frontier.end(), next.begin(), next.end());
+            next.clear();
+        }
+    }
+
+    std::vector<int> out(n);
+    for (int i = 0; i < n; ++i) out[i] = dist[i].load(std::memory_order_relaxed);
+    if (parents) *parents = std::move(parent);
+    return out;
+}
+
+/**
+ * @brief Propagates minimum labels across arcs until no label changes.
+ *
+ * Labels always name a vertex of the same component, so each sweep also jumps a label to
+ * its label's label, which collapses long chains in a logarithmic number of rounds.
+ * @return Component label per vertex.
+ */
+std::vector<int> GraphSnapshot::componentLabels() const
+{
+    const int n = vertexCount();
+    std::unique_ptr<std::atomic<int>[]> label(new std::atomic<int>[n]);
+    for (int i = 0; i < n; ++i) label[i].store(i, std::memory_order_relaxed);
+
+    std::atomic<bool> changed{true};
+    while (changed.load()) {
+        changed.store(false);
+        Parallel::forRanges(n, [&](int begin, int end, int) {
+            bool localChange = false;
+            for (int v = begin; v < end; ++v) {
+                int best = label[v].load(std::memory_order_relaxed);
+                for (int k = m_offsets[v]; k < m_offsets[v + 1]; ++k) {
+                    best = std::min(best, label[m_targets[k]].load(std::memory_order_relaxed));
+                }
+                best = std::min(best, label[best].load(std::memory_order_relaxed));
+                if (best < label[v].load(std::memory_order_relaxed)) {
+                    label[v].store(best, std::memory_order_relaxed);
+                    localChange = true;
+                }
+            }
+            if (localChange) changed.store(true);
+        });
+    }
+
+    std::vector<int> out(n);
+    for (int i = 0; i < n; ++i) out[i] = label[i].load(std::memory_order_relaxed);
+    return out;
+}
+
+/**
+ * @brief Selects the highest-degree vertices with a partial sort.
+ * @param k Number of vertices requested.
+ * @return Vertex and degree pairs, highest degree first.
+ */
+QVector<QPair<int, int>> GraphSnapshot::topDegrees(int k) const
+{
+    const int n = vertexCount();
+    std::vector<int> order(n);
+    for (int i = 0; i < n; ++i) order[i] = i;
+
+    k = std::min(k, n);
+    std::partial_sort(order.begin(), order.begin() + k, order.end(), [this](int a, int b) {
+        const int da = degree(a);
+        const int db = degree(b);
+        return da != db ? da > db : a < b;
+    });
+
+    QVector<QPair<int, int>> out;
+    out.reserve(k);
+    for (int i = 0; i < k; ++i) out.append({order[i], degree(order[i])});
+    return out;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file GraphAnalytics.h
+ * @brief Declares the CSR snapshot of the connection graph and its parallel algorithms.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QString>
+#include <QPair>
+#include <QVector>
+#include <vector>
+#include "ShapeHandle.h"
+
+class ShapeRepository;
+
+/**
+ * @class GraphSnapshot
+ * @brief Immutable compressed-sparse-row copy of the shape connection graph.
+ *
+ * Every shape becomes a dense vertex id, found from its handle through an array indexed by
+ * handle; connections become undirected arcs stored in one contiguous target array
+ * indexed by per-vertex offsets. Algorithms run on this
+ * snapshot so they never touch Qt containers or the scene in their inner loops.
+ */
+class GraphSnapshot
+{
+public:
+    /**
+     * @brief Builds a snapshot of the repository's current connections.
+     * @param repo Repository providing shapes and the connection index.
+     */
+    explicit GraphSnapshot(const ShapeRepository& repo);
+
+    /**
+     * @brief Returns the number of vertices (shapes).
+     */
+    int vertexCount() const { return int(m_handles.size()); }
+
+    /**
+     * @brief Returns the number of undirected edges.
+     */
+    int edgeCount() const { return m_edgeCount; }
+
+    /**
+     * @brief Maps a shape name to its vertex id.
+     * @return Vertex id or `-1` when the shape is unknown.
+     */
+    int vertexOf(const QString& name) const;
+
+    /**
+     * @brief Maps a vertex id back to the shape name.
+     */
+    const QString& nameOf(int vertex) const;
+
+    /**
+     * @brief Maps a vertex id back to the shape handle.
+     */
+    ShapeHandle handleOf(int vertex) const { return m_handles[vertex]; }
+
+    /**
+     * @brief Returns the number of arcs leaving a vertex (its degree).
+     */
+    int degree(int vertex) const { return m_offsets[vertex + 1] - m_offsets[vertex]; }
+
+    /**
+     * @brief Runs a level-synchronous parallel breadth-first search.
+     * @param source Start vertex.
+     * @param parents Optionally receives the BFS parent of every reached vertex (`-1` otherwise).
+     * @return Hop distance per vertex, `-1` for unreachable vertices.
+     */
+    std::vector<int> bfs(int source, std::vector<int>* parents = nullptr) const;
+
+    /**
+     * @brief Labels connected components by parallel min-label propagation with pointer jumping.
+     * @return Per-vertex label equal to the smallest vertex id in the component.
+     */
+    std::vector<int> componentLabels() const;
+
+    /**
+     * @brief Returns the @p k vertices with the highest degree, highest first.
+     * @param k Number of vertices to return.
+     * @return Pairs of vertex id and degree.
+     */
+    QVector<QPair<int, int>> topDegrees(int k) const;
+
+private:
+    const ShapeRepository& m_repo;
+    std::vector<ShapeHandle> m_handles;  ///< Shape of each vertex.
+    std::vector<int> m_vertexOf;         ///< Vertex per handle index, `-1` for free slots.
+    std::vector<int> m_offsets;
+    std::vector<int> m_targets;
+    int m_edgeCount = 0;
+};
@@ -0,0 +1,368 @@
+/**
+ * @file InstanceLayerItem.cpp
+ * @brief Implements the item that draws instances of a prototype from a shared path.
+ * @author Nikol Grigoryan
+ */
+#include "InstanceLayerItem.h"
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+/**
+ * @brief Tint of highlighted instances; matches the colorize effect used on shape items.
+ */
+const QColor kHighlightColor(255, 140, 0);
+
+/**
+ * @brief Edge of a bucket cell in instance extents; a cell then holds up to a few dozen tiled instances.
+ */
+constexpr qreal kCellSpan = 4.0;
+
+/**
+ * @brief Cell coordinates are clamped to this magnitude so far-away instances cannot overflow them.
+ */
+constexpr qreal kMaxCell = 1 << 30;
+
+} // namespace
+
+/**
+ * @brief Stores the shared geometry and style, and enables exposed-rect culling.
+ */
+InstanceLayerItem::InstanceLayerItem(ShapeKind kind, const QVector<QPointF>& vertices, const QPainterPath& path,
+                                     const QPen& pen, const QBrush& brush)
+    : m_kind(kind), m_vertices(vertices), m_path(path), m_pathRect(path.boundingRect()), m_pen(pen), m_brush(brush)
+{
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, true);
+
+    // The vertex average is the centroid every shape kind uses as its center
+    for (const QPointF& p : m_vertices) m_center += p;
+    if (!m_vertices.isEmpty()) m_center /= m_vertices.size();
+
+    // A translated slot spans at most two cells per axis, so queries widen by one cell
+    const qreal extent = qMax(m_pathRect.width(), m_pathRect.height()) + 2 * m_pen.widthF();
+    m_cellSize = qMax(qreal(1.0), kCellSpan * extent);
+    account();
+}
+
+/**
+ * @brief Withdraws the bytes the layer published.
+ */
+InstanceLayerItem::~InstanceLayerItem()
+{
+    MemoryStats::add(MemoryStats::Counter::InstanceLayerBytes, -m_accountedBytes);
+}
+
+/**
+ * @brief Appends slots with a single bounding-rectangle update.
+ */
+int InstanceLayerItem::addInstances(const QTransform& placement, const QVector<QPointF>& offsets)
+{
+    const int first = m_slots.size();
+    const bool translation = placement.type() <= QTransform::TxTranslate;
+    const QPointF base(placement.dx(), placement.dy());
+
+    prepareGeometryChange();
+    m_slots.resize(first + offsets.size());
+    m_where.resize(m_slots.size());
+    for (int i = 0; i < offsets.size(); ++i) {
+        Slot& slot = m_slots[first + i];
+        slot.live = true;
+        if (translation) {
+            slot.offset = base + offsets[i];
+        } else {
+            slot.transform = storeTransform(placement * QTransform::fromTranslate(offsets[i].x(), offsets[i].y()));
+        }
+        growBounds(slotBounds(slot));
+        bucketInsert(first + i);
+    }
+    m_liveCount += offsets.size();
+    account();
+    return first;
+}
+
+/**
+ * @brief Rebuilds the transform of a translated slot on demand.
+ */
+QTransform InstanceLayerItem::placement(int slot) const
+{
+    const Slot& s = m_slots[slot];
+    return s.transform < 0 ? QTransform::fromTranslate(s.offset.x(), s.offset.y()) : m_transforms[s.transform];
+}
+
+/**
+ * @brief Updates one slot; the bounds only change when the instance leaves them.
+ */
+void InstanceLayerItem::setPlacement(int slot, const QTransform& placement)
+{
+    Slot& s = m_slots[slot];
+    const QRectF old = slotBounds(s);
+    bucketRemove(slot);
+    if (placement.type() <= QTransform::TxTranslate) {
+        releaseTransform(s);
+        s.offset = QPointF(placement.dx(), placement.dy());
+    } else if (s.transform < 0) {
+        s.transform = storeTransform(placement);
+    } else {
+        m_transforms[s.transform] = placement;
+    }
+    bucketInsert(slot);
+
+    const QRectF r = slotBounds(s);
+    if (!m_bounds.contains(r)) {
+        prepareGeometryChange();
+        growBounds(r);
+    }
+    update(old.united(r));
+    account();
+}
+
+/**
+ * @brief Maps the prototype vertices through the slot's placement.
+ */
+QVector<QPointF> InstanceLayerItem::vertices(int slot) const
+{
+    const Slot& s = m_slots[slot];
+    QVector<QPointF> points = m_vertices;
+    if (s.transform < 0) {
+        for (QPointF& p : points) p += s.offset;
+    } else {
+        for (QPointF& p : points) p = m_transforms[s.transform].map(p);
+    }
+    return points;
+}
+
+/**
+ * @brief Maps the prototype center through the slot's placement.
+ */
+QPointF InstanceLayerItem::center(int slot) const
+{
+    const Slot& s = m_slots[slot];
+    return s.transform < 0 ? m_center + s.offset : m_transforms[s.transform].map(m_center);
+}
+
+/**
+ * @brief Hides a slot and returns its transform to the free list; trailing dead slots are dropped.
+ */
+void InstanceLayerItem::removeInstance(int slot)
+{
+    Slot& s = m_slots[slot];
+    if (!s.live) return;
+    update(slotBounds(s));
+    bucketRemove(slot);
+    releaseTransform(s);
+    s.live = false;
+    --m_liveCount;
+    while (!m_slots.isEmpty() && !m_slots.last().live) m_slots.removeLast();
+    m_where.resize(m_slots.size());
+    account();
+}
+
+/**
+ * @brief Flags a slot and repaints only its area.
+ */
+void InstanceLayerItem::setHighlighted(int slot, bool on)
+{
+    Slot& s = m_slots[slot];
+    if (s.highlighted == on) return;
+    s.highlighted = on;
+    update(slotBounds(s));
+}
+
+/**
+ * @brief Reports the cached union of instance bounds.
+ */
+QRectF InstanceLayerItem::boundingRect() const
+{
+    return m_bounds;
+}
+
+/**
+ * @brief Paints the visible slots: translated slots reuse the shared path, transformed ones map it.
+ *
+ * Candidates are the slots larger than a cell plus the buckets around the exposed area, or
+ * every bucket when the area covers more cells than there are buckets. They are drawn in slot order, so
+ * overlapping instances stack in creation order as separate items would. Transformed paths
+ * are mapped rather than drawn through a painter transform so the pen keeps its width, as
+ * it does on a shape item whose vertices were transformed.
+ */
+void InstanceLayerItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+    Q_UNUSED(widget);
+    const QRectF exposed = option->exposedRect;
+    QVector<int> visible;
+    const auto collect = [this, &exposed, &visible](const QVector<int>& slots) {
+        for (int i : slots) {
+            if (exposed.intersects(slotBounds(m_slots[i]))) visible.append(i);
+        }
+    };
+    collect(m_long);
+
+    const QPoint lo = cellOf(exposed.topLeft() - QPointF(m_cellSize, m_cellSize));
+    const QPoint hi = cellOf(exposed.bottomRight());
+    const qint64 cells = qint64(hi.x() - lo.x() + 1) * (hi.y() - lo.y() + 1);
+    if (cells > m_buckets.size()) {
+        for (auto it = m_buckets.constBegin(); it != m_buckets.constEnd(); ++it) {
+            const int cx = qint32(it.key() >> 32), cy = qint32(quint32(it.key()));
+            if (cx >= lo.x() && cx <= hi.x() && cy >= lo.y() && cy <= hi.y()) collect(it.value());
+        }
+    } else {
+        for (int cy = lo.y(); cy <= hi.y(); ++cy) {
+            for (int cx = lo.x(); cx <= hi.x(); ++cx) {
+                const auto it = m_buckets.constFind(cellKey(QPoint(cx, cy)));
+                if (it != m_buckets.constEnd()) collect(it.value());
+            }
+        }
+    }
+    std::sort(visible.begin(), visible.end());
+
+    QPen highlightPen = m_pen;
+    highlightPen.setColor(kHighlightColor);
+    QColor highlightFill = kHighlightColor;
+    highlightFill.setAlpha(m_brush.color().alpha());
+    const QBrush highlightBrush = m_brush.style() == Qt::NoBrush ? m_brush : QBrush(highlightFill);
+
+    bool highlighted = false;
+    painter->setPen(m_pen);
+    painter->setBrush(m_brush);
+    for (int i : std::as_const(visible)) {
+        const Slot& s = m_slots[i];
+        if (s.highlighted != highlighted) {
+            highlighted = s.highlighted;
+            painter->setPen(highlighted ? highlightPen : m_pen);
+            painter->setBrush(highlighted ? highlightBrush : m_brush);
+        }
+        if (s.transform < 0) {
+            painter->translate(s.offset);
+            painter->drawPath(m_path);
+            painter->translate(-s.offset);
+        } else {
+            painter->drawPath(m_transforms[s.transform].map(m_path));
+        }
+    }
+}
+
+/**
+ * @brief Bounds of one instance including the pen.
+ */
+QRectF InstanceLayerItem::slotBounds(const Slot& slot) const
+{
+    const qreal pad = m_pen.widthF();
+    const QRectF r = slot.transform < 0 ? m_pathRect.translated(slot.offset) : m_transforms[slot.transform].mapRect(m_pathRect);
+    return r.adjusted(-pad, -pad, pad, pad);
+}
+
+/**
+ * @brief Returns the bucket cell containing a point.
+ */
+QPoint InstanceLayerItem::cellOf(const QPointF& p) const
+{
+    return QPoint(int(qBound(-kMaxCell, std::floor(p.x() / m_cellSize), kMaxCell)),
+                  int(qBound(-kMaxCell, std::floor(p.y() / m_cellSize), kMaxCell)));
+}
+
+/**
+ * @brief Packs cell coordinates into a bucket key.
+ */
+quint64 InstanceLayerItem::cellKey(const QPoint& cell)
+{
+    return (quint64(quint32(cell.x())) << 32) | quint32(cell.y());
+}
+
+/**
+ * @brief Files a live slot under the cell of its top-left corner, or in the long list.
+ */
+void InstanceLayerItem::bucketInsert(int slot)
+{
+    const QRectF r = slotBounds(m_slots[slot]);
+    if (r.width() > m_cellSize || r.height() > m_cellSize) {
+        m_where[slot] = m_long.size();
+        m_long.append(slot);
+        return;
+    }
+    QVector<int>& bucket = m_buckets[cellKey(cellOf(r.topLeft()))];
+    m_where[slot] = bucket.size();
+    bucket.append(slot);
+    ++m_bucketEntries;
+}
+
+/**
+ * @brief Drops a slot from the list it was filed in; the last entry fills the hole, so this is O(1).
+ *
+ * Called before the slot's placement changes, so its bounds still lead to the same list.
+ */
+void InstanceLayerItem::bucketRemove(int slot)
+{
+    const auto drop = [this, slot](QVector<int>& list) {
+        const int pos = m_where[slot];
+        const int moved = list.last();
+        list[pos] = moved;
+        m_where[moved] = pos;
+        list.removeLast();
+    };
+    const QRectF r = slotBounds(m_slots[slot]);
+    if (r.width() > m_cellSize || r.height() > m_cellSize) {
+        drop(m_long);
+        return;
+    }
+    const auto it = m_buckets.find(cellKey(cellOf(r.topLeft())));
+    if (it == m_buckets.end()) return;
+    drop(it.value());
+    --m_bucketEntries;
+    if (it.value().isEmpty()) m_buckets.erase(it);
+}
+
+/**
+ * @brief Extends the cached bounds to cover an instance.
+ */
+void InstanceLayerItem::growBounds(const QRectF& rect)
+{
+    m_bounds = m_bounds.isNull() ? rect : m_bounds.united(rect);
+}
+
+/**
+ * @brief Puts a transform in a free side-table entry, growing the table only when none is free.
+ * @return Index of the entry.
+ */
+int InstanceLayerItem::storeTransform(const QTransform& transform)
+{
+    if (m_freeTransforms.isEmpty()) {
+        m_transforms.append(transform);
+        return m_transforms.size() - 1;
+    }
+    const int index = m_freeTransforms.takeLast();
+    m_transforms[index] = transform;
+    return index;
+}
+
+/**
+ * @brief Returns a slot's side-table transform, if any, to the free list.
+ */
+void InstanceLayerItem::releaseTransform(Slot& slot)
+{
+    if (slot.transform < 0) return;
+    m_freeTransforms.append(slot.transform);
+    slot.transform = -1;
+}
+
+/**
+ * @brief Publishes the change in the layer's size since the last call.
+ *
+ * Slot and transform arrays only change capacity when they grow, so apart from buckets
+ * being opened and emptied the counter moves in a handful of steps per layer.
+ */
+void InstanceLayerItem::account()
+{
+    const qsizetype bytes = qsizetype(sizeof(InstanceLayerItem)) + MemoryStats::kItemPrivateBytes
+                          + m_path.elementCount() * qsizetype(sizeof(QPainterPath::Element))
+                          + MemoryStats::capacityBytes(m_vertices) + MemoryStats::capacityBytes(m_slots)
+                          + MemoryStats::capacityBytes(m_transforms) + MemoryStats::capacityBytes(m_freeTransforms)
+                          + m_buckets.size() * qsizetype(sizeof(quint64) + sizeof(QVector<int>))
+                          + m_bucketEntries * qsizetype(sizeof(int)) + MemoryStats::capacityBytes(m_long)
+                          + MemoryStats::capacityBytes(m_where);
+    if (bytes == m_accountedBytes) return;
+    MemoryStats::add(MemoryStats::Counter::InstanceLayerBytes, bytes - m_accountedBytes);
+    m_accountedBytes = bytes;
+}
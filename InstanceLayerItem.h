@@ -0,0 +1,166 @@
+/**
+ * @file InstanceLayerItem.h
+ * @brief Declares a graphics item that draws every instance of one prototype from a shared path.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QBrush>
+#include <QGraphicsItem>
+#include <QHash>
+#include <QPainterPath>
+#include <QPen>
+#include <QTransform>
+#include <QVector>
+#include "MemoryStats.h"
+#include "ShapeBase.h"
+
+/**
+ * @class InstanceLayerItem
+ * @brief Draws many copies of one prototype geometry as a single scene item.
+ *
+ * The prototype's outline, pen and brush are stored once. Each instance is a 24-byte slot
+ * holding its offset from the prototype; an instance that is rotated or scaled gets an
+ * entry in a side table of transforms instead. Painting translates the shared path per
+ * visible slot, so thousands of identical shapes cost neither a vertex list, a polygon nor
+ * a `QGraphicsPolygonItem` and scene-index entry each. Dead slots at the end of the table
+ * are dropped, so undoing and redoing a batch of instances reuses its slots. The layer is
+ * deleted with its last `InstanceShape`, or with the last history step that can restore one.
+ *
+ * Slots are bucketed by the grid cell holding the top-left corner of their bounds, mapped
+ * ones included. Cells are larger than one translated instance, so painting only visits the
+ * cells around the exposed area; the few instances mapped larger than a cell are kept in a
+ * separate list. Each slot remembers its position in its list, so moving or removing an
+ * instance does not search the list.
+ */
+class InstanceLayerItem : public QGraphicsItem
+{
+public:
+    /**
+     * @brief Creates an empty layer for a prototype geometry.
+     * @param kind Kind every instance reports.
+     * @param vertices Prototype vertices in scene coordinates.
+     * @param path Outline drawn for the prototype, in scene coordinates.
+     * @param pen Pen of the prototype's item.
+     * @param brush Brush of the prototype's item; `Qt::NoBrush` for lines.
+     */
+    InstanceLayerItem(ShapeKind kind, const QVector<QPointF>& vertices, const QPainterPath& path, const QPen& pen,
+                      const QBrush& brush);
+
+    /**
+     * @brief Removes the layer's bytes from `MemoryStats::Counter::InstanceLayerBytes`.
+     */
+    ~InstanceLayerItem() override;
+
+    /**
+     * @brief Returns the kind of every instance.
+     */
+    ShapeKind kind() const { return m_kind; }
+
+    /**
+     * @brief Returns the prototype vertices that placements map.
+     */
+    const QVector<QPointF>& baseVertices() const { return m_vertices; }
+
+    /**
+     * @brief Appends instances in one geometry change.
+     * @param placement Transform applied to the prototype before each offset.
+     * @param offsets Translation of each new instance after @p placement.
+     * @return Slot of the first instance; the others follow consecutively.
+     */
+    int addInstances(const QTransform& placement, const QVector<QPointF>& offsets);
+
+    /**
+     * @brief Returns the transform that maps the prototype onto an instance.
+     * @param slot Live slot.
+     */
+    QTransform placement(int slot) const;
+
+    /**
+     * @brief Moves an instance; a pure translation frees its side-table transform.
+     * @param slot Live slot.
+     * @param placement Transform that maps the prototype onto the instance.
+     */
+    void setPlacement(int slot, const QTransform& placement);
+
+    /**
+     * @brief Returns the vertices of an instance.
+     * @param slot Live slot.
+     */
+    QVector<QPointF> vertices(int slot) const;
+
+    /**
+     * @brief Returns the center of an instance; affine maps preserve the vertex centroid.
+     * @param slot Live slot.
+     */
+    QPointF center(int slot) const;
+
+    /**
+     * @brief Stops drawing an instance.
+     * @param slot Live slot.
+     */
+    void removeInstance(int slot);
+
+    /**
+     * @brief Tints an instance like a highlighted shape item, or restores it.
+     * @param slot Live slot.
+     * @param on Whether the instance is highlighted.
+     */
+    void setHighlighted(int slot, bool on);
+
+    /**
+     * @brief Returns the number of instances still drawn.
+     */
+    int liveCount() const { return m_liveCount; }
+
+    /**
+     * @brief Returns the union of all instance bounds, grown by the pen width.
+     */
+    QRectF boundingRect() const override;
+
+    /**
+     * @brief Draws the live instances that intersect the exposed area.
+     */
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) override;
+
+private:
+    /**
+     * @brief Placement of one instance.
+     */
+    struct Slot
+    {
+        QPointF offset;          ///< Translation from the prototype when `transform` is `-1`.
+        qint32 transform = -1;   ///< Index into `m_transforms` for rotated or scaled instances.
+        bool live = false;
+        bool highlighted = false;
+    };
+
+    QRectF slotBounds(const Slot& slot) const;
+    QPoint cellOf(const QPointF& p) const;
+    static quint64 cellKey(const QPoint& cell);
+    void bucketInsert(int slot);
+    void bucketRemove(int slot);
+    void growBounds(const QRectF& rect);
+    int storeTransform(const QTransform& transform);
+    void releaseTransform(Slot& slot);
+    void account();
+
+    ShapeKind m_kind;
+    QVector<QPointF> m_vertices;
+    QPointF m_center;
+    QPainterPath m_path;
+    QRectF m_pathRect;              ///< Bounds of `m_path` without the pen.
+    QPen m_pen;
+    QBrush m_brush;
+    QVector<Slot> m_slots;
+    QVector<QTransform> m_transforms;
+    QVector<int> m_freeTransforms;
+    qreal m_cellSize = 1.0;                 ///< Edge of a bucket cell; at least the extent of a translated slot.
+    QHash<quint64, QVector<int>> m_buckets; ///< Live slots per cell.
+    QVector<int> m_long;                    ///< Live slots whose bounds are larger than a cell.
+    QVector<int> m_where;                   ///< Position of each live slot in its bucket or in `m_long`.
+    qsizetype m_bucketEntries = 0;          ///< Slots held across all buckets.
+    int m_liveCount = 0;
+    QRectF m_bounds;
+    qsizetype m_accountedBytes = 0; ///< Bytes last published to the memory counters.
+};
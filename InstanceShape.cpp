@@ -0,0 +1,109 @@
+/**
+ * @file InstanceShape.cpp
+ * @brief Implements shapes that place a shared prototype geometry.
+ * @author Nikol Grigoryan
+ */
+#include "InstanceShape.h"
+#include <QGraphicsLineItem>
+#include <QGraphicsPolygonItem>
+#include <QtMath>
+
+namespace {
+
+/**
+ * @brief Linear parts closer than this to the identity are treated as a pure translation.
+ */
+constexpr double kIdentityTolerance = 1e-9;
+
+/**
+ * @brief Finds the affine map taking the prototype vertices @p from onto @p to.
+ *
+ * Polygons determine it from their first three vertices. A line only determines a
+ * similarity (rotation and uniform scale about its first point), which is exactly what
+ * `rotate` and `scale` apply.
+ */
+QTransform fitPlacement(const QVector<QPointF>& from, const QVector<QPointF>& to)
+{
+    const QPointF p0 = from[0];
+    const QPointF q0 = to[0];
+    double a = 1.0, b = 0.0, c = 0.0, d = 1.0; // Linear part [[a, b], [c, d]] acting on column vectors
+
+    if (from.size() >= 3) {
+        // Solve A * u = fu and A * v = fv with Cramer's rule
+        const QPointF u = from[1] - p0, v = from[2] - p0;
+        const QPointF fu = to[1] - q0, fv = to[2] - q0;
+        const double det = u.x() * v.y() - u.y() * v.x();
+        if (det != 0.0) {
+            a = (fu.x() * v.y() - fv.x() * u.y()) / det;
+            b = (fv.x() * u.x() - fu.x() * v.x()) / det;
+            c = (fu.y() * v.y() - fv.y() * u.y()) / det;
+            d = (fv.y() * u.x() - fu.y() * v.x()) / det;
+        }
+    } else if (from.size() == 2) {
+        // Complex division (q1 - q0) / (p1 - p0)
+        const QPointF u = from[1] - p0, fu = to[1] - q0;
+        const double norm = u.x() * u.x() + u.y() * u.y();
+        if (norm > 0.0) {
+            a = d = (fu.x() * u.x() + fu.y() * u.y()) / norm;
+            c = (fu.y() * u.x() - fu.x() * u.y()) / norm;
+            b = -c;
+        }
+    }
+
+    // Rounding in the caller's translation must not turn a move into a side-table transform
+    if (qAbs(a - 1.0) < kIdentityTolerance && qAbs(b) < kIdentityTolerance
+        && qAbs(c) < kIdentityTolerance && qAbs(d - 1.0) < kIdentityTolerance) {
+        return QTransform::fromTranslate(q0.x() - p0.x(), q0.y() - p0.y());
+    }
+
+    // QTransform maps row vectors: x' = m11 x + m21 y + dx, y' = m12 x + m22 y + dy
+    return QTransform(a, c, b, d, q0.x() - (a * p0.x() + b * p0.y()), q0.y() - (c * p0.x() + d * p0.y()));
+}
+
+} // namespace
+
+/**
+ * @brief Takes a share of the layer; the slot was added by the caller.
+ */
+InstanceShape::InstanceShape(std::shared_ptr<InstanceLayerItem> layer, int slot)
+    : m_layer(std::move(layer)), m_slot(slot)
+{
+}
+
+/**
+ * @brief Frees the slot before dropping the share of the layer.
+ */
+InstanceShape::~InstanceShape()
+{
+    m_layer->removeInstance(m_slot);
+}
+
+/**
+ * @brief Stores the fitted placement; translations keep the slot at its compact size.
+ */
+void InstanceShape::setVertices(const QVector<QPointF>& points)
+{
+    m_layer->setPlacement(m_slot, fitPlacement(m_layer->baseVertices(), points));
+}
+
+/**
+ * @brief Copies the outline exactly as the prototype's item draws it, in its drawing order.
+ */
+std::shared_ptr<InstanceLayerItem> InstanceShape::makeLayer(const ShapeBase& prototype)
+{
+    QPainterPath path;
+    QPen pen;
+    QBrush brush;
+    QGraphicsItem* item = prototype.graphicsItem();
+    if (auto* line = dynamic_cast<QGraphicsLineItem*>(item)) {
+        path.moveTo(line->line().p1());
+        path.lineTo(line->line().p2());
+        pen = line->pen();
+    } else if (auto* polygon = dynamic_cast<QGraphicsPolygonItem*>(item)) {
+        path.addPolygon(polygon->polygon());
+        path.closeSubpath();
+        pen = polygon->pen();
+        brush = polygon->brush();
+    }
+    return std::make_shared<InstanceLayerItem>(prototype.kind(), prototype.vertices(), path, pen, brush);
+}
@@ -0,0 +1,104 @@
+/**
+ * @file InstanceShape.h
+ * @brief Declares the shape that places a shared prototype geometry instead of owning vertices.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <memory>
+#include "InstanceLayerItem.h"
+#include "ShapeBase.h"
+
+/**
+ * @class InstanceShape
+ * @brief A named copy of a prototype, stored as a slot of the prototype's `InstanceLayerItem`.
+ *
+ * Besides its handle, an instance holds only a reference to the layer and its slot number;
+ * its vertices and center are computed from the layer's prototype geometry and the slot's
+ * placement. It reports the prototype's kind, so the repository, history and saved scenes
+ * treat it like any other shape of that kind. The shape table refers to its slot, and the
+ * scene store and history share the prototype vertices unless it is rotated or scaled.
+ */
+class InstanceShape : public ShapeBase
+{
+public:
+    /**
+     * @brief Adopts a slot already added to the layer.
+     * @param layer Layer drawing the instance; shared with the other instances.
+     * @param slot Live slot of the layer.
+     */
+    InstanceShape(std::shared_ptr<InstanceLayerItem> layer, int slot);
+
+    /**
+     * @brief Removes the slot; the last instance deletes the layer, which leaves the scene.
+     */
+    ~InstanceShape() override;
+
+    /**
+     * @brief Returns the shared layer item.
+     */
+    QGraphicsItem* graphicsItem() const override { return m_layer.get(); }
+
+    /**
+     * @brief Returns the prototype center mapped by the placement.
+     */
+    QPointF center() const override { return m_layer->center(m_slot); }
+
+    /**
+     * @brief Returns the prototype's kind.
+     */
+    ShapeKind kind() const override { return m_layer->kind(); }
+
+    /**
+     * @brief Returns the prototype vertices mapped by the placement.
+     */
+    QVector<QPointF> vertices() const override { return m_layer->vertices(m_slot); }
+
+    /**
+     * @brief Fits the placement that maps the prototype vertices onto @p points.
+     * @param points New vertices, an affine image of the prototype's, as produced by `move`, `rotate` and `scale`.
+     */
+    void setVertices(const QVector<QPointF>& points) override;
+
+    /**
+     * @brief Counts the object, plus the vertex copy its scene record holds once it is rotated
+     *        or scaled; the layer is counted once, separately.
+     */
+    MemoryStats::ShapeUsage memoryUsage() const override
+    {
+        const qint64 copy = placement().type() <= QTransform::TxTranslate
+            ? 0 : m_layer->baseVertices().size() * qint64(sizeof(QPointF));
+        return { sizeof(InstanceShape), copy, 0, true };
+    }
+
+    /**
+     * @brief Tints only this instance's slot of the shared layer.
+     */
+    void setHighlighted(bool on) override { m_layer->setHighlighted(m_slot, on); }
+
+    /**
+     * @brief Returns the layer drawing the instance.
+     */
+    const std::shared_ptr<InstanceLayerItem>& layer() const { return m_layer; }
+
+    /**
+     * @brief Returns the instance's slot in the layer.
+     */
+    int slot() const { return m_slot; }
+
+    /**
+     * @brief Returns the transform that maps the prototype onto the instance.
+     */
+    QTransform placement() const { return m_layer->placement(m_slot); }
+
+    /**
+     * @brief Creates an empty layer with the geometry and style of an ordinary shape.
+     * @param prototype Shape whose item outline, pen and brush are copied.
+     * @return New layer, not yet in a scene.
+     */
+    static std::shared_ptr<InstanceLayerItem> makeLayer(const ShapeBase& prototype);
+
+private:
+    std::shared_ptr<InstanceLayerItem> m_layer;
+    int m_slot;
+};
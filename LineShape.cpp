@@ -5,26 +5,44 @@
  */
 #include "LineShape.h"
 #include <QPen>
+#include "Utility.h"
 
 /**
  * @brief Constructs a line shape using two endpoints.
- * @param name Unique logical name for the shape.
  * @param p1 First endpoint of the line segment.
  * @param p2 Second endpoint of the line segment.
  */
-LineShape::LineShape(const QString& name, const QPointF& p1, const QPointF& p2)
-    : ShapeBase(name), m_item(new QGraphicsLineItem(QLineF(p1, p2))), m_p1(p1), m_p2(p2)
+LineShape::LineShape(const QPointF& p1, const QPointF& p2)
+    : m_item(new QGraphicsLineItem(QLineF(p1, p2))), m_p1(p1), m_p2(p2)
 {
     // Style the line for better visibility
     m_item->setPen(QPen(Qt::blue, 2.0));
 }
 
+/**
+ * @brief Releases the graphics item owned by the shape.
+ */
+LineShape::~LineShape()
+{
+    delete m_item;
+}
+
 /**
  * @brief Computes the midpoint of the stored endpoints.
  * @return Scene coordinate of the line's midpoint.
  */
 QPointF LineShape::center() const
 {
-    // Compute midpoint between endpoints
-    return QPointF((m_p1.x() + m_p2.x()) / 2.0, (m_p1.y() + m_p2.y()) / 2.0);
+    return Utility::toPointF(Geometry::midpoint(Utility::toVec(m_p1), Utility::toVec(m_p2)));
+}
+
+/**
+ * @brief Replaces the endpoints and updates the rendered line.
+ * @param points New endpoints.
+ */
+void LineShape::setVertices(const QVector<QPointF>& points)
+{
+    m_p1 = points[0];
+    m_p2 = points[1];
+    m_item->setLine(QLineF(m_p1, m_p2));
 }
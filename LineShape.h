@@ -20,11 +20,15 @@ class LineShape : public ShapeBase
 public:
     /**
      * @brief Creates a line shape from two endpoints.
-     * @param name Unique logical name for repository lookup.
      * @param p1 Starting endpoint of the segment.
      * @param p2 Ending endpoint of the segment.
      */
-    LineShape(const QString& name, const QPointF& p1, const QPointF& p2);
+    LineShape(const QPointF& p1, const QPointF& p2);
+
+    /**
+     * @brief Deletes the graphics item, which also removes it from its scene.
+     */
+    ~LineShape() override;
 
     /**
      * @brief Provides access to the underlying graphics item.
@@ -38,6 +42,35 @@ public:
      */
     QPointF center() const override;
 
+    /**
+     * @brief Identifies the shape as a line.
+     * @return `ShapeKind::Line`.
+     */
+    ShapeKind kind() const override { return ShapeKind::Line; }
+
+    /**
+     * @brief Returns the stored vertices.
+     * @return Vertices in construction order.
+     */
+    QVector<QPointF> vertices() const override { return { m_p1, m_p2 }; }
+
+    /**
+     * @brief Moves both endpoints and updates the line item.
+     * @param points New endpoints `{p1, p2}`.
+     */
+    void setVertices(const QVector<QPointF>& points) override;
+
+    /**
+     * @brief Counts the object, the endpoint array of its scene record, and the line item.
+     *
+     * The endpoints themselves live inside the object, so the record gets its own array.
+     */
+    MemoryStats::ShapeUsage memoryUsage() const override
+    {
+        return { sizeof(LineShape), 2 * qint64(sizeof(QPointF)),
+                 sizeof(QGraphicsLineItem) + MemoryStats::kItemPrivateBytes };
+    }
+
 private:
     QGraphicsLineItem* m_item;
     QPointF m_p1;
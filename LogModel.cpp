@@ -0,0 +1,184 @@
+/**
+ * @file LogModel.cpp
+ * @brief Implements the fixed-capacity log model shown in the main window's log view.
+ * @author Nikol Grigoryan
+ */
+#include "LogModel.h"
+#include "MemoryStats.h"
+#include <QColor>
+#include <QStringList>
+#include <QTimer>
+#include <algorithm>
+
+/**
+ * @brief Creates an empty model; ring slots are allocated as lines arrive.
+ */
+LogModel::LogModel(int capacity, QObject* parent)
+    : QAbstractListModel(parent), m_capacity(std::max(1, capacity))
+{
+}
+
+/**
+ * @brief Withdraws the bytes the model published.
+ */
+LogModel::~LogModel()
+{
+    MemoryStats::add(MemoryStats::Counter::LogBufferBytes, -m_accountedBytes);
+}
+
+/**
+ * @brief Splits the message into lines, queues them and schedules one flush per interval.
+ */
+void LogModel::append(Level level, const QString& message)
+{
+    const QStringList lines = message.split('\n');
+
+    std::lock_guard<std::mutex> lock(m_pendingMutex);
+    for (int i = 0; i < lines.size(); ++i) {
+        m_pending.push_back(Entry{ level, lines[i], i > 0 });
+    }
+
+    // Only the newest `capacity` lines can survive the flush, so older pending ones are dropped early
+    if (m_pending.size() > 2 * static_cast<size_t>(m_capacity)) {
+        m_pending.erase(m_pending.begin(), m_pending.end() - m_capacity);
+    }
+
+    if (m_flushScheduled) return;
+    m_flushScheduled = true;
+    // The timer has to start on the model's thread, whichever thread appended
+    QMetaObject::invokeMethod(this, [this]() {
+        QTimer::singleShot(kFlushIntervalMs, this, &LogModel::flush);
+    }, Qt::QueuedConnection);
+}
+
+/**
+ * @brief Drops the lines that no longer fit, then appends the batch as one row insertion.
+ */
+void LogModel::flush()
+{
+    std::vector<Entry> batch;
+    {
+        std::lock_guard<std::mutex> lock(m_pendingMutex);
+        batch.swap(m_pending);
+        m_flushScheduled = false;
+    }
+    if (batch.size() > static_cast<size_t>(m_capacity)) {
+        batch.erase(batch.begin(), batch.end() - m_capacity);
+    }
+    if (batch.empty()) return;
+
+    const qint64 count = static_cast<qint64>(batch.size());
+    const std::deque<qint64>* index = filteredIndex();
+
+    // Evict the oldest lines so the batch fits
+    const qint64 evict = std::max<qint64>(0, (m_next - m_first) + count - m_capacity);
+    if (evict > 0) {
+        const qint64 newFirst = m_first + evict;
+        const int removed = index ? static_cast<int>(std::lower_bound(index->begin(), index->end(), newFirst) - index->begin())
+                                  : static_cast<int>(evict);
+        if (removed > 0) beginRemoveRows(QModelIndex(), 0, removed - 1);
+        m_first = newFirst;
+        for (std::deque<qint64>& levelIndex : m_byLevel) {
+            while (!levelIndex.empty() && levelIndex.front() < m_first) levelIndex.pop_front();
+        }
+        if (removed > 0) endRemoveRows();
+    }
+
+    int added = static_cast<int>(count);
+    if (index) {
+        const Level shown = m_filter == Filter::InfoOnly ? Level::Info : Level::Error;
+        added = static_cast<int>(std::count_if(batch.begin(), batch.end(),
+                                               [shown](const Entry& e) { return e.level == shown; }));
+    }
+    const int firstRow = rowCount();
+    if (added > 0) beginInsertRows(QModelIndex(), firstRow, firstRow + added - 1);
+    for (Entry& entry : batch) {
+        const qint64 seq = m_next++;
+        m_byLevel[static_cast<int>(entry.level)].push_back(seq);
+        const size_t slot = static_cast<size_t>(seq % m_capacity);
+        m_textBytes += entry.text.size() * qsizetype(sizeof(QChar));
+        if (slot < m_ring.size()) {
+            m_textBytes -= m_ring[slot].text.size() * qsizetype(sizeof(QChar));
+            m_ring[slot] = std::move(entry);
+        } else {
+            m_ring.push_back(std::move(entry));
+        }
+    }
+    if (added > 0) endInsertRows();
+    account();
+}
+
+/**
+ * @brief Counts the ring slots, the text of the stored lines and both level indexes.
+ */
+void LogModel::account()
+{
+    const qsizetype bytes = MemoryStats::capacityBytes(m_ring) + m_textBytes
+                          + qsizetype(m_byLevel[0].size() + m_byLevel[1].size()) * qsizetype(sizeof(qint64));
+    MemoryStats::add(MemoryStats::Counter::LogBufferBytes, bytes - m_accountedBytes);
+    m_accountedBytes = bytes;
+}
+
+/**
+ * @brief Swaps the row mapping; the lines themselves stay where they are.
+ */
+void LogModel::setFilter(Filter filter)
+{
+    if (filter == m_filter) return;
+    beginResetModel();
+    m_filter = filter;
+    endResetModel();
+}
+
+/**
+ * @brief Counts stored lines, or those of the filtered level.
+ */
+int LogModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) return 0;
+    const std::deque<qint64>* index = filteredIndex();
+    return static_cast<int>(index ? index->size() : m_next - m_first);
+}
+
+/**
+ * @brief Shows the level prefix on the first line of a message and colors errors.
+ */
+QVariant LogModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount()) return QVariant();
+    const Entry& entry = m_ring[static_cast<size_t>(sequenceAt(index.row()) % m_capacity)];
+
+    if (role == Qt::DisplayRole) {
+        if (entry.continuation) return QString("    %1").arg(entry.text);
+        return QString(entry.level == Level::Error ? "[ERROR] %1" : "[INFO] %1").arg(entry.text);
+    }
+    if (role == Qt::ForegroundRole && entry.level == Level::Error) {
+        return QColor(255, 110, 110);
+    }
+    return QVariant();
+}
+
+/**
+ * @brief Maps a row to a sequence number through the filtered index, if any.
+ */
+qint64 LogModel::sequenceAt(int row) const
+{
+    const std::deque<qint64>* index = filteredIndex();
+    return index ? (*index)[row] : m_first + row;
+}
+
+/**
+ * @brief Picks the per-level index that backs the current filter.
+ */
+const std::deque<qint64>* LogModel::filteredIndex() const
+{
+    switch (m_filter) {
+    case Filter::InfoOnly:
+        return &m_byLevel[static_cast<int>(Level::Info)];
+    case Filter::ErrorsOnly:
+        return &m_byLevel[static_cast<int>(Level::Error)];
+    case Filter::All:
+        break;
+    }
+    return nullptr;
+}
@@ -0,0 +1,137 @@
+/**
+ * @file LogModel.h
+ * @brief Declares the fixed-capacity log model shown in the main window's log view.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QAbstractListModel>
+#include <QString>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+/**
+ * @class LogModel
+ * @brief Keeps the most recent log lines in a ring buffer and exposes them to a list view.
+ *
+ * Messages may be appended from any thread. They are collected in a pending batch and
+ * moved into the model on the GUI thread at most every `kFlushIntervalMs`, so a burst of
+ * thousands of messages costs one row insertion and one repaint. Once `capacity` lines
+ * are stored, the oldest lines are dropped, so memory does not grow with the session.
+ *
+ * Multi-line messages are split into one row per line, which keeps rows the same height
+ * and lets the view lay out only the visible rows. Each level keeps its own index of row
+ * positions, so switching the level filter is O(1).
+ */
+class LogModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Severity of a log line.
+     */
+    enum class Level
+    {
+        Info,
+        Error
+    };
+
+    /**
+     * @brief Which lines the model exposes.
+     */
+    enum class Filter
+    {
+        All,        ///< Every line.
+        InfoOnly,   ///< Only informational lines.
+        ErrorsOnly  ///< Only errors.
+    };
+
+    /**
+     * @brief Lines kept before the oldest are dropped.
+     */
+    static constexpr int kDefaultCapacity = 100000;
+
+    /**
+     * @brief Delay between the first pending append and the batch flush.
+     */
+    static constexpr int kFlushIntervalMs = 50;
+
+    /**
+     * @brief Creates an empty model.
+     * @param capacity Lines kept; must be positive.
+     * @param parent Optional QObject parent.
+     */
+    explicit LogModel(int capacity = kDefaultCapacity, QObject* parent = nullptr);
+
+    /**
+     * @brief Removes the stored lines from `MemoryStats::Counter::LogBufferBytes`.
+     */
+    ~LogModel() override;
+
+    /**
+     * @brief Queues a message for the next flush; safe to call from any thread.
+     * @param level Severity of the message.
+     * @param message Text; each line becomes one row.
+     */
+    void append(Level level, const QString& message);
+
+    /**
+     * @brief Selects which lines the model exposes.
+     */
+    void setFilter(Filter filter);
+
+    /**
+     * @brief Returns the current filter.
+     */
+    Filter filter() const { return m_filter; }
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+public slots:
+    /**
+     * @brief Moves pending messages into the ring buffer; called by the flush timer.
+     */
+    void flush();
+
+private:
+    /**
+     * @brief One stored line.
+     */
+    struct Entry
+    {
+        Level level = Level::Info;
+        QString text;
+        bool continuation = false; ///< Second or later line of a multi-line message.
+    };
+
+    /**
+     * @brief Absolute sequence number of the line shown at @p row under the current filter.
+     */
+    qint64 sequenceAt(int row) const;
+
+    /**
+     * @brief Returns the index of a level's lines, or `nullptr` for `Filter::All`.
+     */
+    const std::deque<qint64>* filteredIndex() const;
+
+    /**
+     * @brief Publishes the change in the ring's size since the last flush to the memory counters.
+     */
+    void account();
+
+    const int m_capacity;
+    std::vector<Entry> m_ring;         ///< Line with sequence number `s` lives at `s % m_capacity`.
+    qint64 m_first = 0;                ///< Sequence number of the oldest stored line.
+    qint64 m_next = 0;                 ///< Sequence number the next line will get.
+    std::deque<qint64> m_byLevel[2];   ///< Sequence numbers of stored lines per level.
+    Filter m_filter = Filter::All;
+    qsizetype m_textBytes = 0;         ///< Character data of the stored lines.
+    qsizetype m_accountedBytes = 0;    ///< Bytes last published to the memory counters.
+
+    std::mutex m_pendingMutex;
+    std::vector<Entry> m_pending;      ///< Lines appended since the last flush.
+    bool m_flushScheduled = false;
+};
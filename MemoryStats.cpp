@@ -0,0 +1,106 @@
+/**
+ * @file MemoryStats.cpp
+ * @brief Implements the memory counters and the `mem_stats` report.
+ * @author Nikol Grigoryan
+ */
+#include "MemoryStats.h"
+#include <QStringList>
+#include <atomic>
+
+namespace {
+
+/**
+ * @brief Counter storage; relaxed ordering suffices since the values are only read for reports.
+ */
+std::atomic<qint64> g_counters[int(MemoryStats::Counter::Count)];
+
+/**
+ * @brief Label of each subsystem line, in `Report::Subsystem` order.
+ */
+const char* const kSubsystemLabels[MemoryStats::Report::SubsystemCount] = {
+    "Shape objects", "Vertex storage", "Qt items (estimated)", "Names",
+    "Repository index", "Connectors", "Log buffer", "History and caches"
+};
+
+/**
+ * @brief Label of each row of the per-type table.
+ */
+const char* const kTypeLabels[MemoryStats::Report::kTypeCount] = {
+    "line", "triangle", "rectangle", "square", "instance"
+};
+
+} // namespace
+
+namespace MemoryStats {
+
+void add(Counter counter, qint64 delta)
+{
+    g_counters[int(counter)].fetch_add(delta, std::memory_order_relaxed);
+}
+
+qint64 value(Counter counter)
+{
+    return g_counters[int(counter)].load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Picks the largest unit that keeps the value at or above one.
+ */
+QString formatBytes(qint64 bytes)
+{
+    static const char* const units[] = { "KiB", "MiB", "GiB" };
+    if (bytes < 1024) return QString("%1 B").arg(bytes);
+    double value = double(bytes) / 1024;
+    int unit = 0;
+    while (value >= 1024 && unit < 2) {
+        value /= 1024;
+        ++unit;
+    }
+    return QString("%1 %2").arg(value, 0, 'f', 1).arg(units[unit]);
+}
+
+qint64 Report::total() const
+{
+    qint64 sum = 0;
+    for (qint64 b : bytes) sum += b;
+    return sum;
+}
+
+qint64 Report::shapeCount() const
+{
+    qint64 n = 0;
+    for (const Type& t : types) n += t.count;
+    return n;
+}
+
+/**
+ * @brief Prints the subsystems, then the average object, vertex and item bytes of each type in use.
+ */
+QString Report::text() const
+{
+    const qint64 shapes = shapeCount();
+    QStringList lines;
+    lines << QString("Memory: %1 for %2 shapes").arg(formatBytes(total())).arg(shapes)
+                 + (shapes > 0 ? QString(", %1 B per shape.").arg(total() / shapes) : QString("."));
+
+    for (int i = 0; i < SubsystemCount; ++i) {
+        QString line = QString("  %1: %2").arg(kSubsystemLabels[i], formatBytes(bytes[i]));
+        if (i == ShapeObjects) line += QString(" in %1 objects").arg(value(Counter::ShapeObjects));
+        if (i == Connectors) line += QString(" for %1 connections").arg(connectors);
+        lines << line + '.';
+    }
+
+    if (shapes > 0) {
+        lines << "Bytes per shape by type (object + vertices + item):";
+        for (int i = 0; i < kTypeCount; ++i) {
+            const Type& t = types[i];
+            if (t.count == 0) continue;
+            lines << QString("  %1: %2 shapes, %3 B each (%4 + %5 + %6).")
+                         .arg(kTypeLabels[i]).arg(t.count).arg(t.usage.total() / t.count)
+                         .arg(t.usage.object / t.count).arg(t.usage.vertices / t.count).arg(t.usage.item / t.count);
+        }
+    }
+    return lines.join('\n');
+}
+
+} // namespace MemoryStats
@@ -0,0 +1,153 @@
+/**
+ * @file MemoryStats.h
+ * @brief Declares the per-subsystem memory counters and the report printed by `mem_stats`.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+/**
+ * @namespace MemoryStats
+ * @brief Cheap memory accounting for the engine's subsystems.
+ *
+ * Allocations the engine makes itself are counted where they happen: `ShapeBase` routes
+ * its objects through a class allocator that feeds the `ShapeObject*` counters, and the
+ * log buffer and instance layers publish their size as it changes. Containers are measured
+ * from their capacity on demand, which is O(1) per container. Memory Qt allocates behind an
+ * item (its private data and scene-index entry) cannot be observed, so it is charged as the
+ * fixed estimate `kItemPrivateBytes` per item.
+ */
+namespace MemoryStats {
+
+/**
+ * @brief Process-wide counters updated as memory is allocated and released.
+ */
+enum class Counter
+{
+    ShapeObjects,       ///< Live `ShapeBase` objects.
+    ShapeObjectBytes,   ///< Bytes allocated for live `ShapeBase` objects.
+    InstanceLayerBytes, ///< Bytes held by instance layer items and their slot tables.
+    LogBufferBytes,     ///< Bytes held by the log view's ring buffer and indexes.
+    Count
+};
+
+/**
+ * @brief Estimated bytes Qt allocates behind every scene item besides the item object itself.
+ */
+constexpr qsizetype kItemPrivateBytes = 384;
+
+/**
+ * @brief Adjusts a counter; safe to call from any thread.
+ * @param counter Counter to change.
+ * @param delta Signed change.
+ */
+void add(Counter counter, qint64 delta);
+
+/**
+ * @brief Reads a counter.
+ */
+qint64 value(Counter counter);
+
+/**
+ * @brief Returns the bytes reserved by a container with `capacity()` and `value_type`.
+ */
+template <typename Container>
+qsizetype capacityBytes(const Container& c)
+{
+    return qsizetype(c.capacity()) * qsizetype(sizeof(typename Container::value_type));
+}
+
+/**
+ * @brief Formats a byte count with a binary unit, e.g. `12.5 MiB`.
+ */
+QString formatBytes(qint64 bytes);
+
+/**
+ * @struct ShapeUsage
+ * @brief Bytes attributed to one shape, or summed over several.
+ */
+struct ShapeUsage
+{
+    qint64 object = 0;     ///< The `ShapeBase` object itself.
+    qint64 vertices = 0;   ///< Vertex arrays owned by the shape.
+    qint64 item = 0;       ///< Its own graphics item, including the `kItemPrivateBytes` estimate.
+    bool instance = false; ///< The shape is drawn by a shared instance layer.
+
+    qint64 total() const { return object + vertices + item; }
+
+    ShapeUsage& operator+=(const ShapeUsage& other)
+    {
+        object += other.object;
+        vertices += other.vertices;
+        item += other.item;
+        return *this;
+    }
+
+    ShapeUsage& operator-=(const ShapeUsage& other)
+    {
+        object -= other.object;
+        vertices -= other.vertices;
+        item -= other.item;
+        return *this;
+    }
+};
+
+/**
+ * @struct Report
+ * @brief Bytes per subsystem and per shape type, as printed by `mem_stats`.
+ */
+struct Report
+{
+    /**
+     * @brief Subsystems reported as separate lines.
+     */
+    enum Subsystem
+    {
+        ShapeObjects,
+        Vertices,
+        Items,
+        Names,
+        Index,
+        Connectors,
+        LogBuffer,
+        Caches,
+        SubsystemCount
+    };
+
+    /**
+     * @brief Rows of the per-type table: the four shape kinds, then instances of any kind.
+     */
+    static constexpr int kTypeCount = 5;
+
+    /**
+     * @brief Count and summed usage of the shapes of one type.
+     */
+    struct Type
+    {
+        qint64 count = 0;
+        ShapeUsage usage;
+    };
+
+    qint64 bytes[SubsystemCount] = {};
+    Type types[kTypeCount];
+    qint64 connectors = 0;  ///< Live connections, for the connector line.
+
+    /**
+     * @brief Returns the sum over all subsystems.
+     */
+    qint64 total() const;
+
+    /**
+     * @brief Returns the number of shapes counted in the type table.
+     */
+    qint64 shapeCount() const;
+
+    /**
+     * @brief Formats the report: total, one line per subsystem, then bytes per shape by type.
+     */
+    QString text() const;
+};
+
+} // namespace MemoryStats
@@ -0,0 +1,119 @@
+/**
+ * @file NamePool.cpp
+ * @brief Implements the shape name interning pool.
+ * @author Nikol Grigoryan
+ */
+#include "NamePool.h"
+
+namespace {
+
+/**
+ * @brief Bucket count of the first table; always a power of two.
+ */
+constexpr int kInitialBuckets = 64;
+
+} // namespace
+
+/**
+ * @brief Takes a free slot or appends one, then links it into the bucket table.
+ */
+ShapeHandle NamePool::insert(const QString& name)
+{
+    int index;
+    if (!m_free.isEmpty()) {
+        index = m_free.takeLast();
+    } else {
+        if (m_entries.size() == ShapeHandle::kMaxCount) return ShapeHandle{};
+        index = m_entries.size();
+        m_entries.append(Entry{});
+    }
+
+    // Keep the load factor at or below one half so probe sequences stay short
+    if (2 * (m_size + 1) > int(m_buckets.size())) {
+        rehash(m_buckets.empty() ? kInitialBuckets : int(m_buckets.size()) * 2);
+    }
+
+    Entry& e = m_entries[index];
+    e.name = name;
+    e.hash = hashOf(name);
+    e.live = true;
+    m_nameBytes += name.size() * qsizetype(sizeof(QChar));
+
+    int b = bucketOf(e.hash);
+    while (m_buckets[b] != 0) b = (b + 1) & (int(m_buckets.size()) - 1);
+    m_buckets[b] = quint32(index) + 1;
+    ++m_size;
+    return ShapeHandle::make(index, e.generation);
+}
+
+/**
+ * @brief Unlinks the slot with backward-shift deletion, so no tombstones accumulate.
+ */
+bool NamePool::erase(ShapeHandle handle)
+{
+    if (!isLive(handle)) return false;
+    const int index = handle.index();
+    const int mask = int(m_buckets.size()) - 1;
+
+    int hole = bucketOf(m_entries[index].hash);
+    while (m_buckets[hole] != quint32(index) + 1) hole = (hole + 1) & mask;
+
+    // Move later entries of the cluster back unless that would put them before their home bucket
+    for (int b = (hole + 1) & mask; m_buckets[b] != 0; b = (b + 1) & mask) {
+        const int home = bucketOf(m_entries[m_buckets[b] - 1].hash);
+        if (((b - home) & mask) >= ((b - hole) & mask)) {
+            m_buckets[hole] = m_buckets[b];
+            hole = b;
+        }
+    }
+    m_buckets[hole] = 0;
+
+    Entry& e = m_entries[index];
+    m_nameBytes -= e.name.size() * qsizetype(sizeof(QChar));
+    e.name = QString();
+    e.live = false;
+    // Generation zero is skipped so slot zero never issues the null handle
+    e.generation = e.generation == 255 ? 1 : e.generation + 1;
+    m_free.append(index);
+    --m_size;
+    return true;
+}
+
+/**
+ * @brief Probes from the name's home bucket until it finds the name or an empty bucket.
+ */
+ShapeHandle NamePool::find(QStringView name) const
+{
+    if (m_size == 0) return ShapeHandle{};
+    const uint hash = hashOf(name);
+    const int mask = int(m_buckets.size()) - 1;
+    for (int b = bucketOf(hash); m_buckets[b] != 0; b = (b + 1) & mask) {
+        const int index = int(m_buckets[b]) - 1;
+        const Entry& e = m_entries[index];
+        if (e.hash == hash && QStringView(e.name) == name) return ShapeHandle::make(index, e.generation);
+    }
+    return ShapeHandle{};
+}
+
+/**
+ * @brief Hashes the characters of a name; equal text hashes equally in every string type.
+ */
+uint NamePool::hashOf(QStringView name)
+{
+    return uint(qHash(name));
+}
+
+/**
+ * @brief Rebuilds the bucket table from the cached hashes of the live slots.
+ */
+void NamePool::rehash(int bucketCount)
+{
+    m_buckets.assign(bucketCount, 0);
+    const int mask = bucketCount - 1;
+    for (int i = 0; i < m_entries.size(); ++i) {
+        if (!m_entries[i].live) continue;
+        int b = bucketOf(m_entries[i].hash);
+        while (m_buckets[b] != 0) b = (b + 1) & mask;
+        m_buckets[b] = quint32(i) + 1;
+    }
+}
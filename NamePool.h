@@ -0,0 +1,118 @@
+/**
+ * @file NamePool.h
+ * @brief Declares the interning pool that stores each shape name once and issues its handle.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QString>
+#include <QStringView>
+#include <QVector>
+#include <vector>
+#include "MemoryStats.h"
+#include "ShapeHandle.h"
+
+/**
+ * @class NamePool
+ * @brief Maps live shape names to generational `ShapeHandle`s and back.
+ *
+ * Every name is held once, in the slot its handle indexes; copies handed out are implicitly
+ * shared with that string, so snapshots, history and replies add no character data. The
+ * name-to-handle direction is an open-addressing table of 32-bit slot numbers with linear
+ * probing and backward-shift deletion, so a lookup compares a cached hash and then one
+ * string, and an entry costs four bytes of index instead of a hash node with its own key.
+ * Freed slots are reused through a free list with their generation bumped.
+ */
+class NamePool
+{
+public:
+    /**
+     * @brief Interns a name that is not live yet.
+     * @param name Shape name.
+     * @return New handle, or the null handle when all `ShapeHandle::kMaxCount` slots are live.
+     */
+    ShapeHandle insert(const QString& name);
+
+    /**
+     * @brief Releases a live handle; its slot returns to the free list with a new generation.
+     * @return `false` when the handle is not live.
+     */
+    bool erase(ShapeHandle handle);
+
+    /**
+     * @brief Looks up the handle of a live name.
+     * @return Handle, or the null handle when no live shape has the name.
+     */
+    ShapeHandle find(QStringView name) const;
+
+    /**
+     * @brief Tests whether a handle refers to a live name.
+     */
+    bool isLive(ShapeHandle handle) const
+    {
+        const int i = handle.index();
+        return !handle.isNull() && i < m_entries.size() && m_entries[i].live
+               && m_entries[i].generation == handle.generation();
+    }
+
+    /**
+     * @brief Returns the name of a live handle.
+     */
+    const QString& name(ShapeHandle handle) const { return m_entries[handle.index()].name; }
+
+    /**
+     * @brief Returns the live handle stored in a slot, or the null handle for a free slot.
+     * @param index Slot index below `capacity()`.
+     */
+    ShapeHandle handleAt(int index) const
+    {
+        const Entry& e = m_entries[index];
+        return e.live ? ShapeHandle::make(index, e.generation) : ShapeHandle{};
+    }
+
+    /**
+     * @brief Returns the number of live names.
+     */
+    int size() const { return m_size; }
+
+    /**
+     * @brief Returns one past the highest slot index ever issued; per-shape arrays use it as their size.
+     */
+    int capacity() const { return m_entries.size(); }
+
+    /**
+     * @brief Returns the bytes of character data held by live names.
+     */
+    qsizetype nameBytes() const { return m_nameBytes; }
+
+    /**
+     * @brief Returns the bytes reserved by the slot array, free list and bucket table.
+     */
+    qsizetype indexBytes() const
+    {
+        return MemoryStats::capacityBytes(m_entries) + MemoryStats::capacityBytes(m_free)
+             + MemoryStats::capacityBytes(m_buckets);
+    }
+
+private:
+    /**
+     * @brief Slot of one name.
+     */
+    struct Entry
+    {
+        QString name;
+        uint hash = 0;           ///< `qHash` of `name`, compared before the string.
+        quint8 generation = 1;   ///< Generation of the current or next handle.
+        bool live = false;
+    };
+
+    static uint hashOf(QStringView name);
+    int bucketOf(uint hash) const { return int(hash & quint32(m_buckets.size() - 1)); }
+    void rehash(int bucketCount);
+
+    QVector<Entry> m_entries;
+    QVector<int> m_free;
+    std::vector<quint32> m_buckets; ///< Slot index plus one; `0` marks an empty bucket.
+    int m_size = 0;
+    qsizetype m_nameBytes = 0;
+};
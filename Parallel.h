@@ -0,0 +1,56 @@
+/**
+ * @file Parallel.h
+ * @brief Declares small fork-join helpers used by CPU-bound batch operations.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+/**
+ * @namespace Parallel
+ * @brief Minimal fork-join utilities built on `std::thread`.
+ */
+namespace Parallel {
+
+/**
+ * @brief Returns the number of worker threads to use for a batch operation.
+ */
+inline int workerCount()
+{
+    return static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+/**
+ * @brief Splits `[0, count)` into contiguous ranges and runs them on worker threads.
+ *
+ * The calling thread processes the first range itself. Small inputs run inline so the
+ * thread start-up cost is never paid for trivial work.
+ * @param count Number of items.
+ * @param fn Callable `fn(int begin, int end, int worker)`.
+ * @param minPerWorker Minimum number of items that justifies an extra thread.
+ */
+template <typename Fn>
+void forRanges(int count, Fn fn, int minPerWorker = 1024)
+{
+    const int workers = std::max(1, std::min(workerCount(), count / std::max(1, minPerWorker)));
+    if (workers == 1) {
+        fn(0, count, 0);
+        return;
+    }
+
+    const int step = (count + workers - 1) / workers;
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (int w = 1; w < workers; ++w) {
+        const int begin = std::min(count, w * step);
+        const int end = std::min(count, begin + step);
+        threads.emplace_back([=, &fn]() { fn(begin, end, w); });
+    }
+    fn(0, std::min(count, step), 0);
+    for (auto& t : threads) t.join();
+}
+
+} // namespace Parallel
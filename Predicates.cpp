@@ -0,0 +1,329 @@
+/**
+ * @file Predicates.cpp
+ * @brief Implements the adaptive-precision geometric predicates.
+ * @author Nikol Grigoryan
+ */
+#include "Predicates.h"
+#include <cmath>
+
+namespace {
+
+/**
+ * @brief Nonoverlapping floating-point expansion, components in increasing magnitude.
+ *
+ * The represented value is the exact sum of the components. Zero components are
+ * eliminated, so the last component carries the sign of the whole expansion; zero is
+ * stored as a single `0.0`.
+ */
+struct Expansion
+{
+    static constexpr int kCapacity = 128;
+    double c[kCapacity];
+    int n = 0;
+
+    int sign() const { return c[n - 1] > 0.0 ? 1 : (c[n - 1] < 0.0 ? -1 : 0); }
+};
+
+/**
+ * @brief Computes `a + b` as `x + y` exactly (Knuth).
+ */
+inline void twoSum(double a, double b, double& x, double& y)
+{
+    x = a + b;
+    const double bv = x - a;
+    const double av = x - bv;
+    y = (a - av) + (b - bv);
+}
+
+/**
+ * @brief Computes `a + b` as `x + y` exactly, given `|a| >= |b|` (Dekker).
+ */
+inline void fastTwoSum(double a, double b, double& x, double& y)
+{
+    x = a + b;
+    y = b - (x - a);
+}
+
+/**
+ * @brief Computes `a * b` as `x + y` exactly using a fused multiply-add for the tail.
+ */
+inline void twoProduct(double a, double b, double& x, double& y)
+{
+    x = a * b;
+    y = std::fma(a, b, -x);
+}
+
+/**
+ * @brief Computes `a + b` and reports whether the rounded result is exact.
+ */
+inline bool exactSum(double a, double b, double& x)
+{
+    double y;
+    twoSum(a, b, x, y);
+    return y == 0.0;
+}
+
+/**
+ * @brief Computes `a * b` and reports whether the rounded result is exact.
+ */
+inline bool exactProduct(double a, double b, double& x)
+{
+    double y;
+    twoProduct(a, b, x, y);
+    return y == 0.0;
+}
+
+/**
+ * @brief Returns the exact difference `a - b` as an expansion of at most two components.
+ */
+Expansion difference(double a, double b)
+{
+    Expansion e;
+    double x, y;
+    twoSum(a, -b, x, y);
+    if (y != 0.0) e.c[e.n++] = y;
+    e.c[e.n++] = x;
+    return e;
+}
+
+/**
+ * @brief Multiplies an expansion by a double exactly (Shewchuk's scale_expansion_zeroelim).
+ */
+Expansion scale(const Expansion& e, double b)
+{
+    Expansion h;
+    double q, hh;
+    twoProduct(e.c[0], b, q, hh);
+    if (hh != 0.0) h.c[h.n++] = hh;
+    for (int i = 1; i < e.n; ++i) {
+        double p1, p0, sum;
+        twoProduct(e.c[i], b, p1, p0);
+        twoSum(q, p0, sum, hh);
+        if (hh != 0.0) h.c[h.n++] = hh;
+        fastTwoSum(p1, sum, q, hh);
+        if (hh != 0.0) h.c[h.n++] = hh;
+    }
+    if (q != 0.0 || h.n == 0) h.c[h.n++] = q;
+    return h;
+}
+
+/**
+ * @brief Returns the exact sum of two expansions (Shewchuk's fast_expansion_sum_zeroelim).
+ *
+ * Merges the components of both inputs by magnitude and accumulates them in one pass.
+ */
+Expansion add(const Expansion& e, const Expansion& f)
+{
+    Expansion h;
+    int i = 0, j = 0;
+    const auto takeE = [&]() {
+        return j == f.n || (i < e.n && (f.c[j] > e.c[i]) == (f.c[j] > -e.c[i]));
+    };
+
+    double q = takeE() ? e.c[i++] : f.c[j++];
+    bool first = true;
+    while (i < e.n || j < f.n) {
+        const double next = takeE() ? e.c[i++] : f.c[j++];
+        double sum, hh;
+        // The second-smallest component never exceeds the smallest-so-far sum in order
+        if (first) {
+            fastTwoSum(next, q, sum, hh);
+            first = false;
+        } else {
+            twoSum(q, next, sum, hh);
+        }
+        q = sum;
+        if (hh != 0.0) h.c[h.n++] = hh;
+    }
+    if (q != 0.0 || h.n == 0) h.c[h.n++] = q;
+    return h;
+}
+
+/**
+ * @brief Returns the exact negation of an expansion.
+ */
+Expansion negate(Expansion e)
+{
+    for (int i = 0; i < e.n; ++i) e.c[i] = -e.c[i];
+    return e;
+}
+
+/**
+ * @brief Returns the exact product of an expansion and a short expansion.
+ */
+Expansion multiply(const Expansion& e, const Expansion& f)
+{
+    Expansion h = scale(e, f.c[0]);
+    for (int i = 1; i < f.n; ++i) h = add(h, scale(e, f.c[i]));
+    return h;
+}
+
+/**
+ * @brief Returns the sign of a floating-point value.
+ */
+inline int signOf(double v)
+{
+    return v > 0.0 ? 1 : (v < 0.0 ? -1 : 0);
+}
+
+} // namespace
+
+namespace Predicates {
+
+/**
+ * @brief Filters the orientation determinant and falls back to the exact stage near zero.
+ */
+int orient2d(double ax, double ay, double bx, double by, double cx, double cy)
+{
+    const double left = (bx - ax) * (cy - ay);
+    const double right = (by - ay) * (cx - ax);
+    const double det = left - right;
+    if (std::fabs(det) > kProductSumBound * (std::fabs(left) + std::fabs(right))) return signOf(det);
+    return orient2dExact(ax, ay, bx, by, cx, cy);
+}
+
+/**
+ * @brief Filters the dot product and falls back to the exact stage near zero.
+ */
+int dotSign(double ax, double ay, double bx, double by, double cx, double cy)
+{
+    const double left = (bx - ax) * (cx - ax);
+    const double right = (by - ay) * (cy - ay);
+    const double dot = left + right;
+    if (std::fabs(dot) > kProductSumBound * (std::fabs(left) + std::fabs(right))) return signOf(dot);
+    return dotSignExact(ax, ay, bx, by, cx, cy);
+}
+
+/**
+ * @brief Filters the squared-length difference and falls back to the exact stage near zero.
+ */
+int compareDist2(double ax, double ay, double bx, double by,
+                 double cx, double cy, double dx, double dy)
+{
+    const double ux = ax - bx, uy = ay - by;
+    const double vx = cx - dx, vy = cy - dy;
+    const double s1 = ux * ux + uy * uy;
+    const double s2 = vx * vx + vy * vy;
+    const double diff = s1 - s2;
+    if (std::fabs(diff) > kSquareSumBound * (s1 + s2)) return signOf(diff);
+    return compareDist2Exact(ax, ay, bx, by, cx, cy, dx, dy);
+}
+
+/**
+ * @brief Filters the margin `tol (|u|^2 + |v|^2) - 2 |u . v|` and falls back to the exact stage near zero.
+ */
+bool nearlyOrthogonal(double ax, double ay, double bx, double by, double cx, double cy)
+{
+    const double ux = bx - ax, uy = by - ay;
+    const double vx = cx - ax, vy = cy - ay;
+    const double left = ux * vx, right = uy * vy;
+    const double lengths = kRelativeTolerance * ((ux * ux + uy * uy) + (vx * vx + vy * vy));
+    const double margin = lengths - 2.0 * std::fabs(left + right);
+    const double bound = kToleranceBound * (lengths + 2.0 * (std::fabs(left) + std::fabs(right)));
+    if (std::fabs(margin) > bound) return margin > 0.0;
+    return nearlyOrthogonalExact(ax, ay, bx, by, cx, cy);
+}
+
+/**
+ * @brief Filters the margin `tol (s1 + s2) - |s1 - s2|` and falls back to the exact stage near zero.
+ */
+bool nearlyEqualDist2(double ax, double ay, double bx, double by,
+                      double cx, double cy, double dx, double dy)
+{
+    const double ux = ax - bx, uy = ay - by;
+    const double vx = cx - dx, vy = cy - dy;
+    const double s1 = ux * ux + uy * uy;
+    const double s2 = vx * vx + vy * vy;
+    const double sum = s1 + s2;
+    const double margin = kRelativeTolerance * sum - std::fabs(s1 - s2);
+    const double bound = kToleranceBound * (kRelativeTolerance * sum + sum);
+    if (std::fabs(margin) > bound) return margin > 0.0;
+    return nearlyEqualDist2Exact(ax, ay, bx, by, cx, cy, dx, dy);
+}
+
+/**
+ * @brief Evaluates `(bx-ax)(cy-ay) - (by-ay)(cx-ax)` exactly.
+ */
+int orient2dExact(double ax, double ay, double bx, double by, double cx, double cy)
+{
+    // Typed coordinates usually make every difference and product exact; then the
+    // correctly rounded final subtraction already has the exact sign
+    double ux, uy, vx, vy, l, r;
+    if (exactSum(bx, -ax, ux) && exactSum(cy, -ay, vy) && exactSum(by, -ay, uy) && exactSum(cx, -ax, vx)
+        && exactProduct(ux, vy, l) && exactProduct(uy, vx, r)) {
+        return signOf(l - r);
+    }
+
+    const Expansion left = multiply(difference(bx, ax), difference(cy, ay));
+    const Expansion right = multiply(difference(by, ay), difference(cx, ax));
+    return add(left, negate(right)).sign();
+}
+
+/**
+ * @brief Evaluates `(bx-ax)(cx-ax) + (by-ay)(cy-ay)` exactly.
+ */
+int dotSignExact(double ax, double ay, double bx, double by, double cx, double cy)
+{
+    double ux, uy, vx, vy, l, r;
+    if (exactSum(bx, -ax, ux) && exactSum(by, -ay, uy) && exactSum(cx, -ax, vx) && exactSum(cy, -ay, vy)
+        && exactProduct(ux, vx, l) && exactProduct(uy, vy, r)) {
+        return signOf(l + r);
+    }
+
+    const Expansion left = multiply(difference(bx, ax), difference(cx, ax));
+    const Expansion right = multiply(difference(by, ay), difference(cy, ay));
+    return add(left, right).sign();
+}
+
+/**
+ * @brief Evaluates `|a-b|^2 - |c-d|^2` exactly.
+ */
+int compareDist2Exact(double ax, double ay, double bx, double by,
+                      double cx, double cy, double dx, double dy)
+{
+    double du, dv, dw, dz, pu, pv, pw, pz, sum1, sum2;
+    if (exactSum(ax, -bx, du) && exactSum(ay, -by, dv) && exactSum(cx, -dx, dw) && exactSum(cy, -dy, dz)
+        && exactProduct(du, du, pu) && exactProduct(dv, dv, pv)
+        && exactProduct(dw, dw, pw) && exactProduct(dz, dz, pz)
+        && exactSum(pu, pv, sum1) && exactSum(pw, pz, sum2)) {
+        return signOf(sum1 - sum2);
+    }
+
+    const Expansion ux = difference(ax, bx), uy = difference(ay, by);
+    const Expansion vx = difference(cx, dx), vy = difference(cy, dy);
+    const Expansion s1 = add(multiply(ux, ux), multiply(uy, uy));
+    const Expansion s2 = add(multiply(vx, vx), multiply(vy, vy));
+    return add(s1, negate(s2)).sign();
+}
+
+/**
+ * @brief Evaluates the sign of `tol (|u|^2 + |v|^2) - 2 |u . v|` exactly.
+ *
+ * Scaling by the power-of-two tolerance and by two is exact, so every step stays exact.
+ */
+bool nearlyOrthogonalExact(double ax, double ay, double bx, double by, double cx, double cy)
+{
+    const Expansion ux = difference(bx, ax), uy = difference(by, ay);
+    const Expansion vx = difference(cx, ax), vy = difference(cy, ay);
+    const Expansion lengths = add(add(multiply(ux, ux), multiply(uy, uy)), add(multiply(vx, vx), multiply(vy, vy)));
+    Expansion dot = add(multiply(ux, vx), multiply(uy, vy));
+    if (dot.sign() < 0) dot = negate(dot);
+    return add(scale(lengths, kRelativeTolerance), negate(scale(dot, 2.0))).sign() >= 0;
+}
+
+/**
+ * @brief Evaluates the sign of `tol (s1 + s2) - |s1 - s2|` exactly.
+ */
+bool nearlyEqualDist2Exact(double ax, double ay, double bx, double by,
+                           double cx, double cy, double dx, double dy)
+{
+    const Expansion ux = difference(ax, bx), uy = difference(ay, by);
+    const Expansion vx = difference(cx, dx), vy = difference(cy, dy);
+    const Expansion s1 = add(multiply(ux, ux), multiply(uy, uy));
+    const Expansion s2 = add(multiply(vx, vx), multiply(vy, vy));
+    Expansion diff = add(s1, negate(s2));
+    if (diff.sign() < 0) diff = negate(diff);
+    return add(scale(add(s1, s2), kRelativeTolerance), negate(diff)).sign() >= 0;
+}
+
+} // namespace Predicates
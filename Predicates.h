@@ -0,0 +1,106 @@
+/**
+ * @file Predicates.h
+ * @brief Declares adaptive-precision geometric predicates used by shape validation.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+/**
+ * @namespace Predicates
+ * @brief Exact sign tests on double coordinates in the style of Shewchuk's predicates.
+ *
+ * Each predicate first evaluates its expression in plain floating point and compares the
+ * result with a forward error bound. Only when the result is too close to zero for its
+ * sign to be trusted is the expression re-evaluated with floating-point expansions,
+ * which represent the value exactly. The answers are therefore exact for every finite
+ * input that does not overflow or underflow, at close to naive cost.
+ */
+namespace Predicates {
+
+/**
+ * @brief Unit roundoff of `double` (2^-53).
+ */
+constexpr double kEpsilon = 1.0 / 9007199254740992.0;
+
+/**
+ * @brief Relative error bound for `l + r` where `l` and `r` are products of differences.
+ *
+ * Matches Shewchuk's `ccwerrboundA`; the computed sum's sign is correct whenever its
+ * magnitude exceeds `kProductSumBound * (|l| + |r|)`.
+ */
+constexpr double kProductSumBound = (3.0 + 16.0 * kEpsilon) * kEpsilon;
+
+/**
+ * @brief Relative error bound for `s1 - s2` where both are sums of two squared differences.
+ *
+ * The sign of the computed difference is correct whenever its magnitude exceeds
+ * `kSquareSumBound * (s1 + s2)`.
+ */
+constexpr double kSquareSumBound = (5.0 + 32.0 * kEpsilon) * kEpsilon;
+
+/**
+ * @brief Relative tolerance of the `nearly*` tests: 2^-20, about 9.5e-7.
+ *
+ * A power of two, so scaling a value by it is exact and the tests can be decided exactly.
+ */
+constexpr double kRelativeTolerance = 1.0 / 1048576.0;
+
+/**
+ * @brief Relative error bound for the margins computed by the `nearly*` filters.
+ *
+ * A margin's sign is correct whenever its magnitude exceeds `kToleranceBound` times the
+ * sum of the magnitudes it was computed from.
+ */
+constexpr double kToleranceBound = (10.0 + 64.0 * kEpsilon) * kEpsilon;
+
+/**
+ * @brief Returns the sign of the cross product `(b - a) x (c - a)`.
+ * @return `+1` for a counter-clockwise turn, `-1` for clockwise, `0` when collinear.
+ */
+int orient2d(double ax, double ay, double bx, double by, double cx, double cy);
+
+/**
+ * @brief Returns the sign of the dot product `(b - a) . (c - a)`.
+ * @return `0` exactly when the angle at `a` is a right angle (or a vector is zero).
+ */
+int dotSign(double ax, double ay, double bx, double by, double cx, double cy);
+
+/**
+ * @brief Compares the squared lengths of segments `ab` and `cd`.
+ * @return `-1`, `0` or `+1` as `|ab|^2` is smaller than, equal to, or larger than `|cd|^2`.
+ */
+int compareDist2(double ax, double ay, double bx, double by,
+                 double cx, double cy, double dx, double dy);
+
+/**
+ * @brief Tests whether the angle at `a` is right within `kRelativeTolerance`.
+ *
+ * Holds when `2 |(b - a) . (c - a)| <= kRelativeTolerance * (|b - a|^2 + |c - a|^2)`; for
+ * sides of equal length the cosine of the angle may be off by at most the tolerance.
+ * The comparison itself is exact.
+ */
+bool nearlyOrthogonal(double ax, double ay, double bx, double by, double cx, double cy);
+
+/**
+ * @brief Tests whether segments `ab` and `cd` have equal length within `kRelativeTolerance`.
+ *
+ * Holds when `| |ab|^2 - |cd|^2 | <= kRelativeTolerance * (|ab|^2 + |cd|^2)`, i.e. the
+ * lengths differ by at most about half the tolerance relative to their size. The
+ * comparison itself is exact.
+ */
+bool nearlyEqualDist2(double ax, double ay, double bx, double by,
+                      double cx, double cy, double dx, double dy);
+
+/// @name Exact Stages
+/// Called by the predicates above and by vectorized filters once the fast path is inconclusive.
+/// @{
+int orient2dExact(double ax, double ay, double bx, double by, double cx, double cy);
+int dotSignExact(double ax, double ay, double bx, double by, double cx, double cy);
+int compareDist2Exact(double ax, double ay, double bx, double by,
+                      double cx, double cy, double dx, double dy);
+bool nearlyOrthogonalExact(double ax, double ay, double bx, double by, double cx, double cy);
+bool nearlyEqualDist2Exact(double ax, double ay, double bx, double by,
+                           double cx, double cy, double dx, double dy);
+/// @}
+
+} // namespace Predicates
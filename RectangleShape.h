@@ -21,18 +21,21 @@ class RectangleShape : public ShapeBase
 public:
     /**
      * @brief Constructs an axis-aligned rectangle by its diagonal points.
-     * @param name Unique logical name used in the shape repository.
      * @param p1 First diagonal endpoint.
      * @param p2 Opposite diagonal endpoint.
      */
-    RectangleShape(const QString& name, const QPointF& p1, const QPointF& p2);
+    RectangleShape(const QPointF& p1, const QPointF& p2);
 
     /**
      * @brief Constructs a rectangle with the given corner sequence.
-     * @param name Unique logical name used in the shape repository.
      * @param corners Collection of four vertices forming a valid rectangle.
      */
-    RectangleShape(const QString& name, const QVector<QPointF>& corners);
+    explicit RectangleShape(const QVector<QPointF>& corners);
+
+    /**
+     * @brief Deletes the graphics item, which also removes it from its scene.
+     */
+    ~RectangleShape() override;
 
     /**
      * @brief Provides access to the polygon item inserted into the scene.
@@ -46,7 +49,35 @@ public:
      */
     QPointF center() const override;
 
+    /**
+     * @brief Identifies the shape as a rectangle.
+     * @return `ShapeKind::Rectangle`.
+     */
+    ShapeKind kind() const override { return ShapeKind::Rectangle; }
+
+    /**
+     * @brief Returns the stored vertices.
+     * @return Vertices in construction order.
+     */
+    QVector<QPointF> vertices() const override { return m_pts; }
+
+    /**
+     * @brief Replaces the vertices and updates the polygon item and cached center.
+     * @param points New vertices in the same order as `vertices()`.
+     */
+    void setVertices(const QVector<QPointF>& points) override;
+
+    /**
+     * @brief Counts the object, the vertex array it shares with its item and scene record, and the item.
+     */
+    MemoryStats::ShapeUsage memoryUsage() const override
+    {
+        return { sizeof(RectangleShape), m_pts.size() * qint64(sizeof(QPointF)),
+                 sizeof(QGraphicsPolygonItem) + MemoryStats::kItemPrivateBytes };
+    }
+
 private:
     QGraphicsPolygonItem* m_item;
     QVector<QPointF> m_pts;
+    QPointF m_center;
 };
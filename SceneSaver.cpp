@@ -0,0 +1,250 @@
+/**
+ * @file SceneSaver.cpp
+ * @brief Implements background serialization of scene snapshots.
+ * @author Nikol Grigoryan
+ */
+#include "SceneSaver.h"
+#include <QHash>
+#include <QLocale>
+#include <QSaveFile>
+#include <QTextStream>
+
+namespace {
+
+/**
+ * @brief Formats a number in the fixed-point form accepted by the coordinate parser.
+ *
+ * Emits the shortest digits that read back as the same double, so a saved scene reloads
+ * with exactly the coordinates it was saved with. The parser rejects exponents, so the scientific form is expanded in place.
+ */
+QString formatNumber(double v)
+{
+    if (!qIsFinite(v)) return QString::number(v);
+    const QString sci = QString::number(v, 'e', QLocale::FloatingPointShortest);
+    const int e = sci.indexOf('e');
+    const int exponent = sci.mid(e + 1).toInt();
+    const bool negative = sci.startsWith('-');
+    QString digits = sci.left(e).remove('-').remove('.');
+
+    // The decimal point goes after `point` digits; pad with zeros on whichever side it falls outside
+    const int point = exponent + 1;
+    if (point <= 0) {
+        digits = "0." + QString(-point, '0') + digits;
+    } else if (point >= digits.size()) {
+        digits += QString(point - digits.size(), '0');
+    } else {
+        digits.insert(point, '.');
+    }
+    return negative ? '-' + digits : digits;
+}
+
+/**
+ * @brief Returns the command name that creates a shape of the given kind.
+ */
+QString commandFor(ShapeKind kind)
+{
+    switch (kind) {
+    case ShapeKind::Line:      return "create_line";
+    case ShapeKind::Triangle:  return "create_triangle";
+    case ShapeKind::Rectangle: return "create_rectangle";
+    case ShapeKind::Square:    return "create_square";
+    }
+    return QString();
+}
+
+/**
+ * @brief Shape the instances of one layer are saved relative to.
+ */
+struct Prototype
+{
+    QString name;
+    QPointF offset;                     ///< Translation of its vertices from the layer's prototype vertices.
+    const ShapeRecord* self = nullptr;  ///< The layer's own first instance when no ordinary shape matched.
+};
+
+/**
+ * @brief Compares vertex lists exactly; `QPointF`'s own comparison is fuzzy.
+ */
+bool sameVertices(const QVector<QPointF>& a, const QVector<QPointF>& b)
+{
+    if (a.size() != b.size()) return false;
+    for (int i = 0; i < a.size(); ++i) {
+        if (a[i].x() != b[i].x() || a[i].y() != b[i].y()) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Tests whether an instance saved relative to a prototype reloads at exactly its own vertices.
+ *
+ * The reloaded prototype has the vertices `b + from` and the instance is placed at
+ * `to - from` from it, which only equals `b + to` when no step rounds.
+ * @param base Prototype vertices of the layer.
+ * @param from Offset of the prototype shape.
+ * @param to Offset of the instance.
+ */
+bool exactRelative(const QVector<QPointF>& base, const QPointF& from, const QPointF& to)
+{
+    const QPointF rel = to - from;
+    for (const QPointF& b : base) {
+        const QPointF placed = (b + from) + rel;
+        if (placed.x() != b.x() + to.x() || placed.y() != b.y() + to.y()) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+/**
+ * @brief Joins the worker so no thread outlives the saver.
+ */
+SceneSaver::~SceneSaver()
+{
+    if (m_worker.joinable()) m_worker.join();
+}
+
+/**
+ * @brief Launches a worker thread that serializes the snapshot.
+ * @param snapshot Immutable scene version.
+ * @param path Destination script path.
+ * @return `false` if another save is in progress.
+ */
+bool SceneSaver::start(const SceneSnapshot& snapshot, const QString& path)
+{
+    if (isBusy()) return false;
+    if (m_worker.joinable()) m_worker.join();
+
+    m_busy.store(true, std::memory_order_release);
+    m_worker = std::thread([this, snapshot, path]() {
+        QString error;
+        const bool ok = write(snapshot, path, error);
+        {
+            std::lock_guard<std::mutex> lock(m_resultMutex);
+            m_hasResult = true;
+            m_resultOk = ok;
+            m_resultMessage = ok
+                ? QString("Saved %1 shapes and %2 connections (version %3) to %4.")
+                      .arg(snapshot.size()).arg(snapshot.connectionCount()).arg(snapshot.version()).arg(path)
+                : error;
+        }
+        m_busy.store(false, std::memory_order_release);
+    });
+    return true;
+}
+
+/**
+ * @brief Hands over a finished save result to the caller.
+ * @param ok Receives the success flag.
+ * @param message Receives the outcome description.
+ * @return `true` if a result was available.
+ */
+bool SceneSaver::takeResult(bool& ok, QString& message)
+{
+    std::lock_guard<std::mutex> lock(m_resultMutex);
+    if (!m_hasResult) return false;
+    m_hasResult = false;
+    ok = m_resultOk;
+    message = m_resultMessage;
+    return true;
+}
+
+/**
+ * @brief Writes every live record of the snapshot as a command line, then its connections.
+ *
+ * Ordinary shapes come first. Translated instances follow as `create_instance` lines
+ * relative to a prototype, so a replay draws them from one layer again: an ordinary shape
+ * with exactly the layer's prototype vertices, or else the layer's first instance, saved
+ * as an ordinary shape for the purpose. An instance whose relative offset would not
+ * reload exactly is saved as an ordinary shape. The `connect` lines are wrapped in
+ * `begin`/`commit`, so replaying the script draws all connectors through one batch item
+ * instead of one line item per connection.
+ * @param snapshot Scene version to serialize.
+ * @param path Destination path.
+ * @param error Describes failures.
+ * @return `true` on success.
+ */
+bool SceneSaver::write(const SceneSnapshot& snapshot, const QString& path, QString& error)
+{
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        error = QString("Failed to open save file: %1").arg(path);
+        return false;
+    }
+
+    QTextStream out(&f);
+    out << "# ObjectDrawer scene, version " << snapshot.version() << "\n";
+
+    // The first instance of each layer carries the layer's prototype vertices in `points`
+    QVector<const ShapeRecord*> layers;
+    QHash<quintptr, Prototype> prototypes;
+    QMultiHash<QPair<qreal, qreal>, const ShapeRecord*> layersByVertex;
+    snapshot.forEach([&](const ShapeRecord& record) {
+        if (!record.instance || prototypes.contains(record.layer)) return;
+        layers.append(&record);
+        prototypes.insert(record.layer, Prototype());
+        layersByVertex.insert(qMakePair(record.points.first().x(), record.points.first().y()), &record);
+    });
+
+    snapshot.forEach([&](const ShapeRecord& record) {
+        if (record.instance) return;
+        out << toCommand(record) << "\n";
+        if (layersByVertex.isEmpty()) return;
+        const auto key = qMakePair(record.points.first().x(), record.points.first().y());
+        for (auto it = layersByVertex.constFind(key); it != layersByVertex.constEnd() && it.key() == key; ++it) {
+            Prototype& prototype = prototypes[it.value()->layer];
+            if (prototype.name.isEmpty() && it.value()->kind == record.kind && sameVertices(it.value()->points, record.points)) {
+                prototype.name = record.name;
+            }
+        }
+    });
+    for (const ShapeRecord* first : std::as_const(layers)) {
+        Prototype& prototype = prototypes[first->layer];
+        if (!prototype.name.isEmpty()) continue;
+        out << toCommand(*first) << "\n";
+        prototype = Prototype{ first->name, first->offset, first };
+    }
+
+    snapshot.forEach([&](const ShapeRecord& record) {
+        if (!record.instance) return;
+        const Prototype& prototype = prototypes[record.layer];
+        if (prototype.self == &record) return;
+        if (!exactRelative(record.points, prototype.offset, record.offset)) {
+            out << toCommand(record) << "\n";
+            return;
+        }
+        const QPointF rel = record.offset - prototype.offset;
+        out << "create_instance -prototype " << prototype.name << " -name " << record.name
+            << " -offset {" << formatNumber(rel.x()) << ',' << formatNumber(rel.y()) << "}\n";
+    });
+
+    if (snapshot.connectionCount() > 0) {
+        out << "begin\n";
+        snapshot.forEachConnection([&out](const ShapeRecord& a, const ShapeRecord& b) {
+            out << "connect -object_name_1 " << a.name << " -object_name_2 " << b.name << "\n";
+        });
+        out << "commit\n";
+    }
+    out.flush();
+
+    if (!f.commit()) {
+        error = QString("Failed to write save file: %1").arg(path);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Formats a record as a `create_*` command.
+ * @param record Shape description.
+ * @return Command text.
+ */
+QString SceneSaver::toCommand(const ShapeRecord& record)
+{
+    QString line = QString("%1 -name %2").arg(commandFor(record.kind), record.name);
+    const QVector<QPointF> points = record.vertices();
+    for (int i = 0; i < points.size(); ++i) {
+        const QPointF& p = points[i];
+        line += QString(" -coord_%1 {%2,%3}").arg(i + 1).arg(formatNumber(p.x()), formatNumber(p.y()));
+    }
+    return line;
+}
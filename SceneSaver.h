@@ -0,0 +1,82 @@
+/**
+ * @file SceneSaver.h
+ * @brief Declares the background serializer that writes scene snapshots as command scripts.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QString>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include "SceneStore.h"
+
+/**
+ * @class SceneSaver
+ * @brief Serializes `SceneSnapshot` instances to disk on a worker thread.
+ *
+ * The output is a plain command script that can be replayed with `execute_file`. Because
+ * snapshots are immutable, the GUI thread keeps mutating the scene while a save is running.
+ */
+class SceneSaver
+{
+public:
+    /**
+     * @brief Creates an idle saver.
+     */
+    SceneSaver() = default;
+
+    /**
+     * @brief Waits for any running save to finish.
+     */
+    ~SceneSaver();
+
+    SceneSaver(const SceneSaver&) = delete;
+    SceneSaver& operator=(const SceneSaver&) = delete;
+
+    /**
+     * @brief Reports whether a background save is still running.
+     */
+    bool isBusy() const { return m_busy.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Starts writing a snapshot on a worker thread.
+     * @param snapshot Scene version to serialize.
+     * @param path Destination script path.
+     * @return `false` when a previous save is still running.
+     */
+    bool start(const SceneSnapshot& snapshot, const QString& path);
+
+    /**
+     * @brief Retrieves the outcome of the most recently finished save, once.
+     * @param ok Receives whether the save succeeded.
+     * @param message Receives a user-facing description of the outcome.
+     * @return `true` when a result was pending.
+     */
+    bool takeResult(bool& ok, QString& message);
+
+    /**
+     * @brief Writes a snapshot synchronously.
+     * @param snapshot Scene version to serialize.
+     * @param path Destination script path; replaced atomically on success.
+     * @param error Describes I/O failures.
+     * @return `true` when the file was written.
+     */
+    static bool write(const SceneSnapshot& snapshot, const QString& path, QString& error);
+
+    /**
+     * @brief Formats a record as the command line that recreates it.
+     * @param record Shape description.
+     * @return Command text accepted by `CommandParser`.
+     */
+    static QString toCommand(const ShapeRecord& record);
+
+private:
+    std::thread m_worker;
+    std::atomic<bool> m_busy{false};
+
+    std::mutex m_resultMutex;
+    bool m_hasResult = false;
+    bool m_resultOk = false;
+    QString m_resultMessage;
+};
@@ -0,0 +1,186 @@
+/**
+ * @file SceneStore.cpp
+ * @brief Implements the versioned, copy-on-write shape store.
+ * @author Nikol Grigoryan
+ */
+#include "SceneStore.h"
+#include <algorithm>
+
+/**
+ * @brief Stores a record in a reused or new slot, detaching only the chunk that receives it.
+ * @param handle Shape handle.
+ * @param record Shape description to store.
+ */
+void SceneStore::insert(ShapeHandle handle, const ShapeRecord& record)
+{
+    SceneChunk::Slot s;
+    s.record = record;
+    s.live = true;
+
+    // Non-const access detaches the chunk list and the target chunk only if a snapshot shares them
+    int slot;
+    if (!m_freeSlots.isEmpty()) {
+        slot = m_freeSlots.takeLast();
+        m_current.m_chunks[slot / kChunkSize]->entries[slot % kChunkSize] = s;
+    } else {
+        slot = m_nextSlot++;
+        const int chunkIndex = slot / kChunkSize;
+        if (chunkIndex == m_current.m_chunks.size()) {
+            m_current.m_chunks.append(QSharedDataPointer<SceneChunk>(new SceneChunk));
+            m_current.m_chunks.last()->entries.reserve(kChunkSize);
+        }
+        m_current.m_chunks[chunkIndex]->entries.append(s);
+    }
+
+    if (handle.index() >= int(m_slotByHandle.size())) m_slotByHandle.resize(handle.index() + 1, -1);
+    m_slotByHandle[handle.index()] = slot;
+    ++m_current.m_size;
+    journal(SceneChange::Op::Added, handle);
+}
+
+/**
+ * @brief Marks the record of a shape as erased and frees its slot, keeping its name for the journal.
+ * @param handle Shape handle.
+ * @return `true` if the record existed.
+ */
+bool SceneStore::erase(ShapeHandle handle)
+{
+    int* index = slotOf(handle);
+    if (!index) return false;
+
+    const int slot = *index;
+    *index = -1;
+
+    SceneChunk::Slot& s = m_current.m_chunks[slot / kChunkSize]->entries[slot % kChunkSize];
+    m_removedNames.append(s.record.name);
+    m_removedNameBytes += s.record.name.size() * qsizetype(sizeof(QChar));
+    s.live = false;
+    s.record = ShapeRecord{};
+    m_freeSlots.append(slot);
+
+    --m_current.m_size;
+    journal(SceneChange::Op::Removed, handle);
+    return true;
+}
+
+/**
+ * @brief Rewrites the geometry of a live record, detaching only its chunk.
+ * @param handle Shape handle.
+ * @param geometry Record holding the new geometry.
+ * @return `true` if the record existed.
+ */
+bool SceneStore::update(ShapeHandle handle, const ShapeRecord& geometry)
+{
+    const int* index = slotOf(handle);
+    if (!index) return false;
+
+    const int slot = *index;
+    ShapeRecord& record = m_current.m_chunks[slot / kChunkSize]->entries[slot % kChunkSize].record;
+    record.points = geometry.points;
+    record.offset = geometry.offset;
+    record.instance = geometry.instance;
+    record.layer = geometry.layer;
+
+    journal(SceneChange::Op::Modified, handle);
+    return true;
+}
+
+/**
+ * @brief Moves the retention floor and trims the journal if that freed enough entries.
+ * @param version Oldest checkpoint still referenced, or `kRetainNone`.
+ */
+void SceneStore::retainChangesSince(quint64 version)
+{
+    m_retainFrom = version;
+    trimJournal();
+}
+
+/**
+ * @brief Slices the journal after the given version and names every entry.
+ *
+ * The slice is walked backwards from the end of the journal: a `Removed` entry names its
+ * handle for every earlier entry of the same shape, and handles without a later removal
+ * are still live in @p names. A recycled handle value therefore never borrows the name of
+ * a later shape.
+ * @param version Checkpoint version.
+ * @param names Pool of live names.
+ * @param changes Receives the changes applied after the checkpoint.
+ * @return `false` when the checkpoint is newer than the store or was trimmed.
+ */
+bool SceneStore::changesSince(quint64 version, const NamePool& names, QVector<SceneChange>& changes) const
+{
+    // Versions map one-to-one onto journal positions after the trimmed prefix
+    changes.clear();
+    if (version < m_journalBase || version > this->version()) return false;
+    const int first = static_cast<int>(version - m_journalBase);
+
+    changes.resize(m_journal.size() - first);
+    QHash<ShapeHandle, QString> removed;
+    int removedIndex = m_removedNames.size();
+    for (int i = m_journal.size() - 1; i >= first; --i) {
+        const JournalEntry& e = m_journal[i];
+        if (e.op == SceneChange::Op::Removed) removed.insert(e.shape, m_removedNames[--removedIndex]);
+
+        SceneChange& change = changes[i - first];
+        change.op = e.op;
+        const auto it = removed.constFind(e.shape);
+        change.name = it != removed.constEnd() ? it.value() : names.name(e.shape);
+        if (e.op == SceneChange::Op::Added) removed.remove(e.shape);
+    }
+    return true;
+}
+
+/**
+ * @brief Finds the record slot of a handle.
+ * @return Pointer into the slot array, or `nullptr` when the handle has no record.
+ */
+int* SceneStore::slotOf(ShapeHandle handle)
+{
+    const int i = handle.index();
+    if (handle.isNull() || i >= int(m_slotByHandle.size()) || m_slotByHandle[i] < 0) return nullptr;
+    return &m_slotByHandle[i];
+}
+
+/**
+ * @brief Bumps the version and records one mutation, trimming entries no checkpoint needs.
+ */
+void SceneStore::journal(SceneChange::Op op, ShapeHandle handle)
+{
+    ++m_current.m_version;
+    m_journal.append(JournalEntry{op, handle});
+    trimJournal();
+}
+
+/**
+ * @brief Drops the journal prefix below the retention floor.
+ *
+ * Trimming waits until the prefix is at least half of the journal and `kMinJournalTrim`
+ * entries, so the copy of the remainder is O(1) amortized per mutation.
+ */
+void SceneStore::trimJournal()
+{
+    const quint64 floor = std::min(m_retainFrom, version());
+    const qint64 drop = qint64(floor - m_journalBase);
+    if (drop < kMinJournalTrim || 2 * drop < m_journal.size()) return;
+
+    int removed = 0;
+    for (int i = 0; i < drop; ++i) {
+        if (m_journal[i].op == SceneChange::Op::Removed) ++removed;
+    }
+    for (int i = 0; i < removed; ++i) m_removedNameBytes -= m_removedNames[i].size() * qsizetype(sizeof(QChar));
+    m_removedNames.remove(0, removed);
+    m_journal.remove(0, int(drop));
+    m_journalBase = floor;
+}
+
+/**
+ * @brief Charges every chunk its full slot array, since chunks reserve `kChunkSize` slots up front.
+ */
+qsizetype SceneStore::usedBytes() const
+{
+    const qsizetype chunkBytes = qsizetype(sizeof(SceneChunk)) + kChunkSize * qsizetype(sizeof(SceneChunk::Slot));
+    return MemoryStats::capacityBytes(m_current.m_chunks) + m_current.m_chunks.size() * chunkBytes
+         + MemoryStats::capacityBytes(m_slotByHandle) + MemoryStats::capacityBytes(m_freeSlots)
+         + MemoryStats::capacityBytes(m_journal)
+         + MemoryStats::capacityBytes(m_removedNames) + m_removedNameBytes;
+}
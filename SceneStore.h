@@ -0,0 +1,335 @@
+/**
+ * @file SceneStore.h
+ * @brief Declares the versioned, copy-on-write shape store used for snapshots and checkpoints.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QPointF>
+#include <QSharedData>
+#include <QSharedDataPointer>
+#include <vector>
+#include "NamePool.h"
+#include "ShapeBase.h"
+
+/**
+ * @struct ShapeRecord
+ * @brief Plain value description of a shape that can be serialized or recreated.
+ */
+struct ShapeRecord
+{
+    /**
+     * @brief Logical shape name.
+     */
+    QString name;
+    /**
+     * @brief Concrete shape kind.
+     */
+    ShapeKind kind = ShapeKind::Line;
+    /**
+     * @brief Defining vertices in construction order; for a translated instance, the
+     *        prototype vertices shared with its layer, so the record holds no copy.
+     */
+    QVector<QPointF> points;
+    /**
+     * @brief Translation from `points` to the shape when `instance` is set.
+     */
+    QPointF offset;
+    /**
+     * @brief `points` are shared prototype vertices moved by `offset`.
+     */
+    bool instance = false;
+    /**
+     * @brief Identity of the layer drawing an instance, so saves can group its copies;
+     *        only compared, never dereferenced.
+     */
+    quintptr layer = 0;
+
+    /**
+     * @brief Returns the shape's own vertices.
+     */
+    QVector<QPointF> vertices() const
+    {
+        if (!instance) return points;
+        QVector<QPointF> result = points;
+        for (QPointF& p : result) p += offset;
+        return result;
+    }
+};
+
+/**
+ * @struct SceneChange
+ * @brief Single mutation of the store, as reported by `SceneStore::changesSince`.
+ */
+struct SceneChange
+{
+    /**
+     * @brief Kind of mutation.
+     */
+    enum class Op : quint8
+    {
+        Added,    ///< A shape was inserted.
+        Removed,  ///< A shape was erased.
+        Modified  ///< A shape's geometry changed.
+    };
+
+    /**
+     * @brief Mutation kind.
+     */
+    Op op = Op::Added;
+    /**
+     * @brief Name of the affected shape.
+     */
+    QString name;
+};
+
+/**
+ * @brief Fixed-size block of record slots shared between store versions.
+ *
+ * Chunks are implicitly shared; a chunk is only copied when a version that
+ * still references it is mutated.
+ */
+struct SceneChunk : public QSharedData
+{
+    /**
+     * @brief Record slot; an erased slot stays dead until the store reuses it.
+     */
+    struct Slot
+    {
+        ShapeRecord record;
+        bool live = false;
+    };
+
+    /**
+     * @brief Number of record slots per chunk.
+     */
+    static constexpr int kSize = 256;
+
+    QVector<Slot> entries;
+};
+
+/**
+ * @class SceneSnapshot
+ * @brief Immutable view of the store at a given version.
+ *
+ * Taking a snapshot is O(1); the snapshot shares all chunks with the live store and is
+ * safe to read from a background thread while the store keeps changing. A snapshot taken
+ * through the repository also lists the connections as pairs of record slots, so their
+ * endpoint names are read from the snapshot's own records rather than the live name pool.
+ */
+class SceneSnapshot
+{
+public:
+    /**
+     * @brief Connection between two live records, as their slots in the snapshot.
+     */
+    struct Link
+    {
+        int a = -1;
+        int b = -1;
+    };
+
+    /**
+     * @brief Creates an empty snapshot at version zero.
+     */
+    SceneSnapshot() = default;
+
+    /**
+     * @brief Returns the store version captured by the snapshot.
+     */
+    quint64 version() const { return m_version; }
+
+    /**
+     * @brief Returns the number of live shapes in the snapshot.
+     */
+    int size() const { return m_size; }
+
+    /**
+     * @brief Returns the number of connections captured with the snapshot.
+     */
+    int connectionCount() const { return m_links.size(); }
+
+    /**
+     * @brief Invokes @p fn for every live record in slot order.
+     *
+     * Slots freed by erased shapes are reused, so this is insertion order only until the
+     * first erase.
+     * @param fn Callable accepting `const ShapeRecord&`.
+     */
+    template <typename Fn>
+    void forEach(Fn fn) const
+    {
+        for (const auto& chunk : m_chunks) {
+            for (const auto& slot : chunk->entries) {
+                if (slot.live) fn(slot.record);
+            }
+        }
+    }
+
+    /**
+     * @brief Invokes @p fn for every captured connection.
+     * @param fn Callable accepting the two endpoint records as `const ShapeRecord&`.
+     */
+    template <typename Fn>
+    void forEachConnection(Fn fn) const
+    {
+        for (const Link& link : m_links) fn(record(link.a), record(link.b));
+    }
+
+private:
+    friend class SceneStore;
+
+    const ShapeRecord& record(int slot) const
+    {
+        return m_chunks[slot / SceneChunk::kSize]->entries[slot % SceneChunk::kSize].record;
+    }
+
+    QVector<QSharedDataPointer<SceneChunk>> m_chunks;
+    QVector<Link> m_links;
+    quint64 m_version = 0;
+    int m_size = 0;
+};
+
+/**
+ * @class SceneStore
+ * @brief Versioned record store backed by copy-on-write chunks and a change journal.
+ *
+ * Every mutation bumps the version by one and appends a journal entry, so a checkpoint
+ * is simply a version number and the diff since a checkpoint is a slice of the journal.
+ * Records are found through an array indexed by shape handle, and journal entries hold
+ * the handle only; names are resolved when a diff is requested. The name of an erased
+ * shape is kept for the journal, since its handle no longer resolves.
+ *
+ * Memory follows the live scene rather than the number of mutations: erased slots are
+ * reused, and the journal is trimmed to the entries after the oldest version passed to
+ * `retainChangesSince()`, or dropped entirely when no checkpoint is held.
+ */
+class SceneStore
+{
+public:
+    /**
+     * @brief Number of record slots per shared chunk.
+     */
+    static constexpr int kChunkSize = SceneChunk::kSize;
+
+    /**
+     * @brief Passed to `retainChangesSince()` when no checkpoint needs the journal.
+     */
+    static constexpr quint64 kRetainNone = ~quint64(0);
+
+    /**
+     * @brief Journal entries are trimmed in batches of at least this many.
+     */
+    static constexpr int kMinJournalTrim = 1024;
+
+    /**
+     * @brief Appends a record for a newly created shape.
+     * @param handle Handle issued for the shape's name; must not have a record already.
+     * @param record Shape description.
+     */
+    void insert(ShapeHandle handle, const ShapeRecord& record);
+
+    /**
+     * @brief Erases the live record of a shape.
+     * @param handle Shape handle.
+     * @return `true` when a record was erased.
+     */
+    bool erase(ShapeHandle handle);
+
+    /**
+     * @brief Replaces the geometry of a live record, keeping its name and kind.
+     * @param handle Shape handle.
+     * @param geometry Record whose `points`, `offset`, `instance` and `layer` are taken.
+     * @return `true` when the record exists.
+     */
+    bool update(ShapeHandle handle, const ShapeRecord& geometry);
+
+    /**
+     * @brief Returns the current version (number of mutations applied so far).
+     */
+    quint64 version() const { return m_current.m_version; }
+
+    /**
+     * @brief Returns the number of live records.
+     */
+    int size() const { return m_current.m_size; }
+
+    /**
+     * @brief Captures an immutable snapshot of the current version in O(1).
+     */
+    SceneSnapshot snapshot() const { return m_current; }
+
+    /**
+     * @brief Captures a snapshot together with the connections between its records.
+     * @param links Connections as record slots obtained from `slot()`.
+     */
+    SceneSnapshot snapshot(QVector<SceneSnapshot::Link> links) const
+    {
+        SceneSnapshot snap = m_current;
+        snap.m_links = std::move(links);
+        return snap;
+    }
+
+    /**
+     * @brief Returns the record slot of a shape, or `-1` when it has no record.
+     */
+    int slot(ShapeHandle handle) const
+    {
+        const int i = handle.index();
+        return handle.isNull() || i >= int(m_slotByHandle.size()) ? -1 : m_slotByHandle[i];
+    }
+
+    /**
+     * @brief Sets the oldest version whose changes must stay available to `changesSince()`.
+     *
+     * Journal entries up to that version may be discarded; pass `kRetainNone` when no
+     * checkpoint is held.
+     * @param version Oldest checkpoint still referenced.
+     */
+    void retainChangesSince(quint64 version);
+
+    /**
+     * @brief Returns the journal entries applied after the given version.
+     * @param version Checkpoint previously obtained from `version()`.
+     * @param names Pool that issued the handles, used to name shapes that are still live.
+     * @param changes Receives the changes in application order; empty when @p version is current.
+     * @return `false` when @p version is newer than the store or its entries were trimmed.
+     */
+    bool changesSince(quint64 version, const NamePool& names, QVector<SceneChange>& changes) const;
+
+    /**
+     * @brief Estimates the bytes held by the current version's chunks, the slot map and the journal.
+     *
+     * Record vertex arrays are attributed to their shapes by `ShapeBase::memoryUsage()`,
+     * and instance records share their layer's; chunks still shared with snapshots are
+     * counted once.
+     */
+    qsizetype usedBytes() const;
+
+private:
+    /**
+     * @brief Journal entry: the mutation and the handle of the shape; 8 bytes.
+     */
+    struct JournalEntry
+    {
+        SceneChange::Op op = SceneChange::Op::Added;
+        ShapeHandle shape;
+    };
+
+    int* slotOf(ShapeHandle handle);
+    void journal(SceneChange::Op op, ShapeHandle handle);
+    void trimJournal();
+
+    SceneSnapshot m_current;
+    std::vector<int> m_slotByHandle; ///< Record slot per handle index, `-1` when none.
+    QVector<int> m_freeSlots;        ///< Dead slots, reused before new ones.
+    QVector<JournalEntry> m_journal;
+    quint64 m_journalBase = 0;       ///< Version before the first journal entry.
+    quint64 m_retainFrom = kRetainNone;
+    QVector<QString> m_removedNames; ///< Name of each `Removed` entry, in journal order.
+    qsizetype m_removedNameBytes = 0; ///< Character data of `m_removedNames`.
+    int m_nextSlot = 0;
+};
@@ -0,0 +1,67 @@
+/**
+ * @file SceneTransaction.cpp
+ * @brief Implements the side buffer that stages shapes and connections between `begin` and `commit`.
+ * @author Nikol Grigoryan
+ */
+#include "SceneTransaction.h"
+#include "Parallel.h"
+
+/**
+ * @brief Starts from an empty buffer.
+ */
+void SceneTransaction::begin()
+{
+    clear();
+    m_open = true;
+}
+
+/**
+ * @brief Frees only what was staged; the scene was never touched.
+ */
+void SceneTransaction::clear()
+{
+    m_open = false;
+    m_abortReason.clear();
+    m_commands = 0;
+    m_shapes.clear();
+    m_names.clear();
+    m_connections.clear();
+}
+
+/**
+ * @brief Keeps the first failure, which is the one the user needs to fix.
+ */
+void SceneTransaction::abort(const QString& reason)
+{
+    if (m_abortReason.isEmpty()) m_abortReason = reason.isEmpty() ? QString("a command failed") : reason;
+}
+
+/**
+ * @brief Appends the shape and indexes its name.
+ */
+void SceneTransaction::stageShape(const ShapeRequest& request, std::unique_ptr<ShapeBase> shape)
+{
+    m_names.insert(request.name);
+    m_shapes.push_back(StagedShape{ request, std::move(shape) });
+}
+
+/**
+ * @brief Appends the pairs in order.
+ */
+void SceneTransaction::stageConnections(const QVector<Pair>& pairs)
+{
+    m_connections += pairs;
+}
+
+/**
+ * @brief Builds the vertices and graphics items of unbuilt shapes on worker threads.
+ */
+void SceneTransaction::buildShapes()
+{
+    Parallel::forRanges(static_cast<int>(m_shapes.size()), [this](int first, int last, int) {
+        for (int i = first; i < last; ++i) {
+            StagedShape& staged = m_shapes[i];
+            if (!staged.shape) staged.shape.reset(staged.request.build());
+        }
+    }, 256);
+}
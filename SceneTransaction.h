@@ -0,0 +1,120 @@
+/**
+ * @file SceneTransaction.h
+ * @brief Declares the side buffer that stages shapes and connections between `begin` and `commit`.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QVector>
+#include <memory>
+#include <vector>
+#include "ShapeRequest.h"
+
+/**
+ * @class SceneTransaction
+ * @brief Shapes and connections that become visible together on commit, or not at all.
+ *
+ * While a transaction is open the dispatcher validates `create_*` and `connect*` commands
+ * against the repository plus what is already staged, and stores them here instead of
+ * touching the scene. A failed command aborts the transaction, so the commit that follows
+ * publishes nothing. Rolling back only clears these containers, which is O(staged items)
+ * whatever the size of the scene.
+ */
+class SceneTransaction
+{
+public:
+    /**
+     * @brief A validated shape waiting for commit.
+     */
+    struct StagedShape
+    {
+        ShapeRequest request;             ///< Validated geometry and name.
+        std::unique_ptr<ShapeBase> shape; ///< Built ahead of time by `execute_file`, or built at commit.
+    };
+
+    using Pair = QPair<QString, QString>;
+
+    /**
+     * @brief Opens an empty transaction.
+     */
+    void begin();
+
+    /**
+     * @brief Discards everything staged and closes the transaction.
+     */
+    void clear();
+
+    /**
+     * @brief Marks the transaction as failed; the first reason is kept.
+     */
+    void abort(const QString& reason);
+
+    /**
+     * @brief Reports whether commands are being staged.
+     */
+    bool isOpen() const { return m_open; }
+
+    /**
+     * @brief Reports whether a command failed since `begin()`.
+     */
+    bool isAborted() const { return !m_abortReason.isEmpty(); }
+
+    /**
+     * @brief Returns why the transaction was aborted.
+     */
+    const QString& abortReason() const { return m_abortReason; }
+
+    /**
+     * @brief Stages a shape whose name must not be staged yet.
+     * @param request Validated shape request.
+     * @param shape Optional pre-built shape; ownership is taken.
+     */
+    void stageShape(const ShapeRequest& request, std::unique_ptr<ShapeBase> shape = nullptr);
+
+    /**
+     * @brief Stages connections whose endpoints have been resolved.
+     */
+    void stageConnections(const QVector<Pair>& pairs);
+
+    /**
+     * @brief Reports whether a staged shape has this name.
+     */
+    bool definesName(const QString& name) const { return m_names.contains(name); }
+
+    /**
+     * @brief Counts a successfully staged command.
+     * @return Commands staged so far.
+     */
+    int addCommand() { return ++m_commands; }
+
+    /**
+     * @brief Returns the number of staged commands.
+     */
+    int commandCount() const { return m_commands; }
+
+    /**
+     * @brief Builds every staged shape that is not built yet, in parallel.
+     */
+    void buildShapes();
+
+    /**
+     * @brief Returns the staged shapes in staging order.
+     */
+    std::vector<StagedShape>& shapes() { return m_shapes; }
+
+    /**
+     * @brief Returns the staged connections in staging order.
+     */
+    const QVector<Pair>& connections() const { return m_connections; }
+
+private:
+    bool m_open = false;
+    QString m_abortReason;
+    int m_commands = 0;
+    std::vector<StagedShape> m_shapes;
+    QSet<QString> m_names;         ///< Names of the staged shapes.
+    QVector<Pair> m_connections;
+};
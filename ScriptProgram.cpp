@@ -0,0 +1,643 @@
+/**
+ * @file ScriptProgram.cpp
+ * @brief Implements the compiler of generative scripts.
+ * @author Nikol Grigoryan
+ */
+#include "ScriptProgram.h"
+#include <QHash>
+#include <QLocale>
+#include <QRegularExpression>
+#include <algorithm>
+#include <cmath>
+#include "ScriptValidator.h"
+
+namespace {
+
+using Instr = ScriptProgram::Instr;
+using Op = ScriptProgram::Op;
+using Function = ScriptProgram::Function;
+
+bool isSpace(QChar c)
+{
+    const ushort u = c.unicode();
+    return u == ' ' || (u >= '\t' && u <= '\r');
+}
+
+bool isDigit(QChar c)
+{
+    return c.unicode() >= '0' && c.unicode() <= '9';
+}
+
+bool isIdentStart(QChar c)
+{
+    const ushort u = c.unicode();
+    return u == '_' || (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z');
+}
+
+bool isIdentPart(QChar c)
+{
+    return isIdentStart(c) || isDigit(c);
+}
+
+/**
+ * @brief Returns the first whitespace-separated word of a line.
+ */
+QStringView firstWord(QStringView line)
+{
+    int i = 0;
+    while (i < line.size() && !isSpace(line[i])) ++i;
+    return line.left(i);
+}
+
+bool isKeyword(QStringView word)
+{
+    return word == QLatin1String("let") || word == QLatin1String("for") || word == QLatin1String("repeat")
+        || word == QLatin1String("end");
+}
+
+const QHash<QString, Function>& functions()
+{
+    static const QHash<QString, Function> table = {
+        { "abs", Function::Abs }, { "floor", Function::Floor }, { "sqrt", Function::Sqrt },
+        { "sin", Function::Sin }, { "cos", Function::Cos }, { "min", Function::Min }, { "max", Function::Max },
+    };
+    return table;
+}
+
+/**
+ * @brief Words that cannot name a variable.
+ */
+bool isReserved(const QString& name)
+{
+    return isKeyword(name) || name == "to" || name == "step" || functions().contains(name);
+}
+
+/**
+ * @brief Change in stack depth caused by an instruction.
+ */
+int stackEffect(const Instr& instr, const QVector<ScriptProgram::CommandTemplate>& templates)
+{
+    switch (instr.op) {
+    case Op::Push:
+    case Op::Load:
+        return 1;
+    case Op::Store:
+    case Op::Add:
+    case Op::Sub:
+    case Op::Mul:
+    case Op::Div:
+    case Op::Mod:
+        return -1;
+    case Op::Call:
+        return 1 - ScriptProgram::arity(static_cast<Function>(instr.a));
+    case Op::Exec:
+        return -templates[instr.a].valueCount;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief Recursive-descent parser that emits the bytecode of one expression, folding constants.
+ */
+class ExpressionCompiler
+{
+public:
+    ExpressionCompiler(QStringView text, const QHash<QString, int>& variables, std::vector<Instr>& out)
+        : m_text(text), m_variables(variables), m_out(out)
+    {
+    }
+
+    /**
+     * @brief Compiles the whole text as one expression.
+     */
+    bool compile(QString& error)
+    {
+        if (!sum()) {
+            error = m_error;
+            return false;
+        }
+        skipSpaces();
+        if (m_pos < m_text.size()) {
+            error = QString("Unexpected '%1' in expression '%2'.").arg(m_text.mid(m_pos).toString(), m_text.toString());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    void skipSpaces()
+    {
+        while (m_pos < m_text.size() && isSpace(m_text[m_pos])) ++m_pos;
+    }
+
+    bool accept(QChar c)
+    {
+        skipSpaces();
+        if (m_pos < m_text.size() && m_text[m_pos] == c) {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+
+    bool fail(const QString& what)
+    {
+        m_error = QString("%1 in expression '%2'.").arg(what, m_text.toString());
+        return false;
+    }
+
+    bool sum()
+    {
+        const size_t lhs = m_out.size();
+        if (!product()) return false;
+        for (;;) {
+            const Op op = accept('+') ? Op::Add : accept('-') ? Op::Sub : Op::Push;
+            if (op == Op::Push) return true;
+            if (!product()) return false;
+            binary(op, lhs);
+        }
+    }
+
+    bool product()
+    {
+        const size_t lhs = m_out.size();
+        if (!unary()) return false;
+        for (;;) {
+            const Op op = accept('*') ? Op::Mul : accept('/') ? Op::Div : accept('%') ? Op::Mod : Op::Push;
+            if (op == Op::Push) return true;
+            if (!unary()) return false;
+            binary(op, lhs);
+        }
+    }
+
+    bool unary()
+    {
+        if (!accept('-')) return primary();
+        if (!unary()) return false;
+        if (m_out.back().op == Op::Push) {
+            m_out.back().value = -m_out.back().value;
+        } else {
+            m_out.push_back(Instr{ Op::Neg });
+        }
+        return true;
+    }
+
+    bool primary()
+    {
+        skipSpaces();
+        if (m_pos >= m_text.size()) return fail("Missing operand");
+
+        if (accept('(')) {
+            if (!sum()) return false;
+            return accept(')') || fail("Missing ')'");
+        }
+
+        const int begin = m_pos;
+        if (isDigit(m_text[m_pos])) {
+            while (m_pos < m_text.size() && isDigit(m_text[m_pos])) ++m_pos;
+            if (m_pos < m_text.size() && m_text[m_pos] == '.') {
+                ++m_pos;
+                while (m_pos < m_text.size() && isDigit(m_text[m_pos])) ++m_pos;
+            }
+            bool ok = false;
+            const double value = QLocale::c().toDouble(m_text.mid(begin, m_pos - begin), &ok);
+            if (!ok) return fail(QString("Invalid number '%1'").arg(m_text.mid(begin, m_pos - begin).toString()));
+            m_out.push_back(Instr{ Op::Push, 0, 0, 0, value });
+            return true;
+        }
+
+        if (!isIdentStart(m_text[m_pos])) return fail(QString("Unexpected '%1'").arg(m_text[m_pos]));
+        while (m_pos < m_text.size() && isIdentPart(m_text[m_pos])) ++m_pos;
+        const QString name = m_text.mid(begin, m_pos - begin).toString();
+
+        if (accept('(')) {
+            const auto function = functions().constFind(name);
+            if (function == functions().constEnd()) return fail(QString("Unknown function '%1'").arg(name));
+            const size_t args = m_out.size();
+            const int count = ScriptProgram::arity(*function);
+            for (int i = 0; i < count; ++i) {
+                if (i > 0 && !accept(',')) return fail(QString("'%1' takes %2 arguments").arg(name).arg(count));
+                if (!sum()) return false;
+            }
+            if (!accept(')')) return fail("Missing ')'");
+            call(*function, args);
+            return true;
+        }
+
+        const auto slot = m_variables.constFind(name);
+        if (slot == m_variables.constEnd()) return fail(QString("Unknown variable '%1'").arg(name));
+        m_out.push_back(Instr{ Op::Load, *slot });
+        return true;
+    }
+
+    /**
+     * @brief Emits a binary operator, or folds it when both operands are constants.
+     */
+    void binary(Op op, size_t lhs)
+    {
+        if (m_out.size() - lhs == 2 && m_out[lhs].op == Op::Push && m_out[lhs + 1].op == Op::Push) {
+            m_out[lhs].value = ScriptProgram::apply(op, m_out[lhs].value, m_out[lhs + 1].value);
+            m_out.pop_back();
+            return;
+        }
+        m_out.push_back(Instr{ op });
+    }
+
+    /**
+     * @brief Emits a call, or folds it when every argument is a constant.
+     */
+    void call(Function function, size_t args)
+    {
+        const int count = ScriptProgram::arity(function);
+        bool constant = static_cast<int>(m_out.size() - args) == count;
+        double values[2] = {};
+        for (int i = 0; constant && i < count; ++i) {
+            constant = m_out[args + i].op == Op::Push;
+            values[i] = m_out[args + i].value;
+        }
+        if (constant) {
+            m_out.resize(args);
+            m_out.push_back(Instr{ Op::Push, 0, 0, 0, ScriptProgram::call(function, values) });
+            return;
+        }
+        m_out.push_back(Instr{ Op::Call, static_cast<qint32>(function) });
+    }
+
+    QStringView m_text;
+    int m_pos = 0;
+    const QHash<QString, int>& m_variables;
+    std::vector<Instr>& m_out;
+    QString m_error;
+};
+
+/**
+ * @brief Compiles statements line by line into one instruction stream.
+ */
+class Compiler
+{
+public:
+    std::vector<Instr> code;
+    QVector<ScriptProgram::CommandTemplate> templates;
+    int slotCount = 0;
+
+    bool compile(const QStringList& lines, ScriptProgram::CompileError& error)
+    {
+        for (int i = 0; i < lines.size(); ++i) {
+            const QString& line = lines[i];
+            if (ScriptValidator::isSkipped(line)) continue;
+            m_line = i + 1;
+            if (!statement(line)) {
+                error = ScriptProgram::CompileError{ m_line, m_error };
+                return false;
+            }
+        }
+        if (!m_blocks.isEmpty()) {
+            const Block& open = m_blocks.last();
+            error = ScriptProgram::CompileError{ open.line, QString("'%1' has no matching 'end'.")
+                                                                .arg(open.isFor ? "for" : "repeat") };
+            return false;
+        }
+        return true;
+    }
+
+private:
+    /**
+     * @brief Open `for` or `repeat`, patched when its `end` is reached.
+     */
+    struct Block
+    {
+        bool isFor = false;
+        int line = 0;
+        int check = 0; ///< Index of the loop's check instruction.
+    };
+
+    bool fail(const QString& message)
+    {
+        m_error = message;
+        return false;
+    }
+
+    bool statement(const QString& line)
+    {
+        static const QRegularExpression letRe(R"(^let\s+([A-Za-z_]\w*)\s*=\s*(.+)$)");
+        static const QRegularExpression forRe(R"(^for\s+([A-Za-z_]\w*)\s*=\s*(.+?)\s+to\s+(.+?)(?:\s+step\s+(.+))?$)");
+        static const QRegularExpression repeatRe(R"(^repeat\s+(.+)$)");
+
+        const QStringView word = firstWord(line);
+        if (word == QLatin1String("let")) {
+            const QRegularExpressionMatch m = letRe.match(line);
+            if (!m.hasMatch()) return fail("Expected 'let NAME = EXPR'.");
+            if (!expression(m.capturedView(2), code)) return false;
+            int slot = 0;
+            if (!define(m.captured(1), slot)) return false;
+            code.push_back(Instr{ Op::Store, slot });
+            return true;
+        }
+
+        if (word == QLatin1String("for")) {
+            const QRegularExpressionMatch m = forRe.match(line);
+            if (!m.hasMatch()) return fail("Expected 'for NAME = EXPR to EXPR [step EXPR]'.");
+            const int bound = slotCount;
+            slotCount += 2;
+            if (!expression(m.capturedView(2), code) || !expression(m.capturedView(3), code)) return false;
+            code.push_back(Instr{ Op::Store, bound });
+            if (m.capturedLength(4) > 0) {
+                if (!expression(m.capturedView(4), code)) return false;
+                if (code.back().op == Op::Push && code.back().value == 0.0) return fail("'for' step cannot be zero.");
+            } else {
+                code.push_back(Instr{ Op::Push, 0, 0, 0, 1.0 });
+            }
+            code.push_back(Instr{ Op::Store, bound + 1 });
+            int variable = 0;
+            if (!define(m.captured(1), variable)) return false;
+            // The start value waits on the stack until the bounds are stored, so they cannot refer to the variable
+            code.push_back(Instr{ Op::Store, variable });
+            m_blocks.append(Block{ true, m_line, static_cast<int>(code.size()) });
+            code.push_back(Instr{ Op::ForCheck, variable, 0, bound });
+            return true;
+        }
+
+        if (word == QLatin1String("repeat")) {
+            const QRegularExpressionMatch m = repeatRe.match(line);
+            if (!m.hasMatch()) return fail("Expected 'repeat EXPR'.");
+            if (!expression(m.capturedView(1), code)) return false;
+            const int counter = slotCount++;
+            code.push_back(Instr{ Op::Store, counter });
+            m_blocks.append(Block{ false, m_line, static_cast<int>(code.size()) });
+            code.push_back(Instr{ Op::RepeatCheck, counter });
+            return true;
+        }
+
+        if (word == QLatin1String("end")) {
+            if (line != "end") return fail("Expected 'end' alone on its line.");
+            if (m_blocks.isEmpty()) return fail("'end' without 'for' or 'repeat'.");
+            const Block block = m_blocks.takeLast();
+            Instr& check = code[block.check];
+            if (block.isFor) {
+                code.push_back(Instr{ Op::ForNext, check.a, block.check, check.c });
+            } else {
+                code.push_back(Instr{ Op::Jump, 0, block.check });
+            }
+            check.b = static_cast<qint32>(code.size());
+            return true;
+        }
+
+        return command(line);
+    }
+
+    /**
+     * @brief Returns the slot of a variable, allocating one the first time it is assigned.
+     */
+    bool define(const QString& name, int& slot)
+    {
+        if (isReserved(name)) return fail(QString("'%1' is reserved and cannot name a variable.").arg(name));
+        const auto it = m_variables.constFind(name);
+        slot = it != m_variables.constEnd() ? *it : (m_variables[name] = slotCount++);
+        return true;
+    }
+
+    bool expression(QStringView text, std::vector<Instr>& out)
+    {
+        return ExpressionCompiler(text, m_variables, out).compile(m_error);
+    }
+
+    /**
+     * @brief Splits a command line at whitespace outside braces, so `{x + 1, y}` stays one token.
+     */
+    static QVector<QStringView> tokenize(QStringView line)
+    {
+        QVector<QStringView> tokens;
+        int i = 0;
+        for (;;) {
+            while (i < line.size() && isSpace(line[i])) ++i;
+            if (i >= line.size()) return tokens;
+            const int begin = i;
+            int depth = 0;
+            while (i < line.size() && (depth > 0 || !isSpace(line[i]))) {
+                if (line[i] == '{') ++depth;
+                else if (line[i] == '}' && depth > 0) --depth;
+                ++i;
+            }
+            tokens.append(line.mid(begin, i - begin));
+        }
+    }
+
+    /**
+     * @brief Compiles a command line into a template and the code that computes its fields.
+     */
+    bool command(const QString& line)
+    {
+        const QVector<QStringView> tokens = tokenize(line);
+        ScriptProgram::CommandTemplate tmpl;
+        tmpl.line = m_line;
+        tmpl.command.name = tokens[0].toString();
+        if (tmpl.command.name.contains("${")) return fail("Command names cannot contain expressions.");
+
+        std::vector<Instr> fieldCode;
+        for (int i = 1; i < tokens.size(); i += 2) {
+            const QStringView flag = tokens[i];
+            if (!flag.startsWith('-')) {
+                return fail(QString("Unexpected token '%1'. Flags should start with '-'.").arg(flag.toString()));
+            }
+            if (i + 1 >= tokens.size()) {
+                return fail(QString("Expected value after flag '%1'.").arg(flag.toString()));
+            }
+            const QString key = flag.mid(1).toString();
+            const QStringView value = tokens[i + 1];
+            const bool ok = flag.startsWith(QLatin1String("-coord_")) || value.startsWith('{')
+                ? coordinate(key, value, tmpl, fieldCode)
+                : text(key, value, tmpl, fieldCode);
+            if (!ok) return false;
+        }
+
+        code.insert(code.end(), fieldCode.begin(), fieldCode.end());
+        code.push_back(Instr{ Op::Exec, static_cast<qint32>(templates.size()) });
+        templates.append(std::move(tmpl));
+        return true;
+    }
+
+    /**
+     * @brief Compiles `{x,y}`; a constant point is stored in the template directly.
+     */
+    bool coordinate(const QString& key, QStringView value, ScriptProgram::CommandTemplate& tmpl,
+                    std::vector<Instr>& out)
+    {
+        // The comma that separates x and y is the one outside parentheses, so min(a,b) stays whole
+        int comma = -1;
+        int depth = 0;
+        for (int i = 1; i < value.size() - 1; ++i) {
+            if (value[i] == '(') ++depth;
+            else if (value[i] == ')') --depth;
+            else if (value[i] == ',' && depth == 0) {
+                if (comma >= 0) comma = -2;
+                if (comma == -1) comma = i;
+            }
+        }
+        if (!value.startsWith('{') || !value.endsWith('}') || comma < 0) {
+            return fail(QString("Invalid coordinate format '%1'. Expected {x,y}.").arg(value.toString()));
+        }
+
+        std::vector<Instr> xy;
+        if (!expression(value.mid(1, comma - 1), xy) || !expression(value.mid(comma + 1, value.size() - comma - 2), xy)) {
+            return false;
+        }
+        if (xy.size() == 2 && xy[0].op == Op::Push && xy[1].op == Op::Push) {
+            tmpl.command.coords.insert(key, QPointF(xy[0].value, xy[1].value));
+            return true;
+        }
+        out.insert(out.end(), xy.begin(), xy.end());
+        tmpl.fields.append(ScriptProgram::Field{ key, true, {} });
+        tmpl.valueCount += 2;
+        return true;
+    }
+
+    /**
+     * @brief Compiles a text value with `${EXPR}` parts; constant parts are formatted now.
+     */
+    bool text(const QString& key, QStringView value, ScriptProgram::CommandTemplate& tmpl, std::vector<Instr>& out)
+    {
+        ScriptProgram::Field field{ key, false, { QString() } };
+        int values = 0;
+        int i = 0;
+        for (;;) {
+            const int open = value.indexOf(QLatin1String("${"), i);
+            if (open < 0) {
+                field.pieces.last() += value.mid(i);
+                break;
+            }
+            const int close = value.indexOf('}', open + 2);
+            if (close < 0) return fail(QString("Missing '}' in '%1'.").arg(value.toString()));
+            field.pieces.last() += value.mid(i, open - i);
+
+            std::vector<Instr> part;
+            if (!expression(value.mid(open + 2, close - open - 2), part)) return false;
+            if (part.size() == 1 && part[0].op == Op::Push) {
+                field.pieces.last() += ScriptProgram::formatNumber(part[0].value);
+            } else {
+                out.insert(out.end(), part.begin(), part.end());
+                field.pieces.append(QString());
+                ++values;
+            }
+            i = close + 1;
+        }
+
+        if (values == 0) {
+            tmpl.command.args.insert(key, field.pieces.first());
+            return true;
+        }
+        tmpl.fields.append(std::move(field));
+        tmpl.valueCount += values;
+        return true;
+    }
+
+    QHash<QString, int> m_variables;
+    QVector<Block> m_blocks;
+    int m_line = 0;
+    QString m_error;
+};
+
+} // namespace
+
+/**
+ * @brief Fields are rewritten in place, so the flags keep their map nodes across instances.
+ */
+const Command& ScriptProgram::CommandTemplate::instantiate(const double* values)
+{
+    for (const Field& field : fields) {
+        if (field.coordinate) {
+            command.coords.insert(field.key, QPointF(values[0], values[1]));
+            values += 2;
+            continue;
+        }
+        QString text = field.pieces.first();
+        for (int i = 1; i < field.pieces.size(); ++i) {
+            text += formatNumber(*values++);
+            text += field.pieces[i];
+        }
+        command.args.insert(field.key, text);
+    }
+    return command;
+}
+
+/**
+ * @brief Looks only at the first word of each line and for `${`; plain scripts keep the line-by-line path.
+ */
+bool ScriptProgram::isProgram(const QStringList& lines)
+{
+    for (const QString& line : lines) {
+        if (ScriptValidator::isSkipped(line)) continue;
+        if (isKeyword(firstWord(line)) || line.contains(QLatin1String("${"))) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Compiles every statement, then sizes the VM's stack from the code.
+ */
+bool ScriptProgram::compile(const QStringList& lines, CompileError& error)
+{
+    Compiler compiler;
+    if (!compiler.compile(lines, error)) return false;
+    m_code = std::move(compiler.code);
+    m_templates = std::move(compiler.templates);
+    m_variableCount = compiler.slotCount;
+
+    // Statements leave the stack empty and jumps only target statements, so a linear scan finds the peak
+    int depth = 0;
+    m_maxStack = 0;
+    for (const Instr& instr : m_code) {
+        depth += stackEffect(instr, m_templates);
+        m_maxStack = std::max(m_maxStack, depth);
+    }
+    return true;
+}
+
+/**
+ * @brief Arithmetic shared by the VM and constant folding; `%` is the floating-point remainder.
+ */
+double ScriptProgram::apply(Op op, double lhs, double rhs)
+{
+    switch (op) {
+    case Op::Add: return lhs + rhs;
+    case Op::Sub: return lhs - rhs;
+    case Op::Mul: return lhs * rhs;
+    case Op::Div: return lhs / rhs;
+    case Op::Mod: return std::fmod(lhs, rhs);
+    default: return 0.0;
+    }
+}
+
+/**
+ * @brief `min` and `max` take two arguments.
+ */
+int ScriptProgram::arity(Function function)
+{
+    return function == Function::Min || function == Function::Max ? 2 : 1;
+}
+
+/**
+ * @brief Evaluates a built-in function.
+ */
+double ScriptProgram::call(Function function, const double* args)
+{
+    switch (function) {
+    case Function::Abs: return std::abs(args[0]);
+    case Function::Floor: return std::floor(args[0]);
+    case Function::Sqrt: return std::sqrt(args[0]);
+    case Function::Sin: return std::sin(args[0]);
+    case Function::Cos: return std::cos(args[0]);
+    case Function::Min: return std::min(args[0], args[1]);
+    case Function::Max: return std::max(args[0], args[1]);
+    }
+    return 0.0;
+}
+
+/**
+ * @brief Whole numbers print without a fraction so `sq_${i}` gives `sq_3`, not `sq_3.0`.
+ */
+QString ScriptProgram::formatNumber(double value)
+{
+    if (std::floor(value) == value && std::abs(value) < 1e15) return QString::number(static_cast<qint64>(value));
+    return QString::number(value, 'g', 15);
+}
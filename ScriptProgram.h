@@ -0,0 +1,186 @@
+/**
+ * @file ScriptProgram.h
+ * @brief Declares the compiler of generative scripts: variables, loops and arithmetic, compiled to bytecode.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <vector>
+#include "CommandParser.h"
+
+/**
+ * @class ScriptProgram
+ * @brief A script with `let`, `for`, `repeat` or `${...}`, compiled once into stack bytecode.
+ *
+ *     let size = 10
+ *     for y = 0 to 999
+ *       for x = 0 to 999
+ *         create_square -name sq_${x}_${y} -coord_1 {x*size*2,y*size*2} -coord_2 {x*size*2+size,y*size*2+size}
+ *       end
+ *     end
+ *
+ * Expressions use numbers, variables, `+ - * / %`, unary minus, parentheses and the
+ * functions `abs`, `floor`, `sqrt`, `sin`, `cos` (radians), `min` and `max`. `for` bounds
+ * are inclusive and evaluated once; `repeat N` runs its body `floor(N)` times.
+ *
+ * Every command line becomes a `CommandTemplate`: the command with its literal flags
+ * already in place, plus the fields that hold expressions. The code pushes the values of
+ * those expressions and then an `Exec` instruction, which fills the template's `Command`
+ * directly. No text is parsed while the program runs; the dispatcher's VM only evaluates
+ * arithmetic and executes the filled commands in order.
+ */
+class ScriptProgram
+{
+public:
+    /**
+     * @brief Bytecode operations.
+     */
+    enum class Op : quint8
+    {
+        Push,        ///< Push `value`.
+        Load,        ///< Push variable `a`.
+        Store,       ///< Pop into variable `a`.
+        Add,
+        Sub,
+        Mul,
+        Div,
+        Mod,
+        Neg,
+        Call,        ///< Apply function `a` (a `Function`) to its arguments on the stack.
+        ForCheck,    ///< Jump to `b` unless variable `a` is within the bound in `c`, stepping by `c + 1`.
+        ForNext,     ///< Add the step in `c + 1` to variable `a` and jump to `b`.
+        RepeatCheck, ///< Jump to `b` when counter `a` is below one, else decrement it.
+        Jump,        ///< Continue at `b`.
+        Exec         ///< Pop the values of template `a` and execute it.
+    };
+
+    /**
+     * @brief Built-in functions callable from expressions.
+     */
+    enum class Function : quint8
+    {
+        Abs,
+        Floor,
+        Sqrt,
+        Sin,
+        Cos,
+        Min,
+        Max
+    };
+
+    /**
+     * @brief One instruction; 24 bytes.
+     */
+    struct Instr
+    {
+        Op op = Op::Push;
+        qint32 a = 0;
+        qint32 b = 0;
+        qint32 c = 0;
+        double value = 0.0;
+    };
+
+    /**
+     * @brief Part of a command that is only known when the command runs.
+     */
+    struct Field
+    {
+        QString key;            ///< Flag name without the leading dash.
+        bool coordinate = false; ///< `{x,y}` value taking two values; otherwise text.
+        QStringList pieces;     ///< Text only: literal text before each value, then the trailing text.
+    };
+
+    /**
+     * @brief A command line with its literal parts filled in.
+     */
+    struct CommandTemplate
+    {
+        int line = 0;           ///< One-based script line.
+        Command command;        ///< Literal flags; the fields are written into it by `instantiate`.
+        QVector<Field> fields;  ///< Fields in the order their values are pushed.
+        int valueCount = 0;     ///< Values `Exec` pops.
+
+        /**
+         * @brief Writes the field values into `command` and returns it.
+         * @param values `valueCount` values, in push order.
+         */
+        const Command& instantiate(const double* values);
+    };
+
+    /**
+     * @brief Where and why a script failed to compile.
+     */
+    struct CompileError
+    {
+        int line = 0;    ///< One-based script line.
+        QString message;
+    };
+
+    /**
+     * @brief Tests whether a script uses any program syntax, so it must be compiled rather than run line by line.
+     *
+     * Callers pass the first `ScriptReader::kScanWindow` lines, so a script is classified
+     * without reading all of it.
+     * @param lines Trimmed script lines.
+     */
+    static bool isProgram(const QStringList& lines);
+
+    /**
+     * @brief Compiles a script.
+     * @param lines Trimmed script lines; blank lines and `#` comments are skipped.
+     * @param error Receives the first problem.
+     * @return `true` when the script compiled.
+     */
+    bool compile(const QStringList& lines, CompileError& error);
+
+    /**
+     * @brief Returns the bytecode.
+     */
+    const std::vector<Instr>& code() const { return m_code; }
+
+    /**
+     * @brief Returns the command templates referenced by `Exec`.
+     */
+    QVector<CommandTemplate>& templates() { return m_templates; }
+
+    /**
+     * @brief Returns the number of variable slots, hidden loop state included.
+     */
+    int variableCount() const { return m_variableCount; }
+
+    /**
+     * @brief Returns the largest number of values the stack holds at once.
+     */
+    int maxStack() const { return m_maxStack; }
+
+    /**
+     * @brief Applies a binary arithmetic operation (`Add` to `Mod`).
+     */
+    static double apply(Op op, double lhs, double rhs);
+
+    /**
+     * @brief Returns the number of arguments a function takes.
+     */
+    static int arity(Function function);
+
+    /**
+     * @brief Applies a built-in function.
+     * @param function Function to apply.
+     * @param args Its arguments; two for `min` and `max`, one otherwise.
+     */
+    static double call(Function function, const double* args);
+
+    /**
+     * @brief Formats a value for a name or other text flag: integers without a fraction.
+     */
+    static QString formatNumber(double value);
+
+private:
+    std::vector<Instr> m_code;
+    QVector<CommandTemplate> m_templates;
+    int m_variableCount = 0;
+    int m_maxStack = 0;
+};
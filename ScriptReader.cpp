@@ -0,0 +1,38 @@
+/**
+ * @file ScriptReader.cpp
+ * @brief Implements the streaming script reader.
+ * @author Nikol Grigoryan
+ */
+#include "ScriptReader.h"
+
+/**
+ * @brief Opens the file in text mode and attaches the stream to it.
+ */
+bool ScriptReader::open(const QString& path, QString& error)
+{
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        error = QString("Failed to open script file: %1").arg(path);
+        return false;
+    }
+    m_in.setDevice(&m_file);
+    return true;
+}
+
+/**
+ * @brief Reads until @p max lines are buffered or the file ends.
+ */
+int ScriptReader::read(QStringList& lines, int max)
+{
+    lines.clear();
+    while (lines.size() < max && !m_in.atEnd()) lines.append(m_in.readLine().trimmed());
+    return lines.size();
+}
+
+/**
+ * @brief Seeks the stream back to the start; the stream drops its buffered text.
+ */
+void ScriptReader::rewind()
+{
+    m_in.seek(0);
+}
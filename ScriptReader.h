@@ -0,0 +1,53 @@
+/**
+ * @file ScriptReader.h
+ * @brief Declares the line reader that streams command scripts from disk.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+
+/**
+ * @class ScriptReader
+ * @brief Reads a script in windows of trimmed lines, so no caller holds the whole file.
+ *
+ * Execution reads one window per batch and validation makes its own pass, each through
+ * its own reader. Only compiled programs, which need every line at once, read to the end.
+ */
+class ScriptReader
+{
+public:
+    /**
+     * @brief Lines read at a time by passes that scan or validate a script.
+     */
+    static constexpr int kScanWindow = 16384;
+
+    /**
+     * @brief Opens a script for reading from its first line.
+     * @param path Script path.
+     * @param error Describes why the file could not be opened.
+     * @return `true` when the file is open.
+     */
+    bool open(const QString& path, QString& error);
+
+    /**
+     * @brief Reads the next lines.
+     * @param lines Replaced by up to @p max trimmed lines, blank lines included, so
+     *              line numbers follow from the number of lines read before.
+     * @param max Upper bound on the lines read.
+     * @return Number of lines read; `0` at the end of the file.
+     */
+    int read(QStringList& lines, int max);
+
+    /**
+     * @brief Returns to the first line.
+     */
+    void rewind();
+
+private:
+    QFile m_file;
+    QTextStream m_in;
+};
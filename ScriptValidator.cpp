@@ -0,0 +1,306 @@
+/**
+ * @file ScriptValidator.cpp
+ * @brief Implements the parallel, scene-free validation of command scripts.
+ * @author Nikol Grigoryan
+ */
+#include "ScriptValidator.h"
+#include <QSet>
+#include <algorithm>
+#include <climits>
+#include <utility>
+#include <vector>
+#include "CommandParser.h"
+#include "ConcurrentNameSet.h"
+#include "Parallel.h"
+#include "ScriptProgram.h"
+#include "ScriptReader.h"
+#include "ShapeRepository.h"
+#include "ShapeRequest.h"
+
+namespace {
+
+/**
+ * @brief Per-line result of the parallel check.
+ */
+struct LineState
+{
+    QString error;        ///< Problem found without looking at names, if any.
+    QString defines;      ///< Name a `create_*` or `create_instance` line asks for, if it could be read.
+    bool valid = false;   ///< The creating line passes every check except uniqueness.
+    QStringList uses;     ///< Names of shapes the line requires to exist.
+    QString barrier;      ///< Command of a `delete`, `execute_file`, `rollback` or `create_grid` line, which change names unpredictably.
+};
+
+/**
+ * @brief Commands the dispatcher accepts inside scripts, besides the `create_*` family.
+ */
+const QSet<QString>& otherCommands()
+{
+    static const QSet<QString> names = {
+        "connect", "connect_chain", "connect_star", "connect_edges", "execute_file", "validate_file",
+        "save", "autosave", "checkpoint", "diff", "move", "rotate", "scale", "disconnect",
+        "list_connections", "delete", "history_budget", "reachable", "shortest_path", "component",
+        "components", "top_degree", "clear_highlight", "queue_stats", "serve", "audit_log", "begin",
+        "commit", "rollback", "create_instance", "create_grid", "mem_stats",
+    };
+    return names;
+}
+
+/**
+ * @brief Collects the names a command refers to and checks that the naming flags exist.
+ * @return `false` with @p error set when a required flag is missing.
+ */
+bool collectUses(const Command& cmd, QStringList& uses, QString& error)
+{
+    const auto single = [&cmd, &uses](const QString& key) {
+        const QString name = cmd.args.value(key).trimmed();
+        if (!name.isEmpty()) uses << name;
+    };
+    const auto list = [&cmd, &uses, &error](const QString& key) {
+        const QStringList names = cmd.args.value(key).split(',', Qt::SkipEmptyParts);
+        if (names.isEmpty()) {
+            error = cmd.args.contains(key) ? QString("-%1 must list at least one name.").arg(key)
+                                           : QString("Missing -%1.").arg(key);
+            return false;
+        }
+        uses << names;
+        return true;
+    };
+
+    if (cmd.name == "connect" || cmd.name == "disconnect") {
+        if (!cmd.args.contains("object_name_1") || !cmd.args.contains("object_name_2")) {
+            error = "Missing -object_name_1 or -object_name_2.";
+            return false;
+        }
+        single("object_name_1");
+        single("object_name_2");
+    } else if (cmd.name == "connect_chain") {
+        if (!list("names")) return false;
+        if (uses.size() < 2) {
+            error = "A chain needs at least two names.";
+            return false;
+        }
+    } else if (cmd.name == "connect_star") {
+        if (!cmd.args.contains("hub")) {
+            error = "Missing -hub.";
+            return false;
+        }
+        single("hub");
+        if (!list("names")) return false;
+    } else if (cmd.name == "move" || cmd.name == "rotate" || cmd.name == "scale") {
+        if (!cmd.args.contains("name") && !cmd.args.contains("pattern")) {
+            error = "Missing -name or -pattern.";
+            return false;
+        }
+        single("name");
+    } else if (cmd.name == "list_connections" || cmd.name == "component") {
+        single("name");
+    } else if (cmd.name == "reachable" || cmd.name == "shortest_path") {
+        single("from");
+        single("to");
+    }
+    return true;
+}
+
+/**
+ * @brief Runs every check of a single line that does not depend on other lines.
+ */
+void checkLine(const QString& raw, LineState& state, ConcurrentNameSet& defined, int line)
+{
+    Command cmd;
+    QString error;
+    if (!CommandParser().parse(raw, cmd, error)) {
+        state.error = QString("parse error: %1").arg(error);
+        return;
+    }
+    if (cmd.name == "delete" || cmd.name == "execute_file" || cmd.name == "rollback" || cmd.name == "create_grid") {
+        state.barrier = cmd.name;
+    }
+
+    if (ShapeRequest::isCreateCommand(cmd.name)) {
+        if (!ShapeRequest::readName(cmd, state.defines, state.error)) return;
+        ShapeRequest request;
+        state.valid = ShapeRequest::fromCommand(cmd, state.defines, request, state.error);
+        if (state.valid) defined.claim(state.defines, line);
+        return;
+    }
+
+    if (cmd.name == "create_instance") {
+        if (!ShapeRequest::readName(cmd, state.defines, state.error)) return;
+        const QString prototype = cmd.args.value("prototype").trimmed();
+        if (prototype.isEmpty()) {
+            state.error = "Missing -prototype.";
+        } else if (!cmd.coords.contains("offset")) {
+            state.error = "Missing -offset coordinate.";
+        } else {
+            state.uses << prototype;
+            state.valid = true;
+            defined.claim(state.defines, line);
+        }
+        return;
+    }
+
+    if (cmd.name == "undo" || cmd.name == "redo") {
+        state.error = QString("'%1' cannot be used inside a script.").arg(cmd.name);
+    } else if (!otherCommands().contains(cmd.name)) {
+        state.error = QString("Unknown command '%1'.").arg(cmd.name);
+    } else {
+        collectUses(cmd, state.uses, state.error);
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Compiles a program and checks the command of every template.
+ *
+ * Names and coordinates depend on values only known while the program runs, so they are
+ * checked then.
+ */
+ScriptValidator::Report ScriptValidator::validateProgram(const QStringList& lines)
+{
+    Report report;
+    report.unchecked = "Names and coordinates were not checked; they depend on values known only at run time.";
+    ScriptProgram program;
+    ScriptProgram::CompileError error;
+    if (!program.compile(lines, error)) {
+        report.issues.append({ error.line, error.message });
+        return report;
+    }
+
+    for (const ScriptProgram::CommandTemplate& tmpl : program.templates()) {
+        ++report.commandCount;
+        const QString& name = tmpl.command.name;
+        if (name == "undo" || name == "redo") {
+            report.issues.append({ tmpl.line, QString("'%1' cannot be used inside a script.").arg(name) });
+        } else if (!ShapeRequest::isCreateCommand(name) && !otherCommands().contains(name)) {
+            report.issues.append({ tmpl.line, QString("Unknown command '%1'.").arg(name) });
+        }
+    }
+    return report;
+}
+
+/**
+ * @brief Lists every issue under a one-line summary.
+ */
+QString ScriptValidator::Report::toString() const
+{
+    QString text = QString("Script validated: %1 commands, %2 errors.").arg(commandCount).arg(issues.size());
+    if (!unchecked.isEmpty()) text += ' ' + unchecked;
+    for (const Issue& issue : issues) text += QString("\nLine %1: %2").arg(issue.line).arg(issue.message);
+    return text;
+}
+
+/**
+ * @brief Picks the program or plain path from the first window, as execution does, then validates the file.
+ *
+ * A program is compiled whole, as it would be to run. A plain script is checked one
+ * window at a time, so only the name set grows with the script.
+ */
+bool ScriptValidator::validateFile(const QString& path, Report& report, QString& error) const
+{
+    ScriptReader reader;
+    if (!reader.open(path, error)) return false;
+
+    QStringList lines;
+    reader.read(lines, ScriptReader::kScanWindow);
+    if (ScriptProgram::isProgram(lines)) {
+        QStringList rest;
+        reader.read(rest, INT_MAX);
+        report = validateProgram(lines + rest);
+        return true;
+    }
+
+    Pass pass(m_repo);
+    do {
+        pass.feed(lines);
+    } while (reader.read(lines, ScriptReader::kScanWindow));
+    report = pass.report();
+    return true;
+}
+
+ScriptValidator::Pass::Pass(const ShapeRepository& repo)
+    : m_repo(repo)
+    , m_defined(std::make_unique<ConcurrentNameSet>())
+{
+}
+
+ScriptValidator::Pass::~Pass() = default;
+
+/**
+ * @brief Names defined by earlier windows stay in the set, so later windows resolve against them.
+ */
+void ScriptValidator::Pass::feed(const QStringList& lines)
+{
+    ScriptValidator(m_repo).validateWindow(lines, m_first, *m_defined, m_report);
+    m_first += lines.size();
+}
+
+/**
+ * @brief Checks lines in parallel, then resolves names against the earliest definitions.
+ *
+ * The first pass parses and checks each line on its own and claims the names of valid
+ * `create_*` lines. The second pass only reads the name set, so it is parallel too; lines
+ * of later windows only claim later line numbers, so they cannot change its answers. Issues
+ * are then gathered in line order.
+ */
+void ScriptValidator::validateWindow(const QStringList& lines, int first, ConcurrentNameSet& defined,
+                                     Report& report) const
+{
+    const int count = lines.size();
+    std::vector<LineState> states(count);
+    std::vector<int> barriers(Parallel::workerCount(), INT_MAX);
+    std::vector<int> commands(Parallel::workerCount(), 0);
+
+    Parallel::forRanges(count, [&](int begin, int end, int worker) {
+        for (int i = begin; i < end; ++i) {
+            const QString& raw = lines[i];
+            if (isSkipped(raw)) continue;
+            ++commands[worker];
+            checkLine(raw, states[i], defined, first + i);
+            if (!states[i].barrier.isEmpty()) barriers[worker] = std::min(barriers[worker], i);
+        }
+    });
+    int barrier = std::min(count, *std::min_element(barriers.begin(), barriers.end()));
+    if (!report.unchecked.isEmpty()) {
+        barrier = 0;
+    } else if (barrier < count) {
+        report.unchecked = QString("Names after line %1 ('%2') were not checked.")
+                               .arg(first + barrier + 1).arg(states[barrier].barrier);
+    }
+
+    // A name is available on line i if it existed before the script or a valid create precedes i
+    const auto available = [this, &defined](const QString& name, int line) {
+        if (m_repo.contains(name)) return true;
+        const int firstLine = defined.firstLine(name);
+        return firstLine >= 0 && firstLine < line;
+    };
+
+    Parallel::forRanges(barrier, [&](int begin, int end, int) {
+        for (int i = begin; i < end; ++i) {
+            LineState& state = states[i];
+            const int line = first + i;
+            if (!state.defines.isEmpty()) {
+                const int firstLine = defined.firstLine(state.defines);
+                if (m_repo.contains(state.defines)) {
+                    state.error = QString("An object named '%1' already exists. Choose a unique name.").arg(state.defines);
+                } else if (firstLine >= 0 && firstLine < line) {
+                    state.error = QString("An object named '%1' is already created on line %2.")
+                                      .arg(state.defines).arg(firstLine + 1);
+                }
+            }
+            if (state.error.isEmpty()) {
+                for (const QString& name : std::as_const(state.uses)) {
+                    if (available(name, line)) continue;
+                    state.error = QString("Object '%1' is not defined before this line.").arg(name);
+                    break;
+                }
+            }
+        }
+    });
+
+    for (int c : commands) report.commandCount += c;
+    for (int i = 0; i < count; ++i) {
+        if (!states[i].error.isEmpty()) report.issues.append(Issue{ first + i + 1, states[i].error });
+    }
+}
@@ -0,0 +1,139 @@
+/**
+ * @file ScriptValidator.h
+ * @brief Declares the parallel, scene-free validation of command scripts.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <memory>
+
+class ConcurrentNameSet;
+class ShapeRepository;
+
+/**
+ * @class ScriptValidator
+ * @brief Checks every line of a script without touching the scene.
+ *
+ * Lines are parsed and checked in parallel: syntax, known commands, required flags and
+ * shape geometry. Shape names are then resolved the way serial execution would see
+ * them, against the repository plus the earliest successful definition in the script,
+ * which workers record in a `ConcurrentNameSet`. A `create_*` whose name is taken and a
+ * command naming a shape that does not exist yet are both reported.
+ *
+ * The file is read a window at a time; names defined by earlier windows stay in the set,
+ * so the result is the same as checking the whole script at once. A `Pass` takes the
+ * windows one by one, so a caller can spread the check over several time slices.
+ *
+ * `delete`, nested `execute_file`, `rollback` and `create_grid` change the set of names in
+ * ways the validator does not model, so name checks stop at the first such line; later
+ * lines still get syntax and geometry checks, and the report says where names stopped.
+ *
+ * A script whose first window uses variables or loops (see `ScriptProgram`) is compiled
+ * instead, and only its syntax and command names are checked.
+ */
+class ScriptValidator
+{
+public:
+    /**
+     * @brief Problem found on one script line.
+     */
+    struct Issue
+    {
+        int line = 0;    ///< One-based line number.
+        QString message; ///< Same wording execution would report.
+    };
+
+    /**
+     * @brief Outcome of validating a whole script.
+     */
+    struct Report
+    {
+        int commandCount = 0;  ///< Non-blank, non-comment lines.
+        QVector<Issue> issues; ///< Problems in line order.
+        QString unchecked;     ///< Which lines got no name checks; empty when every line did.
+
+        /**
+         * @brief Returns `true` when no line has a problem.
+         */
+        bool ok() const { return issues.isEmpty(); }
+
+        /**
+         * @brief Formats the report with one line per issue, after a summary that also
+         *        names the lines whose names were not checked.
+         */
+        QString toString() const;
+    };
+
+    /**
+     * @class Pass
+     * @brief Validation of a plain script that is fed one window at a time.
+     */
+    class Pass
+    {
+    public:
+        /**
+         * @brief Starts a pass that resolves names against a repository.
+         * @param repo Shapes that exist before the script runs; only read.
+         */
+        explicit Pass(const ShapeRepository& repo);
+        ~Pass();
+
+        /**
+         * @brief Checks the next window of the script.
+         * @param lines Window of trimmed lines, following the windows fed before.
+         */
+        void feed(const QStringList& lines);
+
+        /**
+         * @brief Returns the problems found in the windows fed so far.
+         */
+        const Report& report() const { return m_report; }
+
+    private:
+        const ShapeRepository& m_repo;
+        std::unique_ptr<ConcurrentNameSet> m_defined;
+        int m_first = 0;
+        Report m_report;
+    };
+
+    /**
+     * @brief Creates a validator that resolves names against a repository.
+     * @param repo Shapes that exist before the script runs; only read.
+     */
+    explicit ScriptValidator(const ShapeRepository& repo) : m_repo(repo) {}
+
+    /**
+     * @brief Validates a script file in its own streaming pass.
+     * @param path Script path; blank lines and lines starting with `#` are skipped.
+     * @param report Receives every problem.
+     * @param error Describes why the file could not be read.
+     * @return `true` when the file was read and @p report filled.
+     */
+    bool validateFile(const QString& path, Report& report, QString& error) const;
+
+    /**
+     * @brief Compiles a program and checks the command of every template.
+     * @param lines Every trimmed line of the script.
+     */
+    static Report validateProgram(const QStringList& lines);
+
+    /**
+     * @brief Tests whether a trimmed script line carries no command.
+     */
+    static bool isSkipped(const QString& line) { return line.isEmpty() || line.startsWith('#'); }
+
+private:
+    /**
+     * @brief Checks one window of a plain script and appends its issues to @p report.
+     * @param lines Window of trimmed lines.
+     * @param first Zero-based script line of the window's first line.
+     * @param defined Earliest defining line of each name, across all windows so far.
+     * @param report Report of the windows so far; names are not checked once `unchecked` is set.
+     */
+    void validateWindow(const QStringList& lines, int first, ConcurrentNameSet& defined, Report& report) const;
+
+    const ShapeRepository& m_repo;
+};
@@ -1,7 +1,73 @@
 /**
  * @file ShapeBase.cpp
- * @brief Provides a compilation unit for potential shared shape logic in ObjectDrawer. 
+ * @brief Implements shared shape logic for ObjectDrawer, such as recreating shapes from stored vertices.
  * @author Nikol Grigoryan
  */
 #include "ShapeBase.h"
-// No shared implementation yet
+#include <QGraphicsColorizeEffect>
+#include "LineShape.h"
+#include "TriangleShape.h"
+#include "RectangleShape.h"
+#include "SquareShape.h"
+
+/**
+ * @brief Builds the concrete shape that matches a stored kind and vertex list.
+ * @param kind Concrete shape kind.
+ * @param points Vertices in construction order.
+ * @return New shape, or `nullptr` when the vertex count is inconsistent with the kind.
+ */
+ShapeBase* ShapeBase::create(ShapeKind kind, const QVector<QPointF>& points)
+{
+    switch (kind) {
+    case ShapeKind::Line:
+        if (points.size() != 2) return nullptr;
+        return new LineShape(points[0], points[1]);
+    case ShapeKind::Triangle:
+        if (points.size() != 3) return nullptr;
+        return new TriangleShape(points[0], points[1], points[2]);
+    case ShapeKind::Rectangle:
+        if (points.size() != 4) return nullptr;
+        return new RectangleShape(points);
+    case ShapeKind::Square:
+        if (points.size() != 4) return nullptr;
+        return new SquareShape(points);
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Allocates through the global allocator and adds the object to the shape counters.
+ */
+void* ShapeBase::operator new(std::size_t size)
+{
+    void* p = ::operator new(size);
+    MemoryStats::add(MemoryStats::Counter::ShapeObjects, 1);
+    MemoryStats::add(MemoryStats::Counter::ShapeObjectBytes, qint64(size));
+    return p;
+}
+
+/**
+ * @brief Removes the object from the shape counters before freeing it.
+ */
+void ShapeBase::operator delete(void* p, std::size_t size)
+{
+    if (!p) return;
+    MemoryStats::add(MemoryStats::Counter::ShapeObjects, -1);
+    MemoryStats::add(MemoryStats::Counter::ShapeObjectBytes, -qint64(size));
+    ::operator delete(p);
+}
+
+/**
+ * @brief Replaces the item's effect; the item owns and deletes it.
+ * @param on Whether the shape is highlighted.
+ */
+void ShapeBase::setHighlighted(bool on)
+{
+    if (!on) {
+        graphicsItem()->setGraphicsEffect(nullptr);
+        return;
+    }
+    auto* effect = new QGraphicsColorizeEffect;
+    effect->setColor(QColor(255, 140, 0));
+    graphicsItem()->setGraphicsEffect(effect);
+}
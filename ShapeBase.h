@@ -8,6 +8,22 @@
 #include <QString>
 #include <QGraphicsItem>
 #include <QPointF>
+#include <QVector>
+#include <cstddef>
+#include "MemoryStats.h"
+#include "ShapeHandle.h"
+
+/**
+ * @enum ShapeKind
+ * @brief Identifies the concrete geometry behind a `ShapeBase` instance.
+ */
+enum class ShapeKind
+{
+    Line,      ///< Two-point segment.
+    Triangle,  ///< Three-vertex polygon.
+    Rectangle, ///< Four-vertex rectangle.
+    Square     ///< Four-vertex square.
+};
 
 /**
  * @class ShapeBase
@@ -15,16 +31,17 @@
  *
  * Each derived shape wraps a `QGraphicsItem` instance that can be inserted into a
  * `QGraphicsScene` and provides a consistent way to obtain the geometric center
- * used for connection operations.
+ * used for connection operations. A shape does not store its name: `ShapeRepository`
+ * interns the name and gives the shape its handle when the shape is added.
+ * Shapes are allocated through a class allocator that counts them for `mem_stats`.
  */
 class ShapeBase
 {
 public:
     /**
-     * @brief Constructs a shape with the given logical name.
-     * @param name Human-readable identifier used for lookup in `ShapeRepository`.
+     * @brief Constructs a shape that has no handle until it is added to a repository.
      */
-    explicit ShapeBase(const QString& name) : m_name(name) {}
+    ShapeBase() = default;
 
     /**
      * @brief Virtual destructor to ensure derived classes clean up correctly.
@@ -44,11 +61,66 @@ public:
     virtual QPointF center() const = 0;
 
     /**
-     * @brief Retrieves the logical name of the shape.
-     * @return Shape name used for repository lookup.
+     * @brief Reports the concrete kind of the shape.
+     * @return Shape kind used when serializing or recreating the shape.
+     */
+    virtual ShapeKind kind() const = 0;
+
+    /**
+     * @brief Returns the vertices that define the shape.
+     * @return Endpoints for lines, polygon corners for all other kinds.
+     */
+    virtual QVector<QPointF> vertices() const = 0;
+
+    /**
+     * @brief Replaces the defining vertices, updating the graphics item and cached center.
+     * @param points New vertices; must have the same count as `vertices()`.
+     */
+    virtual void setVertices(const QVector<QPointF>& points) = 0;
+
+    /**
+     * @brief Tints the shape to mark it as a query result, or restores its normal look.
+     *
+     * The default installs a colorize effect on `graphicsItem()`; shapes that share an item
+     * tint only their own part of it.
+     * @param on Whether the shape is highlighted.
+     */
+    virtual void setHighlighted(bool on);
+
+    /**
+     * @brief Retrieves the handle the repository issued for the shape's name.
+     * @return Handle, or the null handle while the shape is not stored.
+     */
+    ShapeHandle handle() const { return m_handle; }
+
+    /**
+     * @brief Estimates the bytes the shape accounts for: itself, its vertex arrays and its own item.
+     *
+     * Arrays shared with the scene record or the item are counted once, here. The result
+     * must not change while the shape is stored, since the repository subtracts it on removal.
+     */
+    virtual MemoryStats::ShapeUsage memoryUsage() const = 0;
+
+    /**
+     * @brief Allocates a shape and counts it in `MemoryStats::Counter::ShapeObjects`.
      */
-    QString name() const { return m_name; }
+    static void* operator new(std::size_t size);
+
+    /**
+     * @brief Releases a shape; the virtual destructor supplies the size of the derived object.
+     */
+    static void operator delete(void* p, std::size_t size);
+
+    /**
+     * @brief Recreates a shape of the given kind from its stored vertices.
+     * @param kind Concrete shape kind.
+     * @param points Vertices as returned by `vertices()`.
+     * @return Newly allocated shape owned by the caller, or `nullptr` if the vertex count does not match the kind.
+     */
+    static ShapeBase* create(ShapeKind kind, const QVector<QPointF>& points);
+
+private:
+    friend class ShapeRepository;
 
-protected:
-    QString m_name;
+    ShapeHandle m_handle;
 };
@@ -0,0 +1,66 @@
+/**
+ * @file ShapeHandle.h
+ * @brief Declares the 32-bit generational handle that identifies a shape inside the engine.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QtGlobal>
+#include <QHash>
+
+/**
+ * @struct ShapeHandle
+ * @brief Slot index plus generation, packed into 32 bits.
+ *
+ * The low 24 bits index the per-shape arrays of the repository, shape table, scene store
+ * and connection index, so resolving a handle is an array access. The high 8 bits hold
+ * the generation of the slot, which `NamePool` bumps whenever the slot is freed; a handle
+ * kept past its shape's removal therefore no longer matches the slot. Generations start at
+ * one, so the all-zero value is never issued and serves as the null handle.
+ */
+struct ShapeHandle
+{
+    static constexpr int kIndexBits = 24;                              ///< Bits of the slot index.
+    static constexpr quint32 kIndexMask = (1u << kIndexBits) - 1;      ///< Mask of the slot index.
+    static constexpr int kMaxCount = int(kIndexMask) + 1;              ///< Number of addressable slots.
+
+    quint32 value = 0; ///< Packed generation and index; `0` for the null handle.
+
+    /**
+     * @brief Packs a slot index and a generation.
+     */
+    static constexpr ShapeHandle make(int index, quint8 generation)
+    {
+        return ShapeHandle{ (quint32(generation) << kIndexBits) | (quint32(index) & kIndexMask) };
+    }
+
+    /**
+     * @brief Returns the slot index used for array lookups.
+     */
+    constexpr int index() const { return int(value & kIndexMask); }
+
+    /**
+     * @brief Returns the generation of the slot when the handle was issued.
+     */
+    constexpr quint8 generation() const { return quint8(value >> kIndexBits); }
+
+    /**
+     * @brief Tests for the null handle.
+     */
+    constexpr bool isNull() const { return value == 0; }
+
+    constexpr bool operator==(ShapeHandle other) const { return value == other.value; }
+    constexpr bool operator!=(ShapeHandle other) const { return value != other.value; }
+};
+
+/**
+ * @brief Hashes a handle by its packed value, so handles can key `QHash` and `QSet`.
+ */
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+inline size_t qHash(ShapeHandle handle, size_t seed = 0)
+#else
+inline uint qHash(ShapeHandle handle, uint seed = 0)
+#endif
+{
+    return qHash(handle.value, seed);
+}
@@ -4,6 +4,32 @@
  * @author Nikol Grigoryan
  */
 #include "ShapeRepository.h"
+#include "InstanceShape.h"
+
+namespace {
+
+/**
+ * @brief Describes a shape for the store and history.
+ *
+ * A translated instance shares its layer's prototype vertices and adds only its offset;
+ * every other shape, including a rotated or scaled instance, records its own vertices.
+ * @param name Shape name.
+ * @param shape Shape to describe.
+ */
+ShapeRecord recordOf(const QString& name, const ShapeBase* shape)
+{
+    if (const auto* instance = dynamic_cast<const InstanceShape*>(shape)) {
+        const QTransform placement = instance->placement();
+        if (placement.type() <= QTransform::TxTranslate) {
+            return ShapeRecord{ name, shape->kind(), instance->layer()->baseVertices(),
+                                QPointF(placement.dx(), placement.dy()), true,
+                                quintptr(instance->layer().get()) };
+        }
+    }
+    return ShapeRecord{ name, shape->kind(), shape->vertices() };
+}
+
+} // namespace
 
 /**
  * @brief Releases all shapes owned by the repository.
@@ -11,38 +37,171 @@
 ShapeRepository::~ShapeRepository()
 {
     // Delete all owned shapes on shutdown to prevent memory leaks
-    for (auto it = m_items.begin(); it != m_items.end(); ++it) {
-        delete it.value();
+    for (ShapeBase* shape : m_shapes) {
+        delete shape;
     }
 }
 
 /**
- * @brief Reports whether a shape with the given name exists.
- * @param name Logical shape name.
- * @return `true` if the name is already present; otherwise `false`.
+ * @brief Interns the name and stores the shape under the issued handle.
+ * @param name New shape name. Must not be already present.
+ * @param shape Pointer to the shape whose ownership transfers to the repository.
+ * @return Handle of the shape, or the null handle when the pool is full.
  */
-bool ShapeRepository::contains(const QString& name) const
+ShapeHandle ShapeRepository::add(const QString& name, ShapeBase* shape)
 {
-    return m_items.contains(name);
+    const ShapeHandle handle = m_names.insert(name);
+    if (handle.isNull()) return handle;
+    const size_t slot = size_t(handle.index());
+    if (slot >= m_shapes.size()) m_shapes.resize(slot + 1, nullptr);
+    m_shapes[slot] = shape;
+    shape->m_handle = handle;
+
+    if (const auto* instance = dynamic_cast<const InstanceShape*>(shape)) {
+        m_store.insert(handle, recordOf(m_names.name(handle), shape));
+        m_table.insertInstance(handle, instance->layer().get(), instance->slot());
+    } else {
+        const QVector<QPointF> points = shape->vertices();
+        m_store.insert(handle, ShapeRecord{m_names.name(handle), shape->kind(), points});
+        m_table.insert(handle, shape->kind(), points);
+    }
+    tally(shape, 1);
+    return handle;
 }
 
 /**
- * @brief Stores a shape under a unique name.
- * @param name New shape name. Must not be already present.
- * @param shape Pointer to the shape whose ownership transfers to the repository.
+ * @brief Detaches a shape from the repository and hands ownership back to the caller.
+ * @param handle Shape handle.
+ * @return Detached shape pointer or `nullptr` when the handle is stale.
+ */
+ShapeBase* ShapeRepository::take(ShapeHandle handle)
+{
+    ShapeBase* shape = get(handle);
+    if (!shape) return nullptr;
+
+    tally(shape, -1);
+    m_store.erase(handle);
+    m_table.erase(handle);
+    m_shapes[size_t(handle.index())] = nullptr;
+    m_names.erase(handle);
+    shape->m_handle = ShapeHandle{};
+    return shape;
+}
+
+/**
+ * @brief Describes a live shape the way the store records it.
+ * @param handle Shape handle.
+ * @return Record of the shape, or an empty record when the handle is stale.
+ */
+ShapeRecord ShapeRepository::record(ShapeHandle handle) const
+{
+    const ShapeBase* shape = get(handle);
+    if (!shape) return ShapeRecord{};
+    return recordOf(m_names.name(handle), shape);
+}
+
+/**
+ * @brief Copies every live name out of the pool.
+ * @return Names in handle order.
  */
-void ShapeRepository::add(const QString& name, ShapeBase* shape)
+QStringList ShapeRepository::names() const
 {
-    m_items.insert(name, shape);
+    QStringList result;
+    result.reserve(m_names.size());
+    forEachHandle([this, &result](ShapeHandle h) { result << m_names.name(h); });
+    return result;
 }
 
 /**
- * @brief Retrieves a shape by name.
- * @param name Logical shape name.
- * @return Stored shape pointer or `nullptr` when no shape matches.
+ * @brief Applies new vertices to a shape, records them, and refreshes its connectors.
+ * @param handle Shape handle.
+ * @param points New vertices.
+ * @return `true` if the shape was found.
  */
-ShapeBase* ShapeRepository::get(const QString& name) const
+bool ShapeRepository::updateGeometry(ShapeHandle handle, const QVector<QPointF>& points)
 {
-    auto it = m_items.find(name);
-    return it == m_items.end() ? nullptr : it.value();
+    ShapeBase* shape = get(handle);
+    if (!shape) return false;
+
+    // An instance's usage depends on whether its placement is a pure translation
+    tally(shape, -1);
+    shape->setVertices(points);
+    tally(shape, 1);
+    m_store.update(handle, recordOf(QString(), shape));
+    m_table.update(handle, points);
+    refreshConnectors(handle);
+    return true;
+}
+
+/**
+ * @brief Re-aims every connector attached to a shape at the shape's current center.
+ * @param handle Shape whose geometry changed.
+ */
+void ShapeRepository::refreshConnectors(ShapeHandle handle)
+{
+    bool found = false;
+    const QPointF c = m_table.center(handle, &found);
+    if (!found) return;
+
+    for (int id : m_connections.incident(handle)) {
+        const ConnectionIndex::Edge& e = m_connections.edge(id);
+        bool otherFound = false;
+        const QPointF other = m_table.center(e.a == handle ? e.b : e.a, &otherFound);
+        const QPointF oc = otherFound ? other : c;
+        // Preserve the a -> b direction so the line matches the original connect order
+        m_connections.setLine(id, e.a == handle ? QLineF(c, oc) : QLineF(oc, c));
+    }
+}
+
+/**
+ * @brief Combines the per-type sums with the sizes of the pool, arrays, store and connection index.
+ * @param report Report to fill.
+ */
+void ShapeRepository::measure(MemoryStats::Report& report) const
+{
+    using Report = MemoryStats::Report;
+    MemoryStats::ShapeUsage shapes;
+    for (int i = 0; i < Report::kTypeCount; ++i) {
+        report.types[i] = m_usage[i];
+        shapes += m_usage[i].usage;
+    }
+    // The allocator counter also covers shapes held outside the repository, e.g. by a pending transaction
+    report.bytes[Report::ShapeObjects] = MemoryStats::value(MemoryStats::Counter::ShapeObjectBytes);
+    report.bytes[Report::Vertices] = shapes.vertices + m_table.vertexBytes();
+    report.bytes[Report::Items] = shapes.item + MemoryStats::value(MemoryStats::Counter::InstanceLayerBytes);
+    report.bytes[Report::Names] = m_names.nameBytes();
+    report.bytes[Report::Index] = m_names.indexBytes() + MemoryStats::capacityBytes(m_shapes)
+                                + m_table.indexBytes() + m_store.usedBytes();
+    report.bytes[Report::Connectors] = m_connections.usedBytes();
+    report.connectors = m_connections.size();
+}
+
+/**
+ * @brief Shares the store's chunks and lists every live edge by the record slots of its endpoints.
+ */
+SceneSnapshot ShapeRepository::snapshot() const
+{
+    QVector<SceneSnapshot::Link> links;
+    links.reserve(m_connections.size());
+    m_connections.forEachEdge([this, &links](const ConnectionIndex::Edge& e) {
+        links.append(SceneSnapshot::Link{ m_store.slot(e.a), m_store.slot(e.b) });
+    });
+    return m_store.snapshot(std::move(links));
+}
+
+/**
+ * @brief Adds a shape's usage to its type row, or removes it.
+ * @param shape Shape being added or taken.
+ * @param sign `1` when adding, `-1` when taking.
+ */
+void ShapeRepository::tally(const ShapeBase* shape, int sign)
+{
+    const MemoryStats::ShapeUsage usage = shape->memoryUsage();
+    MemoryStats::Report::Type& row = m_usage[usage.instance ? MemoryStats::Report::kTypeCount - 1 : int(shape->kind())];
+    row.count += sign;
+    if (sign > 0) {
+        row.usage += usage;
+    } else {
+        row.usage -= usage;
+    }
 }
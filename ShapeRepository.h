@@ -1,20 +1,30 @@
 /**
  * @file ShapeRepository.h
- * @brief Declares a repository for owning and retrieving shapes by name.
+ * @brief Declares a repository for owning and retrieving shapes by handle or name.
  * @author Nikol Grigoryan
  */
 #pragma once
 
 #include <QString>
-#include <QMap>
+#include <QStringList>
+#include <vector>
+#include "NamePool.h"
 #include "ShapeBase.h"
+#include "SceneStore.h"
+#include "ShapeTable.h"
+#include "ConnectionIndex.h"
 
 /**
  * @class ShapeRepository
- * @brief Owns `ShapeBase` instances and exposes name-based lookup.
+ * @brief Owns `ShapeBase` instances and exposes handle- and name-based lookup.
  *
  * The repository guarantees uniqueness of shape names and releases the owned
- * shapes on destruction to avoid memory leaks.
+ * shapes on destruction to avoid memory leaks. Names are interned in a `NamePool`, which
+ * issues the `ShapeHandle` every internal structure uses; names are only resolved at the
+ * boundary, when a command names a shape or a reply lists one. Every insertion is mirrored into a
+ * versioned `SceneStore` so consistent snapshots can be taken without copying shapes, and
+ * into a `ShapeTable` of plain values that whole-scene passes iterate without virtual calls.
+ * Connections between shapes are tracked in a `ConnectionIndex` owned by the repository.
  */
 class ShapeRepository
 {
@@ -34,22 +44,185 @@ public:
      * @param name Logical shape name.
      * @return `true` if the repository already contains the name.
      */
-    bool contains(const QString& name) const;
+    bool contains(const QString& name) const { return !m_names.find(name).isNull(); }
+
+    /**
+     * @brief Tests whether a handle still refers to a stored shape.
+     */
+    bool contains(ShapeHandle handle) const { return m_names.isLive(handle); }
+
+    /**
+     * @brief Resolves a name to the handle of its shape.
+     * @param name Logical shape name.
+     * @return Handle, or the null handle when not found.
+     */
+    ShapeHandle handle(const QString& name) const { return m_names.find(name); }
+
+    /**
+     * @brief Returns the name of a stored shape; the text is shared with the pool.
+     * @param handle Live handle.
+     */
+    const QString& name(ShapeHandle handle) const { return m_names.name(handle); }
+
+    /**
+     * @brief Tests whether every handle is in use, so no further shape can be added.
+     */
+    bool isFull() const { return m_names.size() == ShapeHandle::kMaxCount; }
+
+    /**
+     * @brief Tests whether @p count more shapes still fit.
+     */
+    bool canAdd(qint64 count) const { return m_names.size() + count <= ShapeHandle::kMaxCount; }
 
     /**
      * @brief Inserts a new shape instance into the repository.
      * @param name Unique logical name. Must not already exist.
-     * @param shape Pointer to the caller-created shape. Ownership transfers to the repository.
+     * @param shape Pointer to the caller-created shape. Ownership transfers to the repository
+     *              unless the repository is full.
+     * @return Handle issued for the name, also stored in the shape; the null handle when the
+     *         repository is full, in which case nothing is changed and the caller keeps the shape.
+     */
+    ShapeHandle add(const QString& name, ShapeBase* shape);
+
+    /**
+     * @brief Retrieves a shape by handle.
+     * @return Pointer to the stored shape, or `nullptr` for a stale handle.
      */
-    void add(const QString& name, ShapeBase* shape);
+    ShapeBase* get(ShapeHandle handle) const { return contains(handle) ? m_shapes[size_t(handle.index())] : nullptr; }
 
     /**
      * @brief Retrieves a shape by name.
      * @param name Logical shape name.
      * @return Pointer to the stored shape, or `nullptr` when not found.
      */
-    ShapeBase* get(const QString& name) const;
+    ShapeBase* get(const QString& name) const { return get(handle(name)); }
+
+    /**
+     * @brief Removes a shape from the repository without destroying it; its handle becomes stale.
+     * @param handle Shape handle.
+     * @return Removed shape whose ownership returns to the caller, or `nullptr` when not found.
+     */
+    ShapeBase* take(ShapeHandle handle);
+
+    /**
+     * @brief Returns the number of stored shapes.
+     */
+    int size() const { return m_names.size(); }
+
+    /**
+     * @brief Lists the names of all stored shapes in handle order.
+     */
+    QStringList names() const;
+
+    /**
+     * @brief Invokes @p fn for the handle of every stored shape in handle order.
+     * @param fn Callable `fn(ShapeHandle)`.
+     */
+    template <typename Fn>
+    void forEachHandle(Fn fn) const
+    {
+        for (int i = 0; i < m_names.capacity(); ++i) {
+            const ShapeHandle h = m_names.handleAt(i);
+            if (!h.isNull()) fn(h);
+        }
+    }
+
+    /**
+     * @brief Describes a shape as the scene store records it.
+     *
+     * A translated instance shares its prototype's vertex array and adds only its offset,
+     * so history deltas built from the record copy no vertices either.
+     * @param handle Shape handle.
+     * @return Record, or an empty record when the handle is stale.
+     */
+    ShapeRecord record(ShapeHandle handle) const;
+
+    /**
+     * @brief Provides the per-kind value table mirroring the stored shapes.
+     */
+    const ShapeTable& table() const { return m_table; }
+
+    /**
+     * @brief Provides the index of connections between stored shapes.
+     */
+    ConnectionIndex& connections() { return m_connections; }
+
+    /**
+     * @brief Provides read-only access to the connection index.
+     */
+    const ConnectionIndex& connections() const { return m_connections; }
+
+    /**
+     * @brief Replaces a shape's vertices and propagates the change to the store and connectors.
+     * @param handle Shape handle.
+     * @param points New vertices; must match the shape's vertex count.
+     * @return `true` when the shape exists.
+     */
+    bool updateGeometry(ShapeHandle handle, const QVector<QPointF>& points);
+
+    /**
+     * @brief Recomputes the connectors incident to a shape after its geometry changed.
+     *
+     * Only the connectors attached to @p handle are touched, so the cost is O(degree).
+     * @param handle Shape whose center moved.
+     */
+    void refreshConnectors(ShapeHandle handle);
+
+    /**
+     * @brief Captures an immutable snapshot of all stored shapes and their connections.
+     *
+     * The shapes are shared with the store in O(1); the connections are copied as pairs of
+     * record slots in O(edges).
+     * @return Snapshot that may be read from any thread.
+     */
+    SceneSnapshot snapshot() const;
+
+    /**
+     * @brief Returns the current scene version, usable as a checkpoint.
+     */
+    quint64 version() const { return m_store.version(); }
+
+    /**
+     * @brief Returns a counter that changes whenever a shape or a connection changes.
+     *
+     * Unlike `version()` it also moves on `connect` and `disconnect`, so it tells whether a
+     * save or a cached graph query is out of date.
+     */
+    quint64 revision() const { return m_store.version() + m_connections.version(); }
+
+    /**
+     * @brief Lists the changes applied after a checkpoint.
+     * @param version Checkpoint obtained from `version()`.
+     * @param changes Receives the changes in application order.
+     * @return `false` when the checkpoint's changes are no longer retained.
+     */
+    bool changesSince(quint64 version, QVector<SceneChange>& changes) const
+    {
+        return m_store.changesSince(version, m_names, changes);
+    }
+
+    /**
+     * @brief Keeps the changes after @p version available; older ones may be discarded.
+     * @param version Oldest checkpoint still held, or `SceneStore::kRetainNone`.
+     */
+    void retainChangesSince(quint64 version) { m_store.retainChangesSince(version); }
+
+    /**
+     * @brief Fills the shape, vertex, item, name, index and connector parts of a memory report.
+     *
+     * Per-type sums are kept up to date by `add()` and `take()`, so this is O(1) apart from
+     * the connector batches.
+     * @param report Report whose `ShapeObjects` to `Connectors` subsystems and type rows are set.
+     */
+    void measure(MemoryStats::Report& report) const;
 
 private:
-    QMap<QString, ShapeBase*> m_items;
+    void tally(const ShapeBase* shape, int sign);
+
+    NamePool m_names;
+    std::vector<ShapeBase*> m_shapes; ///< Indexed by handle index; `nullptr` for free slots.
+    SceneStore m_store;
+    ShapeTable m_table;
+    ConnectionIndex m_connections;
+    MemoryStats::Report::Type m_usage[MemoryStats::Report::kTypeCount]; ///< Count and usage per report type row.
 };
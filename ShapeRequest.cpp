@@ -0,0 +1,192 @@
+/**
+ * @file ShapeRequest.cpp
+ * @brief Implements the scene-independent validation of `create_*` commands.
+ * @author Nikol Grigoryan
+ */
+#include "ShapeRequest.h"
+#include <QtMath>
+#include "Utility.h"
+
+namespace {
+
+/**
+ * @brief Fetches a required coordinate, reporting it by flag name when missing.
+ */
+bool requireCoord(const Command& cmd, const QString& key, QPointF& out, QString& msg)
+{
+    if (!cmd.coords.contains(key)) {
+        msg = QString("Missing -%1 coordinate.").arg(key);
+        return false;
+    }
+    out = cmd.coords[key];
+    return true;
+}
+
+/**
+ * @brief Reports whether all four corner coordinates are present.
+ */
+bool hasFourCorners(const Command& cmd)
+{
+    return cmd.coords.contains("coord_1") && cmd.coords.contains("coord_2")
+        && cmd.coords.contains("coord_3") && cmd.coords.contains("coord_4");
+}
+
+} // namespace
+
+/**
+ * @brief Matches the four shape creation commands.
+ */
+bool ShapeRequest::isCreateCommand(const QString& command)
+{
+    return command == "create_line" || command == "create_triangle"
+        || command == "create_rectangle" || command == "create_square";
+}
+
+/**
+ * @brief Retrieves and validates the `-name` flag.
+ */
+bool ShapeRequest::readName(const Command& cmd, QString& nameOut, QString& msg)
+{
+    if (!cmd.args.contains("name")) {
+        msg = "Missing -name flag.";
+        return false;
+    }
+    nameOut = cmd.args["name"].trimmed();
+    if (nameOut.isEmpty()) {
+        msg = "Name cannot be empty.";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Checks the coordinates per command and derives the final vertex list.
+ *
+ * Rectangles and squares accept either four vertices or a diagonal; the diagonal form is
+ * expanded to four corners here, so the shape is built the same way in both cases.
+ */
+bool ShapeRequest::fromCommand(const Command& cmd, const QString& name, ShapeRequest& out, QString& msg)
+{
+    out = ShapeRequest{};
+    out.name = name;
+
+    if (cmd.name == "create_line") {
+        // Expect: create_line -name NAME -coord_1 {x,y} -coord_2 {x,y}
+        QPointF p1, p2;
+        if (!requireCoord(cmd, "coord_1", p1, msg)) return false;
+        if (!requireCoord(cmd, "coord_2", p2, msg)) return false;
+        out.kind = ShapeKind::Line;
+        out.points = { p1, p2 };
+        return true;
+    }
+
+    if (cmd.name == "create_triangle") {
+        // Expect: create_triangle -name NAME -coord_1 -coord_2 -coord_3
+        QPointF p1, p2, p3;
+        if (!requireCoord(cmd, "coord_1", p1, msg)) return false;
+        if (!requireCoord(cmd, "coord_2", p2, msg)) return false;
+        if (!requireCoord(cmd, "coord_3", p3, msg)) return false;
+
+        // Simple non-degenerate validation
+        if (Utility::areCollinear(p1, p2, p3)) {
+            msg = "Triangle vertices are collinear. Provide non-collinear points.";
+            return false;
+        }
+        out.kind = ShapeKind::Triangle;
+        out.points = { p1, p2, p3 };
+        return true;
+    }
+
+    if (cmd.name == "create_rectangle") {
+        // Supports two forms:
+        // 1) Diagonal: -coord_1, -coord_2 (axis-aligned rectangle)
+        // 2) Four corners: -coord_1..-coord_4 (validated as rectangle)
+        out.kind = ShapeKind::Rectangle;
+        if (hasFourCorners(cmd)) {
+            const QPointF p1 = cmd.coords["coord_1"], p2 = cmd.coords["coord_2"];
+            const QPointF p3 = cmd.coords["coord_3"], p4 = cmd.coords["coord_4"];
+            if (!Utility::isRectangle(p1, p2, p3, p4)) {
+                msg = "Provided corners do not form a rectangle.";
+                return false;
+            }
+            out.points = { p1, p2, p3, p4 };
+            return true;
+        }
+
+        QPointF p1, p2;
+        if (!requireCoord(cmd, "coord_1", p1, msg)) return false;
+        if (!requireCoord(cmd, "coord_2", p2, msg)) return false;
+        if (qFuzzyCompare(p1.x(), p2.x()) || qFuzzyCompare(p1.y(), p2.y())) {
+            msg = "Diagonal points must differ in both x and y for a valid rectangle.";
+            return false;
+        }
+        out.form = Form::Diagonal;
+        out.points = Utility::toPointVector<4>(Geometry::axisAlignedRect(Utility::toVec(p1), Utility::toVec(p2)));
+        return true;
+    }
+
+    if (cmd.name == "create_square") {
+        // Supports two forms:
+        // 1) Diagonal: -coord_1, -coord_2 (validated equal side lengths)
+        // 2) Four vertices: -coord_1..-coord_4 (validated equal sides and right angles)
+        out.kind = ShapeKind::Square;
+        if (hasFourCorners(cmd)) {
+            const QPointF p1 = cmd.coords["coord_1"], p2 = cmd.coords["coord_2"];
+            const QPointF p3 = cmd.coords["coord_3"], p4 = cmd.coords["coord_4"];
+            if (!Utility::isSquare(p1, p2, p3, p4)) {
+                msg = "Provided vertices do not form a square.";
+                return false;
+            }
+            out.points = { p1, p2, p3, p4 };
+            return true;
+        }
+
+        QPointF p1, p2;
+        if (!requireCoord(cmd, "coord_1", p1, msg)) return false;
+        if (!requireCoord(cmd, "coord_2", p2, msg)) return false;
+        if (!Utility::isValidSquareDiagonal(p1, p2)) {
+            msg = "Diagonal points do not define a valid square.";
+            return false;
+        }
+        out.form = Form::Diagonal;
+        out.points = Utility::toPointVector<4>(Geometry::squareFromDiagonal(Utility::toVec(p1), Utility::toVec(p2)));
+        return true;
+    }
+
+    msg = QString("'%1' is not a create command.").arg(cmd.name);
+    return false;
+}
+
+/**
+ * @brief Delegates to `ShapeBase::create`; the vertex count always matches the kind.
+ */
+ShapeBase* ShapeRequest::build() const
+{
+    return ShapeBase::create(kind, points);
+}
+
+/**
+ * @brief Picks the per-kind result code; the message is only formatted if someone shows it.
+ */
+void ShapeRequest::describeSuccess(CommandResult& result) const
+{
+    using Code = CommandResult::Code;
+    const bool diagonal = form == Form::Diagonal;
+    switch (kind) {
+    case ShapeKind::Line:
+        result.code = Code::LineCreated;
+        result.first = points[0];
+        result.second = points[1];
+        break;
+    case ShapeKind::Triangle:
+        result.code = Code::TriangleCreated;
+        break;
+    case ShapeKind::Rectangle:
+        result.code = diagonal ? Code::RectangleCreatedDiagonal : Code::RectangleCreated;
+        break;
+    case ShapeKind::Square:
+        result.code = diagonal ? Code::SquareCreatedDiagonal : Code::SquareCreated;
+        break;
+    }
+    result.subject = name;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file ShapeRequest.h
+ * @brief Declares the scene-independent validation of `create_*` commands.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <QPointF>
+#include "CommandParser.h"
+#include "CommandResult.h"
+#include "ShapeBase.h"
+
+/**
+ * @struct ShapeRequest
+ * @brief Fully validated description of a shape a `create_*` command asks for.
+ *
+ * Building a request only reads the command, so it is safe on any thread. Name
+ * uniqueness is not checked here because it depends on the scene; the dispatcher and
+ * the script validator each check it against their own view of the defined names.
+ */
+struct ShapeRequest
+{
+    /**
+     * @brief How the command specified the shape's geometry.
+     */
+    enum class Form : quint8
+    {
+        Vertices, ///< Every vertex was given.
+        Diagonal  ///< Two opposite corners were given and the rest derived.
+    };
+
+    QString name;                       ///< Shape name.
+    ShapeKind kind = ShapeKind::Line;   ///< Requested kind.
+    Form form = Form::Vertices;         ///< Input form, used for the success result.
+    QVector<QPointF> points;            ///< Final vertices in construction order.
+
+    /**
+     * @brief Tests whether a command name is one of the `create_*` commands.
+     */
+    static bool isCreateCommand(const QString& command);
+
+    /**
+     * @brief Reads the non-empty `-name` flag of a command.
+     * @param nameOut Receives the trimmed name.
+     * @param msg Describes a missing or empty name.
+     */
+    static bool readName(const Command& cmd, QString& nameOut, QString& msg);
+
+    /**
+     * @brief Validates the coordinates and geometry of a `create_*` command.
+     * @param cmd Parsed `create_*` command.
+     * @param name Name already read with `readName`.
+     * @param out Receives the request on success.
+     * @param msg Describes the first problem on failure.
+     * @return `true` when the command describes a valid shape.
+     */
+    static bool fromCommand(const Command& cmd, const QString& name, ShapeRequest& out, QString& msg);
+
+    /**
+     * @brief Constructs the shape object; no scene or repository is touched.
+     * @return New shape owned by the caller.
+     */
+    ShapeBase* build() const;
+
+    /**
+     * @brief Sets the result code and payload reported once the shape has been created.
+     * @param result Result whose `code`, `subject` and, for lines, endpoints are set.
+     */
+    void describeSuccess(CommandResult& result) const;
+};
@@ -0,0 +1,207 @@
+/**
+ * @file ShapeTable.cpp
+ * @brief Implements the shape value model and the per-kind shape table.
+ * @author Nikol Grigoryan
+ */
+#include "ShapeTable.h"
+#include "InstanceLayerItem.h"
+#include "Utility.h"
+#include <QtMath>
+#include <algorithm>
+
+namespace {
+
+/**
+ * @brief Builds a shape value of type @p T, checking the vertex count.
+ */
+template <typename T>
+ShapeModel::Shape makeAs(const QVector<QPointF>& points, bool* ok)
+{
+    const bool valid = points.size() == T::kVertexCount;
+    if (ok) *ok = valid;
+    T shape;
+    if (valid) shape.pts = Utility::toPoints<T::kVertexCount>(points);
+    return shape;
+}
+
+} // namespace
+
+namespace ShapeModel {
+
+/**
+ * @brief Dispatches on the kind once and converts the vertices into a fixed-size array.
+ */
+Shape make(ShapeKind kind, const QVector<QPointF>& points, bool* ok)
+{
+    switch (kind) {
+    case ShapeKind::Line: return makeAs<Line>(points, ok);
+    case ShapeKind::Triangle: return makeAs<Triangle>(points, ok);
+    case ShapeKind::Rectangle: return makeAs<Rectangle>(points, ok);
+    case ShapeKind::Square: return makeAs<Square>(points, ok);
+    }
+    if (ok) *ok = false;
+    return Line{};
+}
+
+/**
+ * @brief Visits the variant; every alternative computes its centroid inline.
+ */
+QPointF center(const Shape& shape)
+{
+    return std::visit([](const auto& s) { return Utility::toPointF(s.center()); }, shape);
+}
+
+} // namespace ShapeModel
+
+/**
+ * @brief Appends the shape to the array of its kind and records its location.
+ */
+bool ShapeTable::insert(ShapeHandle handle, ShapeKind kind, const QVector<QPointF>& points)
+{
+    bool ok = false;
+    const ShapeModel::Shape shape = ShapeModel::make(kind, points, &ok);
+    if (!ok) return false;
+
+    const size_t slot = size_t(handle.index());
+    if (slot >= m_locations.size()) m_locations.resize(slot + 1);
+    std::visit([&](const auto& s) {
+        auto& c = column<std::decay_t<decltype(s)>>();
+        m_locations[slot] = Location{ handle, kind, static_cast<int>(c.items.size()) };
+        c.items.push_back(s);
+        c.handles.push_back(handle);
+    }, shape);
+    ++m_size;
+    return true;
+}
+
+/**
+ * @brief Appends a reference to the instance's layer slot and records its location.
+ */
+void ShapeTable::insertInstance(ShapeHandle handle, const InstanceLayerItem* layer, int slot)
+{
+    const size_t i = size_t(handle.index());
+    if (i >= m_locations.size()) m_locations.resize(i + 1);
+    m_locations[i] = Location{ handle, layer->kind(), static_cast<int>(m_instances.size()), true };
+    m_instances.push_back(InstanceRef{ layer, slot, handle });
+    ++m_size;
+}
+
+/**
+ * @brief Removes the shape by moving the last shape of the same kind into its slot.
+ */
+bool ShapeTable::erase(ShapeHandle handle)
+{
+    const Location* location = locate(handle);
+    if (!location) return false;
+    const Location loc = *location;
+    m_locations[size_t(handle.index())] = Location{};
+    --m_size;
+
+    if (loc.instance) {
+        const int last = static_cast<int>(m_instances.size()) - 1;
+        if (loc.index != last) {
+            m_instances[size_t(loc.index)] = m_instances[size_t(last)];
+            m_locations[size_t(m_instances[size_t(loc.index)].handle.index())].index = loc.index;
+        }
+        m_instances.pop_back();
+        return true;
+    }
+    switch (loc.kind) {
+    case ShapeKind::Line: eraseAt<ShapeModel::Line>(loc.index); break;
+    case ShapeKind::Triangle: eraseAt<ShapeModel::Triangle>(loc.index); break;
+    case ShapeKind::Rectangle: eraseAt<ShapeModel::Rectangle>(loc.index); break;
+    case ShapeKind::Square: eraseAt<ShapeModel::Square>(loc.index); break;
+    }
+    return true;
+}
+
+/**
+ * @brief Swap-removes element @p index of the array for @p T and re-points the moved shape.
+ */
+template <typename T>
+void ShapeTable::eraseAt(int index)
+{
+    Column<T>& c = column<T>();
+    const int last = static_cast<int>(c.items.size()) - 1;
+    if (index != last) {
+        c.items[index] = c.items[last];
+        c.handles[index] = c.handles[last];
+        m_locations[size_t(c.handles[index].index())].index = index;
+    }
+    c.items.pop_back();
+    c.handles.pop_back();
+}
+
+/**
+ * @brief Overwrites the vertices in place.
+ */
+bool ShapeTable::update(ShapeHandle handle, const QVector<QPointF>& points)
+{
+    const Location* location = locate(handle);
+    if (!location) return false;
+    const Location loc = *location;
+    if (loc.instance) return true;
+
+    bool ok = false;
+    const ShapeModel::Shape shape = ShapeModel::make(loc.kind, points, &ok);
+    if (!ok) return false;
+
+    std::visit([&](const auto& s) {
+        column<std::decay_t<decltype(s)>>().items[loc.index] = s;
+    }, shape);
+    return true;
+}
+
+/**
+ * @brief Copies the stored shape into a variant.
+ */
+ShapeModel::Shape ShapeTable::value(ShapeHandle handle, bool* found) const
+{
+    ShapeModel::Shape result;
+    const bool exists = visit(handle, [&result](const auto& s) { result = s; });
+    if (found) *found = exists;
+    return result;
+}
+
+/**
+ * @brief Builds the value of an instance from its layer.
+ */
+ShapeModel::Shape ShapeTable::instanceValue(int index) const
+{
+    const InstanceRef& ref = m_instances[size_t(index)];
+    return ShapeModel::make(ref.layer->kind(), ref.layer->vertices(ref.slot));
+}
+
+/**
+ * @brief Looks up the handle and computes the centroid of the stored vertices; instances ask their layer.
+ */
+QPointF ShapeTable::center(ShapeHandle handle, bool* found) const
+{
+    const Location* location = locate(handle);
+    if (location && location->instance) {
+        if (found) *found = true;
+        const InstanceRef& ref = m_instances[size_t(location->index)];
+        return ref.layer->center(ref.slot);
+    }
+    QPointF result;
+    const bool exists = visit(handle, [&result](const auto& s) { result = Utility::toPointF(s.center()); });
+    if (found) *found = exists;
+    return result;
+}
+
+/**
+ * @brief Folds the per-shape bounds over every array.
+ */
+QRectF ShapeTable::bounds() const
+{
+    if (m_size == 0) return QRectF();
+
+    Geometry::Vec2<double> lo{ qInf(), qInf() };
+    Geometry::Vec2<double> hi{ -qInf(), -qInf() };
+    forEach([&lo, &hi](ShapeHandle, const auto& s) {
+        const Geometry::Points<double, 2> b = s.bounds();
+        lo = { std::min(lo.x, b[0].x), std::min(lo.y, b[0].y) };
+        hi = { std::max(hi.x, b[1].x), std::max(hi.y, b[1].y) };
+    });
+    return QRectF(Utility::toPointF(lo), Utility::toPointF(hi));
+}
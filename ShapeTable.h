@@ -0,0 +1,270 @@
+/**
+ * @file ShapeTable.h
+ * @brief Declares the closed value model of shapes and its per-kind contiguous table.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <QPointF>
+#include <QRectF>
+#include <tuple>
+#include <utility>
+#include <variant>
+#include <vector>
+#include "GeometryCore.h"
+#include "MemoryStats.h"
+#include "ShapeBase.h"
+#include "ShapeHandle.h"
+
+class InstanceLayerItem;
+
+/**
+ * @namespace ShapeModel
+ * @brief Plain value types for every shape kind.
+ *
+ * Unlike the `ShapeBase` hierarchy these carry no graphics item and no virtual functions;
+ * the set of kinds is closed, so code can dispatch on them at compile time.
+ */
+namespace ShapeModel {
+
+/**
+ * @brief Geometry of one shape kind with a fixed number of vertices.
+ */
+template <ShapeKind K, int N>
+struct Polygon
+{
+    static constexpr ShapeKind kKind = K;   ///< Kind represented by the type.
+    static constexpr int kVertexCount = N;  ///< Number of defining vertices.
+
+    Geometry::Points<double, N> pts{};      ///< Vertices in construction order.
+
+    /**
+     * @brief Returns the vertex centroid, which is the center used by connectors.
+     */
+    constexpr Geometry::Vec2<double> center() const { return Geometry::centroid(pts); }
+
+    /**
+     * @brief Returns the `{min, max}` corners of the bounding box.
+     */
+    constexpr Geometry::Points<double, 2> bounds() const { return Geometry::bounds(pts); }
+};
+
+using Line = Polygon<ShapeKind::Line, 2>;
+using Triangle = Polygon<ShapeKind::Triangle, 3>;
+using Rectangle = Polygon<ShapeKind::Rectangle, 4>;
+using Square = Polygon<ShapeKind::Square, 4>;
+
+/**
+ * @brief Any shape, held by value.
+ */
+using Shape = std::variant<Line, Triangle, Rectangle, Square>;
+
+/**
+ * @brief Builds a shape value from a kind and its vertices.
+ * @param ok Set to `false` when the vertex count does not match the kind.
+ */
+Shape make(ShapeKind kind, const QVector<QPointF>& points, bool* ok = nullptr);
+
+/**
+ * @brief Returns the center of any shape value.
+ */
+QPointF center(const Shape& shape);
+
+} // namespace ShapeModel
+
+/**
+ * @class ShapeTable
+ * @brief Stores shape values contiguously, one array per kind, with handle lookup.
+ *
+ * Whole-scene passes iterate each array directly, so every call is resolved statically
+ * and the data is read sequentially, instead of one virtual call and pointer chase per
+ * `ShapeBase`. A shape is located through an array indexed by its `ShapeHandle`, holding
+ * its kind and position. Erasing swaps the last element of the array into the hole, so
+ * arrays stay dense and only the moved shape's location changes.
+ *
+ * Instances are not copied into the value arrays: each is a `{layer, slot}` reference into
+ * the `InstanceLayerItem` that draws it, and its value is computed from the layer on demand.
+ */
+class ShapeTable
+{
+public:
+    /**
+     * @brief Inserts a shape under a new handle.
+     * @param handle Shape handle; must not be stored already.
+     * @param kind Shape kind.
+     * @param points Vertices in construction order.
+     * @return `false` when the vertex count does not match the kind.
+     */
+    bool insert(ShapeHandle handle, ShapeKind kind, const QVector<QPointF>& points);
+
+    /**
+     * @brief Inserts an instance as a reference to its layer slot.
+     * @param handle Shape handle; must not be stored already.
+     * @param layer Layer drawing the instance; must outlive the entry.
+     * @param slot Live slot of the instance in @p layer.
+     */
+    void insertInstance(ShapeHandle handle, const InstanceLayerItem* layer, int slot);
+
+    /**
+     * @brief Removes a shape.
+     * @return `false` when no shape has the handle.
+     */
+    bool erase(ShapeHandle handle);
+
+    /**
+     * @brief Replaces the vertices of a shape, keeping its kind; instances read theirs from the layer.
+     * @return `false` when the shape is unknown or the vertex count does not match.
+     */
+    bool update(ShapeHandle handle, const QVector<QPointF>& points);
+
+    /**
+     * @brief Tests whether a shape with the handle is stored.
+     */
+    bool contains(ShapeHandle handle) const { return locate(handle) != nullptr; }
+
+    /**
+     * @brief Returns the number of stored shapes.
+     */
+    int size() const { return m_size; }
+
+    /**
+     * @brief Returns a copy of a shape as a variant.
+     * @param found Set to `false` when no shape has the handle.
+     */
+    ShapeModel::Shape value(ShapeHandle handle, bool* found = nullptr) const;
+
+    /**
+     * @brief Returns the center of a shape without going through `ShapeBase`.
+     * @param found Set to `false` when no shape has the handle.
+     */
+    QPointF center(ShapeHandle handle, bool* found = nullptr) const;
+
+    /**
+     * @brief Returns the bounding box of all stored shapes, or a null rectangle when empty.
+     */
+    QRectF bounds() const;
+
+    /**
+     * @brief Returns the bytes reserved by the per-kind value arrays.
+     */
+    qsizetype vertexBytes() const
+    {
+        return std::apply([](const auto&... columns) {
+            return (qsizetype(0) + ... + MemoryStats::capacityBytes(columns.items));
+        }, m_columns);
+    }
+
+    /**
+     * @brief Returns the bytes reserved by the handle arrays, the location array and the instance references.
+     */
+    qsizetype indexBytes() const
+    {
+        return std::apply([](const auto&... columns) {
+            return (qsizetype(0) + ... + MemoryStats::capacityBytes(columns.handles));
+        }, m_columns) + MemoryStats::capacityBytes(m_locations) + MemoryStats::capacityBytes(m_instances);
+    }
+
+    /**
+     * @brief Invokes @p fn on the stored shape with the given handle.
+     * @param fn Generic callable accepting `const T&` for every shape type `T`.
+     * @return `false` when no shape has the handle.
+     */
+    template <typename Fn>
+    bool visit(ShapeHandle handle, Fn&& fn) const
+    {
+        const Location* location = locate(handle);
+        if (!location) return false;
+        const Location loc = *location;
+        if (loc.instance) {
+            std::visit(fn, instanceValue(loc.index));
+            return true;
+        }
+        switch (loc.kind) {
+        case ShapeKind::Line: fn(column<ShapeModel::Line>().items[loc.index]); break;
+        case ShapeKind::Triangle: fn(column<ShapeModel::Triangle>().items[loc.index]); break;
+        case ShapeKind::Rectangle: fn(column<ShapeModel::Rectangle>().items[loc.index]); break;
+        case ShapeKind::Square: fn(column<ShapeModel::Square>().items[loc.index]); break;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Invokes @p fn for every stored shape, one kind after the other, then for the instances.
+     * @param fn Generic callable accepting `(ShapeHandle handle, const T& shape)`.
+     */
+    template <typename Fn>
+    void forEach(Fn&& fn) const
+    {
+        std::apply([&fn](const auto&... columns) {
+            (forEachIn(columns, fn), ...);
+        }, m_columns);
+        for (int i = 0; i < static_cast<int>(m_instances.size()); ++i) {
+            const ShapeHandle handle = m_instances[size_t(i)].handle;
+            std::visit([&fn, handle](const auto& s) { fn(handle, s); }, instanceValue(i));
+        }
+    }
+
+private:
+    /**
+     * @brief Location of a shape: its kind's array and the index within it.
+     */
+    struct Location
+    {
+        ShapeHandle handle;   ///< Handle stored here; a stale handle does not match.
+        ShapeKind kind = ShapeKind::Line;
+        int index = -1;
+        bool instance = false; ///< `index` points into `m_instances`.
+    };
+
+    /**
+     * @brief Instance entry: the layer slot that holds its placement.
+     */
+    struct InstanceRef
+    {
+        const InstanceLayerItem* layer = nullptr;
+        int slot = -1;
+        ShapeHandle handle;
+    };
+
+    /**
+     * @brief Dense array of one shape type with the parallel array of handles.
+     */
+    template <typename T>
+    struct Column
+    {
+        std::vector<T> items;
+        std::vector<ShapeHandle> handles;
+    };
+
+    template <typename T, typename Fn>
+    static void forEachIn(const Column<T>& c, Fn& fn)
+    {
+        for (size_t i = 0; i < c.items.size(); ++i) fn(c.handles[i], c.items[i]);
+    }
+
+    const Location* locate(ShapeHandle handle) const
+    {
+        const size_t i = size_t(handle.index());
+        if (handle.isNull() || i >= m_locations.size() || m_locations[i].handle != handle) return nullptr;
+        return &m_locations[i];
+    }
+
+    template <typename T>
+    Column<T>& column() { return std::get<Column<T>>(m_columns); }
+
+    template <typename T>
+    const Column<T>& column() const { return std::get<Column<T>>(m_columns); }
+
+    template <typename T>
+    void eraseAt(int index);
+
+    ShapeModel::Shape instanceValue(int index) const;
+
+    std::tuple<Column<ShapeModel::Line>, Column<ShapeModel::Triangle>,
+               Column<ShapeModel::Rectangle>, Column<ShapeModel::Square>> m_columns;
+    std::vector<Location> m_locations; ///< Indexed by handle index.
+    std::vector<InstanceRef> m_instances;
+    int m_size = 0;
+};
@@ -21,18 +21,21 @@ class SquareShape : public ShapeBase
 public:
     /**
      * @brief Builds a square using its diagonal endpoints.
-     * @param name Logical identifier registered in the repository.
      * @param d1 First diagonal endpoint.
      * @param d2 Opposite diagonal endpoint.
      */
-    SquareShape(const QString& name, const QPointF& d1, const QPointF& d2);
+    SquareShape(const QPointF& d1, const QPointF& d2);
 
     /**
      * @brief Builds a square using four pre-validated vertices.
-     * @param name Logical identifier registered in the repository.
      * @param vertices Sequence of square vertices.
      */
-    SquareShape(const QString& name, const QVector<QPointF>& vertices);
+    explicit SquareShape(const QVector<QPointF>& vertices);
+
+    /**
+     * @brief Deletes the graphics item, which also removes it from its scene.
+     */
+    ~SquareShape() override;
 
     /**
      * @brief Provides the underlying polygon item for rendering.
@@ -46,7 +49,35 @@ public:
      */
     QPointF center() const override;
 
+    /**
+     * @brief Identifies the shape as a square.
+     * @return `ShapeKind::Square`.
+     */
+    ShapeKind kind() const override { return ShapeKind::Square; }
+
+    /**
+     * @brief Returns the stored vertices.
+     * @return Vertices in construction order.
+     */
+    QVector<QPointF> vertices() const override { return m_pts; }
+
+    /**
+     * @brief Replaces the vertices and updates the polygon item and cached center.
+     * @param points New vertices in the same order as `vertices()`.
+     */
+    void setVertices(const QVector<QPointF>& points) override;
+
+    /**
+     * @brief Counts the object, the vertex array it shares with its item and scene record, and the item.
+     */
+    MemoryStats::ShapeUsage memoryUsage() const override
+    {
+        return { sizeof(SquareShape), m_pts.size() * qint64(sizeof(QPointF)),
+                 sizeof(QGraphicsPolygonItem) + MemoryStats::kItemPrivateBytes };
+    }
+
 private:
     QGraphicsPolygonItem* m_item;
     QVector<QPointF> m_pts;
+    QPointF m_center;
 };
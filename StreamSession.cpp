@@ -0,0 +1,300 @@
+/**
+ * @file StreamSession.cpp
+ * @brief Implements the session that executes commands streamed on standard input.
+ * @author Nikol Grigoryan
+ */
+#include "StreamSession.h"
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QGraphicsScene>
+#include <QImage>
+#include <QPainter>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "CommandDispatcher.h"
+#include "CommandQueue.h"
+#include "SceneSaver.h"
+#include "ShapeRepository.h"
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+/**
+ * @brief Reads whatever stdin has available, up to @p size bytes, blocking only while it has nothing.
+ * @return Bytes read; `0` at end of input or on error.
+ */
+qint64 readStdin(char* buffer, int size)
+{
+#ifdef Q_OS_WIN
+    return std::max(0, _read(0, buffer, static_cast<unsigned>(size)));
+#else
+    ssize_t n;
+    do {
+        n = ::read(STDIN_FILENO, buffer, static_cast<size_t>(size));
+    } while (n < 0 && errno == EINTR);
+    return std::max<ssize_t>(0, n);
+#endif
+}
+
+} // namespace
+
+/**
+ * @brief State shared with the reader thread, which may outlive the session.
+ */
+struct StreamSession::Shared
+{
+    CommandQueue queue{kQueueCapacity};
+    std::mutex lineMutex;
+    std::deque<qint64> lineNumbers;    ///< Input line of each queued command, in queue order.
+    std::atomic<qint64> linesRead{0};
+    std::atomic<qint64> parseErrors{0};
+    std::atomic<bool> eof{false};      ///< Every line has been read and queued.
+    std::atomic<bool> stopping{false}; ///< The session is gone; the reader should exit.
+    StreamSession* owner = nullptr;    ///< GUI thread only.
+
+    /**
+     * @brief Asks the GUI thread to drain, if the session still exists when the call runs.
+     */
+    static void wake(const std::weak_ptr<Shared>& weak)
+    {
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [weak]() {
+            const std::shared_ptr<Shared> shared = weak.lock();
+            if (shared && shared->owner) shared->owner->drain();
+        }, Qt::QueuedConnection);
+    }
+};
+
+/**
+ * @brief Stores the collaborators; the reader starts in `start()`.
+ */
+StreamSession::StreamSession(CommandDispatcher& dispatcher, QGraphicsScene* scene, const ShapeRepository& repo,
+                             const QString& exportPath, bool quitAtEnd, QObject* parent)
+    : QObject(parent), m_dispatcher(dispatcher), m_scene(scene), m_repo(repo),
+      m_exportPath(exportPath), m_quitAtEnd(quitAtEnd), m_shared(std::make_shared<Shared>())
+{
+    m_shared->owner = this;
+    const std::weak_ptr<Shared> weak = m_shared;
+    m_shared->queue.setWakeCallback([weak]() { Shared::wake(weak); });
+    connect(&m_progressTimer, &QTimer::timeout, this, [this]() { reportProgress("progress"); });
+}
+
+/**
+ * @brief Joins a finished reader; one still blocked on stdin is detached and exits with the process.
+ */
+StreamSession::~StreamSession()
+{
+    m_shared->owner = nullptr;
+    m_shared->stopping.store(true);
+    if (!m_reader.joinable()) return;
+    if (m_shared->eof.load()) {
+        m_reader.join();
+    } else {
+        m_reader.detach();
+    }
+}
+
+/**
+ * @brief Launches the reader thread.
+ */
+void StreamSession::start()
+{
+    m_clock.start();
+    m_progressTimer.start(kProgressIntervalMs);
+    m_reader = std::thread(&StreamSession::readLoop, m_shared);
+}
+
+/**
+ * @brief Splits chunks into lines without copying complete lines, parses and queues them.
+ */
+void StreamSession::readLoop(std::shared_ptr<Shared> shared)
+{
+    const CommandParser parser;
+    std::vector<char> chunk(kChunkBytes);
+    QByteArray partial; // Start of a line continued in the next chunk
+    bool skipping = false; // Inside a line that exceeded kMaxLineBytes
+    qint64 lineNo = 0;
+    QString text;
+
+    // Returns false when the session is gone
+    const auto handleLine = [&](const char* data, int size) {
+        ++lineNo;
+        shared->linesRead.store(lineNo, std::memory_order_relaxed);
+        text = QString::fromUtf8(data, size);
+        const QStringView line = QStringView(text).trimmed();
+        if (line.isEmpty() || line.startsWith('#')) return true;
+
+        Command cmd;
+        QString error;
+        if (!parser.parse(line, cmd, error)) {
+            shared->parseErrors.fetch_add(1, std::memory_order_relaxed);
+            std::fprintf(stderr, "Line %lld: Parse error: %s\n", lineNo, qPrintable(error));
+            return true;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(shared->lineMutex);
+            shared->lineNumbers.push_back(lineNo);
+        }
+        // A full queue stops reading, so the writer of the stream blocks on the pipe
+        while (!shared->queue.trySubmit(cmd, nullptr)) {
+            if (shared->stopping.load()) return false;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        return true;
+    };
+    const auto tooLong = [&]() {
+        shared->parseErrors.fetch_add(1, std::memory_order_relaxed);
+        std::fprintf(stderr, "Line %lld: Line exceeds %d bytes; skipped.\n", lineNo + 1, kMaxLineBytes);
+        partial.clear();
+        skipping = true;
+    };
+
+    while (!shared->stopping.load()) {
+        const qint64 n = readStdin(chunk.data(), kChunkBytes);
+        if (n == 0) break;
+
+        const char* p = chunk.data();
+        const char* const end = p + n;
+        while (p < end) {
+            const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            if (!newline) {
+                if (!skipping && partial.size() + (end - p) > kMaxLineBytes) tooLong();
+                if (!skipping) partial.append(p, static_cast<int>(end - p));
+                break;
+            }
+
+            const int size = static_cast<int>(newline - p);
+            if (skipping) {
+                ++lineNo;
+                skipping = false;
+            } else if (partial.isEmpty()) {
+                if (!handleLine(p, size)) return;
+            } else if (partial.size() + size > kMaxLineBytes) {
+                tooLong();
+                ++lineNo;
+                skipping = false;
+            } else {
+                partial.append(p, size);
+                if (!handleLine(partial.constData(), partial.size())) return;
+                partial.clear();
+            }
+            p = newline + 1;
+        }
+    }
+
+    // The last line may lack its newline
+    if (!partial.isEmpty() && !handleLine(partial.constData(), partial.size())) return;
+    shared->eof.store(true, std::memory_order_release);
+    Shared::wake(shared);
+}
+
+/**
+ * @brief Executes a batch in input order and reports failures with their line numbers.
+ */
+void StreamSession::drain()
+{
+    if (m_finished) return;
+
+    // Read before checking the queue: once set, every command is already linked in
+    const bool eof = m_shared->eof.load(std::memory_order_acquire);
+    m_shared->queue.drain(kDrainBatch, [this](const Command& cmd) {
+        qint64 line = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_shared->lineMutex);
+            line = m_shared->lineNumbers.front();
+            m_shared->lineNumbers.pop_front();
+        }
+        CommandResult result;
+        m_dispatcher.execute(cmd, result);
+        ++m_executed;
+        if (!result.ok) {
+            ++m_failed;
+            std::fprintf(stderr, "Line %lld: %s\n", line, qPrintable(result.text()));
+        }
+        return result;
+    });
+
+    if (m_shared->queue.hasPending()) {
+        // Yield to the event loop between batches so the window stays responsive
+        QMetaObject::invokeMethod(this, [this]() { drain(); }, Qt::QueuedConnection);
+    } else if (eof) {
+        finish();
+    }
+}
+
+/**
+ * @brief Prints counts and the sustained rate so far.
+ */
+void StreamSession::reportProgress(const char* label)
+{
+    const double seconds = std::max<qint64>(1, m_clock.elapsed()) / 1000.0;
+    std::fprintf(stderr, "[stdin %s] %lld lines read, %lld commands run (%lld failed, %lld parse errors), "
+                         "%.0f commands/s, %d queued\n",
+                 label, m_shared->linesRead.load(std::memory_order_relaxed), m_executed, m_failed,
+                 m_shared->parseErrors.load(std::memory_order_relaxed), m_executed / seconds,
+                 m_shared->queue.metrics().depth);
+    std::fflush(stderr);
+}
+
+/**
+ * @brief Ends the session once every line has been executed.
+ */
+void StreamSession::finish()
+{
+    m_finished = true;
+    m_progressTimer.stop();
+    reportProgress("end of input");
+
+    int exitCode = (m_failed > 0 || m_shared->parseErrors.load() > 0) ? 1 : 0;
+    if (!m_exportPath.isEmpty()) {
+        QString error;
+        if (exportScene(m_scene, m_repo, m_exportPath, error)) {
+            std::fprintf(stderr, "Exported %d shapes to %s\n", m_repo.size(), qPrintable(m_exportPath));
+        } else {
+            std::fprintf(stderr, "%s\n", qPrintable(error));
+            exitCode = 2;
+        }
+    }
+    if (m_memoryReport) std::fprintf(stderr, "%s\n", qPrintable(m_dispatcher.memoryReport().text()));
+    std::fflush(stderr);
+    if (m_quitAtEnd) QCoreApplication::exit(exitCode);
+}
+
+/**
+ * @brief Renders the scene for image suffixes and saves a replayable script otherwise.
+ */
+bool StreamSession::exportScene(QGraphicsScene* scene, const ShapeRepository& repo, const QString& path, QString& error)
+{
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix != "png" && suffix != "jpg" && suffix != "jpeg" && suffix != "bmp") {
+        return SceneSaver::write(repo.snapshot(), path, error);
+    }
+
+    // Cap the image so a huge scene is scaled down instead of exhausting memory
+    constexpr int kMaxImageSide = 16384;
+    const QRectF bounds = scene->itemsBoundingRect().adjusted(-10, -10, 10, 10);
+    const QSize size = bounds.size().toSize().boundedTo(QSize(kMaxImageSide, kMaxImageSide)).expandedTo(QSize(1, 1));
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::white);
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    scene->render(&painter, QRectF(QPointF(0, 0), QSizeF(size)), bounds);
+    painter.end();
+
+    if (!image.save(path)) {
+        error = QString("Failed to write image: %1").arg(path);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file StreamSession.h
+ * @brief Declares the session that executes commands streamed on standard input.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QString>
+#include <QTimer>
+#include <memory>
+#include <thread>
+
+class CommandDispatcher;
+class QGraphicsScene;
+class ShapeRepository;
+
+/**
+ * @class StreamSession
+ * @brief Applies commands read from standard input while the stream is still being written.
+ *
+ * A reader thread reads stdin in fixed-size chunks, slices complete lines out of the chunk
+ * buffer, parses them with the view-based `CommandParser` overload and hands the commands
+ * to a bounded `CommandQueue`. The GUI thread executes them in batches as they arrive.
+ * Memory stays bounded however long the stream is: the reader holds one chunk plus at most
+ * one partial line, and when the queue is full it stops reading, so the producer of the
+ * stream blocks on the pipe.
+ *
+ * Parse and execution errors are reported on stderr with their line numbers, as is a
+ * progress line every `kProgressIntervalMs`. At end of input the scene is optionally
+ * exported, a summary is printed, and in headless mode the application quits.
+ */
+class StreamSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Bytes read from stdin per system call.
+     */
+    static constexpr int kChunkBytes = 64 * 1024;
+
+    /**
+     * @brief Longest accepted line; longer lines are reported and skipped.
+     */
+    static constexpr int kMaxLineBytes = 1 << 20;
+
+    /**
+     * @brief Parsed commands waiting for the GUI thread.
+     */
+    static constexpr int kQueueCapacity = 16384;
+
+    /**
+     * @brief Commands executed per event-loop turn.
+     */
+    static constexpr int kDrainBatch = 1024;
+
+    /**
+     * @brief Interval between progress lines on stderr.
+     */
+    static constexpr int kProgressIntervalMs = 1000;
+
+    /**
+     * @brief Creates a session; nothing is read until `start()`.
+     * @param dispatcher Executes the commands on the GUI thread.
+     * @param scene Scene rendered by an image export.
+     * @param repo Repository written by a script export.
+     * @param exportPath Where to export the scene at end of input; empty for no export.
+     * @param quitAtEnd Whether to quit the application at end of input (headless mode).
+     * @param parent Optional QObject parent.
+     */
+    StreamSession(CommandDispatcher& dispatcher, QGraphicsScene* scene, const ShapeRepository& repo,
+                  const QString& exportPath, bool quitAtEnd, QObject* parent = nullptr);
+
+    /**
+     * @brief Stops the reader; a reader blocked on an open stdin is left to exit with the process.
+     */
+    ~StreamSession() override;
+
+    /**
+     * @brief Prints the `mem_stats` report to stderr at end of input.
+     * @param enabled Whether the report is printed; off by default.
+     */
+    void setMemoryReport(bool enabled) { m_memoryReport = enabled; }
+
+    /**
+     * @brief Starts the reader thread and the progress timer.
+     */
+    void start();
+
+    /**
+     * @brief Writes the scene to a file: an image for `.png`, `.jpg`, `.jpeg` and `.bmp`, otherwise a command script.
+     * @param scene Scene to render.
+     * @param repo Shapes to save as a script.
+     * @param path Destination file.
+     * @param error Describes why the export failed.
+     * @return `true` when the file was written.
+     */
+    static bool exportScene(QGraphicsScene* scene, const ShapeRepository& repo, const QString& path, QString& error);
+
+private:
+    struct Shared;
+
+    /**
+     * @brief Executes one batch of queued commands; finishes the session once input is exhausted.
+     */
+    void drain();
+
+    /**
+     * @brief Prints a progress line to stderr.
+     */
+    void reportProgress(const char* label);
+
+    /**
+     * @brief Exports, prints the summary and, in headless mode, quits.
+     */
+    void finish();
+
+    /**
+     * @brief Reader thread body: chunks, lines, parsing and submission.
+     */
+    static void readLoop(std::shared_ptr<Shared> shared);
+
+    CommandDispatcher& m_dispatcher;
+    QGraphicsScene* m_scene;
+    const ShapeRepository& m_repo;
+    QString m_exportPath;
+    bool m_quitAtEnd;
+    bool m_memoryReport = false;
+
+    std::shared_ptr<Shared> m_shared;
+    std::thread m_reader;
+    QTimer m_progressTimer;
+    QElapsedTimer m_clock;
+    qint64 m_executed = 0;
+    qint64 m_failed = 0;
+    bool m_finished = false;
+};
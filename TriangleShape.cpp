@@ -6,35 +6,49 @@
 #include "TriangleShape.h"
 #include <QPen>
 #include <QBrush>
+#include "Utility.h"
 
 /**
  * @brief Constructs a triangle from three vertices.
- * @param name Unique logical name for the triangle.
  * @param p1 First vertex.
  * @param p2 Second vertex.
  * @param p3 Third vertex.
  */
-TriangleShape::TriangleShape(const QString& name, const QPointF& p1, const QPointF& p2, const QPointF& p3)
-    : ShapeBase(name), m_item(new QGraphicsPolygonItem()), m_pts{p1, p2, p3}
+TriangleShape::TriangleShape(const QPointF& p1, const QPointF& p2, const QPointF& p3)
+    : m_item(new QGraphicsPolygonItem())
 {
-    // Configure polygon points
-    QPolygonF poly;
-    poly << p1 << p2 << p3;
-    m_item->setPolygon(poly);
+    // Configure polygon points and style
+    setVertices({p1, p2, p3});
     m_item->setPen(QPen(Qt::darkGreen, 2.0));
     m_item->setBrush(QBrush(QColor(0, 180, 0, 60))); // semi-transparent fill
 }
 
 /**
- * @brief Computes the triangle centroid.
+ * @brief Releases the graphics item owned by the shape.
+ */
+TriangleShape::~TriangleShape()
+{
+    delete m_item;
+}
+
+/**
+ * @brief Returns the cached triangle centroid.
  * @return Center point of the triangle.
  */
 QPointF TriangleShape::center() const
 {
+    return m_center;
+}
+
+/**
+ * @brief Replaces the vertices and recomputes the centroid.
+ * @param points Three new vertices.
+ */
+void TriangleShape::setVertices(const QVector<QPointF>& points)
+{
+    m_pts = points;
+    m_item->setPolygon(QPolygonF(m_pts));
+
     // Centroid of triangle: average of vertices
-    const QPointF c(
-        (m_pts[0].x() + m_pts[1].x() + m_pts[2].x()) / 3.0,
-        (m_pts[0].y() + m_pts[1].y() + m_pts[2].y()) / 3.0
-    );
-    return c;
+    m_center = Utility::toPointF(Geometry::centroid(Utility::toPoints<3>(m_pts)));
 }
@@ -22,12 +22,16 @@ class TriangleShape : public ShapeBase
 public:
     /**
      * @brief Creates a triangle with three non-collinear vertices.
-     * @param name Logical identifier assigned to the triangle.
      * @param p1 First vertex.
      * @param p2 Second vertex.
      * @param p3 Third vertex.
      */
-    TriangleShape(const QString& name, const QPointF& p1, const QPointF& p2, const QPointF& p3);
+    TriangleShape(const QPointF& p1, const QPointF& p2, const QPointF& p3);
+
+    /**
+     * @brief Deletes the graphics item, which also removes it from its scene.
+     */
+    ~TriangleShape() override;
 
     /**
      * @brief Returns the underlying polygon graphics item.
@@ -41,7 +45,35 @@ public:
      */
     QPointF center() const override;
 
+    /**
+     * @brief Identifies the shape as a triangle.
+     * @return `ShapeKind::Triangle`.
+     */
+    ShapeKind kind() const override { return ShapeKind::Triangle; }
+
+    /**
+     * @brief Returns the stored vertices.
+     * @return Vertices in construction order.
+     */
+    QVector<QPointF> vertices() const override { return m_pts; }
+
+    /**
+     * @brief Replaces the vertices and updates the polygon item and cached center.
+     * @param points New vertices in the same order as `vertices()`.
+     */
+    void setVertices(const QVector<QPointF>& points) override;
+
+    /**
+     * @brief Counts the object, the vertex array it shares with its item and scene record, and the item.
+     */
+    MemoryStats::ShapeUsage memoryUsage() const override
+    {
+        return { sizeof(TriangleShape), m_pts.size() * qint64(sizeof(QPointF)),
+                 sizeof(QGraphicsPolygonItem) + MemoryStats::kItemPrivateBytes };
+    }
+
 private:
     QGraphicsPolygonItem* m_item;
     QVector<QPointF> m_pts;
+    QPointF m_center;
 };
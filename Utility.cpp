@@ -4,8 +4,240 @@
  * @author Nikol Grigoryan
  */
 #include "Utility.h"
+#include "Predicates.h"
 #include <QtMath>
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UTILITY_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(UTILITY_HAVE_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define UTILITY_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Compile-time checks of the geometry core, in floating and fixed point
+using Fix = Geometry::Fixed<16>;
+constexpr Geometry::Vec2<Fix> fixPoint(int x, int y) { return { Fix::fromInt(x), Fix::fromInt(y) }; }
+
+static_assert(Geometry::equal<double, 4>(Geometry::squareFromDiagonal<double>({ 0, 0 }, { 2, 2 }),
+                                         { { { 0, 0 }, { 2, 0 }, { 2, 2 }, { 0, 2 } } }),
+              "square corners from a diagonal");
+static_assert(Geometry::isSquare(Geometry::squareFromDiagonal<double>({ 1, 5 }, { 4, -2 })),
+              "a square built from a diagonal is a square");
+static_assert(Geometry::isSquare(Geometry::squareFromDiagonal(fixPoint(-3, 7), fixPoint(5, 1))),
+              "the same holds in fixed point");
+static_assert(Geometry::isRectangle<double>({ { { 3, 4 }, { 0, 0 }, { 0, 4 }, { 3, 0 } } })
+                  && !Geometry::isSquare<double>({ { { 3, 4 }, { 0, 0 }, { 0, 4 }, { 3, 0 } } }),
+              "a 3x4 rectangle in any order is not a square");
+static_assert(!Geometry::isRectangle<double>({ { { 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 } } }),
+              "degenerate quads are rejected");
+static_assert(Geometry::equal<double, 4>(Geometry::outlineOrder<double>({ { { 0, 0 }, { 3, 3 }, { 3, 0 }, { 0, 3 } } }),
+                                         { { { 0, 0 }, { 0, 3 }, { 3, 3 }, { 3, 0 } } }),
+              "outline order never crosses the diagonals");
+static_assert(Geometry::axisAlignedRect(fixPoint(4, 1), fixPoint(0, 3))[0] == fixPoint(0, 1),
+              "axis-aligned rectangles start at the minimum corner");
+static_assert(Geometry::centroid<float, 3>({ { { 0, 0 }, { 3, 0 }, { 0, 3 } } }) == Geometry::Vec2<float>{ 1, 1 },
+              "triangle centroid");
+
+/**
+ * @brief One candidate per step using plain doubles.
+ */
+struct ScalarLanes
+{
+    using Real = double;
+    using Mask = bool;
+    static constexpr int kWidth = 1;
+
+    static Real load(const double* p) { return *p; }
+    static Real set1(double v) { return v; }
+    static Real add(Real a, Real b) { return a + b; }
+    static Real sub(Real a, Real b) { return a - b; }
+    static Real mul(Real a, Real b) { return a * b; }
+    static Real abs(Real a) { return std::fabs(a); }
+    static Mask lt(Real a, Real b) { return a < b; }
+    static Mask eq(Real a, Real b) { return a == b; }
+    static Mask both(Mask a, Mask b) { return a && b; }
+    static Mask either(Mask a, Mask b) { return a || b; }
+    static Mask without(Mask a, Mask b) { return a && !b; }
+    static Real select(Mask m, Real a, Real b) { return m ? a : b; }
+    static int bits(Mask m) { return m ? 1 : 0; }
+};
+
+namespace scalar {
+#include "UtilityKernels.h"
+} // namespace scalar
+
+#if defined(UTILITY_HAVE_SSE2)
+/**
+ * @brief Two candidates per step; SSE2 is part of the x86-64 baseline.
+ */
+struct Sse2Lanes
+{
+    using Real = __m128d;
+    using Mask = __m128d;
+    static constexpr int kWidth = 2;
+
+    static Real load(const double* p) { return _mm_loadu_pd(p); }
+    static Real set1(double v) { return _mm_set1_pd(v); }
+    static Real add(Real a, Real b) { return _mm_add_pd(a, b); }
+    static Real sub(Real a, Real b) { return _mm_sub_pd(a, b); }
+    static Real mul(Real a, Real b) { return _mm_mul_pd(a, b); }
+    static Real abs(Real a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+    static Mask lt(Real a, Real b) { return _mm_cmplt_pd(a, b); }
+    static Mask eq(Real a, Real b) { return _mm_cmpeq_pd(a, b); }
+    static Mask both(Mask a, Mask b) { return _mm_and_pd(a, b); }
+    static Mask either(Mask a, Mask b) { return _mm_or_pd(a, b); }
+    static Mask without(Mask a, Mask b) { return _mm_andnot_pd(b, a); }
+    static Real select(Mask m, Real a, Real b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+    static int bits(Mask m) { return _mm_movemask_pd(m); }
+};
+
+namespace sse2 {
+#include "UtilityKernels.h"
+} // namespace sse2
+#endif
+
+#if defined(UTILITY_HAVE_AVX2)
+// Everything up to the matching pop is compiled for AVX2 and only called after the
+// runtime CPU check. FMA is deliberately not enabled: the filter bounds assume every
+// product and sum is rounded separately.
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+/**
+ * @brief Four candidates per step with 256-bit vectors.
+ */
+struct Avx2Lanes
+{
+    using Real = __m256d;
+    using Mask = __m256d;
+    static constexpr int kWidth = 4;
+
+    static Real load(const double* p) { return _mm256_loadu_pd(p); }
+    static Real set1(double v) { return _mm256_set1_pd(v); }
+    static Real add(Real a, Real b) { return _mm256_add_pd(a, b); }
+    static Real sub(Real a, Real b) { return _mm256_sub_pd(a, b); }
+    static Real mul(Real a, Real b) { return _mm256_mul_pd(a, b); }
+    static Real abs(Real a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+    static Mask lt(Real a, Real b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static Mask eq(Real a, Real b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+    static Mask both(Mask a, Mask b) { return _mm256_and_pd(a, b); }
+    static Mask either(Mask a, Mask b) { return _mm256_or_pd(a, b); }
+    static Mask without(Mask a, Mask b) { return _mm256_andnot_pd(b, a); }
+    static Real select(Mask m, Real a, Real b) { return _mm256_blendv_pd(b, a, m); }
+    static int bits(Mask m) { return _mm256_movemask_pd(m); }
+};
+
+namespace avx2 {
+#include "UtilityKernels.h"
+} // namespace avx2
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+#endif
+
+/**
+ * @brief Level used by the batch kernels; starts at the best detected level.
+ */
+std::atomic<int>& activeLevel()
+{
+    static std::atomic<int> level(static_cast<int>(Utility::detectedSimdLevel()));
+    return level;
+}
+
+/**
+ * @brief Returns `true` when all coordinates are finite numbers.
+ */
+bool allFinite(const double* v, int n)
+{
+    for (int i = 0; i < n; ++i) {
+        if (!std::isfinite(v[i])) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Exact collinearity of one candidate.
+ */
+bool exactCollinear(const double* x, const double* y)
+{
+    if (!allFinite(x, 3) || !allFinite(y, 3)) return false;
+    return Predicates::orient2d(x[0], y[0], x[1], y[1], x[2], y[2]) == 0;
+}
+
+/**
+ * @brief Rectangle or square test of one candidate within `Predicates::kRelativeTolerance`.
+ *
+ * Each condition is decided exactly against the tolerance, so the answer is the same at
+ * every batch level.
+ */
+bool exactQuad(const Geometry::Points<double, 4>& corners, bool square)
+{
+    for (const auto& p : corners) {
+        if (!std::isfinite(p.x) || !std::isfinite(p.y)) return false;
+    }
+
+    // A and D are opposite corners; B and C are their shared neighbours
+    const Geometry::Points<double, 4> s = Geometry::sortCorners(corners);
+    const auto& A = s[0];
+    const auto& B = s[1];
+    const auto& C = s[2];
+    const auto& D = s[3];
+    if (A == B || A == C) return false;
+    if (!Predicates::nearlyOrthogonal(A.x, A.y, B.x, B.y, C.x, C.y)) return false;
+    if (!Predicates::nearlyOrthogonal(D.x, D.y, B.x, B.y, C.x, C.y)) return false;
+    if (!Predicates::nearlyEqualDist2(A.x, A.y, B.x, B.y, C.x, C.y, D.x, D.y)) return false;
+    if (!Predicates::nearlyEqualDist2(A.x, A.y, C.x, C.y, B.x, B.y, D.x, D.y)) return false;
+    return !square || Predicates::nearlyEqualDist2(A.x, A.y, B.x, B.y, A.x, A.y, C.x, C.y);
+}
+
+/**
+ * @brief Exact collinearity of candidate @p i of a structure-of-arrays batch.
+ */
+bool exactCollinearAt(const double* const x[3], const double* const y[3], int i)
+{
+    const double px[3] = { x[0][i], x[1][i], x[2][i] };
+    const double py[3] = { y[0][i], y[1][i], y[2][i] };
+    return exactCollinear(px, py);
+}
+
+/**
+ * @brief Runs the widest enabled quad filter and finishes the remainder with the scalar one.
+ */
+void quadBatch(const double* const x[4], const double* const y[4], int count, bool* out, bool square)
+{
+    const auto exact = [square](const double* const px[4], const double* const py[4], int i) {
+        return exactQuad({ { { px[0][i], py[0][i] }, { px[1][i], py[1][i] },
+                             { px[2][i], py[2][i] }, { px[3][i], py[3][i] } } },
+                         square);
+    };
+
+    int done = 0;
+    const auto level = static_cast<Utility::SimdLevel>(activeLevel().load(std::memory_order_relaxed));
+#if defined(UTILITY_HAVE_AVX2)
+    if (level == Utility::SimdLevel::Avx2) done = avx2::quadKernel<Avx2Lanes>(x, y, 0, count, out, square, exact);
+#endif
+#if defined(UTILITY_HAVE_SSE2)
+    if (level == Utility::SimdLevel::Sse2) done = sse2::quadKernel<Sse2Lanes>(x, y, 0, count, out, square, exact);
+#endif
+    Q_UNUSED(level);
+    scalar::quadKernel<ScalarLanes>(x, y, done, count, out, square, exact);
+}
+
+} // namespace
 
 namespace Utility {
 
@@ -13,116 +245,139 @@ namespace Utility {
  * @brief Computes the vector difference `a - b`.
  */
 QPointF sub(const QPointF& a, const QPointF& b) {
-    return QPointF(a.x() - b.x(), a.y() - b.y());
+    return toPointF(toVec(a) - toVec(b));
 }
 
 /**
  * @brief Returns the dot product of vectors represented by two points.
  */
 double dot(const QPointF& a, const QPointF& b) {
-    return a.x()*b.x() + a.y()*b.y();
+    return Geometry::dot(toVec(a), toVec(b));
 }
 
 /**
  * @brief Calculates the squared Euclidean distance between two points.
  */
 double dist2(const QPointF& a, const QPointF& b) {
-    const QPointF v = sub(a,b);
-    return v.x()*v.x() + v.y()*v.y();
+    return Geometry::dist2(toVec(a), toVec(b));
 }
 
 /**
  * @brief Determines whether three points reside on the same line.
  */
-bool areCollinear(const QPointF& a, const QPointF& b, const QPointF& c, double eps)
+bool areCollinear(const QPointF& a, const QPointF& b, const QPointF& c)
 {
-    // Area of triangle via cross product magnitude
-    const QPointF ab = sub(b, a);
-    const QPointF ac = sub(c, a);
-    const double cross = ab.x()*ac.y() - ab.y()*ac.x();
-    return qFabs(cross) < eps;
+    // Exact sign of the cross product; no tolerance, so scale does not matter
+    const double x[3] = { a.x(), b.x(), c.x() };
+    const double y[3] = { a.y(), b.y(), c.y() };
+    return exactCollinear(x, y);
 }
 
 /**
- * @brief Internal helper that checks whether the angle at `b` is right.
+ * @brief Evaluates whether four points form a rectangle.
  */
-static bool isRightAngle(const QPointF& a, const QPointF& b, const QPointF& c, double eps)
+bool isRectangle(const QPointF& p1, const QPointF& p2, const QPointF& p3, const QPointF& p4)
 {
-    // Checks if angle at b is right: (a-b) dot (c-b) == 0
-    const QPointF v1 = sub(a, b);
-    const QPointF v2 = sub(c, b);
-    return qFabs(dot(v1, v2)) < eps;
+    // Sort corners by x,y on the stack, then check right angles at the extreme corners
+    // and equal opposite sides, both within the relative tolerance
+    return exactQuad({ toVec(p1), toVec(p2), toVec(p3), toVec(p4) }, false);
 }
 
 /**
- * @brief Evaluates whether four points form a rectangle.
+ * @brief Evaluates whether four points form a square.
  */
-bool isRectangle(const QPointF& p1, const QPointF& p2, const QPointF& p3, const QPointF& p4, double eps)
+bool isSquare(const QPointF& p1, const QPointF& p2, const QPointF& p3, const QPointF& p4)
 {
-    // A robust approach: sort points by x,y to get a consistent order,
-    // then check opposite sides equal and all angles right.
-
-    QVector<QPointF> pts { p1, p2, p3, p4 };
-    std::sort(pts.begin(), pts.end(), [](const QPointF& a, const QPointF& b){
-        if (a.x() == b.x()) return a.y() < b.y();
-        return a.x() < b.x();
-    });
-
-    const QPointF A = pts[0]; // bottom-left
-    const QPointF B = pts[1]; // bottom-right or top-left depending on sort
-    const QPointF C = pts[2];
-    const QPointF D = pts[3];
-
-    // Try to arrange them as rectangle corners by proximity
-    // Simple heuristic: A (min x,y), D (max x,y). Then two others B,C.
-    // Check right angles at each corner using vectors.
-    const bool rightA = isRightAngle(B, A, C, eps) || isRightAngle(C, A, B, eps);
-    const bool rightD = isRightAngle(B, D, C, eps) || isRightAngle(C, D, B, eps);
+    // Square: rectangle + equal adjacent sides, sharing a single sort with the rectangle test
+    return exactQuad({ toVec(p1), toVec(p2), toVec(p3), toVec(p4) }, true);
+}
 
-    // Opposite sides equal length (using squared distances)
-    const double dAB = dist2(A, B);
-    const double dCD = dist2(C, D);
-    const double dAC = dist2(A, C);
-    const double dBD = dist2(B, D);
+/**
+ * @brief Verifies that two points can serve as a valid diagonal of a square.
+ */
+bool isValidSquareDiagonal(const QPointF& d1, const QPointF& d2, double eps)
+{
+    // Diagonal must have non-zero length
+    return dist2(d1, d2) > eps;
+}
 
-    const bool oppEqual = qFabs(dAB - dCD) < eps && qFabs(dAC - dBD) < eps;
+/**
+ * @brief Queries the CPU once for the widest supported kernel.
+ */
+SimdLevel detectedSimdLevel()
+{
+#if defined(UTILITY_HAVE_AVX2)
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    if (avx2) return SimdLevel::Avx2;
+#endif
+#if defined(UTILITY_HAVE_SSE2)
+    return SimdLevel::Sse2;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
 
-    return rightA && rightD && oppEqual;
+/**
+ * @brief Returns the level currently used by the batch kernels.
+ */
+SimdLevel simdLevel()
+{
+    return static_cast<SimdLevel>(activeLevel().load(std::memory_order_relaxed));
 }
 
 /**
- * @brief Evaluates whether four points form a square.
+ * @brief Selects a batch kernel level no wider than the CPU supports.
  */
-bool isSquare(const QPointF& p1, const QPointF& p2, const QPointF& p3, const QPointF& p4, double eps)
+void setSimdLevel(SimdLevel level)
 {
-    // Square: rectangle + all sides equal
-    QVector<QPointF> pts { p1, p2, p3, p4 };
-    std::sort(pts.begin(), pts.end(), [](const QPointF& a, const QPointF& b){
-        if (a.x() == b.x()) return a.y() < b.y();
-        return a.x() < b.x();
-    });
+    activeLevel().store(std::min(static_cast<int>(level), static_cast<int>(detectedSimdLevel())),
+                        std::memory_order_relaxed);
+}
 
-    const QPointF A = pts[0];
-    const QPointF B = pts[1];
-    const QPointF C = pts[2];
-    const QPointF D = pts[3];
+/**
+ * @brief Returns the display name of a kernel level.
+ */
+const char* simdLevelName(SimdLevel level)
+{
+    switch (level) {
+    case SimdLevel::Avx2: return "avx2";
+    case SimdLevel::Sse2: return "sse2";
+    case SimdLevel::Scalar: break;
+    }
+    return "scalar";
+}
 
-    // Check rectangle property via right angles and opposite sides equality
-    if (!isRectangle(A,B,C,D,eps)) return false;
+/**
+ * @brief Validates collinearity candidates with the active kernel level.
+ */
+void areCollinearBatch(const double* const x[3], const double* const y[3], int count, bool* out)
+{
+    int done = 0;
+    const SimdLevel level = simdLevel();
+#if defined(UTILITY_HAVE_AVX2)
+    if (level == SimdLevel::Avx2) done = avx2::collinearKernel<Avx2Lanes>(x, y, 0, count, out, exactCollinearAt);
+#endif
+#if defined(UTILITY_HAVE_SSE2)
+    if (level == SimdLevel::Sse2) done = sse2::collinearKernel<Sse2Lanes>(x, y, 0, count, out, exactCollinearAt);
+#endif
+    Q_UNUSED(level);
+    scalar::collinearKernel<ScalarLanes>(x, y, done, count, out, exactCollinearAt);
+}
 
-    // Check all sides equal: compute nearest neighbor distances
-    const double s1 = qMin(dist2(A,B), dist2(A,C));
-    const double s2 = qMin(dist2(D,B), dist2(D,C));
-    return qFabs(s1 - s2) < eps && s1 > eps;
+/**
+ * @brief Validates rectangle candidates with the active kernel level.
+ */
+void isRectangleBatch(const double* const x[4], const double* const y[4], int count, bool* out)
+{
+    quadBatch(x, y, count, out, false);
 }
 
 /**
- * @brief Verifies that two points can serve as a valid diagonal of a square.
+ * @brief Validates square candidates with the active kernel level.
  */
-bool isValidSquareDiagonal(const QPointF& d1, const QPointF& d2, double eps)
+void isSquareBatch(const double* const x[4], const double* const y[4], int count, bool* out)
 {
-    // Diagonal must have non-zero length
-    return dist2(d1, d2) > eps;
+    quadBatch(x, y, count, out, true);
 }
 
 } // namespace Utility
@@ -7,6 +7,7 @@
 
 #include <QPointF>
 #include <QVector>
+#include "GeometryCore.h"
 
 /**
  * @namespace Utility
@@ -15,36 +16,44 @@
 namespace Utility {
 
 /**
- * @brief Checks whether three points are collinear using a cross-product test.
+ * @brief Checks whether three points are exactly collinear.
+ *
+ * Uses the adaptive `Predicates::orient2d`, so the answer does not depend on the scale
+ * of the coordinates.
  * @param a First point.
  * @param b Second point.
  * @param c Third point.
- * @param eps Numerical tolerance applied to the cross-product.
- * @return `true` if the area of the triangle is within the tolerance.
+ * @return `true` if the points lie on one line.
  */
-bool areCollinear(const QPointF& a, const QPointF& b, const QPointF& c, double eps = 1e-6);
+bool areCollinear(const QPointF& a, const QPointF& b, const QPointF& c);
 
 /**
- * @brief Validates that four points form a rectangle.
+ * @brief Validates that four points form a non-degenerate rectangle, in any order.
+ *
+ * Right angles and side lengths are accepted within `Predicates::kRelativeTolerance`
+ * (2^-20, about 9.5e-7) relative to the squared side lengths: the cosine of each corner
+ * angle and the relative difference of opposite sides may be off by about that much, so
+ * decimal input and transformed shapes pass. The tolerance comparison is exact, so the
+ * result does not depend on the scale of the coordinates.
  * @param p1 First vertex.
  * @param p2 Second vertex.
  * @param p3 Third vertex.
  * @param p4 Fourth vertex.
- * @param eps Tolerance for numeric comparisons.
  * @return `true` if the points satisfy rectangle constraints.
  */
-bool isRectangle(const QPointF& p1, const QPointF& p2, const QPointF& p3, const QPointF& p4, double eps = 1e-6);
+bool isRectangle(const QPointF& p1, const QPointF& p2, const QPointF& p3, const QPointF& p4);
 
 /**
- * @brief Validates that four points form a square.
+ * @brief Validates that four points form a non-degenerate square, in any order.
+ *
+ * Uses the tolerance of `isRectangle`, also for the equality of adjacent sides.
  * @param p1 First vertex.
  * @param p2 Second vertex.
  * @param p3 Third vertex.
  * @param p4 Fourth vertex.
- * @param eps Tolerance for numeric comparisons.
- * @return `true` if the points satisfy square constraints.
+ * @return `true` if the points form a rectangle with equal adjacent sides.
  */
-bool isSquare(const QPointF& p1, const QPointF& p2, const QPointF& p3, const QPointF& p4, double eps = 1e-6);
+bool isSquare(const QPointF& p1, const QPointF& p2, const QPointF& p3, const QPointF& p4);
 
 /**
  * @brief Tests whether two points may serve as a valid square diagonal.
@@ -55,6 +64,106 @@ bool isSquare(const QPointF& p1, const QPointF& p2, const QPointF& p3, const QPo
  */
 bool isValidSquareDiagonal(const QPointF& d1, const QPointF& d2, double eps = 1e-9);
 
+/**
+ * @brief Instruction-set levels available to the batch validation kernels.
+ */
+enum class SimdLevel
+{
+    Scalar, ///< Portable one-candidate-at-a-time loop.
+    Sse2,   ///< Two candidates per step with 128-bit vectors.
+    Avx2    ///< Four candidates per step with 256-bit vectors.
+};
+
+/**
+ * @brief Returns the best instruction-set level supported by the running CPU.
+ */
+SimdLevel detectedSimdLevel();
+
+/**
+ * @brief Returns the level currently used by the batch kernels.
+ */
+SimdLevel simdLevel();
+
+/**
+ * @brief Selects the level used by the batch kernels, clamped to `detectedSimdLevel()`.
+ * @param level Requested level.
+ */
+void setSimdLevel(SimdLevel level);
+
+/**
+ * @brief Returns a short display name for a level (e.g. `"avx2"`).
+ */
+const char* simdLevelName(SimdLevel level);
+
+/**
+ * @brief Runs `areCollinear` over candidates stored as structure-of-arrays.
+ *
+ * SIMD levels run only the floating-point filters and resolve every candidate they
+ * cannot reject with the exact scalar test, so all levels agree with `areCollinear`.
+ * @param x Three arrays with the x coordinates of points a, b and c.
+ * @param y Three arrays with the y coordinates of points a, b and c.
+ * @param count Number of candidates.
+ * @param out Receives one result per candidate.
+ */
+void areCollinearBatch(const double* const x[3], const double* const y[3], int count, bool* out);
+
+/**
+ * @brief Runs `isRectangle` over candidates stored as structure-of-arrays.
+ * @param x Four arrays with the x coordinates of the vertices.
+ * @param y Four arrays with the y coordinates of the vertices.
+ * @param count Number of candidates.
+ * @param out Receives one result per candidate.
+ */
+void isRectangleBatch(const double* const x[4], const double* const y[4], int count, bool* out);
+
+/**
+ * @brief Runs `isSquare` over candidates stored as structure-of-arrays.
+ * @param x Four arrays with the x coordinates of the vertices.
+ * @param y Four arrays with the y coordinates of the vertices.
+ * @param count Number of candidates.
+ * @param out Receives one result per candidate.
+ */
+void isSquareBatch(const double* const x[4], const double* const y[4], int count, bool* out);
+
+/**
+ * @brief Converts a Qt point to a geometry-core point.
+ */
+inline Geometry::Vec2<double> toVec(const QPointF& p)
+{
+    return { p.x(), p.y() };
+}
+
+/**
+ * @brief Converts a geometry-core point to a Qt point.
+ */
+inline QPointF toPointF(const Geometry::Vec2<double>& v)
+{
+    return QPointF(v.x, v.y);
+}
+
+/**
+ * @brief Copies the first @p N points of a `QVector` into a geometry-core point array.
+ */
+template <int N>
+Geometry::Points<double, N> toPoints(const QVector<QPointF>& pts)
+{
+    Geometry::Points<double, N> out{};
+    for (int i = 0; i < N; ++i) out[i] = toVec(pts[i]);
+    return out;
+}
+
+/**
+ * @brief Converts a geometry-core point array to a `QVector` for the shape API.
+ */
+template <int N>
+QVector<QPointF> toPointVector(const Geometry::Points<double, N>& pts)
+{
+    QVector<QPointF> out;
+    out.reserve(N);
+    for (const auto& p : pts) out.append(toPointF(p));
+    return out;
+}
+
 /**
  * @brief Computes the squared Euclidean distance between two points.
  */
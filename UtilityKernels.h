@@ -0,0 +1,208 @@
+/**
+ * @file UtilityKernels.h
+ * @brief Generic geometry validation filters shared by the scalar and SIMD paths of Utility.
+ * @author Nikol Grigoryan
+ *
+ * This header deliberately has no include guard. `Utility.cpp` includes it once per
+ * instruction-set target, each time inside a different namespace, so every target gets
+ * its own instantiations compiled with the matching code-generation flags. The kernels
+ * are written against a lane traits type `V` providing:
+ *
+ * - `Real`, `Mask` and `kWidth` (candidates per step),
+ * - `load`, `set1`, `add`, `sub`, `mul`, `abs`,
+ * - `lt`, `eq`, `both`, `either`, `without` (`a & ~b`), `select` and `bits`.
+ *
+ * The kernels only run the floating-point stages of the predicates in `Predicates.h`.
+ * A lane is decided in the kernel when a filter proves the answer; every other lane is
+ * resolved by the exact scalar test passed in as `exact`. Results are therefore exact,
+ * and identical at every level.
+ */
+
+/**
+ * @brief Lexicographic (x, then y) less-than of two points.
+ */
+template <class V>
+inline typename V::Mask lessXY(typename V::Real ax, typename V::Real ay,
+                               typename V::Real bx, typename V::Real by)
+{
+    return V::either(V::lt(ax, bx), V::both(V::eq(ax, bx), V::lt(ay, by)));
+}
+
+/**
+ * @brief Orders points `i` and `j` so that point `i` is not greater than point `j`.
+ */
+template <class V>
+inline void compareSwap(typename V::Real* x, typename V::Real* y, int i, int j)
+{
+    const typename V::Mask swap = lessXY<V>(x[j], y[j], x[i], y[i]);
+    const typename V::Real xi = V::select(swap, x[j], x[i]);
+    const typename V::Real yi = V::select(swap, y[j], y[i]);
+    x[j] = V::select(swap, x[i], x[j]);
+    y[j] = V::select(swap, y[i], y[j]);
+    x[i] = xi;
+    y[i] = yi;
+}
+
+/**
+ * @brief Sorts four points by x, then y, with a five-comparator sorting network.
+ */
+template <class V>
+inline void sortCorners(typename V::Real* x, typename V::Real* y)
+{
+    compareSwap<V>(x, y, 0, 1);
+    compareSwap<V>(x, y, 2, 3);
+    compareSwap<V>(x, y, 0, 2);
+    compareSwap<V>(x, y, 1, 3);
+    compareSwap<V>(x, y, 1, 2);
+}
+
+/**
+ * @brief Returns lanes whose points `i` and `j` coincide.
+ */
+template <class V>
+inline typename V::Mask samePoint(const typename V::Real* x, const typename V::Real* y, int i, int j)
+{
+    return V::both(V::eq(x[i], x[j]), V::eq(y[i], y[j]));
+}
+
+/**
+ * @brief Returns lanes that are certainly not collinear.
+ */
+template <class V>
+inline typename V::Mask collinearReject(const typename V::Real* x, const typename V::Real* y)
+{
+    const typename V::Real left = V::mul(V::sub(x[1], x[0]), V::sub(y[2], y[0]));
+    const typename V::Real right = V::mul(V::sub(y[1], y[0]), V::sub(x[2], x[0]));
+    const typename V::Real det = V::sub(left, right);
+    const typename V::Real bound = V::set1(Predicates::kProductSumBound);
+    return V::lt(V::mul(bound, V::add(V::abs(left), V::abs(right))), V::abs(det));
+}
+
+/**
+ * @brief Computes the margin of `Predicates::nearlyOrthogonal` at corner `o` towards `p` and `q`.
+ * @param bound Receives the error bound of the margin.
+ */
+template <class V>
+inline typename V::Real orthogonalMargin(const typename V::Real* x, const typename V::Real* y, int o, int p, int q,
+                                         typename V::Real& bound)
+{
+    const typename V::Real ux = V::sub(x[p], x[o]), uy = V::sub(y[p], y[o]);
+    const typename V::Real vx = V::sub(x[q], x[o]), vy = V::sub(y[q], y[o]);
+    const typename V::Real left = V::mul(ux, vx), right = V::mul(uy, vy);
+    const typename V::Real lengths = V::mul(V::set1(Predicates::kRelativeTolerance),
+                                            V::add(V::add(V::mul(ux, ux), V::mul(uy, uy)),
+                                                   V::add(V::mul(vx, vx), V::mul(vy, vy))));
+    const typename V::Real two = V::set1(2.0);
+    bound = V::mul(V::set1(Predicates::kToleranceBound),
+                   V::add(lengths, V::mul(two, V::add(V::abs(left), V::abs(right)))));
+    return V::sub(lengths, V::mul(two, V::abs(V::add(left, right))));
+}
+
+/**
+ * @brief Computes the margin of `Predicates::nearlyEqualDist2` for segments `ab` and `cd`.
+ * @param bound Receives the error bound of the margin.
+ */
+template <class V>
+inline typename V::Real lengthMargin(const typename V::Real* x, const typename V::Real* y, int a, int b, int c, int d,
+                                     typename V::Real& bound)
+{
+    const typename V::Real ux = V::sub(x[a], x[b]), uy = V::sub(y[a], y[b]);
+    const typename V::Real vx = V::sub(x[c], x[d]), vy = V::sub(y[c], y[d]);
+    const typename V::Real s1 = V::add(V::mul(ux, ux), V::mul(uy, uy));
+    const typename V::Real s2 = V::add(V::mul(vx, vx), V::mul(vy, vy));
+    const typename V::Real sum = V::add(s1, s2);
+    const typename V::Real scaled = V::mul(V::set1(Predicates::kRelativeTolerance), sum);
+    bound = V::mul(V::set1(Predicates::kToleranceBound), V::add(scaled, sum));
+    return V::sub(scaled, V::abs(V::sub(s1, s2)));
+}
+
+/**
+ * @brief Classifies rectangle (or square) candidates with floating-point arithmetic only.
+ *
+ * After sorting, A and D are the lexicographically smallest and largest corners and
+ * therefore opposite. A rectangle needs right angles at A and D towards B and C, equal
+ * opposite sides and non-degenerate sides; a square also needs `|AB| == |AC|`. Angles and
+ * lengths are compared within `Predicates::kRelativeTolerance`.
+ *
+ * Lanes are rejected when a filter proves a condition false, and accepted when the
+ * filters prove every condition true. The exact scalar test only has to resolve lanes
+ * whose margin is within its error bound of the tolerance.
+ * @param accept Receives the lanes proven to be valid.
+ * @return Lanes proven to be invalid.
+ */
+template <class V>
+inline typename V::Mask quadClassify(typename V::Real* x, typename V::Real* y, bool square, typename V::Mask& accept)
+{
+    sortCorners<V>(x, y);
+
+    // Right angles at A and D, then |AB| against |CD|, |AC| against |BD| and for squares |AB| against |AC|
+    typename V::Real margin[5], bound[5];
+    margin[0] = orthogonalMargin<V>(x, y, 0, 1, 2, bound[0]);
+    margin[1] = orthogonalMargin<V>(x, y, 3, 1, 2, bound[1]);
+    margin[2] = lengthMargin<V>(x, y, 0, 1, 2, 3, bound[2]);
+    margin[3] = lengthMargin<V>(x, y, 0, 2, 1, 3, bound[3]);
+    const int conditions = square ? 5 : 4;
+    if (square) margin[4] = lengthMargin<V>(x, y, 0, 1, 0, 2, bound[4]);
+
+    const typename V::Real zero = V::set1(0.0);
+    typename V::Mask reject = V::either(samePoint<V>(x, y, 0, 1), samePoint<V>(x, y, 0, 2));
+    typename V::Mask holds = V::eq(zero, zero);
+    for (int i = 0; i < conditions; ++i) {
+        reject = V::either(reject, V::lt(margin[i], V::sub(zero, bound[i])));
+        holds = V::both(holds, V::lt(bound[i], margin[i]));
+    }
+    accept = V::without(holds, reject);
+    return reject;
+}
+
+/**
+ * @brief Validates collinearity candidates a full step at a time.
+ * @param begin First candidate to validate.
+ * @param exact Exact test `exact(x, y, index)`, called for lanes the filter cannot reject.
+ * @return Index of the first candidate not processed (the scalar tail starts there).
+ */
+template <class V, class Exact>
+inline int collinearKernel(const double* const x[3], const double* const y[3], int begin, int count, bool* out,
+                           Exact exact)
+{
+    int i = begin;
+    for (; i + V::kWidth <= count; i += V::kWidth) {
+        typename V::Real px[3], py[3];
+        for (int k = 0; k < 3; ++k) {
+            px[k] = V::load(x[k] + i);
+            py[k] = V::load(y[k] + i);
+        }
+        const int rejected = V::bits(collinearReject<V>(px, py));
+        for (int k = 0; k < V::kWidth; ++k) {
+            out[i + k] = !((rejected >> k) & 1) && exact(x, y, i + k);
+        }
+    }
+    return i;
+}
+
+/**
+ * @brief Validates rectangle or square candidates a full step at a time.
+ * @param begin First candidate to validate.
+ * @param exact Exact test `exact(x, y, index)`, called for lanes the filter cannot reject.
+ * @return Index of the first candidate not processed (the scalar tail starts there).
+ */
+template <class V, class Exact>
+inline int quadKernel(const double* const x[4], const double* const y[4], int begin, int count, bool* out,
+                      bool square, Exact exact)
+{
+    int i = begin;
+    for (; i + V::kWidth <= count; i += V::kWidth) {
+        typename V::Real px[4], py[4];
+        for (int k = 0; k < 4; ++k) {
+            px[k] = V::load(x[k] + i);
+            py[k] = V::load(y[k] + i);
+        }
+        typename V::Mask accept;
+        const int rejected = V::bits(quadClassify<V>(px, py, square, accept));
+        const int accepted = V::bits(accept);
+        for (int k = 0; k < V::kWidth; ++k) {
+            out[i + k] = ((accepted >> k) & 1) || (!((rejected >> k) & 1) && exact(x, y, i + k));
+        }
+    }
+    return i;
+}
@@ -0,0 +1,524 @@
+/**
+ * @file Benchmarks.cpp
+ * @brief Implements the micro-benchmarks run by `ObjectDrawerBench`.
+ * @author Nikol Grigoryan
+ */
+#include "Benchmarks.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGraphicsScene>
+#include <QLocalSocket>
+#include <QPolygonF>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "CommandDispatcher.h"
+#include "CommandQueue.h"
+#include "CommandServer.h"
+#include "SceneSaver.h"
+#include "ShapeBase.h"
+#include "ShapeRepository.h"
+#include "ShapeTable.h"
+#include "Utility.h"
+
+namespace Benchmarks {
+
+namespace {
+
+/**
+ * @brief Commands drained per batch by the queue benchmark, as the window drains them.
+ */
+constexpr int kDrainBatch = 256;
+
+/**
+ * @brief Parses and runs console lines through a dispatcher, stopping at the first failure.
+ * @return `false` with the failing line and its message in @p msg.
+ */
+bool runLines(CommandDispatcher& dispatcher, const QStringList& lines, QString& msg)
+{
+    for (const QString& line : lines) {
+        Command cmd;
+        QString reply;
+        if (!CommandParser().parse(line, cmd, reply) || !dispatcher.execute(cmd, reply)) {
+            msg = QString("'%1' failed: %2").arg(line, reply);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Reads a saved scene without its header line, which carries the scene version.
+ */
+QByteArray savedBody(const QString& path)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) return QByteArray();
+    f.readLine();
+    return f.readAll();
+}
+
+} // namespace
+
+/**
+ * @brief Runs the `geometry` benchmark which measures the batch validation kernels.
+ *
+ * Generates a fixed-seed mix of rectangles, squares and random quads, runs every kernel
+ * level the CPU supports on one thread and checks each level against the scalar results.
+ * @param cmd Parsed command with an optional `-count` (default 1,000,000).
+ * @param msg Per-core throughput per kernel and level.
+ * @return `true` when `-count` is valid.
+ */
+bool geometry(const Command& cmd, QString& msg)
+{
+    // Expect: geometry [-count N]
+    int count = 1000000;
+    if (cmd.args.contains("count")) {
+        bool ok = false;
+        count = cmd.args["count"].toInt(&ok);
+        if (!ok || count < 1) {
+            msg = "Count must be a positive integer.";
+            return false;
+        }
+    }
+
+    // Every fourth candidate is a random quad; the rest are axis-aligned or rotated shapes
+    QRandomGenerator rng(42);
+    std::vector<double> xs[4], ys[4];
+    for (int k = 0; k < 4; ++k) {
+        xs[k].resize(count);
+        ys[k].resize(count);
+    }
+    for (int i = 0; i < count; ++i) {
+        const double ox = rng.bounded(1000), oy = rng.bounded(1000);
+        const double a = 1 + rng.bounded(100), b = rng.bounded(100);
+        const double h = (i % 4 == 1) ? a : 1 + rng.bounded(100);
+        double px[4] = { ox, ox + a, ox + a - b, ox - b };
+        double py[4] = { oy, oy + b, oy + b + h, oy + h };
+        if (i % 4 == 3) {
+            for (int k = 0; k < 4; ++k) {
+                px[k] = rng.bounded(1000.0);
+                py[k] = rng.bounded(1000.0);
+            }
+        }
+        const int rot = i % 4;
+        for (int k = 0; k < 4; ++k) {
+            xs[k][i] = px[(k + rot) % 4];
+            ys[k][i] = py[(k + rot) % 4];
+        }
+    }
+    const double* x[4] = { xs[0].data(), xs[1].data(), xs[2].data(), xs[3].data() };
+    const double* y[4] = { ys[0].data(), ys[1].data(), ys[2].data(), ys[3].data() };
+
+    using Kernel = void (*)(const double* const*, const double* const*, int, bool*);
+    const struct { const char* name; Kernel fn; } kernels[] = {
+        { "collinear", &Utility::areCollinearBatch },
+        { "rectangle", &Utility::isRectangleBatch },
+        { "square", &Utility::isSquareBatch },
+    };
+
+    const Utility::SimdLevel previous = Utility::simdLevel();
+    const int maxLevel = static_cast<int>(Utility::detectedSimdLevel());
+    std::unique_ptr<bool[]> reference(new bool[count]);
+    std::unique_ptr<bool[]> results(new bool[count]);
+    QStringList lines;
+    for (const auto& kernel : kernels) {
+        QStringList cells;
+        for (int level = 0; level <= maxLevel; ++level) {
+            Utility::setSimdLevel(static_cast<Utility::SimdLevel>(level));
+            bool* out = level == 0 ? reference.get() : results.get();
+            QElapsedTimer timer;
+            timer.start();
+            kernel.fn(x, y, count, out);
+            const double seconds = std::max<qint64>(1, timer.nsecsElapsed()) / 1e9;
+
+            const bool agrees = level == 0 || std::equal(out, out + count, reference.get());
+            cells << QString("%1 %2 M/s%3")
+                         .arg(Utility::simdLevelName(static_cast<Utility::SimdLevel>(level)))
+                         .arg(count / seconds / 1e6, 0, 'f', 1)
+                         .arg(agrees ? "" : " (MISMATCH)");
+        }
+        lines << QString("%1: %2").arg(kernel.name, cells.join(", "));
+    }
+    Utility::setSimdLevel(previous);
+
+    msg = QString("Geometry kernels, %1 candidates on one core; %2").arg(count).arg(lines.join("; "));
+    return true;
+}
+
+/**
+ * @brief Runs the `shapes` benchmark which compares whole-scene passes over both shape models.
+ *
+ * Builds the same fixed-seed mix of shapes as heap-allocated `ShapeBase` objects (in
+ * shuffled order, as a hash table would return them) and as a `ShapeTable`, then times a
+ * center pass and a bounding-box pass over each.
+ * @param cmd Parsed command with an optional `-count` (default 100,000).
+ * @param msg Nanoseconds per shape for each pass and model.
+ * @return `true` on success.
+ */
+bool shapes(const Command& cmd, QString& msg)
+{
+    // Expect: shapes [-count N]
+    int count = 100000;
+    if (cmd.args.contains("count")) {
+        bool ok = false;
+        count = cmd.args["count"].toInt(&ok);
+        if (!ok || count < 1 || count > ShapeHandle::kMaxCount) {
+            msg = QString("-count must be between 1 and %1.").arg(ShapeHandle::kMaxCount);
+            return false;
+        }
+    }
+
+    QRandomGenerator rng(42);
+    std::vector<std::unique_ptr<ShapeBase>> objects;
+    objects.reserve(count);
+    ShapeTable table;
+    for (int i = 0; i < count; ++i) {
+        const ShapeKind kind = static_cast<ShapeKind>(i % 4);
+        const int vertexCount = kind == ShapeKind::Line ? 2 : (kind == ShapeKind::Triangle ? 3 : 4);
+        QVector<QPointF> points;
+        for (int k = 0; k < vertexCount; ++k) points.append(QPointF(rng.bounded(1000.0), rng.bounded(1000.0)));
+        objects.emplace_back(ShapeBase::create(kind, points));
+        table.insert(ShapeHandle::make(i, 1), kind, points);
+    }
+    std::shuffle(objects.begin(), objects.end(), rng);
+
+    // Each pass folds into a sink so the compiler cannot drop it
+    double sink = 0.0;
+    const auto nsPerShape = [count](QElapsedTimer& timer) {
+        return std::max<qint64>(1, timer.nsecsElapsed()) / double(count);
+    };
+    QElapsedTimer timer;
+
+    timer.start();
+    for (const auto& shape : objects) {
+        const QPointF c = shape->center();
+        sink += c.x() + c.y();
+    }
+    const double centersVirtual = nsPerShape(timer);
+
+    timer.start();
+    table.forEach([&sink](ShapeHandle, const auto& shape) {
+        const Geometry::Vec2<double> c = shape.center();
+        sink += c.x + c.y;
+    });
+    const double centersTable = nsPerShape(timer);
+
+    timer.start();
+    QRectF box;
+    for (const auto& shape : objects) {
+        const QVector<QPointF> points = shape->vertices();
+        box |= QPolygonF(points).boundingRect();
+    }
+    sink += box.width();
+    const double boundsVirtual = nsPerShape(timer);
+
+    timer.start();
+    sink += table.bounds().width();
+    const double boundsTable = nsPerShape(timer);
+
+    msg = QString("Whole-scene passes over %1 shapes (ns/shape, ShapeBase vs ShapeTable): "
+                  "centers %2 vs %3, bounds %4 vs %5 [checksum %6]")
+              .arg(count)
+              .arg(centersVirtual, 0, 'f', 2)
+              .arg(centersTable, 0, 'f', 2)
+              .arg(boundsVirtual, 0, 'f', 2)
+              .arg(boundsTable, 0, 'f', 2)
+              .arg(sink, 0, 'g', 6);
+    return true;
+}
+
+/**
+ * @brief Runs the `queue` benchmark, a stress test of the submission queue with many producers.
+ *
+ * Producer threads push numbered commands, a quarter of them as raw lines, into a private
+ * small queue so backpressure kicks in, while this thread drains it. The consumer checks
+ * that each producer's commands arrive in submission order; nothing is executed.
+ * @param cmd Parsed command with optional `-producers` (default 8) and `-count` per producer (default 100,000).
+ * @param msg Throughput, ordering violations and queue counters.
+ * @return `true` when every command arrived in order and every future resolved.
+ */
+bool submissionQueue(const Command& cmd, QString& msg)
+{
+    // Expect: queue [-producers N] [-count N]
+    int producers = 8;
+    int count = 100000;
+    const struct { const char* key; int* value; } options[] = { { "producers", &producers }, { "count", &count } };
+    for (const auto& option : options) {
+        if (!cmd.args.contains(option.key)) continue;
+        bool ok = false;
+        *option.value = cmd.args[option.key].toInt(&ok);
+        if (!ok || *option.value < 1) {
+            msg = QString("-%1 must be a positive integer.").arg(option.key);
+            return false;
+        }
+    }
+    if (producers > 256) {
+        msg = "-producers must not exceed 256.";
+        return false;
+    }
+
+    CommandQueue queue(1024);
+    std::vector<int> expected(producers, 0);
+    std::atomic<int> unresolved{0};
+    int violations = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    std::vector<std::thread> threads;
+    threads.reserve(producers);
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&queue, &unresolved, p, count]() {
+            std::future<CommandResult> last;
+            for (int i = 0; i < count; ++i) {
+                if (i % 4 == 3) {
+                    last = queue.submit(QString("bench -producer %1 -seq %2").arg(p).arg(i));
+                    continue;
+                }
+                Command c;
+                c.name = "bench";
+                c.args.insert("producer", QString::number(p));
+                c.args.insert("seq", QString::number(i));
+                // Spin on refusal to exercise the non-blocking path under backpressure
+                while (!queue.trySubmit(c, &last)) std::this_thread::yield();
+            }
+            if (!last.get().ok) unresolved.fetch_add(1);
+        });
+    }
+
+    const qint64 total = qint64(producers) * count;
+    qint64 drained = 0;
+    while (drained < total) {
+        const int done = queue.drain(kDrainBatch, [&expected, &violations](const Command& c) {
+            const int p = c.args.value("producer").toInt();
+            if (c.args.value("seq").toInt() != expected[p]++) ++violations;
+            return CommandResult{ true, QString() };
+        });
+        if (done == 0) std::this_thread::yield();
+        drained += done;
+    }
+    for (auto& t : threads) t.join();
+    const double seconds = std::max<qint64>(1, timer.nsecsElapsed()) / 1e9;
+
+    const CommandQueue::Metrics m = queue.metrics();
+    msg = QString("Queue stress: %1 producers x %2 commands, %3 M commands/s; %4 ordering violations, "
+                  "%5 unresolved futures; peak depth %6/%7, %8 refusals, %9 drain batches.")
+              .arg(producers).arg(count)
+              .arg(total / seconds / 1e6, 0, 'f', 2)
+              .arg(violations).arg(unresolved.load())
+              .arg(m.peakDepth).arg(queue.capacity()).arg(m.rejected).arg(m.batches);
+    return violations == 0 && unresolved.load() == 0;
+}
+
+/**
+ * @brief Runs the `server` benchmark, a loopback benchmark of the socket protocol.
+ *
+ * A private server with a no-op executor runs on its own thread while client threads
+ * pipeline numbered commands, keeping up to `-window` unacknowledged, and time each reply.
+ * The scene is not touched, so the figures cover transport, parsing and acknowledgement.
+ * @param cmd Parsed command with optional `-clients` (default 4), `-count` per client
+ *            (default 100,000) and `-window` (default 256).
+ * @param msg Sustained throughput, latency percentiles and ordering violations.
+ * @return `true` when every client received every reply in order.
+ */
+bool socketServer(const Command& cmd, QString& msg)
+{
+    // Expect: server [-clients N] [-count N] [-window N]
+    int clients = 4;
+    int count = 100000;
+    int window = 256;
+    const struct { const char* key; int* value; } options[] = {
+        { "clients", &clients }, { "count", &count }, { "window", &window } };
+    for (const auto& option : options) {
+        if (!cmd.args.contains(option.key)) continue;
+        bool ok = false;
+        *option.value = cmd.args[option.key].toInt(&ok);
+        if (!ok || *option.value < 1) {
+            msg = QString("-%1 must be a positive integer.").arg(option.key);
+            return false;
+        }
+    }
+    if (clients > 64) {
+        msg = "-clients must not exceed 64.";
+        return false;
+    }
+
+    QThread serverThread;
+    serverThread.start();
+    auto* server = new CommandServer([](const Command&) { return CommandResult{ true, QString("ok") }; });
+    server->moveToThread(&serverThread);
+    const QString name = QString("objectdrawer-bench-%1").arg(QCoreApplication::applicationPid());
+    bool listening = false;
+    QMetaObject::invokeMethod(server, [&]() { listening = server->listen(name, msg); },
+                              Qt::BlockingQueuedConnection);
+
+    std::vector<std::vector<qint64>> latencies(clients);
+    std::atomic<int> violations{0};
+    std::atomic<int> broken{0};
+    QElapsedTimer clock;
+    clock.start();
+    if (listening) {
+        std::vector<std::thread> threads;
+        threads.reserve(clients);
+        for (int c = 0; c < clients; ++c) {
+            threads.emplace_back([&, c]() {
+                QLocalSocket socket;
+                socket.connectToServer(name);
+                if (!socket.waitForConnected(5000)) {
+                    broken.fetch_add(1);
+                    return;
+                }
+                std::vector<qint64> sentAt(count);
+                std::vector<qint64>& observed = latencies[c];
+                observed.reserve(count);
+                int sent = 0;
+                int acked = 0;
+                while (acked < count) {
+                    // Keep the pipeline full, then block for replies
+                    QByteArray batch;
+                    while (sent < count && sent - acked < window) {
+                        batch += "bench -client " + QByteArray::number(c) + " -seq " + QByteArray::number(sent) + '\n';
+                        sentAt[sent++] = clock.nsecsElapsed();
+                    }
+                    if (!batch.isEmpty()) socket.write(batch);
+                    socket.flush();
+                    if (!socket.canReadLine() && !socket.waitForReadyRead(5000)) {
+                        broken.fetch_add(1);
+                        return;
+                    }
+                    while (socket.canReadLine()) {
+                        const QByteArray reply = socket.readLine();
+                        if (reply.left(reply.indexOf(' ')).toLongLong() != acked + 1) violations.fetch_add(1);
+                        observed.push_back(clock.nsecsElapsed() - sentAt[acked]);
+                        if (++acked == count) break;
+                    }
+                }
+                socket.disconnectFromServer();
+            });
+        }
+        for (auto& t : threads) t.join();
+    }
+    const double seconds = std::max<qint64>(1, clock.nsecsElapsed()) / 1e9;
+
+    // Sockets and the server must be destroyed on the thread that owns them
+    QMetaObject::invokeMethod(server, [server]() { delete server; }, Qt::BlockingQueuedConnection);
+    serverThread.quit();
+    serverThread.wait();
+    if (!listening) return false;
+
+    std::vector<qint64> all;
+    for (const auto& l : latencies) all.insert(all.end(), l.begin(), l.end());
+    if (all.empty()) {
+        msg = "Server benchmark failed: no client could connect.";
+        return false;
+    }
+    const auto percentile = [&all](double p) {
+        const size_t k = std::min(all.size() - 1, static_cast<size_t>(p * all.size()));
+        std::nth_element(all.begin(), all.begin() + k, all.end());
+        return QString::number(all[k] / 1e6, 'f', 3);
+    };
+    const QString p50 = percentile(0.50);
+    const QString p95 = percentile(0.95);
+    const QString p99 = percentile(0.99);
+    const QString worst = percentile(1.0);
+    msg = QString("Server loopback: %1 clients x %2 commands, window %3: %4 commands/s; "
+                  "latency p50 %5 ms, p95 %6 ms, p99 %7 ms, max %8 ms; %9 ordering violations, %10 broken clients.")
+              .arg(clients).arg(count).arg(window)
+              .arg(qint64(all.size() / seconds))
+              .arg(p50, p95, p99, worst)
+              .arg(violations.load()).arg(broken.load());
+    return violations.load() == 0 && broken.load() == 0;
+}
+
+/**
+ * @brief Routes a benchmark command by name.
+ */
+/**
+ * @brief Runs the `roundtrip` check: save a scene, replay the script into an empty scene, save again.
+ *
+ * The scene mixes ordinary shapes with fractional coordinates, single and batched
+ * connections and a grid of instances. The replayed scene must have as many shapes and
+ * connections as the original, and its save must match the first one line for line.
+ */
+bool roundTrip(const Command& cmd, QString& msg)
+{
+    bool ok = true;
+    const int count = cmd.args.value("count", "10000").toInt(&ok);
+    if (!ok || count < 2) {
+        msg = "-count must be an integer of at least 2.";
+        return false;
+    }
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        msg = "Failed to create a temporary directory.";
+        return false;
+    }
+    const QString first = dir.filePath("first.txt"), second = dir.filePath("second.txt");
+
+    QGraphicsScene scene;
+    ShapeRepository repo;
+    CommandDispatcher dispatcher(&scene, &repo);
+    QStringList lines, chain;
+    for (int i = 0; i < count; ++i) {
+        const double x = i * 10.1, y = (i % 7) / 3.0;
+        lines << QString("create_triangle -name tri_%1 -coord_1 {%2,%3} -coord_2 {%4,%3} -coord_3 {%2,%5}")
+                     .arg(i).arg(x, 0, 'g', 17).arg(y, 0, 'g', 17).arg(x + 3.3, 0, 'g', 17).arg(y + 4.7, 0, 'g', 17);
+        chain << QString("tri_%1").arg(i);
+    }
+    lines << "connect -object_name_1 tri_0 -object_name_2 tri_1"
+          << "connect_chain -names " + chain.join(',')
+          << QString("create_grid -prototype tri_0 -name cell -rows 10 -cols %1 -spacing {4.25,6.5} -offset {0,20}")
+                 .arg((count + 9) / 10)
+          << "connect -object_name_1 cell_0_0 -object_name_2 tri_1";
+    if (!runLines(dispatcher, lines, msg)) return false;
+
+    QString error;
+    QElapsedTimer timer;
+    timer.start();
+    if (!SceneSaver::write(repo.snapshot(), first, error)) {
+        msg = error;
+        return false;
+    }
+    const qint64 saveMs = timer.restart();
+
+    QGraphicsScene replayScene;
+    ShapeRepository replay;
+    CommandDispatcher replayDispatcher(&replayScene, &replay);
+    if (!runLines(replayDispatcher, { "execute_file -file_path " + first }, msg)) return false;
+    const qint64 loadMs = timer.elapsed();
+    if (!SceneSaver::write(replay.snapshot(), second, error)) {
+        msg = error;
+        return false;
+    }
+
+    const bool sameShapes = replay.size() == repo.size();
+    const bool sameConnections = replay.connections().size() == repo.connections().size();
+    const bool sameScript = savedBody(first) == savedBody(second);
+    msg = QString("Round trip of %1 shapes and %2 connections: saved in %3 ms, replayed in %4 ms; "
+                  "shapes %5, connections %6, re-saved script %7.")
+              .arg(repo.size()).arg(repo.connections().size()).arg(saveMs).arg(loadMs)
+              .arg(sameShapes ? "match" : QString("differ (%1)").arg(replay.size()))
+              .arg(sameConnections ? "match" : QString("differ (%1)").arg(replay.connections().size()))
+              .arg(sameScript ? "matches" : "differs");
+    return sameShapes && sameConnections && sameScript;
+}
+
+bool run(const Command& cmd, QString& msg)
+{
+    if (cmd.name == "geometry") return geometry(cmd, msg);
+    if (cmd.name == "shapes") return shapes(cmd, msg);
+    if (cmd.name == "queue") return submissionQueue(cmd, msg);
+    if (cmd.name == "server") return socketServer(cmd, msg);
+    if (cmd.name == "roundtrip") return roundTrip(cmd, msg);
+    msg = QString("Unknown benchmark '%1'. Expected geometry, shapes, queue, server or roundtrip.").arg(cmd.name);
+    return false;
+}
+
+} // namespace Benchmarks
@@ -0,0 +1,67 @@
+/**
+ * @file Benchmarks.h
+ * @brief Declares the micro-benchmarks run by `ObjectDrawerBench`, kept out of the application.
+ * @author Nikol Grigoryan
+ */
+#pragma once
+
+#include <QString>
+#include "CommandParser.h"
+
+/**
+ * @namespace Benchmarks
+ * @brief Timed stress runs of the geometry kernels, shape models, submission queue and socket server,
+ *        and a save/replay round-trip check of the scene script.
+ *
+ * Each benchmark takes its options as a parsed command, e.g. `geometry -count 1000000`,
+ * and reports its figures in @p msg. Only `roundtrip` builds a scene.
+ */
+namespace Benchmarks {
+
+/**
+ * @brief Times every batch validation kernel at each SIMD level the CPU supports.
+ * @param cmd Optional `-count` (default 1,000,000).
+ * @param msg Per-core throughput per kernel and level.
+ * @return `true` when `-count` is valid.
+ */
+bool geometry(const Command& cmd, QString& msg);
+
+/**
+ * @brief Compares center and bounds passes over `ShapeBase` objects and a `ShapeTable`.
+ * @param cmd Optional `-count` (default 100,000).
+ * @param msg Nanoseconds per shape for each pass and model.
+ * @return `true` on success.
+ */
+bool shapes(const Command& cmd, QString& msg);
+
+/**
+ * @brief Floods a small private `CommandQueue` from producer threads and checks ordering.
+ * @param cmd Optional `-producers` (default 8) and `-count` per producer (default 100,000).
+ * @param msg Throughput, ordering violations and queue counters.
+ * @return `true` when every command arrived in order.
+ */
+bool submissionQueue(const Command& cmd, QString& msg);
+
+/**
+ * @brief Pipelines commands through a loopback `CommandServer` with a no-op executor.
+ * @param cmd Optional `-clients` (default 4), `-count` per client (default 100,000) and `-window` (default 256).
+ * @param msg Sustained throughput, latency percentiles and ordering violations.
+ * @return `true` when every client received every reply in order.
+ */
+bool socketServer(const Command& cmd, QString& msg);
+
+/**
+ * @brief Saves a scene of shapes, connections and instances, replays it and compares.
+ * @param cmd Optional `-count` of ordinary shapes (default 10,000).
+ * @param msg Save and replay times and whether shapes, connections and the re-saved script match.
+ * @return `true` when the replayed scene matches the original.
+ */
+bool roundTrip(const Command& cmd, QString& msg);
+
+/**
+ * @brief Runs the benchmark named by the command: `geometry`, `shapes`, `queue`, `server` or `roundtrip`.
+ * @return `false` for an unknown name or a failed benchmark.
+ */
+bool run(const Command& cmd, QString& msg);
+
+} // namespace Benchmarks
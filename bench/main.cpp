@@ -0,0 +1,46 @@
+/**
+ * @file main.cpp
+ * @brief Entry point of `ObjectDrawerBench`, which runs the benchmarks outside the application.
+ * @author Nikol Grigoryan
+ */
+#include "Benchmarks.h"
+
+#include <QApplication>
+#include <QStringList>
+#include <cstdio>
+
+/**
+ * @brief Runs one benchmark given on the command line, or all of them with their defaults.
+ *
+ *     ObjectDrawerBench geometry -count 1000000
+ *     ObjectDrawerBench server -clients 4 -count 100000 -window 256
+ *
+ * Shapes create graphics items, so a `QApplication` is needed; it uses the offscreen
+ * platform unless another one is chosen.
+ * @param argc Argument count.
+ * @param argv Benchmark name and flags.
+ * @return 0 when every benchmark run succeeded, 1 otherwise.
+ */
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication a(argc, argv);
+
+    QStringList lines;
+    const QStringList args = a.arguments().mid(1);
+    if (args.isEmpty()) {
+        lines << "geometry" << "shapes" << "queue" << "server" << "roundtrip";
+    } else {
+        lines << args.join(' ');
+    }
+
+    bool ok = true;
+    for (const QString& line : lines) {
+        Command cmd;
+        QString msg;
+        const bool passed = CommandParser().parse(line, cmd, msg) && Benchmarks::run(cmd, msg);
+        std::fprintf(passed ? stdout : stderr, "%s\n", qPrintable(msg));
+        ok = ok && passed;
+    }
+    return ok ? 0 : 1;
+}
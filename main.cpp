@@ -4,19 +4,62 @@
  * @author Nikol Grigoryan
  */
 #include "mainwindow.h"
+#include "StreamSession.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <cstdio>
+#include <cstring>
 
 /**
- * @brief Creates the Qt application and launches the main window.
+ * @brief Creates the Qt application and launches the main window, or a headless stdin session.
+ *
+ * `--stdin` executes commands streamed on standard input as they arrive; with `--headless`
+ * no window is shown and the application exits at end of input. `--export PATH` writes
+ * the scene once the input is exhausted.
  * @param argc Argument count.
  * @param argv Argument values.
  * @return Qt event loop exit code.
  */
 int main(int argc, char *argv[])
 {
+    // A headless run must not need a display, which is decided before the application exists
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--headless") == 0 && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        }
+    }
+
     QApplication a(argc, argv);
+
+    QCommandLineParser options;
+    options.setApplicationDescription("Draws shapes from typed, scripted or streamed commands.");
+    options.addHelpOption();
+    const QCommandLineOption stdinOption("stdin", "Execute commands read from standard input as they arrive.");
+    const QCommandLineOption headlessOption("headless", "Run without a window; requires --stdin and exits at end of input.");
+    const QCommandLineOption exportOption("export", "Export the scene to <path> at end of input (image for .png/.jpg/.bmp, "
+                                                    "command script otherwise).", "path");
+    const QCommandLineOption memStatsOption("mem-stats", "With --headless, print the mem_stats report to stderr at end of input.");
+    options.addOptions({ stdinOption, headlessOption, exportOption, memStatsOption });
+    options.process(a);
+
+    const QString exportPath = options.value(exportOption);
+    if (options.isSet(headlessOption)) {
+        if (!options.isSet(stdinOption)) {
+            std::fprintf(stderr, "--headless requires --stdin.\n");
+            return 2;
+        }
+        QGraphicsScene scene;
+        ShapeRepository repo;
+        CommandDispatcher dispatcher(&scene, &repo);
+        StreamSession session(dispatcher, &scene, repo, exportPath, true);
+        session.setMemoryReport(options.isSet(memStatsOption));
+        session.start();
+        return a.exec();
+    }
+
     MainWindow w;
     w.show();
+    if (options.isSet(stdinOption)) w.startStdinSession(exportPath);
     return a.exec();
 }
@@ -49,6 +49,17 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
+/**
+ * @brief Starts a stdin session on the window's dispatcher; progress and errors go to stderr.
+ * @param exportPath Where to export the scene at end of input; empty for no export.
+ */
+void MainWindow::startStdinSession(const QString& exportPath)
+{
+    m_stdinSession = std::make_unique<StreamSession>(m_dispatcher, m_scene, m_repo, exportPath, false);
+    m_stdinSession->start();
+    logInfo("Executing commands from standard input.");
+}
+
 /**
  * @brief Binds UI signals to the appropriate slots.
  */
@@ -57,10 +68,60 @@ void MainWindow::setupConnections()
     // When user presses Enter in the command line, handle the command
     connect(ui->commandEdit, &QLineEdit::returnPressed,
             this, &MainWindow::onCommandEntered);
+
+    // Poll background saves without blocking the GUI thread
+    connect(&m_backgroundTimer, &QTimer::timeout,
+            this, &MainWindow::onBackgroundTick);
+    m_backgroundTimer.start(250);
+
+    // Commands submitted from other threads are executed here, in batches, on the GUI thread
+    m_dispatcher.queue().setWakeCallback([this]() {
+        QMetaObject::invokeMethod(this, "onSubmissionsReady", Qt::QueuedConnection);
+    });
+
+    // Console commands and background scripts run in slices between event-loop turns
+    m_dispatcher.scheduler().setWakeCallback([this]() {
+        QMetaObject::invokeMethod(this, "onSchedulerSlice", Qt::QueuedConnection);
+    });
+}
+
+/**
+ * @brief Runs one scheduler slice; the scheduler requests the next one itself while work remains.
+ */
+void MainWindow::onSchedulerSlice()
+{
+    m_dispatcher.scheduler().runSlice();
 }
 
 /**
- * @brief Reads the text from the command input, parses it, and executes it.
+ * @brief Drains one batch of queued submissions and schedules another if work remains.
+ *
+ * Yielding to the event loop between batches keeps the window responsive under a flood
+ * of submissions.
+ */
+void MainWindow::onSubmissionsReady()
+{
+    const bool more = m_dispatcher.drainQueue(CommandDispatcher::kDrainBatch,
+                                              [this](const Command&, const CommandResult& result) {
+        if (result.ok) logInfo(result.text()); else logError(result.text());
+    });
+    if (more) QMetaObject::invokeMethod(this, "onSubmissionsReady", Qt::QueuedConnection);
+}
+
+/**
+ * @brief Lets the dispatcher start due autosaves and logs finished saves.
+ */
+void MainWindow::onBackgroundTick()
+{
+    bool ok = false;
+    QString msg;
+    if (m_dispatcher.serviceBackgroundTasks(ok, msg)) {
+        if (ok) logInfo(msg); else logError(msg);
+    }
+}
+
+/**
+ * @brief Reads the text from the command input, parses it, and schedules it for execution.
  */
 void MainWindow::onCommandEntered()
 {
@@ -81,16 +142,17 @@ void MainWindow::onCommandEntered()
         return;
     }
 
-    // Dispatch the command to perform the requested action
-    QString execMsg;
-    if (m_dispatcher.execute(cmd, execMsg)) {
-        // Success path: log positive feedback
-        logInfo(execMsg);
-        ui->commandEdit->clear();
-    } else {
-        // Failure path: log meaningful error
-        logError(execMsg);
-    }
+    // Schedule the command ahead of any running script; the result is logged when it runs
+    m_dispatcher.submit(cmd, [this, raw](const CommandResult& result) {
+        if (!result.ok) {
+            // Failure path: log meaningful error
+            logError(result.text());
+            return;
+        }
+        // Success path: log positive feedback, keeping anything typed since
+        logInfo(result.text());
+        if (ui->commandEdit->text().trimmed() == raw) ui->commandEdit->clear();
+    });
 }
 
 /**
@@ -98,7 +160,20 @@ void MainWindow::onCommandEntered()
  */
 void MainWindow::initializeUi()
 {
-   m_log = ui->logWindow;
+    m_log = ui->logWindow;
+    m_log->setModel(&m_logModel);
+
+    // Follow new lines only while the view is scrolled to the bottom
+    connect(&m_logModel, &QAbstractItemModel::rowsAboutToBeInserted, this, [this]() {
+        m_followLog = m_log->verticalScrollBar()->value() == m_log->verticalScrollBar()->maximum();
+    });
+    connect(&m_logModel, &QAbstractItemModel::rowsInserted, this, [this]() {
+        if (m_followLog) m_log->scrollToBottom();
+    });
+    connect(ui->logFilter, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index) {
+        m_logModel.setFilter(static_cast<LogModel::Filter>(index));
+        m_log->scrollToBottom();
+    });
 
     if (ui->actionExit) {
         connect(ui->actionExit, &QAction::triggered, this, &QWidget::close);
@@ -111,8 +186,8 @@ void MainWindow::initializeUi()
  */
 void MainWindow::logError(const QString& msg)
 {
-    // Append error message to the log window with a simple prefix
-    m_log->append(QString("[ERROR] %1").arg(msg));
+    // The model adds the prefix and shows the line with the next batch
+    m_logModel.append(LogModel::Level::Error, msg);
 }
 
 /**
@@ -121,6 +196,6 @@ void MainWindow::logError(const QString& msg)
  */
 void MainWindow::logInfo(const QString& msg)
 {
-    // Append informational message to the log window with a simple prefix
-    m_log->append(QString("[INFO] %1").arg(msg));
+    // The model adds the prefix and shows the line with the next batch
+    m_logModel.append(LogModel::Level::Info, msg);
 }
@@ -11,12 +11,16 @@
 #include <QGraphicsView>
 #include <QGraphicsScene>
 #include <QLineEdit>
-#include <QTextEdit>
+#include <QListView>
 #include <QSplitter>
 #include <QVBoxLayout>
+#include <QTimer>
 #include "CommandParser.h"
 #include "CommandDispatcher.h"
 #include "ShapeRepository.h"
+#include "StreamSession.h"
+#include "LogModel.h"
+#include <memory>
 
 
 class QGraphicsScene;
@@ -49,11 +53,29 @@ public:
      */
     ~MainWindow();
 
+    /**
+     * @brief Starts executing commands streamed on standard input alongside the console.
+     * @param exportPath Where to export the scene at end of input; empty for no export.
+     */
+    void startStdinSession(const QString& exportPath);
+
 private slots:
     /**
      * @brief Handles the Enter key event from the command input field.
      */
     void onCommandEntered();
+    /**
+     * @brief Periodically lets the dispatcher run autosaves and reports finished saves.
+     */
+    void onBackgroundTick();
+    /**
+     * @brief Executes a batch of commands submitted through the dispatcher's queue and logs them.
+     */
+    void onSubmissionsReady();
+    /**
+     * @brief Runs pending console commands, then a time-boxed slice of any background script.
+     */
+    void onSchedulerSlice();
     //void handleCommandResult(const CommandResult &result);
 
 
@@ -76,12 +98,16 @@ private:
     // UI components
     QGraphicsView* m_view;
     //QLineEdit* m_commandEdit;
-    QTextEdit* m_log;
+    QListView* m_log;
+    LogModel m_logModel;
+    bool m_followLog = true;
+    QTimer m_backgroundTimer;
 
     // Collaboration components
     ShapeRepository m_repo;
     CommandParser m_parser;
     CommandDispatcher m_dispatcher;
+    std::unique_ptr<StreamSession> m_stdinSession;
 
     // Helpers
     /**